@@ -0,0 +1,329 @@
+/** @file
+  Non-blocking requests of the Block I/O 2 protocol of the IDE hard disks.
+
+  The UDMA reads and writes issued with an event are queued on the channel of
+  the device. The first request of each queue has its command running on the
+  channel, and a periodic timer polls the bus master status of the channels, so
+  the primary and secondary channels transfer data at the same time while the
+  caller goes on. The other requests are completed before the Block I/O 2
+  functions return.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "IdeBus.h"
+
+/**
+  Advance the request at the head of the queue of a channel: check the end of
+  its command in progress, and start the next command of the request.
+
+  @param  Request  The non-blocking request
+
+  @retval EFI_NOT_READY     A command of the request is in progress.
+  @retval EFI_SUCCESS       All the blocks of the request are transferred.
+  @retval EFI_DEVICE_ERROR  The request failed. The device is reset by AtaSoftReset().
+
+**/
+EFI_STATUS
+IdeAsyncRunRequest (
+  IN IDE_ASYNC_REQUEST  *Request
+  )
+{
+  EFI_STATUS      Status;
+  IDE_BLK_IO_DEV  *IdeDev;
+
+  IdeDev = Request->IdeDev;
+
+  if (Request->CommandStarted) {
+    Status = AtaUdmaCheckCommand (IdeDev);
+    if (Status == EFI_NOT_READY) {
+      if (Request->Timeout > 0) {
+        Request->Timeout--;
+        return EFI_NOT_READY;
+      }
+      Status = EFI_DEVICE_ERROR;
+    }
+
+    AtaUdmaEndCommand (IdeDev, Request->Map);
+    Request->CommandStarted = FALSE;
+    if (EFI_ERROR (Status)) {
+      AtaSoftReset (IdeDev);
+      return EFI_DEVICE_ERROR;
+    }
+
+    Request->Buffer         += Request->CommandBlocks * IdeDev->BlkIo.Media->BlockSize;
+    Request->Lba            += Request->CommandBlocks;
+    Request->NumberOfBlocks -= Request->CommandBlocks;
+  }
+
+  if (Request->NumberOfBlocks == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = AtaUdmaStartCommand (
+             IdeDev,
+             Request->Buffer,
+             Request->Lba,
+             Request->NumberOfBlocks,
+             Request->UdmaOp,
+             &Request->CommandBlocks,
+             &Request->Map
+             );
+  if (EFI_ERROR (Status)) {
+    AtaSoftReset (IdeDev);
+    return EFI_DEVICE_ERROR;
+  }
+
+  Request->CommandStarted = TRUE;
+  Request->Timeout        = IDE_ASYNC_UDMA_TIMEOUT;
+  return EFI_NOT_READY;
+}
+
+/**
+  Advance the queue of a channel. The finished requests are removed from the
+  queue and their event is signaled, until a request has a command in progress.
+
+  @param  IdeBusDriverPrivateData  The private data of the IDE controller
+  @param  Channel                  The channel
+
+**/
+VOID
+IdeAsyncProcessChannel (
+  IN IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData,
+  IN UINTN                        Channel
+  )
+{
+  EFI_STATUS         Status;
+  LIST_ENTRY         *Queue;
+  IDE_ASYNC_REQUEST  *Request;
+
+  Queue = &IdeBusDriverPrivateData->AsyncQueue[Channel];
+
+  while (!IsListEmpty (Queue)) {
+    Request = IDE_ASYNC_REQUEST_FROM_LINK (GetFirstNode (Queue));
+
+    Status = IdeAsyncRunRequest (Request);
+    if (Status == EFI_NOT_READY) {
+      return;
+    }
+
+    RemoveEntryList (&Request->Link);
+    Request->Token->TransactionStatus = Status;
+    gBS->SignalEvent (Request->Token->Event);
+    FreePool (Request);
+  }
+}
+
+/**
+  Poll the non-blocking requests of the channels of an IDE controller. The timer
+  is stopped when no request is left.
+
+  @param  Event    The periodic timer
+  @param  Context  Event handler private data, the private data of the IDE controller
+
+**/
+VOID
+EFIAPI
+IdeAsyncOnTimer (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData;
+  UINTN                        Channel;
+  BOOLEAN                      Idle;
+
+  IdeBusDriverPrivateData = (IDE_BUS_DRIVER_PRIVATE_DATA *) Context;
+
+  Idle = TRUE;
+  for (Channel = 0; Channel < MAX_IDE_CHANNELS; Channel++) {
+    IdeAsyncProcessChannel (IdeBusDriverPrivateData, Channel);
+    if (!IsListEmpty (&IdeBusDriverPrivateData->AsyncQueue[Channel])) {
+      Idle = FALSE;
+    }
+  }
+
+  if (Idle) {
+    gBS->SetTimer (Event, TimerCancel, 0);
+  }
+}
+
+/**
+  Initialize the queues of the non-blocking requests of an IDE controller, and
+  create the timer polling them.
+
+  @param  IdeBusDriverPrivateData  The private data of the IDE controller
+
+  @retval EFI_SUCCESS  The queues are ready.
+  @retval other        The timer could not be created.
+
+**/
+EFI_STATUS
+IdeAsyncInit (
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData
+  )
+{
+  UINTN  Channel;
+
+  for (Channel = 0; Channel < MAX_IDE_CHANNELS; Channel++) {
+    InitializeListHead (&IdeBusDriverPrivateData->AsyncQueue[Channel]);
+  }
+
+  return gBS->CreateEvent (
+                EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                TPL_CALLBACK,
+                IdeAsyncOnTimer,
+                IdeBusDriverPrivateData,
+                &IdeBusDriverPrivateData->AsyncTimerEvent
+                );
+}
+
+/**
+  Close the timer polling the non-blocking requests of an IDE controller. The
+  queues must be empty.
+
+  @param  IdeBusDriverPrivateData  The private data of the IDE controller
+
+**/
+VOID
+IdeAsyncFree (
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData
+  )
+{
+  if (IdeBusDriverPrivateData->AsyncTimerEvent != NULL) {
+    gBS->CloseEvent (IdeBusDriverPrivateData->AsyncTimerEvent);
+    IdeBusDriverPrivateData->AsyncTimerEvent = NULL;
+  }
+}
+
+/**
+  Queue a non-blocking UDMA read or write of an ATA device, and start it if the
+  channel is idle. The request does not go through the block cache: the modified
+  lines it reads are written onto the disk first, and the lines it writes are
+  dropped from the cache. Must be called at TPL_CALLBACK.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Write           TRUE to write the blocks, FALSE to read them
+  @param  Buffer          The buffer of the data
+  @param  Lba             The starting logical block address
+  @param  NumberOfBlocks  The number of blocks, not 0
+  @param  Token           The token of the request, with an event
+
+  @retval EFI_SUCCESS           The request is queued.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be allocated.
+  @retval EFI_DEVICE_ERROR      A modified line of the block cache could not be written.
+
+**/
+EFI_STATUS
+IdeAsyncSubmit (
+  IN IDE_BLK_IO_DEV       *IdeDev,
+  IN BOOLEAN              Write,
+  IN VOID                 *Buffer,
+  IN EFI_LBA              Lba,
+  IN UINTN                NumberOfBlocks,
+  IN EFI_BLOCK_IO2_TOKEN  *Token
+  )
+{
+  EFI_STATUS                   Status;
+  IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData;
+  IDE_ASYNC_REQUEST            *Request;
+  UINTN                        Channel;
+  BOOLEAN                      Idle;
+
+  IdeBusDriverPrivateData = IdeDev->IdeBusDriverPrivateData;
+
+  if (IdeDev->BlockCache.LineCount != 0) {
+    //
+    // Writing the modified lines needs the channel
+    //
+    if (IdeDev->BlockCache.DirtyCount != 0) {
+      IdeAsyncDrainChannel (IdeDev);
+    }
+
+    if (Write) {
+      Status = IdeBlockCacheInvalidateRange (IdeDev, Lba, NumberOfBlocks);
+    } else {
+      Status = IdeBlockCacheFlushRange (IdeDev, Lba, NumberOfBlocks);
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Request = AllocateZeroPool (sizeof (IDE_ASYNC_REQUEST));
+  if (Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Request->Signature      = IDE_ASYNC_REQUEST_SIGNATURE;
+  Request->IdeDev         = IdeDev;
+  Request->Token          = Token;
+  Request->Buffer         = (UINT8 *) Buffer;
+  Request->Lba            = Lba;
+  Request->NumberOfBlocks = NumberOfBlocks;
+  if (IdeDev->Type == Ide48bitAddressingHardDisk) {
+    Request->UdmaOp = Write ? AtaUdmaWriteExtOp : AtaUdmaReadExtOp;
+  } else {
+    Request->UdmaOp = Write ? AtaUdmaWriteOp : AtaUdmaReadOp;
+  }
+
+  Idle = TRUE;
+  for (Channel = 0; Channel < MAX_IDE_CHANNELS; Channel++) {
+    if (!IsListEmpty (&IdeBusDriverPrivateData->AsyncQueue[Channel])) {
+      Idle = FALSE;
+    }
+  }
+
+  if (Idle) {
+    Status = gBS->SetTimer (
+                    IdeBusDriverPrivateData->AsyncTimerEvent,
+                    TimerPeriodic,
+                    IDE_ASYNC_TIMER_PERIOD
+                    );
+    if (EFI_ERROR (Status)) {
+      FreePool (Request);
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  InsertTailList (&IdeBusDriverPrivateData->AsyncQueue[IdeDev->Channel], &Request->Link);
+
+  //
+  // Start the first command of the request now if the channel is idle
+  //
+  IdeAsyncProcessChannel (IdeBusDriverPrivateData, IdeDev->Channel);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Complete all the non-blocking requests queued on the channel of an IDE device,
+  before the channel is used by a blocking request. Must be called at TPL_CALLBACK
+  or above, so that the timer does not poll the queue at the same time.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+**/
+VOID
+IdeAsyncDrainChannel (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  )
+{
+  IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData;
+
+  IdeBusDriverPrivateData = IdeDev->IdeBusDriverPrivateData;
+
+  IdeAsyncProcessChannel (IdeBusDriverPrivateData, IdeDev->Channel);
+  while (!IsListEmpty (&IdeBusDriverPrivateData->AsyncQueue[IdeDev->Channel])) {
+    gBS->Stall (1000);
+    IdeAsyncProcessChannel (IdeBusDriverPrivateData, IdeDev->Channel);
+  }
+}
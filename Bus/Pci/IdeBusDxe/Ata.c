@@ -452,6 +452,167 @@ PrintAtaModuleName (
   IdeDev->ModelName[40] = 0x00;
 }
 
+/**
+  Get the size of the data block the device transfers for each DRQ assertion
+  of a PIO data command.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+  @param AtaCommand   value of the Command Register
+
+  @return the size in words of a DRQ data block, which is one sector except for
+          READ/WRITE MULTIPLE (EXT), where it is the block of sectors set by
+          SET MULTIPLE MODE.
+
+**/
+UINTN
+AtaPioDrqBlockWords (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINT8           AtaCommand
+  )
+{
+  if ((AtaCommand == ATA_CMD_READ_MULTIPLE)     ||
+      (AtaCommand == ATA_CMD_WRITE_MULTIPLE)    ||
+      (AtaCommand == ATA_CMD_READ_MULTIPLE_EXT) ||
+      (AtaCommand == ATA_CMD_WRITE_MULTIPLE_EXT)) {
+    return 256 * (UINTN) IdeDev->MultipleSectorCount;
+  }
+
+  return 256;
+}
+
+/**
+  Read a data block from the data register of the IDE device in PIO mode.
+  32-bit accesses are used when they are enabled for the device and the block
+  is a whole number of dwords; 16-bit accesses are used otherwise, and for the
+  following blocks if the 32-bit accesses fail.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+  @param WordCount    No. of UINT16's to read
+  @param Buffer       Pointer to the data buffer for read
+
+**/
+VOID
+AtaPioReadData (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINTN           WordCount,
+  OUT VOID            *Buffer
+  )
+{
+  EFI_STATUS  Status;
+
+  if (IdeDev->DataPort32Bit && ((WordCount & 0x1) == 0)) {
+    Status = IDEReadPortDMultiple (
+               IdeDev->PciIo,
+               IdeDev->IoPort->Data,
+               WordCount / 2,
+               Buffer
+               );
+    if (!EFI_ERROR (Status)) {
+      return;
+    }
+
+    if (Status != EFI_OUT_OF_RESOURCES) {
+      DEBUG ((EFI_D_BLKIO, "AtaPioReadData()-- 32-bit PIO is not supported: %r\n", Status));
+      IdeDev->DataPort32Bit = FALSE;
+    }
+  }
+
+  IDEReadPortWMultiple (
+    IdeDev->PciIo,
+    IdeDev->IoPort->Data,
+    WordCount,
+    Buffer
+    );
+}
+
+/**
+  Write a data block to the data register of the IDE device in PIO mode.
+  32-bit accesses are used when they are enabled for the device and the block
+  is a whole number of dwords; 16-bit accesses are used otherwise, and for the
+  following blocks if the 32-bit accesses fail.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+  @param WordCount    No. of UINT16's to write
+  @param Buffer       Pointer to the data buffer for write
+
+**/
+VOID
+AtaPioWriteData (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINTN           WordCount,
+  IN  VOID            *Buffer
+  )
+{
+  EFI_STATUS  Status;
+
+  if (IdeDev->DataPort32Bit && ((WordCount & 0x1) == 0)) {
+    Status = IDEWritePortDMultiple (
+               IdeDev->PciIo,
+               IdeDev->IoPort->Data,
+               WordCount / 2,
+               Buffer
+               );
+    if (!EFI_ERROR (Status)) {
+      return;
+    }
+
+    if (Status != EFI_OUT_OF_RESOURCES) {
+      DEBUG ((EFI_D_BLKIO, "AtaPioWriteData()-- 32-bit PIO is not supported: %r\n", Status));
+      IdeDev->DataPort32Bit = FALSE;
+    }
+  }
+
+  IDEWritePortWMultiple (
+    IdeDev->PciIo,
+    IdeDev->IoPort->Data,
+    WordCount,
+    Buffer
+    );
+}
+
+/**
+  Check if the device aborted the READ/WRITE MULTIPLE (EXT) command just sent,
+  which happens when it has lost the multiple mode set at initialization, and
+  disable the multiple mode for the device in that case. The caller can then
+  retry the transfer with the single sector commands.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+
+  @retval TRUE   The command was aborted and the multiple mode is disabled.
+  @retval FALSE  The command failed for another reason.
+
+**/
+BOOLEAN
+AtaMultipleModeAborted (
+  IN  IDE_BLK_IO_DEV  *IdeDev
+  )
+{
+  UINT8 StatusRegister;
+  UINT8 ErrorRegister;
+
+  if (IdeDev->MultipleSectorCount == 0) {
+    return FALSE;
+  }
+
+  StatusRegister = IDEReadPortB (IdeDev->PciIo, IdeDev->IoPort->Reg.Status);
+  if ((StatusRegister & ATA_STSREG_ERR) == 0) {
+    return FALSE;
+  }
+
+  ErrorRegister = IDEReadPortB (IdeDev->PciIo, IdeDev->IoPort->Reg1.Error);
+  if ((ErrorRegister & ATA_ERRREG_ABRT) == 0) {
+    return FALSE;
+  }
+
+  DEBUG ((EFI_D_BLKIO, "AtaMultipleModeAborted()-- multiple mode is disabled\n"));
+  IdeDev->MultipleSectorCount = 0;
+  return TRUE;
+}
+
 /**
   This function is used to send out ATA commands conforms to the PIO Data In Protocol.
 
@@ -549,12 +710,13 @@ AtaPioDataIn (
   // For ATA command such as Read Sector command, the data size of one ATA
   // command request is often larger than 1 sector, according to the
   // Read Sector command, the data size of "a series of read" is exactly 1
-  // sector.
+  // sector, and for Read Multiple command, it is the block of sectors set by
+  // Set Multiple Mode command.
   // Here for simplification reason, we specify the data size for
-  // "a series of read" to 1 sector (256 words) if data size of one ATA command
-  // request is larger than 256 words.
+  // "a series of read" to 1 DRQ data block if data size of one ATA command
+  // request is larger than that.
   //
-  Increment = 256;
+  Increment = AtaPioDrqBlockWords (IdeDev, AtaCommand);
 
   //
   // used to record bytes of currently transfered data
@@ -582,12 +744,7 @@ AtaPioDataIn (
       Increment = ByteCount / 2 - WordCount;
     }
 
-    IDEReadPortWMultiple (
-      IdeDev->PciIo,
-      IdeDev->IoPort->Data,
-      Increment,
-      Buffer16
-      );
+    AtaPioReadData (IdeDev, Increment, Buffer16);
 
     WordCount += Increment;
     Buffer16 += Increment;
@@ -697,12 +854,13 @@ AtaPioDataOut (
   // For ATA command such as Write Sector command, the data size of one
   // ATA command request is often larger than 1 sector, according to the
   // Write Sector command, the data size of "a series of read" is exactly
-  // 1 sector.
+  // 1 sector, and for Write Multiple command, it is the block of sectors set
+  // by Set Multiple Mode command.
   // Here for simplification reason, we specify the data size for
-  // "a series of write" to 1 sector (256 words) if data size of one ATA command
-  // request is larger than 256 words.
+  // "a series of write" to 1 DRQ data block if data size of one ATA command
+  // request is larger than that.
   //
-  Increment = 256;
+  Increment = AtaPioDrqBlockWords (IdeDev, AtaCommand);
   WordCount = 0;
 
   while (WordCount < ByteCount / 2) {
@@ -731,12 +889,7 @@ AtaPioDataOut (
     // perform a series of write without check DRQ ready
     //
 
-    IDEWritePortWMultiple (
-      IdeDev->PciIo,
-      IdeDev->IoPort->Data,
-      Increment,
-      Buffer16
-      );
+    AtaPioWriteData (IdeDev, Increment, Buffer16);
     WordCount += Increment;
     Buffer16 += Increment;
 
@@ -885,12 +1038,6 @@ AtaReadSectors (
 
   Buffer = DataBuffer;
 
-  //
-  // Using ATA Read Sector(s) command (opcode=0x20) with PIO DATA IN protocol
-  //
-  AtaCommand      = ATA_CMD_READ_SECTORS;
-
-
   BlocksRemaining = NumberOfBlocks;
 
   Lba32           = (UINT32) Lba;
@@ -932,6 +1079,17 @@ AtaReadSectors (
     //
     ByteCount = SectorCount * (IdeDev->BlkIo.Media->BlockSize);
 
+    //
+    // Using ATA Read Multiple command (opcode=0xC4) when the multiple mode is
+    // enabled, so that the device asserts DRQ once per block of sectors, or
+    // ATA Read Sector(s) command (opcode=0x20), both with PIO DATA IN protocol
+    //
+    if (IdeDev->MultipleSectorCount != 0) {
+      AtaCommand = ATA_CMD_READ_MULTIPLE;
+    } else {
+      AtaCommand = ATA_CMD_READ_SECTORS;
+    }
+
     //
     // call AtaPioDataIn() to send Read Sector Command and receive data read
     //
@@ -947,6 +1105,9 @@ AtaReadSectors (
               Lba2
               );
     if (EFI_ERROR (Status)) {
+      if ((AtaCommand == ATA_CMD_READ_MULTIPLE) && AtaMultipleModeAborted (IdeDev)) {
+        continue;
+      }
       return Status;
     }
 
@@ -994,11 +1155,6 @@ AtaWriteSectors (
 
   Buffer = BufferData;
 
-  //
-  // Using Write Sector(s) command (opcode=0x30) with PIO DATA OUT protocol
-  //
-  AtaCommand      = ATA_CMD_WRITE_SECTORS;
-
   BlocksRemaining = NumberOfBlocks;
 
   Lba32           = (UINT32) Lba;
@@ -1031,6 +1187,17 @@ AtaWriteSectors (
 
     ByteCount = SectorCount * (IdeDev->BlkIo.Media->BlockSize);
 
+    //
+    // Using Write Multiple command (opcode=0xC5) when the multiple mode is
+    // enabled, or Write Sector(s) command (opcode=0x30), both with PIO DATA
+    // OUT protocol
+    //
+    if (IdeDev->MultipleSectorCount != 0) {
+      AtaCommand = ATA_CMD_WRITE_MULTIPLE;
+    } else {
+      AtaCommand = ATA_CMD_WRITE_SECTORS;
+    }
+
     Status = AtaPioDataOut (
               IdeDev,
               Buffer,
@@ -1043,6 +1210,9 @@ AtaWriteSectors (
               Lba2
               );
     if (EFI_ERROR (Status)) {
+      if ((AtaCommand == ATA_CMD_WRITE_MULTIPLE) && AtaMultipleModeAborted (IdeDev)) {
+        continue;
+      }
       return Status;
     }
 
@@ -1236,9 +1406,9 @@ AtaPioDataInExt (
   //
 
   //
-  // 256 words
+  // 256 words, or the block of sectors of Read Multiple Ext command
   //
-  Increment = 256;
+  Increment = AtaPioDrqBlockWords (IdeDev, AtaCommand);
 
   //
   // used to record bytes of currently transfered data
@@ -1266,12 +1436,7 @@ AtaPioDataInExt (
       Increment = ByteCount / 2 - WordCount;
     }
 
-    IDEReadPortWMultiple (
-      IdeDev->PciIo,
-      IdeDev->IoPort->Data,
-      Increment,
-      Buffer16
-      );
+    AtaPioReadData (IdeDev, Increment, Buffer16);
 
     WordCount += Increment;
     Buffer16 += Increment;
@@ -1489,34 +1654,78 @@ AtaCommandIssue (
   return EFI_SUCCESS;
 }
 /**
-  Perform an ATA Udma operation (Read, ReadExt, Write, WriteExt).
+  Get the addresses of the bus master registers of the channel of an IDE device.
 
   @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
                         to record all the information of the IDE device.
-  @param DataBuffer     A pointer to the source buffer for the data.
-  @param StartLba       The starting logical block address to write to
-                        on the device media.
-  @param NumberOfBlocks The number of transfer data blocks.
+  @param IoPortForBmic  Returns the address of the Bus Master IDE Command register.
+  @param IoPortForBmis  Returns the address of the Bus Master IDE Status register.
+  @param IoPortForBmid  Returns the address of the Bus Master IDE Descriptor
+                        Table Pointer register.
+
+  @retval EFI_SUCCESS      The addresses are returned.
+  @retval EFI_UNSUPPORTED  Unknown channel.
+
+**/
+EFI_STATUS
+AtaUdmaGetBusMasterPorts (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  OUT UINT64          *IoPortForBmic,
+  OUT UINT64          *IoPortForBmis,
+  OUT UINT64          *IoPortForBmid
+  )
+{
+  if (IdePrimary == IdeDev->Channel) {
+    *IoPortForBmic = IdeDev->IoPort->BusMasterBaseAddr + BMICP_OFFSET;
+    *IoPortForBmis = IdeDev->IoPort->BusMasterBaseAddr + BMISP_OFFSET;
+    *IoPortForBmid = IdeDev->IoPort->BusMasterBaseAddr + BMIDP_OFFSET;
+  } else {
+    if (IdeSecondary == IdeDev->Channel) {
+      *IoPortForBmic = IdeDev->IoPort->BusMasterBaseAddr + BMICS_OFFSET;
+      *IoPortForBmis = IdeDev->IoPort->BusMasterBaseAddr + BMISS_OFFSET;
+      *IoPortForBmid = IdeDev->IoPort->BusMasterBaseAddr + BMIDS_OFFSET;
+    } else {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Start one ATA Udma command (Read, ReadExt, Write, WriteExt) on the channel of
+  an IDE device. The command transfers the first blocks of the request, as many
+  as one command and one mapping of the buffer allow. The caller polls the end
+  of the command with AtaUdmaCheckCommand(), then calls AtaUdmaEndCommand().
+
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
+  @param DataBuffer     A pointer to the source or destination buffer for the data.
+  @param StartLba       The starting logical block address of the request.
+  @param NumberOfBlocks The number of blocks of the request.
   @param UdmaOp         The perform operations could be AtaUdmaReadOp, AtaUdmaReadExOp,
                         AtaUdmaWriteOp, AtaUdmaWriteExOp
+  @param CommandBlocks  Returns the number of blocks transferred by the command.
+  @param Map            Returns the mapping of the data of the command.
 
-  @retval EFI_SUCCESS          the operation is successful.
+  @retval EFI_SUCCESS          the command is started.
   @retval EFI_OUT_OF_RESOURCES Build PRD table failed
   @retval EFI_UNSUPPORTED      Unknown channel or operations command
   @retval EFI_DEVICE_ERROR     Ata command execute failed
 
 **/
 EFI_STATUS
-DoAtaUdma (
+AtaUdmaStartCommand (
   IN  IDE_BLK_IO_DEV      *IdeDev,
   IN  VOID                *DataBuffer,
   IN  EFI_LBA             StartLba,
   IN  UINTN               NumberOfBlocks,
-  IN  ATA_UDMA_OPERATION  UdmaOp
+  IN  ATA_UDMA_OPERATION  UdmaOp,
+  OUT UINTN               *CommandBlocks,
+  OUT VOID                **Map
   )
 {
-  IDE_DMA_PRD                   *PrdAddr;
-  IDE_DMA_PRD                   *UsedPrdAddr;
+  IDE_PRD_TABLE                 *PrdTable;
   IDE_DMA_PRD                   *TempPrdAddr;
   UINT8                         RegisterValue;
   UINT8                         Device;
@@ -1524,16 +1733,12 @@ DoAtaUdma (
   UINT64                        IoPortForBmis;
   UINT64                        IoPortForBmid;
   EFI_STATUS                    Status;
-  UINTN                         PrdTableNum;
   UINTN                         ByteCount;
   UINTN                         ByteAvailable;
-  UINT8                         *PrdBuffer;
-  UINTN                         RemainBlockNum;
+  EFI_PHYSICAL_ADDRESS          PrdBuffer;
   UINT8                         DeviceControl;
-  UINT32                        Count;
-  UINTN                         PageCount;
-  VOID                          *Map;
-  VOID                          *MemPage;
+  UINT32                        PrdTableAddr;
+  UINT32                        BlockSize;
   EFI_PHYSICAL_ADDRESS          DeviceAddress;
   UINTN                         MaxDmaCommandSectors;
   EFI_PCI_IO_PROTOCOL_OPERATION PciIoProtocolOp;
@@ -1565,6 +1770,30 @@ DoAtaUdma (
     break;
   }
 
+  Status = AtaUdmaGetBusMasterPorts (IdeDev, &IoPortForBmic, &IoPortForBmis, &IoPortForBmid);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // The PRD table of the channel is allocated once and reused by all the commands
+  //
+  PrdTable = &IdeDev->IdeBusDriverPrivateData->PrdTable[IdeDev->Channel];
+  if (PrdTable->Entry == NULL) {
+    Status = AllocateIdePrdTable (IdeDev->PciIo, PrdTable);
+    if (EFI_ERROR (Status)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  PrdTableAddr = (UINT32) PrdTable->DeviceAddress;
+
+  //
+  // A command is limited to the data the PRD table can describe, one entry
+  // being kept for a buffer which does not start on a 64K boundary.
+  //
+  BlockSize            = IdeDev->BlkIo.Media->BlockSize;
+  MaxDmaCommandSectors = MIN (MaxDmaCommandSectors, (IDE_PRD_TABLE_ENTRIES - 1) * SIZE_64KB / BlockSize);
+
   //
   // Select device
   //
@@ -1577,324 +1806,388 @@ DoAtaUdma (
   DeviceControl = 0;
   IDEWritePortB (IdeDev->PciIo, IdeDev->IoPort->Alt.DeviceControl, DeviceControl);
 
-  if (IdePrimary == IdeDev->Channel) {
-    IoPortForBmic = IdeDev->IoPort->BusMasterBaseAddr + BMICP_OFFSET;
-    IoPortForBmis = IdeDev->IoPort->BusMasterBaseAddr + BMISP_OFFSET;
-    IoPortForBmid = IdeDev->IoPort->BusMasterBaseAddr + BMIDP_OFFSET;
-  } else {
-    if (IdeSecondary == IdeDev->Channel) {
-      IoPortForBmic = IdeDev->IoPort->BusMasterBaseAddr + BMICS_OFFSET;
-      IoPortForBmis = IdeDev->IoPort->BusMasterBaseAddr + BMISS_OFFSET;
-      IoPortForBmid = IdeDev->IoPort->BusMasterBaseAddr + BMIDS_OFFSET;
-    } else {
-      return EFI_UNSUPPORTED;
-    }
-  }
-
   //
   // Read BMIS register and clear ERROR and INTR bit
   //
   IdeDev->PciIo->Io.Read (
-					  IdeDev->PciIo,
-					  EfiPciIoWidthUint8,
-					  EFI_PCI_IO_PASS_THROUGH_BAR,
-					  IoPortForBmis,
-					  1,
-					  &RegisterValue
-					  );
-  
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmis,
+                      1,
+                      &RegisterValue
+                      );
+
   RegisterValue |= (BMIS_INTERRUPT | BMIS_ERROR);
-  
+
   IdeDev->PciIo->Io.Write (
-					  IdeDev->PciIo,
-					  EfiPciIoWidthUint8,
-					  EFI_PCI_IO_PASS_THROUGH_BAR,
-					  IoPortForBmis,
-					  1,
-					  &RegisterValue
-					  );
-
-  Status = EFI_SUCCESS;
-  
-  RemainBlockNum = NumberOfBlocks;
-  while (RemainBlockNum > 0) {
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmis,
+                      1,
+                      &RegisterValue
+                      );
+
+  //
+  // Map the data of the whole command. The PRDs are built from the mapped
+  // range, which is the caller's buffer itself when the bus master can
+  // reach it.
+  //
+  NumberOfBlocks = MIN (NumberOfBlocks, MaxDmaCommandSectors);
+  ByteCount      = NumberOfBlocks * BlockSize;
+  Status = IdeDev->PciIo->Map (
+                     IdeDev->PciIo,
+                     PciIoProtocolOp,
+                     DataBuffer,
+                     &ByteCount,
+                     &DeviceAddress,
+                     Map
+                     );
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
 
-    if (RemainBlockNum >= MaxDmaCommandSectors) {
-      //
-      //  SectorCount is used to record the number of sectors to be read
-      //  Max 65536 sectors can be transfered at a time.
-      //
-      NumberOfBlocks = MaxDmaCommandSectors;
-      RemainBlockNum -= MaxDmaCommandSectors;
-    } else {
-      NumberOfBlocks  = (UINT16) RemainBlockNum;
-      RemainBlockNum  = 0;
-    }
+  //
+  // When less than the whole command could be mapped, only transfer the
+  // mapped blocks with this command.
+  //
+  NumberOfBlocks = ByteCount / BlockSize;
+  if (NumberOfBlocks == 0) {
+    IdeDev->PciIo->Unmap (IdeDev->PciIo, *Map);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ByteCount = NumberOfBlocks * BlockSize;
 
-    //
-    // Calculate the number of PRD table to make sure the memory region
-    // not cross 64K boundary
-    //
-    ByteCount   = NumberOfBlocks * IdeDev->BlkIo.Media->BlockSize;
-    PrdTableNum = ((ByteCount >> 16) + 1) + 1;
+  //
+  // Build the PRD table, no region crossing a 64K boundary. A ByteCount
+  // of 0 stands for 64K bytes.
+  //
+  PrdBuffer   = DeviceAddress;
+  TempPrdAddr = PrdTable->Entry;
+  while (TRUE) {
 
-    //
-    // Build PRD table
-    //
-    PageCount = EFI_SIZE_TO_PAGES (2 * PrdTableNum * sizeof (IDE_DMA_PRD));
-    Status = IdeDev->PciIo->AllocateBuffer (
-                    IdeDev->PciIo,
-                    AllocateAnyPages,
-                    EfiBootServicesData,
-                    PageCount,
-                    &MemPage,
-                    0
-                    );
-    if (EFI_ERROR (Status)) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-    ZeroMem ((VOID *) ((UINTN) MemPage), EFI_PAGES_TO_SIZE (PageCount));
+    ByteAvailable = 0x10000 - ((UINTN) PrdBuffer & 0xFFFF);
 
-    PrdAddr = (IDE_DMA_PRD *) ((UINTN) MemPage);
-    //
-    // To make sure PRD is allocated in one 64K page
-    //
-    if (((UINTN) PrdAddr & 0x0FFFF) > (((UINTN) PrdAddr + PrdTableNum * sizeof (IDE_DMA_PRD) - 1) & 0x0FFFF)) {
-      UsedPrdAddr = (IDE_DMA_PRD *) ((UINTN) ((UINT8 *) PrdAddr + 0x10000) & 0xFFFF0000);
-    } else {
-      if ((UINTN) PrdAddr & 0x03) {
-        UsedPrdAddr = (IDE_DMA_PRD *) ((UINTN) ((UINT8 *) PrdAddr + 0x04) & 0xFFFFFFFC);
-      } else {
-        UsedPrdAddr = PrdAddr;
-      }
+    if (ByteCount <= ByteAvailable) {
+      TempPrdAddr->RegionBaseAddr = (UINT32) PrdBuffer;
+      TempPrdAddr->ByteCount      = (UINT16) ByteCount;
+      TempPrdAddr->EndOfTable     = 0x8000;
+      break;
     }
 
-    //
-    // Build the PRD table
-    //
-    Status = IdeDev->PciIo->Map (
-                       IdeDev->PciIo,
-                       PciIoProtocolOp,
-                       DataBuffer,
-                       &ByteCount,
-                       &DeviceAddress,
-                       &Map
-                       );
-    if (EFI_ERROR (Status)) {
-      IdeDev->PciIo->FreeBuffer (IdeDev->PciIo, PageCount, MemPage);
-      return EFI_OUT_OF_RESOURCES;
-    }
-    PrdBuffer   = (VOID *) ((UINTN) DeviceAddress);
-    TempPrdAddr = UsedPrdAddr;
-    while (TRUE) {
+    TempPrdAddr->RegionBaseAddr = (UINT32) PrdBuffer;
+    TempPrdAddr->ByteCount      = (UINT16) ByteAvailable;
+    TempPrdAddr->EndOfTable     = 0;
 
-      ByteAvailable = 0x10000 - ((UINTN) PrdBuffer & 0xFFFF);
+    ByteCount -= ByteAvailable;
+    PrdBuffer += ByteAvailable;
+    TempPrdAddr++;
+  }
 
-      if (ByteCount <= ByteAvailable) {
-        TempPrdAddr->RegionBaseAddr = (UINT32) ((UINTN) PrdBuffer);
-        TempPrdAddr->ByteCount      = (UINT16) ByteCount;
-        TempPrdAddr->EndOfTable     = 0x8000;
-        break;
-      }
+  //
+  // Set the base address to BMID register
+  //
+  IdeDev->PciIo->Io.Write (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint32,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmid,
+                      1,
+                      &PrdTableAddr
+                      );
 
-      TempPrdAddr->RegionBaseAddr = (UINT32) ((UINTN) PrdBuffer);
-      TempPrdAddr->ByteCount      = (UINT16) ByteAvailable;
+  //
+  // Set BMIC register to identify the operation direction
+  //
+  IdeDev->PciIo->Io.Read (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmic,
+                      1,
+                      &RegisterValue
+                      );
+
+  if (UdmaOp == AtaUdmaReadExtOp || UdmaOp == AtaUdmaReadOp) {
+    RegisterValue |= BMIC_NREAD;
+  } else {
+    RegisterValue &= ~((UINT8) BMIC_NREAD);
+  }
 
-      ByteCount -= ByteAvailable;
-      PrdBuffer += ByteAvailable;
-      TempPrdAddr++;
-    }
+  IdeDev->PciIo->Io.Write (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmic,
+                      1,
+                      &RegisterValue
+                      );
+
+  if (UdmaOp == AtaUdmaWriteExtOp || UdmaOp == AtaUdmaReadExtOp) {
+    Status = AtaCommandIssueExt (
+               IdeDev,
+               AtaCommand,
+               Device,
+               0,
+               (UINT16) NumberOfBlocks,
+               StartLba
+               );
+  } else {
+    Status = AtaCommandIssue (
+               IdeDev,
+               AtaCommand,
+               Device,
+               0,
+               (UINT16) NumberOfBlocks,
+               StartLba
+               );
+  }
 
-    //
-    // Set the base address to BMID register
-    //
-    IdeDev->PciIo->Io.Write (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint32,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmid,
-                        1,
-                        &UsedPrdAddr
-                        );
+  if (EFI_ERROR (Status)) {
+    IdeDev->PciIo->Unmap (IdeDev->PciIo, *Map);
+    return EFI_DEVICE_ERROR;
+  }
 
-    //
-    // Set BMIC register to identify the operation direction
-    //
-    IdeDev->PciIo->Io.Read (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmic,
-                        1,
-                        &RegisterValue
-                        );
+  //
+  // Set START bit of BMIC register
+  //
+  IdeDev->PciIo->Io.Read (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmic,
+                      1,
+                      &RegisterValue
+                      );
 
-    if (UdmaOp == AtaUdmaReadExtOp || UdmaOp == AtaUdmaReadOp) {
-      RegisterValue |= BMIC_NREAD;
-    } else {
-      RegisterValue &= ~((UINT8) BMIC_NREAD);
-    }
+  RegisterValue |= BMIC_START;
 
-    IdeDev->PciIo->Io.Write (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmic,
-                        1,
-                        &RegisterValue
-                        );
-
-    if (UdmaOp == AtaUdmaWriteExtOp || UdmaOp == AtaUdmaReadExtOp) {
-      Status = AtaCommandIssueExt (
-                 IdeDev,
-                 AtaCommand,
-                 Device,
-                 0,
-                 (UINT16) NumberOfBlocks,
-                 StartLba
-                 );
-    } else {
-      Status = AtaCommandIssue (
-                 IdeDev,
-                 AtaCommand,
-                 Device,
-                 0,
-                 (UINT16) NumberOfBlocks,
-                 StartLba
-                 );
-    }
+  IdeDev->PciIo->Io.Write (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmic,
+                      1,
+                      &RegisterValue
+                      );
+
+  *CommandBlocks = NumberOfBlocks;
+  return EFI_SUCCESS;
+}
 
-    if (EFI_ERROR (Status)) {
-      IdeDev->PciIo->FreeBuffer (IdeDev->PciIo, PageCount, MemPage);
-      IdeDev->PciIo->Unmap (IdeDev->PciIo, Map);
-      return EFI_DEVICE_ERROR;
-    }
+/**
+  Check whether the ATA Udma command started by AtaUdmaStartCommand() on the
+  channel of an IDE device is finished, from the INTERRUPT and ERROR bits of
+  the BMIS register.
 
-    //
-    // Set START bit of BMIC register
-    //
-    IdeDev->PciIo->Io.Read (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmic,
-                        1,
-                        &RegisterValue
-                        );
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
 
-    RegisterValue |= BMIC_START;
+  @retval EFI_SUCCESS       The command is finished.
+  @retval EFI_NOT_READY     The command is still in progress.
+  @retval EFI_DEVICE_ERROR  The command failed.
+  @retval EFI_UNSUPPORTED   Unknown channel.
 
-    IdeDev->PciIo->Io.Write (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmic,
-                        1,
-                        &RegisterValue
-                        );
+**/
+EFI_STATUS
+AtaUdmaCheckCommand (
+  IN  IDE_BLK_IO_DEV  *IdeDev
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       RegisterValue;
+  UINT64      IoPortForBmic;
+  UINT64      IoPortForBmis;
+  UINT64      IoPortForBmid;
 
-    //
-    // Check the INTERRUPT and ERROR bit of BMIS
-    // Max transfer number of sectors for one command is 65536(32Mbyte),
-    // it will cost 1 second to transfer these data in UDMA mode 2(33.3MBps).
-    // So set the variable Count to 2000, for about 2 second timeout time.
-    //
-    Status = EFI_SUCCESS;
-    Count = 2000;
-    while (TRUE) {
+  Status = AtaUdmaGetBusMasterPorts (IdeDev, &IoPortForBmic, &IoPortForBmis, &IoPortForBmid);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
 
-      IdeDev->PciIo->Io.Read (
-                          IdeDev->PciIo,
-                          EfiPciIoWidthUint8,
-                          EFI_PCI_IO_PASS_THROUGH_BAR,
-                          IoPortForBmis,
-                          1,
-                          &RegisterValue
-                          );
-      if (((RegisterValue & (BMIS_INTERRUPT | BMIS_ERROR)) != 0) || (Count == 0)) {
-        if (((RegisterValue & BMIS_ERROR) != 0) || (Count == 0)) {
-		  Status = EFI_DEVICE_ERROR;
-		  break;
-        }
-        break;
-      }
+  IdeDev->PciIo->Io.Read (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmis,
+                      1,
+                      &RegisterValue
+                      );
+
+  if ((RegisterValue & BMIS_ERROR) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
 
-      gBS->Stall (1000);
-      Count --;
-    }
+  if ((RegisterValue & BMIS_INTERRUPT) != 0) {
+    return EFI_SUCCESS;
+  }
 
-    IdeDev->PciIo->FreeBuffer (IdeDev->PciIo, PageCount, MemPage);
-    IdeDev->PciIo->Unmap (IdeDev->PciIo, Map);
-    //
-    // Read BMIS register and clear ERROR and INTR bit
-    //
-    IdeDev->PciIo->Io.Read (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmis,
-                        1,
-                        &RegisterValue
-                        );
-
-    RegisterValue |= (BMIS_INTERRUPT | BMIS_ERROR);
-
-    IdeDev->PciIo->Io.Write (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmis,
-                        1,
-                        &RegisterValue
-                        );
-	//
-    // Read Status Register of IDE device to clear interrupt
-    //
-    RegisterValue = IDEReadPortB(IdeDev->PciIo,IdeDev->IoPort->Reg.Status);
-    //
-    // Clear START bit of BMIC register
-    //
-    IdeDev->PciIo->Io.Read (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmic,
-                        1,
-                        &RegisterValue
-                        );
-
-    RegisterValue &= ~((UINT8) BMIC_START);
-
-    IdeDev->PciIo->Io.Write (
-                        IdeDev->PciIo,
-                        EfiPciIoWidthUint8,
-                        EFI_PCI_IO_PASS_THROUGH_BAR,
-                        IoPortForBmic,
-                        1,
-                        &RegisterValue
-                        );
-
-    if ((RegisterValue & BMIS_ERROR) != 0) {
-      return EFI_DEVICE_ERROR;
-    }
+  return EFI_NOT_READY;
+}
+
+/**
+  Stop the bus master after an ATA Udma command started by AtaUdmaStartCommand(),
+  whether the command is finished or not, and unmap its data.
+
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
+  @param Map            The mapping of the data of the command.
+
+**/
+VOID
+AtaUdmaEndCommand (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  VOID            *Map
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       RegisterValue;
+  UINT8       DeviceControl;
+  UINT64      IoPortForBmic;
+  UINT64      IoPortForBmis;
+  UINT64      IoPortForBmid;
+
+  IdeDev->PciIo->Unmap (IdeDev->PciIo, Map);
 
-	if (EFI_ERROR (Status)) {
-	  break;
-	}
-    DataBuffer = (UINT8 *) DataBuffer + NumberOfBlocks * IdeDev->BlkIo.Media->BlockSize;
-    StartLba += NumberOfBlocks;
+  Status = AtaUdmaGetBusMasterPorts (IdeDev, &IoPortForBmic, &IoPortForBmis, &IoPortForBmid);
+  if (EFI_ERROR (Status)) {
+    return;
   }
 
+  //
+  // Read BMIS register and clear ERROR and INTR bit
+  //
+  IdeDev->PciIo->Io.Read (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmis,
+                      1,
+                      &RegisterValue
+                      );
+
+  RegisterValue |= (BMIS_INTERRUPT | BMIS_ERROR);
+
+  IdeDev->PciIo->Io.Write (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmis,
+                      1,
+                      &RegisterValue
+                      );
+  //
+  // Read Status Register of IDE device to clear interrupt
+  //
+  RegisterValue = IDEReadPortB(IdeDev->PciIo,IdeDev->IoPort->Reg.Status);
+  //
+  // Clear START bit of BMIC register
+  //
+  IdeDev->PciIo->Io.Read (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmic,
+                      1,
+                      &RegisterValue
+                      );
+
+  RegisterValue &= ~((UINT8) BMIC_START);
+
+  IdeDev->PciIo->Io.Write (
+                      IdeDev->PciIo,
+                      EfiPciIoWidthUint8,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      IoPortForBmic,
+                      1,
+                      &RegisterValue
+                      );
+
   //
   // Disable interrupt of Select device
   //
   IDEReadPortB (IdeDev->PciIo, IdeDev->IoPort->Alt.DeviceControl);
-  DeviceControl |= ATA_CTLREG_IEN_L;
+  DeviceControl = ATA_CTLREG_IEN_L;
   IDEWritePortB (IdeDev->PciIo, IdeDev->IoPort->Alt.DeviceControl, DeviceControl);
-
-  return Status;
 }
 
+/**
+  Perform an ATA Udma operation (Read, ReadExt, Write, WriteExt).
+
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
+  @param DataBuffer     A pointer to the source buffer for the data.
+  @param StartLba       The starting logical block address to write to
+                        on the device media.
+  @param NumberOfBlocks The number of transfer data blocks.
+  @param UdmaOp         The perform operations could be AtaUdmaReadOp, AtaUdmaReadExOp,
+                        AtaUdmaWriteOp, AtaUdmaWriteExOp
+
+  @retval EFI_SUCCESS          the operation is successful.
+  @retval EFI_OUT_OF_RESOURCES Build PRD table failed
+  @retval EFI_UNSUPPORTED      Unknown channel or operations command
+  @retval EFI_DEVICE_ERROR     Ata command execute failed
+
+**/
+EFI_STATUS
+DoAtaUdma (
+  IN  IDE_BLK_IO_DEV      *IdeDev,
+  IN  VOID                *DataBuffer,
+  IN  EFI_LBA             StartLba,
+  IN  UINTN               NumberOfBlocks,
+  IN  ATA_UDMA_OPERATION  UdmaOp
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       CommandBlocks;
+  VOID        *Map;
+  UINT32      Count;
+
+  while (NumberOfBlocks > 0) {
+    Status = AtaUdmaStartCommand (
+               IdeDev,
+               DataBuffer,
+               StartLba,
+               NumberOfBlocks,
+               UdmaOp,
+               &CommandBlocks,
+               &Map
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    //
+    // Check the INTERRUPT and ERROR bit of BMIS
+    // Max transfer number of sectors for one command is 65536(32Mbyte),
+    // it will cost 1 second to transfer these data in UDMA mode 2(33.3MBps).
+    // So set the variable Count to 2000, for about 2 second timeout time.
+    //
+    Count = 2000;
+    while (TRUE) {
+      Status = AtaUdmaCheckCommand (IdeDev);
+      if ((Status != EFI_NOT_READY) || (Count == 0)) {
+        break;
+      }
+
+      gBS->Stall (1000);
+      Count --;
+    }
+
+    AtaUdmaEndCommand (IdeDev, Map);
+
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+
+    DataBuffer      = (UINT8 *) DataBuffer + CommandBlocks * IdeDev->BlkIo.Media->BlockSize;
+    StartLba       += CommandBlocks;
+    NumberOfBlocks -= CommandBlocks;
+  }
+
+  return EFI_SUCCESS;
+}
 
 /**
   This function is called by the AtaBlkIoReadBlocks() to perform reading from
@@ -1973,10 +2266,6 @@ AtaReadSectorsExt (
   UINT32      ByteCount;
   VOID        *Buffer;
 
-  //
-  // Using ATA "Read Sectors Ext" command(opcode=0x24) with PIO DATA IN protocol
-  //
-  AtaCommand      = ATA_CMD_READ_SECTORS_EXT;
   Buffer          = DataBuffer;
   BlocksRemaining = NumberOfBlocks;
   Lba64           = StartLba;
@@ -1999,6 +2288,17 @@ AtaReadSectorsExt (
     //
     ByteCount = SectorCount * (IdeDev->BlkIo.Media->BlockSize);
 
+    //
+    // Using ATA "Read Multiple Ext" command(opcode=0x29) when the multiple mode
+    // is enabled, or ATA "Read Sectors Ext" command(opcode=0x24), both with PIO
+    // DATA IN protocol
+    //
+    if (IdeDev->MultipleSectorCount != 0) {
+      AtaCommand = ATA_CMD_READ_MULTIPLE_EXT;
+    } else {
+      AtaCommand = ATA_CMD_READ_SECTORS_EXT;
+    }
+
     //
     // call AtaPioDataInExt() to send Read Sector Command and receive data read
     //
@@ -2011,6 +2311,9 @@ AtaReadSectorsExt (
               SectorCount
               );
     if (EFI_ERROR (Status)) {
+      if ((AtaCommand == ATA_CMD_READ_MULTIPLE_EXT) && AtaMultipleModeAborted (IdeDev)) {
+        continue;
+      }
       return Status;
     }
 
@@ -2022,55 +2325,86 @@ AtaReadSectorsExt (
   return Status;
 }
 /**
-  This function is the ATA implementation for ReadBlocks in the
-  Block I/O Protocol interface.
+  Read blocks from the media of an ATA device, without going through the
+  block cache.
 
   @param IdeBlkIoDevice Indicates the calling context.
-  @param MediaId        The media id that the read request is for.
-  @param Lba            The starting logical block address to read from on the device.
-  @param BufferSize     The size of the Buffer in bytes. This must be a  multiple
-                        of the intrinsic block size of the device.
+  @param Buffer         A pointer to the destination buffer for the data.
+  @param Lba            The starting logical block address to read from on the device media.
+  @param NumberOfBlocks The number of transfer data blocks.
 
-  @param Buffer         A pointer to the destination buffer for the data. The caller
-                        is responsible for either having implicit or explicit ownership
-                        of the memory that data is read into.
+  @retval EFI_SUCCESS       Read Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Read Blocks failed. The device is reset by AtaSoftReset().
 
-  @retval EFI_SUCCESS          Read Blocks successfully.
-  @retval EFI_DEVICE_ERROR     Read Blocks failed.
-  @retval EFI_NO_MEDIA         There is no media in the device.
-  @retval EFI_MEDIA_CHANGE     The MediaId is not for the current media.
-  @retval EFI_BAD_BUFFER_SIZE  The BufferSize parameter is not a multiple of the
-                               intrinsic block size of the device.
-  @retval EFI_INVALID_PARAMETER  The read request contains LBAs that are not valid,
-                                 or the data buffer is not valid.
+**/
+EFI_STATUS
+AtaDeviceReadBlocks (
+  IN  IDE_BLK_IO_DEV  *IdeBlkIoDevice,
+  OUT VOID            *Buffer,
+  IN  EFI_LBA         Lba,
+  IN  UINTN           NumberOfBlocks
+  )
+{
+  EFI_STATUS  Status;
 
-  @note If Read Block error because of device error, this function will call
-        AtaSoftReset() function to reset device.
+  if (IdeBlkIoDevice->Type == Ide48bitAddressingHardDisk) {
+    //
+    // For ATA/ATAPI-6 device(capcity > 120GB), use ATA-6 read block mechanism
+    //
+    if (IdeBlkIoDevice->UdmaMode.Valid) {
+      Status = AtaUdmaReadExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    } else {
+      Status = AtaReadSectorsExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    }
+  } else {
+    //
+    // For ATA-3 compatible device, use ATA-3 read block mechanism
+    //
+    if (IdeBlkIoDevice->UdmaMode.Valid) {
+      Status = AtaUdmaRead (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    } else {
+      Status = AtaReadSectors (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    AtaSoftReset (IdeBlkIoDevice);
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+/**
+  Check the parameters of a read or write request of the Block I/O or Block I/O 2
+  protocol against the media of an ATA device.
+
+  @param IdeBlkIoDevice Indicates the calling context.
+  @param MediaId        The media id that the request is for.
+  @param Lba            The starting logical block address of the request.
+  @param BufferSize     The size of the Buffer in bytes, not 0.
+  @param Buffer         A pointer to the buffer of the data, not NULL.
+
+  @retval EFI_SUCCESS            The request is valid.
+  @retval EFI_NO_MEDIA           There is no media in the device.
+  @retval EFI_MEDIA_CHANGED      The MediaId is not for the current media.
+  @retval EFI_BAD_BUFFER_SIZE    The BufferSize parameter is not a multiple of the
+                                 intrinsic block size of the device.
+  @retval EFI_INVALID_PARAMETER  The request contains LBAs that are not valid,
+                                 or the data buffer is not aligned.
 
 **/
 EFI_STATUS
-AtaBlkIoReadBlocks (
+AtaBlkIoCheckRequest (
   IN IDE_BLK_IO_DEV   *IdeBlkIoDevice,
   IN UINT32           MediaId,
   IN EFI_LBA          Lba,
   IN UINTN            BufferSize,
-  OUT VOID            *Buffer
+  IN VOID             *Buffer
   )
 {
   EFI_BLOCK_IO_MEDIA  *Media;
   UINTN               BlockSize;
   UINTN               NumberOfBlocks;
-  EFI_STATUS          Status;
-
-  if (Buffer == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (BufferSize == 0) {
-    return EFI_SUCCESS;
-  }
-
-  Status = EFI_SUCCESS;
 
   //
   //  Get the intrinsic block size
@@ -2104,34 +2438,67 @@ AtaBlkIoReadBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
-  Status = EFI_SUCCESS;
-  if (IdeBlkIoDevice->Type == Ide48bitAddressingHardDisk) {
-    //
-    // For ATA/ATAPI-6 device(capcity > 120GB), use ATA-6 read block mechanism
-    //
-    if (IdeBlkIoDevice->UdmaMode.Valid) {
-      Status = AtaUdmaReadExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    } else {
-      Status = AtaReadSectorsExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    }
-  } else {
-    //
-    // For ATA-3 compatible device, use ATA-3 read block mechanism
-    //
-    if (IdeBlkIoDevice->UdmaMode.Valid) {
-      Status = AtaUdmaRead (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    } else {
-      Status = AtaReadSectors (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    }
+  return EFI_SUCCESS;
+}
+/**
+  This function is the ATA implementation for ReadBlocks in the
+  Block I/O Protocol interface.
+
+  @param IdeBlkIoDevice Indicates the calling context.
+  @param MediaId        The media id that the read request is for.
+  @param Lba            The starting logical block address to read from on the device.
+  @param BufferSize     The size of the Buffer in bytes. This must be a  multiple
+                        of the intrinsic block size of the device.
+
+  @param Buffer         A pointer to the destination buffer for the data. The caller
+                        is responsible for either having implicit or explicit ownership
+                        of the memory that data is read into.
+
+  @retval EFI_SUCCESS          Read Blocks successfully.
+  @retval EFI_DEVICE_ERROR     Read Blocks failed.
+  @retval EFI_NO_MEDIA         There is no media in the device.
+  @retval EFI_MEDIA_CHANGE     The MediaId is not for the current media.
+  @retval EFI_BAD_BUFFER_SIZE  The BufferSize parameter is not a multiple of the
+                               intrinsic block size of the device.
+  @retval EFI_INVALID_PARAMETER  The read request contains LBAs that are not valid,
+                                 or the data buffer is not valid.
+
+  @note If Read Block error because of device error, this function will call
+        AtaSoftReset() function to reset device.
+
+**/
+EFI_STATUS
+AtaBlkIoReadBlocks (
+  IN IDE_BLK_IO_DEV   *IdeBlkIoDevice,
+  IN UINT32           MediaId,
+  IN EFI_LBA          Lba,
+  IN UINTN            BufferSize,
+  OUT VOID            *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       NumberOfBlocks;
+
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (BufferSize == 0) {
+    return EFI_SUCCESS;
   }
 
+  Status = AtaBlkIoCheckRequest (IdeBlkIoDevice, MediaId, Lba, BufferSize, Buffer);
   if (EFI_ERROR (Status)) {
-    AtaSoftReset (IdeBlkIoDevice);
-    return EFI_DEVICE_ERROR;
+    return Status;
   }
 
-  return EFI_SUCCESS;
+  NumberOfBlocks = BufferSize / IdeBlkIoDevice->BlkIo.Media->BlockSize;
 
+  if (IdeBlkIoDevice->BlockCache.LineCount != 0) {
+    return IdeBlockCacheRead (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+  }
+
+  return AtaDeviceReadBlocks (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
 }
 /**
   This function is used to send out ATA commands conforms to the
@@ -2243,9 +2610,10 @@ AtaPioDataOutExt (
 
   //
   // According to PIO Data Out protocol, host can perform a series of writes to
-  // the data register after each time device set DRQ ready;
+  // the data register after each time device set DRQ ready; the data size of
+  // a series of writes is 1 DRQ data block.
   //
-  Increment = 256;
+  Increment = AtaPioDrqBlockWords (IdeDev, AtaCommand);
 
   //
   // used to record bytes of currently transfered data
@@ -2273,12 +2641,7 @@ AtaPioDataOutExt (
       Increment = ByteCount / 2 - WordCount;
     }
 
-    IDEWritePortWMultiple (
-      IdeDev->PciIo,
-      IdeDev->IoPort->Data,
-      Increment,
-      Buffer16
-      );
+    AtaPioWriteData (IdeDev, Increment, Buffer16);
 
     WordCount += Increment;
     Buffer16 += Increment;
@@ -2364,10 +2727,6 @@ AtaWriteSectorsExt (
   UINT32      ByteCount;
   VOID        *Buffer;
 
-  //
-  // Using ATA "Write Sectors Ext" cmd(opcode=0x24) with PIO DATA OUT protocol
-  //
-  AtaCommand      = ATA_CMD_WRITE_SECTORS_EXT;
   Lba64           = StartLba;
   Buffer          = DataBuffer;
   BlocksRemaining = NumberOfBlocks;
@@ -2391,6 +2750,17 @@ AtaWriteSectorsExt (
     //
     ByteCount = SectorCount * (IdeDev->BlkIo.Media->BlockSize);
 
+    //
+    // Using ATA "Write Multiple Ext" cmd(opcode=0x39) when the multiple mode is
+    // enabled, or ATA "Write Sectors Ext" cmd(opcode=0x34), both with PIO DATA
+    // OUT protocol
+    //
+    if (IdeDev->MultipleSectorCount != 0) {
+      AtaCommand = ATA_CMD_WRITE_MULTIPLE_EXT;
+    } else {
+      AtaCommand = ATA_CMD_WRITE_SECTORS_EXT;
+    }
+
     //
     // Call AtaPioDataOutExt() to send "Write Sectors Ext" Command
     //
@@ -2403,6 +2773,9 @@ AtaWriteSectorsExt (
               SectorCount
               );
     if (EFI_ERROR (Status)) {
+      if ((AtaCommand == ATA_CMD_WRITE_MULTIPLE_EXT) && AtaMultipleModeAborted (IdeDev)) {
+        continue;
+      }
       return Status;
     }
 
@@ -2413,6 +2786,56 @@ AtaWriteSectorsExt (
 
   return Status;
 }
+/**
+  Write blocks onto the media of an ATA device, without going through the
+  block cache.
+
+  @param IdeBlkIoDevice Indicates the calling context.
+  @param Buffer         A pointer to the source buffer for the data.
+  @param Lba            The starting logical block address to write onto the device media.
+  @param NumberOfBlocks The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Write Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Write Blocks failed. The device is reset by AtaSoftReset().
+
+**/
+EFI_STATUS
+AtaDeviceWriteBlocks (
+  IN  IDE_BLK_IO_DEV  *IdeBlkIoDevice,
+  IN  VOID            *Buffer,
+  IN  EFI_LBA         Lba,
+  IN  UINTN           NumberOfBlocks
+  )
+{
+  EFI_STATUS  Status;
+
+  if (IdeBlkIoDevice->Type == Ide48bitAddressingHardDisk) {
+    //
+    // For ATA/ATAPI-6 device(capcity > 120GB), use ATA-6 write block mechanism
+    //
+    if (IdeBlkIoDevice->UdmaMode.Valid) {
+      Status = AtaUdmaWriteExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    } else {
+      Status = AtaWriteSectorsExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    }
+  } else {
+    //
+    // For ATA-3 compatible device, use ATA-3 write block mechanism
+    //
+    if (IdeBlkIoDevice->UdmaMode.Valid) {
+      Status = AtaUdmaWrite (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    } else {
+      Status = AtaWriteSectors (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    AtaSoftReset (IdeBlkIoDevice);
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
 /**
   This function is the ATA implementation for WriteBlocks in the
   Block I/O Protocol interface.
@@ -2448,11 +2871,8 @@ AtaBlkIoWriteBlocks (
   OUT VOID             *Buffer
   )
 {
-
-  EFI_BLOCK_IO_MEDIA  *Media;
-  UINTN               BlockSize;
-  UINTN               NumberOfBlocks;
-  EFI_STATUS          Status;
+  EFI_STATUS  Status;
+  UINTN       NumberOfBlocks;
 
   if (Buffer == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -2462,62 +2882,18 @@ AtaBlkIoWriteBlocks (
     return EFI_SUCCESS;
   }
 
-  Status = EFI_SUCCESS;
-
-  //
-  // Get the intrinsic block size
-  //
-  Media           = IdeBlkIoDevice->BlkIo.Media;
-  BlockSize       = Media->BlockSize;
-  NumberOfBlocks  = BufferSize / BlockSize;
-
-  if (MediaId != Media->MediaId) {
-    return EFI_MEDIA_CHANGED;
-  }
-
-  if (BufferSize % BlockSize != 0) {
-    return EFI_BAD_BUFFER_SIZE;
-  }
-
-  if (Lba > Media->LastBlock) {
-    return EFI_INVALID_PARAMETER;
+  Status = AtaBlkIoCheckRequest (IdeBlkIoDevice, MediaId, Lba, BufferSize, Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
-  if ((Lba + NumberOfBlocks - 1) > Media->LastBlock) {
-    return EFI_INVALID_PARAMETER;
-  }
+  NumberOfBlocks = BufferSize / IdeBlkIoDevice->BlkIo.Media->BlockSize;
 
-  if ((Media->IoAlign > 1) && (((UINTN) Buffer & (Media->IoAlign - 1)) != 0)) {
-    return EFI_INVALID_PARAMETER;
+  if (IdeBlkIoDevice->BlockCache.LineCount != 0) {
+    return IdeBlockCacheWrite (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
   }
 
-  Status = EFI_SUCCESS;
-  if (IdeBlkIoDevice->Type == Ide48bitAddressingHardDisk) {
-    //
-    // For ATA/ATAPI-6 device(capcity > 120GB), use ATA-6 write block mechanism
-    //
-    if (IdeBlkIoDevice->UdmaMode.Valid) {
-      Status = AtaUdmaWriteExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    } else {
-      Status = AtaWriteSectorsExt (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    }
-  } else {
-    //
-    // For ATA-3 compatible device, use ATA-3 write block mechanism
-    //
-    if (IdeBlkIoDevice->UdmaMode.Valid) {
-      Status = AtaUdmaWrite (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    } else {
-      Status = AtaWriteSectors (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
-    }
-  }
-
-  if (EFI_ERROR (Status)) {
-    AtaSoftReset (IdeBlkIoDevice);
-    return EFI_DEVICE_ERROR;
-  }
-
-  return EFI_SUCCESS;
+  return AtaDeviceWriteBlocks (IdeBlkIoDevice, Buffer, Lba, NumberOfBlocks);
 }
 /**
   Enable Long Physical Sector Feature for ATA device.
@@ -0,0 +1,789 @@
+/** @file
+  Block cache of the IDE hard disks.
+
+  File system drivers read the same metadata blocks in small pieces over and
+  over again. The reads and writes of a hard disk go through a cache of lines
+  of IDE_BLOCK_CACHE_LINE_SIZE bytes. A miss reads the missing lines from the
+  disk, and the following ones if the reads form a sequential stream. Requests
+  larger than IDE_BLOCK_CACHE_MAX_RUN_SIZE go to the disk directly.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "IdeBus.h"
+
+/**
+  Get the number of blocks of a line, which is less than the line size for the
+  last line of the disk.
+
+  @param  IdeDev   Standard IDE device private data structure
+  @param  LineLba  The first LBA of the line
+
+  @return The number of blocks of the line.
+
+**/
+UINTN
+IdeBlockCacheLineBlocks (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN EFI_LBA         LineLba
+  )
+{
+  EFI_LBA  LastBlock;
+
+  LastBlock = IdeDev->BlkIo.Media->LastBlock;
+  if (LineLba + IdeDev->BlockCache.LineBlocks - 1 > LastBlock) {
+    return (UINTN) (LastBlock + 1 - LineLba);
+  }
+
+  return IdeDev->BlockCache.LineBlocks;
+}
+
+/**
+  Find a line in the cache.
+
+  @param  Cache    The block cache of the device
+  @param  LineLba  The first LBA of the line
+
+  @return The line, or NULL if it is not in the cache.
+
+**/
+IDE_BLOCK_CACHE_LINE *
+IdeBlockCacheLookup (
+  IN IDE_BLOCK_CACHE  *Cache,
+  IN EFI_LBA          LineLba
+  )
+{
+  LIST_ENTRY            *Bucket;
+  LIST_ENTRY            *Link;
+  IDE_BLOCK_CACHE_LINE  *Line;
+
+  Bucket = &Cache->HashTable[(UINTN) RShiftU64 (LineLba, Cache->LineShift) & Cache->HashMask];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    Line = IDE_BLOCK_CACHE_LINE_FROM_HASH_LINK (Link);
+    if (Line->Lba == LineLba) {
+      return Line;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Make a line the most recently used one of its LRU list.
+
+  @param  Cache  The block cache of the device
+  @param  Line   The line
+
+**/
+VOID
+IdeBlockCacheTouch (
+  IN IDE_BLOCK_CACHE       *Cache,
+  IN IDE_BLOCK_CACHE_LINE  *Line
+  )
+{
+  RemoveEntryList (&Line->LruLink);
+  InsertHeadList (Line->Pinned ? &Cache->PinnedLruList : &Cache->LruList, &Line->LruLink);
+}
+
+/**
+  Write a modified line onto the disk.
+
+  @param  IdeDev  Standard IDE device private data structure
+  @param  Line    The modified line
+
+  @retval EFI_SUCCESS       The line was written and is no longer modified.
+  @retval EFI_DEVICE_ERROR  The line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheWriteLine (
+  IN IDE_BLK_IO_DEV        *IdeDev,
+  IN IDE_BLOCK_CACHE_LINE  *Line
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       LineBlocks;
+
+  LineBlocks = IdeBlockCacheLineBlocks (IdeDev, Line->Lba);
+  Status     = AtaDeviceWriteBlocks (IdeDev, Line->Data, Line->Lba, LineBlocks);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Line->Dirty = FALSE;
+  IdeDev->BlockCache.DirtyCount--;
+  IdeDev->BlockCache.Statistics.WriteBackBlocks += LineBlocks;
+  return EFI_SUCCESS;
+}
+
+/**
+  Check if the lines of an LBA are kept in preference to the other ones: the
+  lines of the first MB, where the MBR, the primary GPT and the start of the
+  first partition usually are, and the lines of the backup GPT.
+
+  @param  IdeDev   Standard IDE device private data structure
+  @param  LineLba  The first LBA of the line
+
+  @retval TRUE   The line is pinned.
+  @retval FALSE  The line is not pinned.
+
+**/
+BOOLEAN
+IdeBlockCacheIsPinnedLba (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN EFI_LBA         LineLba
+  )
+{
+  EFI_BLOCK_IO_MEDIA  *Media;
+
+  Media = IdeDev->BlkIo.Media;
+  if (LineLba < IDE_BLOCK_CACHE_PINNED_HEAD_SIZE / Media->BlockSize) {
+    return TRUE;
+  }
+
+  return (BOOLEAN) ((Media->LastBlock >= IDE_BLOCK_CACHE_PINNED_TAIL_BLOCKS) &&
+                    (LineLba + IdeDev->BlockCache.LineBlocks > Media->LastBlock + 1 - IDE_BLOCK_CACHE_PINNED_TAIL_BLOCKS));
+}
+
+/**
+  Get a line for an LBA which is not in the cache. A free line is used if there
+  is one; otherwise the least recently used line is evicted, a pinned one only
+  if all the lines are pinned. The data of the line is not initialized.
+
+  @param  IdeDev   Standard IDE device private data structure
+  @param  LineLba  The first LBA of the line
+  @param  Line     Returns the line
+
+  @retval EFI_SUCCESS       The line was added to the cache.
+  @retval EFI_DEVICE_ERROR  The modified line to evict could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheAllocateLine (
+  IN  IDE_BLK_IO_DEV        *IdeDev,
+  IN  EFI_LBA               LineLba,
+  OUT IDE_BLOCK_CACHE_LINE  **Line
+  )
+{
+  EFI_STATUS            Status;
+  IDE_BLOCK_CACHE       *Cache;
+  IDE_BLOCK_CACHE_LINE  *NewLine;
+
+  Cache = &IdeDev->BlockCache;
+
+  if (!IsListEmpty (&Cache->FreeList)) {
+    NewLine = IDE_BLOCK_CACHE_LINE_FROM_LRU_LINK (GetFirstNode (&Cache->FreeList));
+  } else {
+    if (!IsListEmpty (&Cache->LruList)) {
+      NewLine = IDE_BLOCK_CACHE_LINE_FROM_LRU_LINK (Cache->LruList.BackLink);
+    } else {
+      NewLine = IDE_BLOCK_CACHE_LINE_FROM_LRU_LINK (Cache->PinnedLruList.BackLink);
+    }
+
+    if (NewLine->Dirty) {
+      Status = IdeBlockCacheWriteLine (IdeDev, NewLine);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+
+    RemoveEntryList (&NewLine->HashLink);
+    if (NewLine->Pinned) {
+      Cache->PinnedCount--;
+    }
+    Cache->Statistics.EvictionCount++;
+  }
+
+  RemoveEntryList (&NewLine->LruLink);
+
+  NewLine->Lba    = LineLba;
+  NewLine->Dirty  = FALSE;
+  NewLine->Pinned = FALSE;
+  if ((Cache->PinnedCount < Cache->MaxPinnedLines) && IdeBlockCacheIsPinnedLba (IdeDev, LineLba)) {
+    NewLine->Pinned = TRUE;
+    Cache->PinnedCount++;
+  }
+
+  InsertHeadList (
+    &Cache->HashTable[(UINTN) RShiftU64 (LineLba, Cache->LineShift) & Cache->HashMask],
+    &NewLine->HashLink
+    );
+  InsertHeadList (NewLine->Pinned ? &Cache->PinnedLruList : &Cache->LruList, &NewLine->LruLink);
+
+  *Line = NewLine;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return a line which is not modified to the free list.
+
+  @param  Cache  The block cache of the device
+  @param  Line   The line
+
+**/
+VOID
+IdeBlockCacheFreeLine (
+  IN IDE_BLOCK_CACHE       *Cache,
+  IN IDE_BLOCK_CACHE_LINE  *Line
+  )
+{
+  ASSERT (!Line->Dirty);
+
+  RemoveEntryList (&Line->HashLink);
+  RemoveEntryList (&Line->LruLink);
+  if (Line->Pinned) {
+    Cache->PinnedCount--;
+  }
+  InsertHeadList (&Cache->FreeList, &Line->LruLink);
+}
+
+/**
+  Read a run of lines from the disk into the run buffer, and add them to the
+  cache. None of the lines may be in the cache already.
+
+  @param  IdeDev     Standard IDE device private data structure
+  @param  LineLba    The first LBA of the first line
+  @param  RunLines   The number of lines, at most MaxRunLines
+  @param  RunBlocks  Returns the number of blocks read, which is less than the size
+                     of the lines if the run ends with the last line of the disk
+
+  @retval EFI_SUCCESS       The lines were read.
+  @retval EFI_DEVICE_ERROR  The lines could not be read.
+
+**/
+EFI_STATUS
+IdeBlockCacheFillRun (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  EFI_LBA         LineLba,
+  IN  UINTN           RunLines,
+  OUT UINTN           *RunBlocks
+  )
+{
+  EFI_STATUS            Status;
+  IDE_BLOCK_CACHE       *Cache;
+  IDE_BLOCK_CACHE_LINE  *Line;
+  UINTN                 BlockSize;
+  UINTN                 Index;
+
+  Cache     = &IdeDev->BlockCache;
+  BlockSize = IdeDev->BlkIo.Media->BlockSize;
+
+  *RunBlocks = RunLines * Cache->LineBlocks;
+  if (LineLba + *RunBlocks - 1 > IdeDev->BlkIo.Media->LastBlock) {
+    *RunBlocks = (UINTN) (IdeDev->BlkIo.Media->LastBlock + 1 - LineLba);
+  }
+
+  Status = AtaDeviceReadBlocks (IdeDev, Cache->RunBuffer, LineLba, *RunBlocks);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < RunLines; Index++) {
+    //
+    // The data is in the run buffer for the caller, so failing to write back a
+    // modified line to make room only leaves the rest of the run out of the cache.
+    //
+    Status = IdeBlockCacheAllocateLine (IdeDev, LineLba + Index * Cache->LineBlocks, &Line);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    CopyMem (
+      Line->Data,
+      Cache->RunBuffer + Index * Cache->LineBlocks * BlockSize,
+      IdeBlockCacheLineBlocks (IdeDev, Line->Lba) * BlockSize
+      );
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write the modified lines of a range of blocks onto the disk.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Lba             The first LBA of the range
+  @param  NumberOfBlocks  The number of blocks of the range
+
+  @retval EFI_SUCCESS       No line of the range is modified any more.
+  @retval EFI_DEVICE_ERROR  A line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheFlushRange (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN EFI_LBA         Lba,
+  IN UINTN           NumberOfBlocks
+  )
+{
+  EFI_STATUS            Status;
+  IDE_BLOCK_CACHE       *Cache;
+  IDE_BLOCK_CACHE_LINE  *Line;
+  EFI_LBA               LineLba;
+
+  Cache = &IdeDev->BlockCache;
+
+  for (LineLba = Lba & ~((EFI_LBA) Cache->LineBlocks - 1);
+       (LineLba < Lba + NumberOfBlocks) && (Cache->DirtyCount != 0);
+       LineLba += Cache->LineBlocks) {
+    Line = IdeBlockCacheLookup (Cache, LineLba);
+    if ((Line != NULL) && Line->Dirty) {
+      Status = IdeBlockCacheWriteLine (IdeDev, Line);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Drop the lines of a range of blocks from the cache, before the range is
+  written onto the disk without going through the cache. The modified lines of
+  the range are written onto the disk first, as the write may not cover them
+  entirely.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Lba             The first LBA of the range
+  @param  NumberOfBlocks  The number of blocks of the range
+
+  @retval EFI_SUCCESS       No line of the range is in the cache any more.
+  @retval EFI_DEVICE_ERROR  A line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheInvalidateRange (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN EFI_LBA         Lba,
+  IN UINTN           NumberOfBlocks
+  )
+{
+  EFI_STATUS            Status;
+  IDE_BLOCK_CACHE       *Cache;
+  IDE_BLOCK_CACHE_LINE  *Line;
+  EFI_LBA               LineLba;
+
+  Cache = &IdeDev->BlockCache;
+
+  Status = IdeBlockCacheFlushRange (IdeDev, Lba, NumberOfBlocks);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (LineLba = Lba & ~((EFI_LBA) Cache->LineBlocks - 1);
+       LineLba < Lba + NumberOfBlocks;
+       LineLba += Cache->LineBlocks) {
+    Line = IdeBlockCacheLookup (Cache, LineLba);
+    if (Line != NULL) {
+      IdeBlockCacheFreeLine (Cache, Line);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate the block cache of a hard disk, with the size of PcdIdeBlockCacheSize.
+  The block size and the last block of the media must be known.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+  @retval EFI_SUCCESS           The cache is enabled.
+  @retval EFI_UNSUPPORTED       The cache is disabled by the PCD, or too small for the block size.
+  @retval EFI_OUT_OF_RESOURCES  The cache could not be allocated.
+
+**/
+EFI_STATUS
+IdeBlockCacheInit (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  )
+{
+  IDE_BLOCK_CACHE  *Cache;
+  UINT32           BlockSize;
+  UINTN            LineSize;
+  UINTN            LineCount;
+  UINTN            HashCount;
+  UINTN            Index;
+
+  Cache     = &IdeDev->BlockCache;
+  BlockSize = IdeDev->BlkIo.Media->BlockSize;
+  if ((BlockSize == 0) || ((BlockSize & (BlockSize - 1)) != 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  LineSize = MAX (IDE_BLOCK_CACHE_LINE_SIZE, BlockSize);
+  LineCount = PcdGet32 (PcdIdeBlockCacheSize) / LineSize;
+  if (LineCount < 4) {
+    return EFI_UNSUPPORTED;
+  }
+
+  HashCount = GetPowerOfTwo32 ((UINT32) LineCount);
+
+  Cache->LineBlocks     = LineSize / BlockSize;
+  Cache->LineShift      = (UINTN) HighBitSet32 ((UINT32) Cache->LineBlocks);
+  Cache->MaxRunLines    = MAX (1, MIN (IDE_BLOCK_CACHE_MAX_RUN_SIZE / LineSize, LineCount / 4));
+  Cache->MaxPinnedLines = LineCount / 2;
+  Cache->HashMask       = HashCount - 1;
+
+  Cache->Lines     = AllocateZeroPool (LineCount * sizeof (IDE_BLOCK_CACHE_LINE));
+  Cache->Data      = AllocatePool (LineCount * LineSize);
+  Cache->RunBuffer = AllocatePool (Cache->MaxRunLines * LineSize);
+  Cache->HashTable = AllocatePool (HashCount * sizeof (LIST_ENTRY));
+  if ((Cache->Lines == NULL) || (Cache->Data == NULL) ||
+      (Cache->RunBuffer == NULL) || (Cache->HashTable == NULL)) {
+    IdeBlockCacheFree (IdeDev);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < HashCount; Index++) {
+    InitializeListHead (&Cache->HashTable[Index]);
+  }
+
+  InitializeListHead (&Cache->FreeList);
+  InitializeListHead (&Cache->LruList);
+  InitializeListHead (&Cache->PinnedLruList);
+  for (Index = 0; Index < LineCount; Index++) {
+    Cache->Lines[Index].Data = Cache->Data + Index * LineSize;
+    InsertTailList (&Cache->FreeList, &Cache->Lines[Index].LruLink);
+  }
+
+  Cache->Statistics.Revision  = IDE_BLOCK_CACHE_STATISTICS_PROTOCOL_REVISION;
+  Cache->Statistics.CacheSize = (UINT32) (LineCount * LineSize);
+  Cache->Statistics.LineSize  = (UINT32) LineSize;
+  Cache->Statistics.WriteBack = FeaturePcdGet (PcdIdeBlockCacheWriteBack);
+
+  if (Cache->Statistics.WriteBack) {
+    //
+    // OS loaders may not flush before ExitBootServices(), so the modified lines
+    // are written at ReadyToBoot and the writes go to the disk from then on.
+    //
+    EfiCreateEventReadyToBootEx (
+      TPL_CALLBACK,
+      IdeBlockCacheOnReadyToBoot,
+      IdeDev,
+      &Cache->ReadyToBootEvent
+      );
+  }
+
+  Cache->LineCount = LineCount;
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the block cache of a hard disk. The modified lines are discarded, so
+  IdeBlockCacheFlush() must be called before if the disk is still present.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+**/
+VOID
+IdeBlockCacheFree (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  )
+{
+  IDE_BLOCK_CACHE  *Cache;
+
+  Cache = &IdeDev->BlockCache;
+
+  if (Cache->ReadyToBootEvent != NULL) {
+    gBS->CloseEvent (Cache->ReadyToBootEvent);
+  }
+
+  if (Cache->Lines != NULL) {
+    FreePool (Cache->Lines);
+  }
+
+  if (Cache->Data != NULL) {
+    FreePool (Cache->Data);
+  }
+
+  if (Cache->RunBuffer != NULL) {
+    FreePool (Cache->RunBuffer);
+  }
+
+  if (Cache->HashTable != NULL) {
+    FreePool (Cache->HashTable);
+  }
+
+  ZeroMem (Cache, sizeof (IDE_BLOCK_CACHE));
+}
+
+/**
+  Read blocks through the block cache. The parameters are already validated.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Buffer          A pointer to the destination buffer for the data.
+  @param  Lba             The starting logical block address to read from on the device media.
+  @param  NumberOfBlocks  The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Read Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Read Blocks failed.
+
+**/
+EFI_STATUS
+IdeBlockCacheRead (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  OUT VOID            *Buffer,
+  IN  EFI_LBA         Lba,
+  IN  UINTN           NumberOfBlocks
+  )
+{
+  EFI_STATUS            Status;
+  IDE_BLOCK_CACHE       *Cache;
+  IDE_BLOCK_CACHE_LINE  *Line;
+  UINTN                 BlockSize;
+  EFI_LBA               LineLba;
+  UINTN                 Offset;
+  UINTN                 Count;
+  UINTN                 RunLines;
+  UINTN                 ReadAheadLines;
+  UINTN                 RunBlocks;
+  UINT8                 *Buffer8;
+
+  Cache     = &IdeDev->BlockCache;
+  BlockSize = IdeDev->BlkIo.Media->BlockSize;
+  Buffer8   = (UINT8 *) Buffer;
+
+  //
+  // Double the read ahead for each read which follows the previous one, and stop
+  // it on the first read which does not.
+  //
+  if (Lba == Cache->NextLba) {
+    Cache->ReadAheadLines = MIN (MAX (Cache->ReadAheadLines * 2, 1), Cache->MaxRunLines);
+  } else {
+    Cache->ReadAheadLines = 0;
+  }
+  Cache->NextLba = Lba + NumberOfBlocks;
+
+  if (NumberOfBlocks > Cache->MaxRunLines * Cache->LineBlocks) {
+    //
+    // Large requests go to the disk directly, after the modified lines they cover
+    //
+    Status = IdeBlockCacheFlushRange (IdeDev, Lba, NumberOfBlocks);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Cache->Statistics.BypassReadBlocks += NumberOfBlocks;
+    return AtaDeviceReadBlocks (IdeDev, Buffer, Lba, NumberOfBlocks);
+  }
+
+  while (NumberOfBlocks > 0) {
+    LineLba = Lba & ~((EFI_LBA) Cache->LineBlocks - 1);
+    Offset  = (UINTN) (Lba - LineLba);
+    Line    = IdeBlockCacheLookup (Cache, LineLba);
+
+    if (Line != NULL) {
+      Count = MIN (NumberOfBlocks, Cache->LineBlocks - Offset);
+      CopyMem (Buffer8, Line->Data + Offset * BlockSize, Count * BlockSize);
+      IdeBlockCacheTouch (Cache, Line);
+      Cache->Statistics.ReadHitBlocks += Count;
+    } else {
+      //
+      // Read the missing lines of the request from here on, up to the next cached
+      // line, followed by the read ahead lines.
+      //
+      RunLines = 1;
+      while ((RunLines < Cache->MaxRunLines) &&
+             (LineLba + RunLines * Cache->LineBlocks < Lba + NumberOfBlocks) &&
+             (IdeBlockCacheLookup (Cache, LineLba + RunLines * Cache->LineBlocks) == NULL)) {
+        RunLines++;
+      }
+
+      ReadAheadLines = 0;
+      while ((RunLines < Cache->MaxRunLines) &&
+             (ReadAheadLines < Cache->ReadAheadLines) &&
+             (LineLba + RunLines * Cache->LineBlocks <= IdeDev->BlkIo.Media->LastBlock) &&
+             (IdeBlockCacheLookup (Cache, LineLba + RunLines * Cache->LineBlocks) == NULL)) {
+        RunLines++;
+        ReadAheadLines++;
+      }
+
+      Status = IdeBlockCacheFillRun (IdeDev, LineLba, RunLines, &RunBlocks);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      Count = MIN (NumberOfBlocks, (RunLines - ReadAheadLines) * Cache->LineBlocks - Offset);
+      CopyMem (Buffer8, Cache->RunBuffer + Offset * BlockSize, Count * BlockSize);
+      Cache->Statistics.ReadMissBlocks  += Count;
+      Cache->Statistics.ReadAheadBlocks += RunBlocks - MIN (RunBlocks, (RunLines - ReadAheadLines) * Cache->LineBlocks);
+    }
+
+    Buffer8        += Count * BlockSize;
+    Lba            += Count;
+    NumberOfBlocks -= Count;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write blocks through the block cache. The parameters are already validated.
+
+  In write-back mode, the blocks are copied into lines which are marked as
+  modified, reading the rest of the lines from the disk first if needed.
+  Otherwise, or for large requests, the blocks are written onto the disk
+  and copied into the lines which are in the cache.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Buffer          A pointer to the source buffer for the data.
+  @param  Lba             The starting logical block address to write onto the device media.
+  @param  NumberOfBlocks  The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Write Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Write Blocks failed.
+
+**/
+EFI_STATUS
+IdeBlockCacheWrite (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN VOID            *Buffer,
+  IN EFI_LBA         Lba,
+  IN UINTN           NumberOfBlocks
+  )
+{
+  EFI_STATUS            Status;
+  IDE_BLOCK_CACHE       *Cache;
+  IDE_BLOCK_CACHE_LINE  *Line;
+  UINTN                 BlockSize;
+  EFI_LBA               LineLba;
+  UINTN                 Offset;
+  UINTN                 Count;
+  UINTN                 LineBlocks;
+  BOOLEAN               WriteBack;
+  UINT8                 *Buffer8;
+
+  Cache     = &IdeDev->BlockCache;
+  BlockSize = IdeDev->BlkIo.Media->BlockSize;
+  Buffer8   = (UINT8 *) Buffer;
+
+  Cache->Statistics.WriteBlocks += NumberOfBlocks;
+
+  WriteBack = (BOOLEAN) (Cache->Statistics.WriteBack &&
+                         (NumberOfBlocks <= Cache->MaxRunLines * Cache->LineBlocks));
+  if (!WriteBack) {
+    Status = AtaDeviceWriteBlocks (IdeDev, Buffer, Lba, NumberOfBlocks);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  while (NumberOfBlocks > 0) {
+    LineLba = Lba & ~((EFI_LBA) Cache->LineBlocks - 1);
+    Offset  = (UINTN) (Lba - LineLba);
+    Count   = MIN (NumberOfBlocks, Cache->LineBlocks - Offset);
+    Line    = IdeBlockCacheLookup (Cache, LineLba);
+
+    if ((Line == NULL) && WriteBack) {
+      Status = IdeBlockCacheAllocateLine (IdeDev, LineLba, &Line);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      LineBlocks = IdeBlockCacheLineBlocks (IdeDev, LineLba);
+      if (Count < LineBlocks) {
+        Status = AtaDeviceReadBlocks (IdeDev, Line->Data, LineLba, LineBlocks);
+        if (EFI_ERROR (Status)) {
+          IdeBlockCacheFreeLine (Cache, Line);
+          return Status;
+        }
+      }
+    }
+
+    if (Line != NULL) {
+      //
+      // A modified line written through stays modified, its data is the same
+      // as on the disk for the blocks just written only.
+      //
+      CopyMem (Line->Data + Offset * BlockSize, Buffer8, Count * BlockSize);
+      if (WriteBack && !Line->Dirty) {
+        Line->Dirty = TRUE;
+        Cache->DirtyCount++;
+      }
+      IdeBlockCacheTouch (Cache, Line);
+    }
+
+    Buffer8        += Count * BlockSize;
+    Lba            += Count;
+    NumberOfBlocks -= Count;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write all the modified lines of the block cache onto the disk.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+  @retval EFI_SUCCESS       No line is modified any more.
+  @retval EFI_DEVICE_ERROR  A line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheFlush (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  )
+{
+  EFI_STATUS       Status;
+  EFI_STATUS       FlushStatus;
+  IDE_BLOCK_CACHE  *Cache;
+  UINTN            Index;
+
+  Cache       = &IdeDev->BlockCache;
+  FlushStatus = EFI_SUCCESS;
+
+  for (Index = 0; (Index < Cache->LineCount) && (Cache->DirtyCount != 0); Index++) {
+    if (Cache->Lines[Index].Dirty) {
+      Status = IdeBlockCacheWriteLine (IdeDev, &Cache->Lines[Index]);
+      if (EFI_ERROR (Status)) {
+        FlushStatus = Status;
+      }
+    }
+  }
+
+  return FlushStatus;
+}
+
+/**
+  Write the modified lines onto the disk at ReadyToBoot, and switch the block
+  cache to write through for the rest of the boot.
+
+  @param  Event    Pointer to this event
+  @param  Context  Event handler private data, the IDE device
+
+**/
+VOID
+EFIAPI
+IdeBlockCacheOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  IDE_BLK_IO_DEV  *IdeDev;
+  EFI_STATUS      Status;
+
+  IdeDev = (IDE_BLK_IO_DEV *) Context;
+
+  gBS->CloseEvent (Event);
+  IdeDev->BlockCache.ReadyToBootEvent = NULL;
+
+  IdeAsyncDrainChannel (IdeDev);
+  ReassignIdeResources (IdeDev);
+  Status = IdeBlockCacheFlush (IdeDev);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "IdeBlockCacheOnReadyToBoot()-- %a : %r\n", IdeDev->ModelName, Status));
+  }
+
+  IdeDev->BlockCache.Statistics.WriteBack = FALSE;
+}
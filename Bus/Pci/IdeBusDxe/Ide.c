@@ -14,12 +14,6 @@
 
 #include "IdeBus.h"
 
-BOOLEAN ChannelDeviceDetected = FALSE;
-BOOLEAN SlaveDeviceExist      = FALSE;
-UINT8   SlaveDeviceType       = INVALID_DEVICE_TYPE;
-BOOLEAN MasterDeviceExist     = FALSE;
-UINT8   MasterDeviceType      = INVALID_DEVICE_TYPE;
-
 /**
   read a one-byte data from a IDE port.
 
@@ -108,6 +102,81 @@ IDEReadPortWMultiple (
   gBS->FreePool (WorkingBuffer);
 }
 
+/**
+  Reads multiple dwords of data from the IDE data port.
+  Call the IO abstraction once to do the complete read,
+  not one dword at a time
+
+  @param  PciIo Pointer to the EFI_PCI_IO instance
+  @param  Port IO port to read
+  @param  Count No. of UINT32's to read
+  @param  Buffer Pointer to the data buffer for read
+
+  @retval EFI_SUCCESS          The data was read.
+  @retval EFI_OUT_OF_RESOURCES No aligned working buffer could be allocated.
+  @retval Others               The IO abstraction failed to read the port with 32-bit accesses.
+
+**/
+EFI_STATUS
+IDEReadPortDMultiple (
+  IN  EFI_PCI_IO_PROTOCOL   *PciIo,
+  IN  UINT16                Port,
+  IN  UINTN                 Count,
+  OUT VOID                  *Buffer
+  )
+{
+  UINT32      *AlignedBuffer;
+  UINT32      *WorkingBuffer;
+  UINTN       Size;
+  EFI_STATUS  Status;
+
+  //
+  // CpuIo will return failure and not perform actual I/O operations if buffer
+  // pointer passed in is not at natural boundary, so only a buffer which is
+  // not 32-bit aligned is read through an alligned working buffer.
+  //
+  Size          = sizeof (UINT32) * Count;
+  WorkingBuffer = NULL;
+  AlignedBuffer = (UINT32 *) Buffer;
+
+  if (((UINTN) Buffer & 0x3) != 0) {
+    Status = gBS->AllocatePool (
+                    EfiBootServicesData,
+                    Size + 3,
+                    (VOID **) &WorkingBuffer
+                    );
+    if (EFI_ERROR (Status)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    AlignedBuffer = (UINT32 *) ((UINTN)(((UINTN) WorkingBuffer + 0x3) & (~0x3)));
+  }
+
+  //
+  // Perform UINT32 data read from FIFO
+  //
+  Status = PciIo->Io.Read (
+                      PciIo,
+                      EfiPciIoWidthFifoUint32,
+                      EFI_PCI_IO_PASS_THROUGH_BAR,
+                      (UINT64) Port,
+                      Count,
+                      AlignedBuffer
+                      );
+
+  if (WorkingBuffer != NULL) {
+    //
+    // Copy data to user buffer
+    //
+    if (!EFI_ERROR (Status)) {
+      CopyMem (Buffer, AlignedBuffer, Size);
+    }
+    gBS->FreePool (WorkingBuffer);
+  }
+
+  return Status;
+}
+
 /**
   write a 1-byte data to a specific IDE port.
 
@@ -221,6 +290,76 @@ IDEWritePortWMultiple (
 
   gBS->FreePool (WorkingBuffer);
 }
+
+/**
+  Write multiple dwords of data to the IDE data port.
+  Call the IO abstraction once to do the complete write,
+  not one dword at a time
+
+  @param  PciIo Pointer to the EFI_PCI_IO instance
+  @param  Port IO port to write
+  @param  Count No. of UINT32's to write
+  @param  Buffer Pointer to the data buffer for write
+
+  @retval EFI_SUCCESS          The data was written.
+  @retval EFI_OUT_OF_RESOURCES No aligned working buffer could be allocated.
+  @retval Others               The IO abstraction failed to write the port with 32-bit accesses.
+
+**/
+EFI_STATUS
+IDEWritePortDMultiple (
+  IN  EFI_PCI_IO_PROTOCOL   *PciIo,
+  IN  UINT16                Port,
+  IN  UINTN                 Count,
+  IN  VOID                  *Buffer
+  )
+{
+  UINT32      *AlignedBuffer;
+  UINT32      *WorkingBuffer;
+  UINTN       Size;
+  EFI_STATUS  Status;
+
+  //
+  // CpuIo will return failure and not perform actual I/O operations if buffer
+  // pointer passed in is not at natural boundary, so only a buffer which is
+  // not 32-bit aligned is copied to an alligned working buffer.
+  //
+  Size          = sizeof (UINT32) * Count;
+  WorkingBuffer = NULL;
+  AlignedBuffer = (UINT32 *) Buffer;
+
+  if (((UINTN) Buffer & 0x3) != 0) {
+    Status = gBS->AllocatePool (
+                    EfiBootServicesData,
+                    Size + 3,
+                    (VOID **) &WorkingBuffer
+                    );
+    if (EFI_ERROR (Status)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    AlignedBuffer = (UINT32 *) ((UINTN)(((UINTN) WorkingBuffer + 0x3) & (~0x3)));
+    CopyMem (AlignedBuffer, Buffer, Size);
+  }
+
+  //
+  // perform UINT32 data write to the FIFO
+  //
+  Status = PciIo->Io.Write (
+                       PciIo,
+                       EfiPciIoWidthFifoUint32,
+                       EFI_PCI_IO_PASS_THROUGH_BAR,
+                       (UINT64) Port,
+                       Count,
+                       AlignedBuffer
+                       );
+
+  if (WorkingBuffer != NULL) {
+    gBS->FreePool (WorkingBuffer);
+  }
+
+  return Status;
+}
 /**
   Get IDE IO port registers' base addresses by mode. In 'Compatibility' mode,
   use fixed addresses. In Native-PCI mode, get base addresses from BARs in
@@ -402,9 +541,7 @@ ReassignIdeResources (
 }
 
 /**
-  This function is called by DiscoverIdeDevice(). It is used for detect
-  whether the IDE device exists in the specified Channel as the specified
-  Device Number.
+  Start the detection of the IDE devices attached to a channel.
 
   There is two IDE channels: one is Primary Channel, the other is
   Secondary Channel.(Channel is the logical name for the physical "Cable".)
@@ -417,27 +554,21 @@ ReassignIdeResources (
   register, it is a must to select the current device to accept the command
   by set the device number in the Head/Device Register.
 
-  @param IdeDev  pointer to IDE_BLK_IO_DEV data structure, used to record all the
-                 information of the IDE device.
-
-  @retval EFI_SUCCESS successfully detects device.
+  The ATA Execute Device Diagnostic command is sent to the channel, after which
+  both devices report their signature. The channel stays busy until the devices
+  are done with the diagnostic, see DetectIdeChannelEnd().
 
-  @retval other       any failure during detection process will return this value.
+  @param IdeDev         pointer to IDE_BLK_IO_DEV data structure of a device of
+                        the channel, whose registers are used.
+  @param InitStatusReg  the status register of the slave device before the command.
 
 **/
-EFI_STATUS
-DetectIDEController (
-  IN  IDE_BLK_IO_DEV  *IdeDev
+VOID
+DetectIdeChannelStart (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  OUT UINT8           *InitStatusReg
   )
 {
-  EFI_STATUS  Status;
-  UINT8       SectorCountReg;
-  UINT8       LBALowReg;
-  UINT8       LBAMidReg;
-  UINT8       LBAHighReg;
-  UINT8       InitStatusReg;
-  UINT8       StatusReg;
-
   //
   // Select slave device
   //
@@ -451,7 +582,7 @@ DetectIDEController (
   //
   // Save the init slave status register
   //
-  InitStatusReg = IDEReadPortB (IdeDev->PciIo, IdeDev->IoPort->Reg.Status);
+  *InitStatusReg = IDEReadPortB (IdeDev->PciIo, IdeDev->IoPort->Reg.Status);
 
   //
   // Select Master back
@@ -468,12 +599,36 @@ DetectIDEController (
   // This command should work no matter DRDY is ready or not
   //
   IDEWritePortB (IdeDev->PciIo, IdeDev->IoPort->Reg.Command, 0x90);
+}
+
+/**
+  End the detection of the IDE devices attached to a channel, once the channel
+  is not busy with the ATA Execute Device Diagnostic command any more: read the
+  signature of the devices, and record their type in the private data of the
+  controller.
+
+  @param IdeDev         pointer to IDE_BLK_IO_DEV data structure of a device of
+                        the channel, whose registers are used.
+  @param InitStatusReg  the status register of the slave device before the command.
+
+**/
+VOID
+DetectIdeChannelEnd (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINT8           InitStatusReg
+  )
+{
+  UINT8       SectorCountReg;
+  UINT8       LBALowReg;
+  UINT8       LBAMidReg;
+  UINT8       LBAHighReg;
+  UINT8       StatusReg;
+  UINT8       MasterDeviceType;
+  UINT8       SlaveDeviceType;
+
+  MasterDeviceType = INVALID_DEVICE_TYPE;
+  SlaveDeviceType  = INVALID_DEVICE_TYPE;
 
-  Status    = WaitForBSYClear (IdeDev, 3500);
-  if (EFI_ERROR (Status)) {
-    DEBUG((EFI_D_ERROR, "New detecting method: Send Execute Diagnostic Command: WaitForBSYClear: Status: %d\n", Status));
-    return Status;
-  }
   //
   // Read device signature
   //
@@ -506,12 +661,10 @@ DetectIDEController (
       (LBALowReg      == 0x1) &&
       (LBAMidReg      == 0x0) &&
       (LBAHighReg     == 0x0)) {
-    MasterDeviceExist = TRUE;
     MasterDeviceType  = ATA_DEVICE_TYPE;
   } else {
     if ((LBAMidReg      == 0x14) &&
         (LBAHighReg     == 0xeb)) {
-      MasterDeviceExist = TRUE;
       MasterDeviceType  = ATAPI_DEVICE_TYPE;
     }
   }
@@ -521,7 +674,7 @@ DetectIDEController (
   // the right signature when operating in single slave mode.
   // We stall 20ms to work around this.
   //
-  if (!MasterDeviceExist) {
+  if (MasterDeviceType == INVALID_DEVICE_TYPE) {
     gBS->Stall (20000);
   }
 
@@ -558,12 +711,10 @@ DetectIDEController (
       (LBALowReg      == 0x1) &&
       (LBAMidReg      == 0x0) &&
       (LBAHighReg     == 0x0)) {
-    SlaveDeviceExist = TRUE;
     SlaveDeviceType  = ATA_DEVICE_TYPE;
   } else {
     if ((LBAMidReg     == 0x14) &&
         (LBAHighReg    == 0xeb)) {
-      SlaveDeviceExist = TRUE;
       SlaveDeviceType  = ATAPI_DEVICE_TYPE;
     }
   }
@@ -575,19 +726,100 @@ DetectIDEController (
   // register.
   // NOTE: This workaround doesn't apply to ATAPI.
   //
-  if (MasterDeviceExist && SlaveDeviceExist &&
+  if (MasterDeviceType != INVALID_DEVICE_TYPE &&
       (StatusReg & ATA_STSREG_DRDY) == 0               &&
       (InitStatusReg & ATA_STSREG_DRDY) == 0           &&
       MasterDeviceType == SlaveDeviceType   &&
       SlaveDeviceType != ATAPI_DEVICE_TYPE) {
-    SlaveDeviceExist = FALSE;
+    SlaveDeviceType = INVALID_DEVICE_TYPE;
   }
 
   //
   // Indicate this channel has been detected
   //
-  ChannelDeviceDetected = TRUE;
-  return EFI_SUCCESS;
+  IdeDev->IdeBusDriverPrivateData->DeviceType[IdeDev->Channel * 2 + IdeMaster] = MasterDeviceType;
+  IdeDev->IdeBusDriverPrivateData->DeviceType[IdeDev->Channel * 2 + IdeSlave]  = SlaveDeviceType;
+  IdeDev->IdeBusDriverPrivateData->ChannelDetected[IdeDev->Channel]            = TRUE;
+}
+
+/**
+  Detect the IDE devices attached to channels of an IDE controller. The ATA
+  Execute Device Diagnostic command is sent to all the channels first, and the
+  channels are then polled together, so that the time the devices take to run
+  their diagnostic and to spin up is only waited once.
+
+  The type of the devices found is recorded in the private data of the
+  controller, and the channels are not detected again until the controller is
+  stopped. A channel which stays busy is recorded without devices.
+
+  @param IdeBusDriverPrivateData  The private data of the IDE controller.
+  @param IdeDev                   For each channel, pointer to IDE_BLK_IO_DEV data
+                                  structure of a device of the channel, or NULL
+                                  to not detect the channel.
+
+**/
+VOID
+DetectIdeChannels (
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData,
+  IN     IDE_BLK_IO_DEV               *IdeDev[MAX_IDE_CHANNELS]
+  )
+{
+  UINTN    Channel;
+  UINT8    InitStatusReg[MAX_IDE_CHANNELS];
+  BOOLEAN  ChannelBusy[MAX_IDE_CHANNELS];
+  BOOLEAN  Busy;
+  UINT32   Delay;
+  UINT8    StatusReg;
+
+  for (Channel = 0; Channel < MAX_IDE_CHANNELS; Channel++) {
+    ChannelBusy[Channel] = FALSE;
+    if (IdeDev[Channel] != NULL) {
+      DetectIdeChannelStart (IdeDev[Channel], &InitStatusReg[Channel]);
+      ChannelBusy[Channel] = TRUE;
+    }
+  }
+
+  //
+  // Wait for BSY clear on all the channels, for up to 3.5 seconds
+  //
+  Delay = (UINT32) (((3500 * STALL_1_MILLI_SECOND) / 30) + 1);
+  do {
+    Busy = FALSE;
+    for (Channel = 0; Channel < MAX_IDE_CHANNELS; Channel++) {
+      if (!ChannelBusy[Channel]) {
+        continue;
+      }
+
+      StatusReg = IDEReadPortB (IdeDev[Channel]->PciIo, IdeDev[Channel]->IoPort->Reg.Status);
+      if ((StatusReg & ATA_STSREG_BSY) == 0x00) {
+        DetectIdeChannelEnd (IdeDev[Channel], InitStatusReg[Channel]);
+        ChannelBusy[Channel] = FALSE;
+      } else {
+        Busy = TRUE;
+      }
+    }
+
+    if (!Busy) {
+      break;
+    }
+
+    //
+    // Stall for 30 us
+    //
+    gBS->Stall (30);
+
+    Delay--;
+
+  } while (Delay > 0);
+
+  for (Channel = 0; Channel < MAX_IDE_CHANNELS; Channel++) {
+    if (ChannelBusy[Channel]) {
+      DEBUG ((EFI_D_ERROR, "Send Execute Diagnostic Command: channel %d stays busy\n", Channel));
+      IdeBusDriverPrivateData->DeviceType[Channel * 2 + IdeMaster] = INVALID_DEVICE_TYPE;
+      IdeBusDriverPrivateData->DeviceType[Channel * 2 + IdeSlave]  = INVALID_DEVICE_TYPE;
+      IdeBusDriverPrivateData->ChannelDetected[Channel]            = TRUE;
+    }
+  }
 }
 /**
   Detect if there is disk attached to this port
@@ -603,63 +835,44 @@ DiscoverIdeDevice (
   IN IDE_BLK_IO_DEV *IdeDev
   )
 {
-  EFI_STATUS  Status;
-  EFI_STATUS  LongPhyStatus;
+  EFI_STATUS      Status;
+  EFI_STATUS      LongPhyStatus;
+  IDE_BLK_IO_DEV  *DetectDevice[MAX_IDE_CHANNELS];
+  UINT8           *DeviceType;
 
   //
   // If a channel has not been checked, check it now. Then set it to "checked" state
   // After this step, all devices in this channel have been checked.
   //
-  if (!ChannelDeviceDetected) {
-    Status = DetectIDEController (IdeDev);
-    if (EFI_ERROR (Status)) {
-      return EFI_NOT_FOUND;
-    }
+  if (!IdeDev->IdeBusDriverPrivateData->ChannelDetected[IdeDev->Channel]) {
+    ZeroMem (DetectDevice, sizeof (DetectDevice));
+    DetectDevice[IdeDev->Channel] = IdeDev;
+    DetectIdeChannels (IdeDev->IdeBusDriverPrivateData, DetectDevice);
   }
 
-  Status = EFI_NOT_FOUND;
+  Status     = EFI_NOT_FOUND;
+  DeviceType = &IdeDev->IdeBusDriverPrivateData->DeviceType[IdeDev->Channel * 2 + IdeDev->Device];
 
   //
   // Device exists. test if it is an ATA device.
-  // Prefer the result from DetectIDEController,
+  // Prefer the result from DetectIdeChannels(),
   // if failed, try another device type to handle
   // devices that not follow the spec.
   //
-  if ((IdeDev->Device == IdeMaster) && (MasterDeviceExist)) {
-    if (MasterDeviceType == ATA_DEVICE_TYPE) {
-      Status = ATAIdentify (IdeDev);
-      if (EFI_ERROR (Status)) {
-        Status = ATAPIIdentify (IdeDev);
-        if (!EFI_ERROR (Status)) {
-          MasterDeviceType = ATAPI_DEVICE_TYPE;
-        }
-      }
-    } else {
+  if (*DeviceType == ATA_DEVICE_TYPE) {
+    Status = ATAIdentify (IdeDev);
+    if (EFI_ERROR (Status)) {
       Status = ATAPIIdentify (IdeDev);
-      if (EFI_ERROR (Status)) {
-        Status = ATAIdentify (IdeDev);
-        if (!EFI_ERROR (Status)) {
-          MasterDeviceType = ATA_DEVICE_TYPE;
-        }
+      if (!EFI_ERROR (Status)) {
+        *DeviceType = ATAPI_DEVICE_TYPE;
       }
     }
-  }
-  if ((IdeDev->Device == IdeSlave) && (SlaveDeviceExist)) {
-    if (SlaveDeviceType == ATA_DEVICE_TYPE) {
+  } else if (*DeviceType == ATAPI_DEVICE_TYPE) {
+    Status = ATAPIIdentify (IdeDev);
+    if (EFI_ERROR (Status)) {
       Status = ATAIdentify (IdeDev);
-      if (EFI_ERROR (Status)) {
-        Status = ATAPIIdentify (IdeDev);
-        if (!EFI_ERROR (Status)) {
-          SlaveDeviceType = ATAPI_DEVICE_TYPE;
-        }
-      }
-    } else {
-      Status = ATAPIIdentify (IdeDev);
-      if (EFI_ERROR (Status)) {
-        Status = ATAIdentify (IdeDev);
-        if (!EFI_ERROR (Status)) {
-          SlaveDeviceType = ATA_DEVICE_TYPE;
-        }
+      if (!EFI_ERROR (Status)) {
+        *DeviceType = ATA_DEVICE_TYPE;
       }
     }
   }
@@ -680,6 +893,12 @@ DiscoverIdeDevice (
   IdeDev->BlkIo.WriteBlocks         = IDEBlkIoWriteBlocks;
   IdeDev->BlkIo.FlushBlocks         = IDEBlkIoFlushBlocks;
 
+  IdeDev->BlkIo2.Media              = IdeDev->BlkIo.Media;
+  IdeDev->BlkIo2.Reset              = IDEBlkIo2Reset;
+  IdeDev->BlkIo2.ReadBlocksEx       = IDEBlkIo2ReadBlocksEx;
+  IdeDev->BlkIo2.WriteBlocksEx      = IDEBlkIo2WriteBlocksEx;
+  IdeDev->BlkIo2.FlushBlocksEx      = IDEBlkIo2FlushBlocksEx;
+
   IdeDev->BlkMedia.LogicalPartition = FALSE;
   IdeDev->BlkMedia.WriteCaching     = FALSE;
 
@@ -695,21 +914,6 @@ DiscoverIdeDevice (
   return EFI_SUCCESS;
 }
 
-/**
-  This interface is used to initialize all state data related to the detection of one
-  channel.
-**/
-VOID
-InitializeIDEChannelData (
-  VOID
-  )
-{
-  ChannelDeviceDetected = FALSE;
-  MasterDeviceExist = FALSE;
-  MasterDeviceType  = 0xff;
-  SlaveDeviceExist  = FALSE;
-  SlaveDeviceType   = 0xff;
-}
 /**
   This function is used to poll for the DRQ bit clear in the Status
   Register. DRQ is cleared when the device is finished transferring data.
@@ -1185,6 +1389,8 @@ ReleaseIdeResources (
     IdeBlkIoDevice->Cache = NULL;
   }
 
+  IdeBlockCacheFree (IdeBlkIoDevice);
+
   if (IdeBlkIoDevice->IdData != NULL) {
     gBS->FreePool (IdeBlkIoDevice->IdData);
     IdeBlkIoDevice->IdData = NULL;
@@ -1218,6 +1424,99 @@ ReleaseIdeResources (
 
   return ;
 }
+/**
+  Allocate the PRD table of a channel and map it for bus master access.
+
+  @param PciIo          The PCI I/O protocol of the IDE controller.
+  @param PrdTable       The PRD table of the channel.
+
+  @retval EFI_SUCCESS          The PRD table is allocated and mapped.
+  @retval EFI_OUT_OF_RESOURCES The PRD table cannot be allocated or mapped.
+
+**/
+EFI_STATUS
+AllocateIdePrdTable (
+  IN     EFI_PCI_IO_PROTOCOL  *PciIo,
+  IN OUT IDE_PRD_TABLE        *PrdTable
+  )
+{
+  EFI_STATUS            Status;
+  VOID                  *Buffer;
+  UINTN                 Bytes;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  VOID                  *Mapping;
+  UINTN                 Offset;
+
+  Status = PciIo->AllocateBuffer (
+                    PciIo,
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    IDE_PRD_TABLE_PAGES,
+                    &Buffer,
+                    0
+                    );
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Bytes  = EFI_PAGES_TO_SIZE (IDE_PRD_TABLE_PAGES);
+  Status = PciIo->Map (
+                    PciIo,
+                    EfiPciIoOperationBusMasterCommonBuffer,
+                    Buffer,
+                    &Bytes,
+                    &DeviceAddress,
+                    &Mapping
+                    );
+  if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (IDE_PRD_TABLE_PAGES))) {
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, Mapping);
+    }
+    PciIo->FreeBuffer (PciIo, IDE_PRD_TABLE_PAGES, Buffer);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // The bus master reads the PRD table from one 64K region
+  //
+  Offset = 0;
+  if ((DeviceAddress & 0xFFFF) > 0x10000 - IDE_PRD_TABLE_ENTRIES * sizeof (IDE_DMA_PRD)) {
+    Offset = (UINTN) (0x10000 - (DeviceAddress & 0xFFFF));
+  }
+
+  ZeroMem (Buffer, EFI_PAGES_TO_SIZE (IDE_PRD_TABLE_PAGES));
+  PrdTable->Buffer        = Buffer;
+  PrdTable->Mapping       = Mapping;
+  PrdTable->Entry         = (IDE_DMA_PRD *) ((UINT8 *) Buffer + Offset);
+  PrdTable->DeviceAddress = DeviceAddress + Offset;
+
+  return EFI_SUCCESS;
+}
+/**
+  Unmap and free the PRD tables of the channels of an IDE controller.
+
+  @param PciIo                   The PCI I/O protocol of the IDE controller.
+  @param IdeBusDriverPrivateData The private data of the IDE controller.
+
+**/
+VOID
+FreeIdePrdTables (
+  IN     EFI_PCI_IO_PROTOCOL          *PciIo,
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData
+  )
+{
+  UINTN          Index;
+  IDE_PRD_TABLE  *PrdTable;
+
+  for (Index = 0; Index < MAX_IDE_CHANNELS; Index++) {
+    PrdTable = &IdeBusDriverPrivateData->PrdTable[Index];
+    if (PrdTable->Buffer != NULL) {
+      PciIo->Unmap (PciIo, PrdTable->Mapping);
+      PciIo->FreeBuffer (PciIo, IDE_PRD_TABLE_PAGES, PrdTable->Buffer);
+      ZeroMem (PrdTable, sizeof (IDE_PRD_TABLE));
+    }
+  }
+}
 /**
   Set the calculated Best transfer mode to a detected device.
 
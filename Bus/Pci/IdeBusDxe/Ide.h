@@ -57,6 +57,29 @@ IDEReadPortWMultiple (
   OUT  VOID                 *Buffer
   );
 
+/**
+  Reads multiple dwords of data from the IDE data port.
+  Call the IO abstraction once to do the complete read,
+  not one dword at a time
+
+  @param  PciIo Pointer to the EFI_PCI_IO instance
+  @param  Port IO port to read
+  @param  Count No. of UINT32's to read
+  @param  Buffer Pointer to the data buffer for read
+
+  @retval EFI_SUCCESS          The data was read.
+  @retval EFI_OUT_OF_RESOURCES No aligned working buffer could be allocated.
+  @retval Others               The IO abstraction failed to read the port with 32-bit accesses.
+
+**/
+EFI_STATUS
+IDEReadPortDMultiple (
+  IN  EFI_PCI_IO_PROTOCOL   *PciIo,
+  IN  UINT16                Port,
+  IN  UINTN                 Count,
+  OUT VOID                  *Buffer
+  );
+
 /**
   write a 1-byte data to a specific IDE port.
 
@@ -104,6 +127,29 @@ IDEWritePortWMultiple (
   IN  VOID                  *Buffer
   );
 
+/**
+  Write multiple dwords of data to the IDE data port.
+  Call the IO abstraction once to do the complete write,
+  not one dword at a time
+
+  @param  PciIo Pointer to the EFI_PCI_IO instance
+  @param  Port IO port to write
+  @param  Count No. of UINT32's to write
+  @param  Buffer Pointer to the data buffer for write
+
+  @retval EFI_SUCCESS          The data was written.
+  @retval EFI_OUT_OF_RESOURCES No aligned working buffer could be allocated.
+  @retval Others               The IO abstraction failed to write the port with 32-bit accesses.
+
+**/
+EFI_STATUS
+IDEWritePortDMultiple (
+  IN  EFI_PCI_IO_PROTOCOL   *PciIo,
+  IN  UINT16                Port,
+  IN  UINTN                 Count,
+  IN  VOID                  *Buffer
+  );
+
 /**
   Get IDE IO port registers' base addresses by mode. In 'Compatibility' mode,
   use fixed addresses. In Native-PCI mode, get base addresses from BARs in
@@ -198,13 +244,24 @@ DiscoverIdeDevice (
   );
 
 /**
-  This interface is used to initialize all state data related to the
-  detection of one channel.
+  Detect the IDE devices attached to channels of an IDE controller. The ATA
+  Execute Device Diagnostic command is sent to all the channels first, and the
+  channels are then polled together.
+
+  The type of the devices found is recorded in the private data of the
+  controller, and the channels are not detected again until the controller is
+  stopped.
+
+  @param IdeBusDriverPrivateData  The private data of the IDE controller.
+  @param IdeDev                   For each channel, pointer to IDE_BLK_IO_DEV data
+                                  structure of a device of the channel, or NULL
+                                  to not detect the channel.
 
 **/
 VOID
-InitializeIDEChannelData (
-  VOID
+DetectIdeChannels (
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData,
+  IN     IDE_BLK_IO_DEV               *IdeDev[MAX_IDE_CHANNELS]
   );
 
 /**
@@ -417,6 +474,81 @@ VOID
 PrintAtaModuleName (
   IN  IDE_BLK_IO_DEV  *IdeDev
   );
+/**
+  Get the size of the data block the device transfers for each DRQ assertion
+  of a PIO data command.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+  @param AtaCommand   value of the Command Register
+
+  @return the size in words of a DRQ data block, which is one sector except for
+          READ/WRITE MULTIPLE (EXT), where it is the block of sectors set by
+          SET MULTIPLE MODE.
+
+**/
+UINTN
+AtaPioDrqBlockWords (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINT8           AtaCommand
+  );
+
+/**
+  Read a data block from the data register of the IDE device in PIO mode.
+  32-bit accesses are used when they are enabled for the device and the block
+  is a whole number of dwords; 16-bit accesses are used otherwise, and for the
+  following blocks if the 32-bit accesses fail.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+  @param WordCount    No. of UINT16's to read
+  @param Buffer       Pointer to the data buffer for read
+
+**/
+VOID
+AtaPioReadData (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINTN           WordCount,
+  OUT VOID            *Buffer
+  );
+
+/**
+  Write a data block to the data register of the IDE device in PIO mode.
+  32-bit accesses are used when they are enabled for the device and the block
+  is a whole number of dwords; 16-bit accesses are used otherwise, and for the
+  following blocks if the 32-bit accesses fail.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+  @param WordCount    No. of UINT16's to write
+  @param Buffer       Pointer to the data buffer for write
+
+**/
+VOID
+AtaPioWriteData (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  UINTN           WordCount,
+  IN  VOID            *Buffer
+  );
+
+/**
+  Check if the device aborted the READ/WRITE MULTIPLE (EXT) command just sent,
+  which happens when it has lost the multiple mode set at initialization, and
+  disable the multiple mode for the device in that case. The caller can then
+  retry the transfer with the single sector commands.
+
+  @param IdeDev       pointer pointing to IDE_BLK_IO_DEV data structure, used to record
+                      all the information of the IDE device.
+
+  @retval TRUE   The command was aborted and the multiple mode is disabled.
+  @retval FALSE  The command failed for another reason.
+
+**/
+BOOLEAN
+AtaMultipleModeAborted (
+  IN  IDE_BLK_IO_DEV  *IdeDev
+  );
+
 /**
   This function is used to send out ATA commands conforms to the PIO Data In Protocol.
 
@@ -522,6 +654,143 @@ AtaSoftReset (
   IN  IDE_BLK_IO_DEV  *IdeDev
   );
 
+/**
+  Read blocks from the media of an ATA device, without going through the
+  block cache.
+
+  @param IdeBlkIoDevice Indicates the calling context.
+  @param Buffer         A pointer to the destination buffer for the data.
+  @param Lba            The starting logical block address to read from on the device media.
+  @param NumberOfBlocks The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Read Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Read Blocks failed. The device is reset by AtaSoftReset().
+
+**/
+EFI_STATUS
+AtaDeviceReadBlocks (
+  IN  IDE_BLK_IO_DEV  *IdeBlkIoDevice,
+  OUT VOID            *Buffer,
+  IN  EFI_LBA         Lba,
+  IN  UINTN           NumberOfBlocks
+  );
+
+/**
+  Write blocks onto the media of an ATA device, without going through the
+  block cache.
+
+  @param IdeBlkIoDevice Indicates the calling context.
+  @param Buffer         A pointer to the source buffer for the data.
+  @param Lba            The starting logical block address to write onto the device media.
+  @param NumberOfBlocks The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Write Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Write Blocks failed. The device is reset by AtaSoftReset().
+
+**/
+EFI_STATUS
+AtaDeviceWriteBlocks (
+  IN  IDE_BLK_IO_DEV  *IdeBlkIoDevice,
+  IN  VOID            *Buffer,
+  IN  EFI_LBA         Lba,
+  IN  UINTN           NumberOfBlocks
+  );
+
+/**
+  Start one ATA Udma command (Read, ReadExt, Write, WriteExt) on the channel of
+  an IDE device. The command transfers the first blocks of the request, as many
+  as one command and one mapping of the buffer allow. The caller polls the end
+  of the command with AtaUdmaCheckCommand(), then calls AtaUdmaEndCommand().
+
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
+  @param DataBuffer     A pointer to the source or destination buffer for the data.
+  @param StartLba       The starting logical block address of the request.
+  @param NumberOfBlocks The number of blocks of the request.
+  @param UdmaOp         The perform operations could be AtaUdmaReadOp, AtaUdmaReadExOp,
+                        AtaUdmaWriteOp, AtaUdmaWriteExOp
+  @param CommandBlocks  Returns the number of blocks transferred by the command.
+  @param Map            Returns the mapping of the data of the command.
+
+  @retval EFI_SUCCESS          the command is started.
+  @retval EFI_OUT_OF_RESOURCES Build PRD table failed
+  @retval EFI_UNSUPPORTED      Unknown channel or operations command
+  @retval EFI_DEVICE_ERROR     Ata command execute failed
+
+**/
+EFI_STATUS
+AtaUdmaStartCommand (
+  IN  IDE_BLK_IO_DEV      *IdeDev,
+  IN  VOID                *DataBuffer,
+  IN  EFI_LBA             StartLba,
+  IN  UINTN               NumberOfBlocks,
+  IN  ATA_UDMA_OPERATION  UdmaOp,
+  OUT UINTN               *CommandBlocks,
+  OUT VOID                **Map
+  );
+
+/**
+  Check whether the ATA Udma command started by AtaUdmaStartCommand() on the
+  channel of an IDE device is finished, from the INTERRUPT and ERROR bits of
+  the BMIS register.
+
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
+
+  @retval EFI_SUCCESS       The command is finished.
+  @retval EFI_NOT_READY     The command is still in progress.
+  @retval EFI_DEVICE_ERROR  The command failed.
+  @retval EFI_UNSUPPORTED   Unknown channel.
+
+**/
+EFI_STATUS
+AtaUdmaCheckCommand (
+  IN  IDE_BLK_IO_DEV  *IdeDev
+  );
+
+/**
+  Stop the bus master after an ATA Udma command started by AtaUdmaStartCommand(),
+  whether the command is finished or not, and unmap its data.
+
+  @param IdeDev         pointer pointing to IDE_BLK_IO_DEV data structure, used
+                        to record all the information of the IDE device.
+  @param Map            The mapping of the data of the command.
+
+**/
+VOID
+AtaUdmaEndCommand (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  IN  VOID            *Map
+  );
+
+/**
+  Check the parameters of a read or write request of the Block I/O or Block I/O 2
+  protocol against the media of an ATA device.
+
+  @param IdeBlkIoDevice Indicates the calling context.
+  @param MediaId        The media id that the request is for.
+  @param Lba            The starting logical block address of the request.
+  @param BufferSize     The size of the Buffer in bytes, not 0.
+  @param Buffer         A pointer to the buffer of the data, not NULL.
+
+  @retval EFI_SUCCESS            The request is valid.
+  @retval EFI_NO_MEDIA           There is no media in the device.
+  @retval EFI_MEDIA_CHANGED      The MediaId is not for the current media.
+  @retval EFI_BAD_BUFFER_SIZE    The BufferSize parameter is not a multiple of the
+                                 intrinsic block size of the device.
+  @retval EFI_INVALID_PARAMETER  The request contains LBAs that are not valid,
+                                 or the data buffer is not aligned.
+
+**/
+EFI_STATUS
+AtaBlkIoCheckRequest (
+  IN IDE_BLK_IO_DEV   *IdeBlkIoDevice,
+  IN UINT32           MediaId,
+  IN EFI_LBA          Lba,
+  IN UINTN            BufferSize,
+  IN VOID             *Buffer
+  );
+
 /**
   This function is the ATA implementation for ReadBlocks in the
   Block I/O Protocol interface.
@@ -727,6 +996,35 @@ ReleaseIdeResources (
   IN  IDE_BLK_IO_DEV  *IdeBlkIoDevice
   );
 
+/**
+  Allocate the PRD table of a channel and map it for bus master access.
+
+  @param PciIo          The PCI I/O protocol of the IDE controller.
+  @param PrdTable       The PRD table of the channel.
+
+  @retval EFI_SUCCESS          The PRD table is allocated and mapped.
+  @retval EFI_OUT_OF_RESOURCES The PRD table cannot be allocated or mapped.
+
+**/
+EFI_STATUS
+AllocateIdePrdTable (
+  IN     EFI_PCI_IO_PROTOCOL  *PciIo,
+  IN OUT IDE_PRD_TABLE        *PrdTable
+  );
+
+/**
+  Unmap and free the PRD tables of the channels of an IDE controller.
+
+  @param PciIo                   The PCI I/O protocol of the IDE controller.
+  @param IdeBusDriverPrivateData The private data of the IDE controller.
+
+**/
+VOID
+FreeIdePrdTables (
+  IN     EFI_PCI_IO_PROTOCOL          *PciIo,
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData
+  );
+
 /**
   Set the calculated Best transfer mode to a detected device
 
@@ -832,4 +1130,213 @@ EFI_STATUS
 EnableInterrupt (
   IN IDE_BLK_IO_DEV       *IdeDev
   );
+
+/**
+  Allocate the block cache of a hard disk, with the size of PcdIdeBlockCacheSize.
+  The block size and the last block of the media must be known.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+  @retval EFI_SUCCESS           The cache is enabled.
+  @retval EFI_UNSUPPORTED       The cache is disabled by the PCD, or too small for the block size.
+  @retval EFI_OUT_OF_RESOURCES  The cache could not be allocated.
+
+**/
+EFI_STATUS
+IdeBlockCacheInit (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  );
+
+/**
+  Free the block cache of a hard disk. The modified lines are discarded, so
+  IdeBlockCacheFlush() must be called before if the disk is still present.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+**/
+VOID
+IdeBlockCacheFree (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  );
+
+/**
+  Read blocks through the block cache. The parameters are already validated.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Buffer          A pointer to the destination buffer for the data.
+  @param  Lba             The starting logical block address to read from on the device media.
+  @param  NumberOfBlocks  The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Read Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Read Blocks failed.
+
+**/
+EFI_STATUS
+IdeBlockCacheRead (
+  IN  IDE_BLK_IO_DEV  *IdeDev,
+  OUT VOID            *Buffer,
+  IN  EFI_LBA         Lba,
+  IN  UINTN           NumberOfBlocks
+  );
+
+/**
+  Write blocks through the block cache. The parameters are already validated.
+
+  In write-back mode, the blocks are copied into lines which are marked as
+  modified, reading the rest of the lines from the disk first if needed.
+  Otherwise, or for large requests, the blocks are written onto the disk
+  and copied into the lines which are in the cache.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Buffer          A pointer to the source buffer for the data.
+  @param  Lba             The starting logical block address to write onto the device media.
+  @param  NumberOfBlocks  The number of transfer data blocks.
+
+  @retval EFI_SUCCESS       Write Blocks successfully.
+  @retval EFI_DEVICE_ERROR  Write Blocks failed.
+
+**/
+EFI_STATUS
+IdeBlockCacheWrite (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN VOID            *Buffer,
+  IN EFI_LBA         Lba,
+  IN UINTN           NumberOfBlocks
+  );
+
+/**
+  Write the modified lines of a range of blocks onto the disk.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Lba             The first LBA of the range
+  @param  NumberOfBlocks  The number of blocks of the range
+
+  @retval EFI_SUCCESS       No line of the range is modified any more.
+  @retval EFI_DEVICE_ERROR  A line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheFlushRange (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN EFI_LBA         Lba,
+  IN UINTN           NumberOfBlocks
+  );
+
+/**
+  Drop the lines of a range of blocks from the cache, before the range is
+  written onto the disk without going through the cache. The modified lines of
+  the range are written onto the disk first, as the write may not cover them
+  entirely.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Lba             The first LBA of the range
+  @param  NumberOfBlocks  The number of blocks of the range
+
+  @retval EFI_SUCCESS       No line of the range is in the cache any more.
+  @retval EFI_DEVICE_ERROR  A line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheInvalidateRange (
+  IN IDE_BLK_IO_DEV  *IdeDev,
+  IN EFI_LBA         Lba,
+  IN UINTN           NumberOfBlocks
+  );
+
+/**
+  Write all the modified lines of the block cache onto the disk.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+  @retval EFI_SUCCESS       No line is modified any more.
+  @retval EFI_DEVICE_ERROR  A line could not be written.
+
+**/
+EFI_STATUS
+IdeBlockCacheFlush (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  );
+
+/**
+  Write the modified lines onto the disk at ReadyToBoot, and switch the block
+  cache to write through for the rest of the boot.
+
+  @param  Event    Pointer to this event
+  @param  Context  Event handler private data, the IDE device
+
+**/
+VOID
+EFIAPI
+IdeBlockCacheOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  );
+
+/**
+  Initialize the queues of the non-blocking requests of an IDE controller, and
+  create the timer polling them.
+
+  @param  IdeBusDriverPrivateData  The private data of the IDE controller
+
+  @retval EFI_SUCCESS  The queues are ready.
+  @retval other        The timer could not be created.
+
+**/
+EFI_STATUS
+IdeAsyncInit (
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData
+  );
+
+/**
+  Close the timer polling the non-blocking requests of an IDE controller. The
+  queues must be empty.
+
+  @param  IdeBusDriverPrivateData  The private data of the IDE controller
+
+**/
+VOID
+IdeAsyncFree (
+  IN OUT IDE_BUS_DRIVER_PRIVATE_DATA  *IdeBusDriverPrivateData
+  );
+
+/**
+  Queue a non-blocking UDMA read or write of an ATA device, and start it if the
+  channel is idle. The request does not go through the block cache: the modified
+  lines it reads are written onto the disk first, and the lines it writes are
+  dropped from the cache. Must be called at TPL_CALLBACK.
+
+  @param  IdeDev          Standard IDE device private data structure
+  @param  Write           TRUE to write the blocks, FALSE to read them
+  @param  Buffer          The buffer of the data
+  @param  Lba             The starting logical block address
+  @param  NumberOfBlocks  The number of blocks, not 0
+  @param  Token           The token of the request, with an event
+
+  @retval EFI_SUCCESS           The request is queued.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be allocated.
+  @retval EFI_DEVICE_ERROR      A modified line of the block cache could not be written.
+
+**/
+EFI_STATUS
+IdeAsyncSubmit (
+  IN IDE_BLK_IO_DEV       *IdeDev,
+  IN BOOLEAN              Write,
+  IN VOID                 *Buffer,
+  IN EFI_LBA              Lba,
+  IN UINTN                NumberOfBlocks,
+  IN EFI_BLOCK_IO2_TOKEN  *Token
+  );
+
+/**
+  Complete all the non-blocking requests queued on the channel of an IDE device,
+  before the channel is used by a blocking request. Must be called at TPL_CALLBACK
+  or above, so that the timer does not poll the queue at the same time.
+
+  @param  IdeDev  Standard IDE device private data structure
+
+**/
+VOID
+IdeAsyncDrainChannel (
+  IN IDE_BLK_IO_DEV  *IdeDev
+  );
 #endif
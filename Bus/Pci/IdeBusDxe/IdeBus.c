@@ -57,6 +57,7 @@ DeRegisterIdeDevice (
   IDE_BLK_IO_DEV        *IdeBlkIoDevice;
   EFI_PCI_IO_PROTOCOL   *PciIo;
   UINTN                 Index;
+  EFI_TPL               OldTpl;
 
   Status = gBS->OpenProtocol (
                   Handle,
@@ -72,6 +73,17 @@ DeRegisterIdeDevice (
 
   IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_THIS (BlkIo);
 
+  //
+  // Complete the non-blocking requests of the channel and write the modified
+  // lines of the block cache while the device is still there
+  //
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  IdeAsyncDrainChannel (IdeBlkIoDevice);
+  if (IdeBlkIoDevice->BlockCache.LineCount != 0) {
+    IdeBlockCacheFlush (IdeBlkIoDevice);
+  }
+  gBS->RestoreTPL (OldTpl);
+
   //
   // Report Status code: Device disabled
   //
@@ -97,6 +109,8 @@ DeRegisterIdeDevice (
                   IdeBlkIoDevice->DevicePath,
                   &gEfiBlockIoProtocolGuid,
                   &IdeBlkIoDevice->BlkIo,
+                  &gEfiBlockIo2ProtocolGuid,
+                  &IdeBlkIoDevice->BlkIo2,
                   &gEfiDiskInfoProtocolGuid,
                   &IdeBlkIoDevice->DiskInfo,
                   NULL
@@ -114,6 +128,14 @@ DeRegisterIdeDevice (
     return Status;
   }
 
+  if (IdeBlkIoDevice->BlockCache.LineCount != 0) {
+    gBS->UninstallProtocolInterface (
+          Handle,
+          &gIdeBlockCacheStatisticsProtocolGuid,
+          &IdeBlkIoDevice->BlockCache.Statistics
+          );
+  }
+
   //
   // Release allocated resources
   //
@@ -303,6 +325,7 @@ IDEBusDriverBindingStart (
   UINT8                             EndIdeDevice;
   IDE_BLK_IO_DEV                    *IdeBlkIoDevice[IdeMaxChannel][IdeMaxDevice];
   IDE_BLK_IO_DEV                    *IdeBlkIoDevicePtr;
+  IDE_BLK_IO_DEV                    *DetectDevice[MAX_IDE_CHANNELS];
   IDE_REGISTERS_BASE_ADDR           IdeRegsBaseAddr[IdeMaxChannel];
   ATA_TRANSFER_MODE                 TransferMode;
   ATA_DRIVE_PARMS                   DriveParameters;
@@ -326,6 +349,7 @@ IDEBusDriverBindingStart (
 
   IdeBusDriverPrivateData = NULL;
   SupportedModes          = NULL;
+  PciIo                   = NULL;
 
   //
   // Perform IdeBus initialization
@@ -401,6 +425,11 @@ IDEBusDriverBindingStart (
     }
 
     ZeroMem (IdeBusDriverPrivateData, sizeof (IDE_BUS_DRIVER_PRIVATE_DATA));
+    Status = IdeAsyncInit (IdeBusDriverPrivateData);
+    if (EFI_ERROR (Status)) {
+      goto ErrorExit;
+    }
+
     Status = gBS->InstallMultipleProtocolInterfaces (
                     &Controller,
                     &gEfiCallerIdGuid,
@@ -522,6 +551,8 @@ IDEBusDriverBindingStart (
   //
   // Strictly follow the enumeration based on IDE_CONTROLLER_INIT protocol
   //
+  ZeroMem (IdeBlkIoDevice, sizeof (IdeBlkIoDevice));
+  ZeroMem (DetectDevice, sizeof (DetectDevice));
   for (IdeChannel = BeginningIdeChannel; IdeChannel <= EndIdeChannel; IdeChannel++) {
 
     IdeInit->NotifyPhase (IdeInit, EfiIdeBeforeChannelEnumeration, IdeChannel);
@@ -565,11 +596,6 @@ IDEBusDriverBindingStart (
               IdeChannel
               );
 
-    //
-    // Prepare to detect IDE device of this channel
-    //
-    InitializeIDEChannelData ();
-
     //
     // -- 1st inner loop --- Master/Slave ------------  Step14
     //
@@ -616,6 +642,8 @@ IDEBusDriverBindingStart (
       //
       IdeBlkIoDevicePtr->IoPort = AllocatePool (sizeof (IDE_BASE_REGISTERS));
       if (IdeBlkIoDevicePtr->IoPort == NULL) {
+        FreePool (IdeBlkIoDevicePtr);
+        IdeBlkIoDevice[IdeChannel][IdeDevice] = NULL;
         continue;
       }
 
@@ -641,6 +669,41 @@ IDEBusDriverBindingStart (
       IdeBlkIoDevicePtr->IdeBusDriverPrivateData = IdeBusDriverPrivateData;
       IdeBlkIoDevicePtr->IoPort->BusMasterBaseAddr = IdeRegsBaseAddr[IdeChannel].BusMasterBaseAddr;
 
+      //
+      // The devices of a channel are detected together, through the registers
+      // of the first device to scan, unless an earlier Start() detected them
+      //
+      if (!IdeBusDriverPrivateData->ChannelDetected[IdeChannel] && DetectDevice[IdeChannel] == NULL) {
+        DetectDevice[IdeChannel] = IdeBlkIoDevicePtr;
+      }
+      //
+      // end of 1st inner loop ---
+      //
+    }
+    //
+    // end of 1st outer loop =========
+    //
+  }
+
+  //
+  // Detect the devices of all the channels at once, so that the waits for the
+  // channels to finish the device diagnostic overlap
+  //
+  PERF_START (NULL, "DetectIdeChannels", "IDE", 0);
+  DetectIdeChannels (IdeBusDriverPrivateData, DetectDevice);
+  PERF_END (NULL, "DetectIdeChannels", "IDE", 0);
+
+  //
+  // Identify the devices, which go through the registers of their channel one
+  // at a time
+  //
+  for (IdeChannel = BeginningIdeChannel; IdeChannel <= EndIdeChannel; IdeChannel++) {
+    for (IdeDevice = BeginningIdeDevice; IdeDevice < IdeMaxDevice; IdeDevice++) {
+      IdeBlkIoDevicePtr = IdeBlkIoDevice[IdeChannel][IdeDevice];
+      if (IdeBlkIoDevicePtr == NULL) {
+        continue;
+      }
+
       //
       // Report Status code: is about to detect IDE drive
       //
@@ -700,13 +763,7 @@ IDEBusDriverBindingStart (
         ReleaseIdeResources (IdeBlkIoDevicePtr);
         IdeBlkIoDevicePtr = NULL;
       }
-      //
-      // end of 1st inner loop ---
-      //
     }
-    //
-    // end of 1st outer loop =========
-    //
   }
 
   //
@@ -808,7 +865,11 @@ IDEBusDriverBindingStart (
       //
       DriveParameters.Sector          = (UINT8) ((ATA5_IDENTIFY_DATA *) IdeBlkIoDevicePtr->IdData)->sectors_per_track;
       DriveParameters.Heads           = (UINT8) (((ATA5_IDENTIFY_DATA *) IdeBlkIoDevicePtr->IdData)->heads - 1);
-      DriveParameters.MultipleSector  = (UINT8) IdeBlkIoDevicePtr->IdData->AtaData.multi_sector_cmd_max_sct_cnt;
+      //
+      // The low byte of the identify data word 47 is the maximum number of sectors
+      // per DRQ data block of READ/WRITE MULTIPLE; use the largest power of two of it.
+      //
+      DriveParameters.MultipleSector  = (UINT8) GetPowerOfTwo32 ((UINT8) IdeBlkIoDevicePtr->IdData->AtaData.multi_sector_cmd_max_sct_cnt);
       //
       // Set Parameters for the device:
       // 1) Init
@@ -816,6 +877,16 @@ IDEBusDriverBindingStart (
       //
       if ((IdeBlkIoDevicePtr->Type == IdeHardDisk) || (IdeBlkIoDevicePtr->Type == Ide48bitAddressingHardDisk)) {
         Status = SetDriveParameters (IdeBlkIoDevicePtr, &DriveParameters);
+        if (!EFI_ERROR (Status) && (DriveParameters.MultipleSector > 1)) {
+          IdeBlkIoDevicePtr->MultipleSectorCount = DriveParameters.MultipleSector;
+        }
+
+        IdeBlkIoDevicePtr->DataPort32Bit = FeaturePcdGet (PcdIdeBusPioDataPort32Bit);
+
+        //
+        // Reads and writes of hard disks go through the block cache if it can be allocated
+        //
+        IdeBlockCacheInit (IdeBlkIoDevicePtr);
       }
 
       //
@@ -840,6 +911,8 @@ IDEBusDriverBindingStart (
                       IdeBlkIoDevicePtr->DevicePath,
                       &gEfiBlockIoProtocolGuid,
                       &IdeBlkIoDevicePtr->BlkIo,
+                      &gEfiBlockIo2ProtocolGuid,
+                      &IdeBlkIoDevicePtr->BlkIo2,
                       &gEfiDiskInfoProtocolGuid,
                       &IdeBlkIoDevicePtr->DiskInfo,
                       NULL
@@ -847,6 +920,13 @@ IDEBusDriverBindingStart (
 
       if (EFI_ERROR (Status)) {
         ReleaseIdeResources (IdeBlkIoDevicePtr);
+      } else if (IdeBlkIoDevicePtr->BlockCache.LineCount != 0) {
+        gBS->InstallProtocolInterface (
+              &IdeBlkIoDevicePtr->Handle,
+              &gIdeBlockCacheStatisticsProtocolGuid,
+              EFI_NATIVE_INTERFACE,
+              &IdeBlkIoDevicePtr->BlockCache.Statistics
+              );
       }
 
       gBS->OpenProtocol (
@@ -931,6 +1011,10 @@ ErrorExit:
         );
 
   if (IdeBusDriverPrivateData != NULL) {
+    if (PciIo != NULL) {
+      FreeIdePrdTables (PciIo, IdeBusDriverPrivateData);
+    }
+    IdeAsyncFree (IdeBusDriverPrivateData);
     gBS->FreePool (IdeBusDriverPrivateData);
   }
 
@@ -985,6 +1069,7 @@ IDEBusDriverBindingStop (
   UINT64                      Supports;
 
   IdeBusDriverPrivateData = NULL;
+  PciIo                   = NULL;
 
   if (NumberOfChildren == 0) {
 
@@ -1031,6 +1116,10 @@ IDEBusDriverBindingStop (
           );
 
     if (IdeBusDriverPrivateData != NULL) {
+      if (PciIo != NULL) {
+        FreeIdePrdTables (PciIo, IdeBusDriverPrivateData);
+      }
+      IdeAsyncFree (IdeBusDriverPrivateData);
       gBS->FreePool (IdeBusDriverPrivateData);
     }
     //
@@ -1101,6 +1190,11 @@ IDEBlkIoReset (
   OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
 
   IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_THIS (This);
+  //
+  // The channel may not be used before its non-blocking requests are completed
+  //
+  IdeAsyncDrainChannel (IdeBlkIoDevice);
+
   //
   // Requery IDE IO resources in case of the switch of native and legacy modes
   //
@@ -1164,6 +1258,11 @@ IDEBlkIoReadBlocks (
 
   IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_THIS (This);
 
+  //
+  // The channel may not be used before its non-blocking requests are completed
+  //
+  IdeAsyncDrainChannel (IdeBlkIoDevice);
+
   //
   // Requery IDE IO resources in case of the switch of native and legacy modes
   //
@@ -1236,6 +1335,11 @@ IDEBlkIoWriteBlocks (
   OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
 
   IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_THIS (This);
+  //
+  // The channel may not be used before its non-blocking requests are completed
+  //
+  IdeAsyncDrainChannel (IdeBlkIoDevice);
+
   //
   // Requery IDE IO resources in case of the switch of native and legacy modes
   //
@@ -1283,7 +1387,8 @@ Done:
   @param  This  Indicates a pointer to the calling context which to sepcify a
                 sepcific block device
 
-  @retval EFI_SUCCESS   Always return success.
+  @retval EFI_SUCCESS       All the modified lines of the block cache were written.
+  @retval EFI_DEVICE_ERROR  A modified line of the block cache could not be written.
 **/
 EFI_STATUS
 EFIAPI
@@ -1291,10 +1396,257 @@ IDEBlkIoFlushBlocks (
   IN  EFI_BLOCK_IO_PROTOCOL   *This
   )
 {
+  IDE_BLK_IO_DEV  *IdeBlkIoDevice;
+  EFI_STATUS      Status;
+  EFI_TPL         OldTpl;
+
+  IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_THIS (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
   //
-  // return directly
+  // The non-blocking writes queued before are part of the modified data
   //
-  return EFI_SUCCESS;
+  IdeAsyncDrainChannel (IdeBlkIoDevice);
+
+  //
+  // Only the write-back block cache holds data which is not on the media
+  //
+  Status = EFI_SUCCESS;
+  if (IdeBlkIoDevice->BlockCache.DirtyCount != 0) {
+    //
+    // Requery IDE IO resources in case of the switch of native and legacy modes
+    //
+    ReassignIdeResources (IdeBlkIoDevice);
+
+    Status = IdeBlockCacheFlush (IdeBlkIoDevice);
+  }
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Reset a block IO device, after the non-blocking requests queued on its channel
+  are completed.
+
+  @param  This                  Block IO 2 protocol instance pointer.
+  @param  ExtendedVerification  If FALSE,for ATAPI device, driver will only invoke ATAPI reset method
+                                If TRUE, for ATAPI device, driver need invoke ATA reset method after
+                                invoke ATAPI reset method
+
+  @retval EFI_DEVICE_ERROR      When the device is neighther ATA device or ATAPI device.
+  @retval EFI_SUCCESS           The device reset successfully
+
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2Reset (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN  BOOLEAN                 ExtendedVerification
+  )
+{
+  IDE_BLK_IO_DEV  *IdeBlkIoDevice;
+
+  IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_BLOCK_IO2_THIS (This);
+
+  return IDEBlkIoReset (&IdeBlkIoDevice->BlkIo, ExtendedVerification);
+}
+
+/**
+  Read or write data of a block IO device for the Block IO 2 protocol. Only the
+  UDMA transfers of hard disks leave the CPU free while the data moves, so they
+  are queued when the token has an event. The other requests are done by the
+  Block IO protocol, and their event is signaled before the function returns.
+
+  @param  IdeBlkIoDevice  Standard IDE device private data structure
+  @param  Write           TRUE to write the data, FALSE to read it
+  @param  MediaId         The media ID of the device
+  @param  Lba             Starting LBA address of the data
+  @param  Token           A pointer to the token associated with the transaction.
+  @param  BufferSize      The size of the data
+  @param  Buffer          Caller supplied buffer of the data
+
+  @retval EFI_SUCCESS           The request was queued if Token->Event is not
+                                NULL, the data was transferred otherwise.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+  @retval other                 transfer status.
+
+**/
+EFI_STATUS
+IdeBlkIo2ReadWriteBlocks (
+  IN     IDE_BLK_IO_DEV       *IdeBlkIoDevice,
+  IN     BOOLEAN              Write,
+  IN     UINT32               MediaId,
+  IN     EFI_LBA              Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN  *Token,
+  IN     UINTN                BufferSize,
+  IN     VOID                 *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  EFI_TPL     OldTpl;
+
+  if ((Token == NULL) || (Token->Event == NULL) ||
+      ((IdeBlkIoDevice->Type != IdeHardDisk) && (IdeBlkIoDevice->Type != Ide48bitAddressingHardDisk)) ||
+      !IdeBlkIoDevice->UdmaMode.Valid) {
+    if (Write) {
+      Status = IDEBlkIoWriteBlocks (&IdeBlkIoDevice->BlkIo, MediaId, Lba, BufferSize, Buffer);
+    } else {
+      Status = IDEBlkIoReadBlocks (&IdeBlkIoDevice->BlkIo, MediaId, Lba, BufferSize, Buffer);
+    }
+
+    if (!EFI_ERROR (Status) && (Token != NULL) && (Token->Event != NULL)) {
+      Token->TransactionStatus = EFI_SUCCESS;
+      gBS->SignalEvent (Token->Event);
+    }
+    return Status;
+  }
+
+  if (Buffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (BufferSize == 0) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+    return EFI_SUCCESS;
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  Status = AtaBlkIoCheckRequest (IdeBlkIoDevice, MediaId, Lba, BufferSize, Buffer);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  //
+  // Requery IDE IO resources in case of the switch of native and legacy modes
+  //
+  ReassignIdeResources (IdeBlkIoDevice);
+
+  Status = IdeAsyncSubmit (
+             IdeBlkIoDevice,
+             Write,
+             Buffer,
+             Lba,
+             BufferSize / IdeBlkIoDevice->BlkIo.Media->BlockSize,
+             Token
+             );
+
+Done:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Read data from a block IO device. The UDMA reads of hard disks with an event
+  are non-blocking, the other ones complete before the function returns.
+
+  @param  This       Block IO 2 protocol instance pointer.
+  @param  MediaId    The media ID of the device
+  @param  Lba        Starting LBA address to read data
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of data to be read
+  @param  Buffer     Caller supplied buffer to save data
+
+  @retval EFI_SUCCESS           The read request was queued if Token->Event is
+                                not NULL, the data was read otherwise.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+  @retval other                 read data status.
+
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2ReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  OUT    VOID                    *Buffer
+  )
+{
+  return IdeBlkIo2ReadWriteBlocks (
+           IDE_BLOCK_IO_DEV_FROM_BLOCK_IO2_THIS (This),
+           FALSE,
+           MediaId,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer
+           );
+}
+
+/**
+  Write data to a block IO device. The UDMA writes of hard disks with an event
+  are non-blocking, the other ones complete before the function returns.
+
+  @param  This       Block IO 2 protocol instance pointer.
+  @param  MediaId    The media ID of the device
+  @param  Lba        Starting LBA address to write data
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of data to be written
+  @param  Buffer     Caller supplied buffer to save data
+
+  @retval EFI_SUCCESS           The write request was queued if Token->Event is
+                                not NULL, the data was written otherwise.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+  @retval other                 write data status.
+
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2WriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  IN     VOID                    *Buffer
+  )
+{
+  return IdeBlkIo2ReadWriteBlocks (
+           IDE_BLOCK_IO_DEV_FROM_BLOCK_IO2_THIS (This),
+           TRUE,
+           MediaId,
+           Lba,
+           Token,
+           BufferSize,
+           Buffer
+           );
+}
+
+/**
+  Flushes all modified data to a physical block device, including the data of
+  the non-blocking writes queued before. The flush completes before the function
+  returns.
+
+  @param  This   Block IO 2 protocol instance pointer.
+  @param  Token  A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All the modified lines of the block cache were written.
+  @retval EFI_DEVICE_ERROR  A modified line of the block cache could not be written.
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2FlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token
+  )
+{
+  IDE_BLK_IO_DEV  *IdeBlkIoDevice;
+  EFI_STATUS      Status;
+
+  IdeBlkIoDevice = IDE_BLOCK_IO_DEV_FROM_BLOCK_IO2_THIS (This);
+
+  Status = IDEBlkIoFlushBlocks (&IdeBlkIoDevice->BlkIo);
+  if (!EFI_ERROR (Status) && (Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return Status;
 }
 
 /**
@@ -1449,10 +1801,11 @@ ClearInterrupt (
   IN VOID       *Context
   )
 {
-  EFI_STATUS      Status;
-  UINT64          IoPortForBmis;
-  UINT8           RegisterValue;
-  IDE_BLK_IO_DEV  *IdeDev;
+  EFI_STATUS         Status;
+  UINT64             IoPortForBmis;
+  UINT8              RegisterValue;
+  IDE_BLK_IO_DEV     *IdeDev;
+  IDE_ASYNC_REQUEST  *Request;
 
   //
   // Get our context
@@ -1467,6 +1820,17 @@ ClearInterrupt (
     return;
   }
 
+  //
+  // Stop the bus master if a non-blocking command is still in progress on the channel
+  //
+  if (!IsListEmpty (&IdeDev->IdeBusDriverPrivateData->AsyncQueue[IdeDev->Channel])) {
+    Request = IDE_ASYNC_REQUEST_FROM_LINK (GetFirstNode (&IdeDev->IdeBusDriverPrivateData->AsyncQueue[IdeDev->Channel]));
+    if (Request->CommandStarted) {
+      AtaUdmaEndCommand (Request->IdeDev, Request->Map);
+      Request->CommandStarted = FALSE;
+    }
+  }
+
   //
   // Check whether interrupt is pending
   //
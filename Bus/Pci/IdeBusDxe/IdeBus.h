@@ -21,9 +21,11 @@
 
 #include <Protocol/IdeControllerInit.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/PciIo.h>
 #include <Protocol/DiskInfo.h>
 #include <Protocol/DevicePath.h>
+#include <Protocol/IdeBlockCacheStatistics.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -36,6 +38,7 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/PcdLib.h>
 
 #include <Guid/EventGroup.h>
 
@@ -60,12 +63,108 @@ extern EFI_DRIVER_DIAGNOSTICS2_PROTOCOL gIDEBusDriverDiagnostics2;
 #define ATA_DEVICE_TYPE     0x00
 #define ATAPI_DEVICE_TYPE   0x01
 
+//
+// The PRD table of a channel takes two pages within one 64K region, which is
+// enough for the PRDs of the largest UDMA command. One more page is allocated
+// to find two pages that do not cross a 64K boundary.
+//
+#define IDE_PRD_TABLE_PAGES       3
+#define IDE_PRD_TABLE_ENTRIES     (EFI_PAGES_TO_SIZE (2) / sizeof (IDE_DMA_PRD))
+
+typedef struct {
+  IDE_DMA_PRD           *Entry;
+  EFI_PHYSICAL_ADDRESS  DeviceAddress;
+  VOID                  *Buffer;
+  VOID                  *Mapping;
+} IDE_PRD_TABLE;
+
 typedef struct {
   BOOLEAN HaveScannedDevice[MAX_IDE_DEVICE];
   BOOLEAN DeviceFound[MAX_IDE_DEVICE];
   BOOLEAN DeviceProcessed[MAX_IDE_DEVICE];
+  //
+  // Result of the detection of each channel, kept until the controller is stopped
+  // so that a later Start() does not detect the channel again: the type of each
+  // device, INVALID_DEVICE_TYPE if the device is absent
+  //
+  BOOLEAN ChannelDetected[MAX_IDE_CHANNELS];
+  UINT8   DeviceType[MAX_IDE_DEVICE];
+  //
+  // PRD table of each channel, allocated by the first UDMA command and reused by the next ones
+  //
+  IDE_PRD_TABLE PrdTable[MAX_IDE_CHANNELS];
+  //
+  // Non-blocking Block I/O 2 requests of each channel, the one with a command
+  // in progress first, and the timer polling them
+  //
+  LIST_ENTRY    AsyncQueue[MAX_IDE_CHANNELS];
+  EFI_EVENT     AsyncTimerEvent;
 } IDE_BUS_DRIVER_PRIVATE_DATA;
 
+//
+// The block cache of a hard disk keeps whole lines of IDE_BLOCK_CACHE_LINE_SIZE
+// bytes, starting on an LBA multiple of the line size. A read reads at most
+// IDE_BLOCK_CACHE_MAX_RUN_SIZE bytes of lines from the disk at once, including
+// read ahead; larger requests do not go through the cache. The lines of the
+// first IDE_BLOCK_CACHE_PINNED_HEAD_SIZE bytes and of the last
+// IDE_BLOCK_CACHE_PINNED_TAIL_BLOCKS blocks (the backup GPT) are evicted after
+// the other ones.
+//
+#define IDE_BLOCK_CACHE_LINE_SIZE           SIZE_4KB
+#define IDE_BLOCK_CACHE_MAX_RUN_SIZE        SIZE_64KB
+#define IDE_BLOCK_CACHE_PINNED_HEAD_SIZE    SIZE_1MB
+#define IDE_BLOCK_CACHE_PINNED_TAIL_BLOCKS  33
+
+typedef struct {
+  LIST_ENTRY            HashLink;
+  //
+  // Link in the free list or in one of the LRU lists
+  //
+  LIST_ENTRY            LruLink;
+  EFI_LBA               Lba;
+  UINT8                 *Data;
+  BOOLEAN               Pinned;
+  BOOLEAN               Dirty;
+} IDE_BLOCK_CACHE_LINE;
+
+#define IDE_BLOCK_CACHE_LINE_FROM_HASH_LINK(a)  BASE_CR (a, IDE_BLOCK_CACHE_LINE, HashLink)
+#define IDE_BLOCK_CACHE_LINE_FROM_LRU_LINK(a)   BASE_CR (a, IDE_BLOCK_CACHE_LINE, LruLink)
+
+typedef struct {
+  //
+  // Number of lines, 0 if the cache is disabled
+  //
+  UINTN                                 LineCount;
+  UINTN                                 LineBlocks;
+  UINTN                                 LineShift;
+  UINTN                                 MaxRunLines;
+  UINTN                                 MaxPinnedLines;
+  UINTN                                 PinnedCount;
+  UINTN                                 DirtyCount;
+  IDE_BLOCK_CACHE_LINE                  *Lines;
+  UINT8                                 *Data;
+  //
+  // Buffer of MaxRunLines lines the disk is read into on a miss
+  //
+  UINT8                                 *RunBuffer;
+  LIST_ENTRY                            *HashTable;
+  UINTN                                 HashMask;
+  LIST_ENTRY                            FreeList;
+  //
+  // Lines in use, the most recently used first
+  //
+  LIST_ENTRY                            LruList;
+  LIST_ENTRY                            PinnedLruList;
+  //
+  // Sequential stream detection: the LBA following the last read, and the
+  // number of lines read ahead on the next miss
+  //
+  EFI_LBA                               NextLba;
+  UINTN                                 ReadAheadLines;
+  EFI_EVENT                             ReadyToBootEvent;
+  IDE_BLOCK_CACHE_STATISTICS_PROTOCOL   Statistics;
+} IDE_BLOCK_CACHE;
+
 #define IDE_BLK_IO_DEV_SIGNATURE  SIGNATURE_32 ('i', 'b', 'i', 'd')
 
 typedef struct {
@@ -73,6 +172,7 @@ typedef struct {
 
   EFI_HANDLE                  Handle;
   EFI_BLOCK_IO_PROTOCOL       BlkIo;
+  EFI_BLOCK_IO2_PROTOCOL      BlkIo2;
   EFI_BLOCK_IO_MEDIA          BlkMedia;
   EFI_DISK_INFO_PROTOCOL      DiskInfo;
   EFI_DEVICE_PATH_PROTOCOL    *DevicePath;
@@ -99,6 +199,20 @@ typedef struct {
   UINT8                       SenseDataNumber;
   UINT8                       *Cache;
 
+  //
+  // Sectors per DRQ data block of READ/WRITE MULTIPLE (EXT), 0 if multiple mode is not enabled
+  //
+  UINT16                      MultipleSectorCount;
+  //
+  // TRUE if the PIO data transfers use 32-bit accesses to the data register
+  //
+  BOOLEAN                     DataPort32Bit;
+
+  //
+  // Block cache of hard disks
+  //
+  IDE_BLOCK_CACHE             BlockCache;
+
   //
   // ExitBootService Event, it is used to clear pending IDE interrupt
   //
@@ -107,9 +221,42 @@ typedef struct {
   EFI_UNICODE_STRING_TABLE    *ControllerNameTable;
 } IDE_BLK_IO_DEV;
 
+//
+// The timer polls the non-blocking requests every millisecond, and a UDMA
+// command fails after IDE_ASYNC_UDMA_TIMEOUT polls, like the blocking ones.
+//
+#define IDE_ASYNC_TIMER_PERIOD  10000
+#define IDE_ASYNC_UDMA_TIMEOUT  2000
+
+#define IDE_ASYNC_REQUEST_SIGNATURE  SIGNATURE_32 ('i', 'd', 'a', 'r')
+
+typedef struct {
+  UINT32                      Signature;
+  LIST_ENTRY                  Link;
+  IDE_BLK_IO_DEV              *IdeDev;
+  EFI_BLOCK_IO2_TOKEN         *Token;
+  ATA_UDMA_OPERATION          UdmaOp;
+  //
+  // Blocks which are not transferred yet
+  //
+  UINT8                       *Buffer;
+  EFI_LBA                     Lba;
+  UINTN                       NumberOfBlocks;
+  //
+  // UDMA command in progress on the channel
+  //
+  BOOLEAN                     CommandStarted;
+  UINTN                       CommandBlocks;
+  VOID                        *Map;
+  UINTN                       Timeout;
+} IDE_ASYNC_REQUEST;
+
+#define IDE_ASYNC_REQUEST_FROM_LINK(a)  CR (a, IDE_ASYNC_REQUEST, Link, IDE_ASYNC_REQUEST_SIGNATURE)
+
 #include "ComponentName.h"
 
 #define IDE_BLOCK_IO_DEV_FROM_THIS(a)           CR (a, IDE_BLK_IO_DEV, BlkIo, IDE_BLK_IO_DEV_SIGNATURE)
+#define IDE_BLOCK_IO_DEV_FROM_BLOCK_IO2_THIS(a) CR (a, IDE_BLK_IO_DEV, BlkIo2, IDE_BLK_IO_DEV_SIGNATURE)
 #define IDE_BLOCK_IO_DEV_FROM_DISK_INFO_THIS(a) CR (a, IDE_BLK_IO_DEV, DiskInfo, IDE_BLK_IO_DEV_SIGNATURE)
 
 #include "Ide.h"
@@ -430,13 +577,108 @@ IDEBlkIoWriteBlocks (
   @param  This  Indicates a pointer to the calling context which to sepcify a 
                 sepcific block device
 
-  @retval EFI_SUCCESS   Always return success.
+  @retval EFI_SUCCESS       All the modified lines of the block cache were written.
+  @retval EFI_DEVICE_ERROR  A modified line of the block cache could not be written.
 **/
 EFI_STATUS
 EFIAPI
 IDEBlkIoFlushBlocks (
   IN  EFI_BLOCK_IO_PROTOCOL       *This
   );
+
+/**
+  Reset a block IO device, after the non-blocking requests queued on its channel
+  are completed.
+
+  @param  This                  Block IO 2 protocol instance pointer.
+  @param  ExtendedVerification  If FALSE,for ATAPI device, driver will only invoke ATAPI reset method
+                                If TRUE, for ATAPI device, driver need invoke ATA reset method after
+                                invoke ATAPI reset method
+
+  @retval EFI_DEVICE_ERROR      When the device is neighther ATA device or ATAPI device.
+  @retval EFI_SUCCESS           The device reset successfully
+
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2Reset (
+  IN  EFI_BLOCK_IO2_PROTOCOL      *This,
+  IN  BOOLEAN                     ExtendedVerification
+  );
+
+/**
+  Read data from a block IO device. The UDMA reads of hard disks with an event
+  are non-blocking, the other ones complete before the function returns.
+
+  @param  This       Block IO 2 protocol instance pointer.
+  @param  MediaId    The media ID of the device
+  @param  Lba        Starting LBA address to read data
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of data to be read
+  @param  Buffer     Caller supplied buffer to save data
+
+  @retval EFI_SUCCESS           The read request was queued if Token->Event is
+                                not NULL, the data was read otherwise.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+  @retval other                 read data status.
+
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2ReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL   *This,
+  IN     UINT32                   MediaId,
+  IN     EFI_LBA                  Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN      *Token,
+  IN     UINTN                    BufferSize,
+  OUT    VOID                     *Buffer
+  );
+
+/**
+  Write data to a block IO device. The UDMA writes of hard disks with an event
+  are non-blocking, the other ones complete before the function returns.
+
+  @param  This       Block IO 2 protocol instance pointer.
+  @param  MediaId    The media ID of the device
+  @param  Lba        Starting LBA address to write data
+  @param  Token      A pointer to the token associated with the transaction.
+  @param  BufferSize The size of data to be written
+  @param  Buffer     Caller supplied buffer to save data
+
+  @retval EFI_SUCCESS           The write request was queued if Token->Event is
+                                not NULL, the data was written otherwise.
+  @retval EFI_OUT_OF_RESOURCES  The request could not be queued.
+  @retval other                 write data status.
+
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2WriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL   *This,
+  IN     UINT32                   MediaId,
+  IN     EFI_LBA                  Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN      *Token,
+  IN     UINTN                    BufferSize,
+  IN     VOID                     *Buffer
+  );
+
+/**
+  Flushes all modified data to a physical block device, including the data of
+  the non-blocking writes queued before. The flush completes before the function
+  returns.
+
+  @param  This   Block IO 2 protocol instance pointer.
+  @param  Token  A pointer to the token associated with the transaction.
+
+  @retval EFI_SUCCESS       All the modified lines of the block cache were written.
+  @retval EFI_DEVICE_ERROR  A modified line of the block cache could not be written.
+**/
+EFI_STATUS
+EFIAPI
+IDEBlkIo2FlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL   *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN      *Token
+  );
 /**
   This function is used by the IDE bus driver to get inquiry data. 
   Data format of Identify data is defined by the Interface GUID.
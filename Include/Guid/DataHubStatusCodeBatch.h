@@ -0,0 +1,92 @@
+/** @file
+  GUID and format of the Data Hub records in which the status code drivers log
+  many status codes at once in a compact binary form.
+
+  A record starts with a DATA_HUB_STATUS_CODE_BATCH_HEADER followed by a stream
+  of entries. Each entry starts with a tag byte. Integers are encoded as
+  unsigned LEB128 varints: 7 bits per byte, least significant group first,
+  with BIT7 set in every byte but the last.
+
+  A format entry (DATA_HUB_STATUS_CODE_ENTRY_FORMAT) holds:
+    varint FormatId, varint Length, Length bytes of the ASCII format string.
+  It precedes the first status code entry using FormatId. Format identifiers
+  are defined once per boot, so the records must be decoded in the order of
+  their monotonic counts.
+
+  A status code entry (DATA_HUB_STATUS_CODE_ENTRY_STATUS_CODE) holds:
+    varint CodeType, varint Value, varint Instance,
+    the 16 bytes of the caller ID if DATA_HUB_STATUS_CODE_ENTRY_CALLER_ID is set,
+    then, depending on the data bits of the tag:
+    - DATA_HUB_STATUS_CODE_ENTRY_DATA_DEBUG: varint ErrorLevel, varint FormatId,
+      the format string inline as varint Length and bytes if FormatId is
+      DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID, and the arguments of the format
+      string in order. Integer arguments are varints, with %d arguments
+      zigzag-encoded. %a, %s and %S arguments are varint Length and ASCII bytes.
+      %g and %t arguments are the 16 bytes of the EFI_GUID or EFI_TIME.
+    - DATA_HUB_STATUS_CODE_ENTRY_DATA_RAW: the 16 bytes of the data type GUID,
+      varint Size and Size bytes of extended data. The pointers of two kinds
+      of extended data are replaced by the strings they point to:
+      ASSERT() data, as recognized by ReportStatusCodeExtractAssertInfo(), is
+      the UINT32 line number followed by the NUL terminated file name and
+      description. EFI_STATUS_CODE_STRING_DATA with an ASCII string is the
+      UINT32 EfiStringAscii followed by the NUL terminated string.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.             
+
+**/
+
+#ifndef __DATA_HUB_STATUS_CODE_BATCH_H__
+#define __DATA_HUB_STATUS_CODE_BATCH_H__
+
+#define DATA_HUB_STATUS_CODE_BATCH_GUID \
+  { \
+    0x27296e02, 0x97d4, 0x450b, {0xbd, 0x58, 0x46, 0x2c, 0x95, 0x06, 0xe3, 0xf1 } \
+  }
+
+#define DATA_HUB_STATUS_CODE_BATCH_VERSION          1
+
+//
+// Tag byte of an entry.
+//
+#define DATA_HUB_STATUS_CODE_ENTRY_TYPE_MASK        0x03
+#define DATA_HUB_STATUS_CODE_ENTRY_STATUS_CODE      0x00
+#define DATA_HUB_STATUS_CODE_ENTRY_FORMAT           0x01
+#define DATA_HUB_STATUS_CODE_ENTRY_CALLER_ID        0x04
+#define DATA_HUB_STATUS_CODE_ENTRY_DATA_MASK        0x30
+#define DATA_HUB_STATUS_CODE_ENTRY_DATA_NONE        0x00
+#define DATA_HUB_STATUS_CODE_ENTRY_DATA_DEBUG       0x10
+#define DATA_HUB_STATUS_CODE_ENTRY_DATA_RAW         0x20
+
+///
+/// Format identifier of a debug entry which carries its format string inline.
+///
+#define DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID       0
+
+///
+/// The header of a batch record. The entries follow it.
+///
+typedef struct {
+  ///
+  /// DATA_HUB_STATUS_CODE_BATCH_VERSION.
+  ///
+  UINT16  Version;
+  ///
+  /// The number of status code entries in the record.
+  ///
+  UINT16  EntryCount;
+  ///
+  /// The number of bytes of entries following the header.
+  ///
+  UINT32  Size;
+} DATA_HUB_STATUS_CODE_BATCH_HEADER;
+
+extern EFI_GUID gDataHubStatusCodeBatchGuid;
+
+#endif
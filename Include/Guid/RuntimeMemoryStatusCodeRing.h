@@ -0,0 +1,108 @@
+/** @file
+  GUID and layout of the ring of status codes kept in runtime memory by the
+  Status Code Runtime DXE driver.
+
+  The ring is published as an EFI configuration table so that code running
+  outside the driver, such as an SMM status code handler or a post-mortem
+  analysis tool reading a memory dump, can locate it.
+
+  A writer reserves a record by atomically incrementing LastSequence. The
+  value returned is the sequence number of its record, which is stored in
+  Records[(Sequence - 1) % MaxRecordsNumber]. The writer clears the Sequence
+  field of the record, fills in the other fields and stores the sequence
+  number last. A record whose Sequence field does not hold the expected
+  sequence number is either still being written or has been overwritten.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.             
+
+**/
+
+#ifndef __RUNTIME_MEMORY_STATUS_CODE_RING_H__
+#define __RUNTIME_MEMORY_STATUS_CODE_RING_H__
+
+///
+/// The GUID of the configuration table pointing to a RUNTIME_MEMORY_STATUS_CODE_RING.
+///
+#define RUNTIME_MEMORY_STATUS_CODE_RING_GUID \
+  { \
+    0x8cb4bbc0, 0x6daf, 0x4b05, {0xa4, 0xd4, 0x17, 0x68, 0x79, 0x70, 0xd6, 0x8b } \
+  }
+
+#define RUNTIME_MEMORY_STATUS_CODE_RING_SIGNATURE  SIGNATURE_32 ('R', 'S', 'C', 'R')
+
+///
+/// A status code kept in the ring.
+///
+typedef struct {
+  ///
+  /// Sequence number of the record. Sequence numbers start with 1 and
+  /// increase by one for each status code reported, so a gap between two
+  /// records read in order means that records were overwritten before they
+  /// were read. Zero while the record is being written.
+  ///
+  UINT32                 Sequence;
+
+  ///
+  /// The enumeration of a hardware or software entity within
+  /// the system.  Valid instance numbers start with 1.
+  ///
+  UINT32                 Instance;
+
+  ///
+  /// Value of the performance counter when the status code was reported.
+  /// Zero means no time stamp, as for status codes reported at runtime.
+  ///
+  UINT64                 TimeStamp;
+
+  ///
+  /// Status Code type reported.
+  ///
+  EFI_STATUS_CODE_TYPE   CodeType;
+
+  ///
+  /// An operation, plus value information about the class and subclass, used to
+  /// classify the hardware and software entity.
+  ///
+  EFI_STATUS_CODE_VALUE  Value;
+} RUNTIME_MEMORY_STATUS_CODE_RECORD;
+
+///
+/// Header of the ring. MaxRecordsNumber records follow it.
+///
+typedef struct {
+  ///
+  /// RUNTIME_MEMORY_STATUS_CODE_RING_SIGNATURE.
+  ///
+  UINT32                 Signature;
+
+  ///
+  /// Number of records the ring holds.
+  ///
+  UINT32                 MaxRecordsNumber;
+
+  ///
+  /// Sequence number of the last record reserved by a writer. Zero if no
+  /// status code has been reported yet.
+  ///
+  UINT32                 LastSequence;
+
+  UINT32                 Reserved;
+
+  ///
+  /// Frequency, in Hz, of the performance counter the time stamps are read
+  /// from. Zero if there is no counter, in which case no record has a time
+  /// stamp.
+  ///
+  UINT64                 TimeStampFrequency;
+} RUNTIME_MEMORY_STATUS_CODE_RING;
+
+extern EFI_GUID gRuntimeMemoryStatusCodeRingGuid;
+
+#endif
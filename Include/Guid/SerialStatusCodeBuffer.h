@@ -0,0 +1,45 @@
+/** @file
+  GUID and layout of the GUID'ed HOB in which the Status Code PEIM buffers
+  the serial status code output.
+
+  The PEIM writes the buffered output to the serial port when the buffer
+  is full, when an error code is reported and at the end of PEI. Data left
+  in the HOB when DXE starts is written out by the Status Code Runtime DXE
+  driver before any DXE status code.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.             
+
+**/
+
+#ifndef __SERIAL_STATUS_CODE_BUFFER_H__
+#define __SERIAL_STATUS_CODE_BUFFER_H__
+
+#define SERIAL_STATUS_CODE_BUFFER_GUID \
+  { \
+    0x5703fbcd, 0x32ff, 0x44df, {0xa6, 0xa0, 0xc9, 0xf5, 0xec, 0x9e, 0xc7, 0x92 } \
+  }
+
+///
+/// The header of the GUID'ed HOB. The buffered characters follow it.
+///
+typedef struct {
+  ///
+  /// The number of bytes available for characters after the header.
+  ///
+  UINT32  Size;
+  ///
+  /// The number of characters not yet written to the serial port.
+  ///
+  UINT32  Length;
+} SERIAL_STATUS_CODE_BUFFER_HEADER;
+
+extern EFI_GUID gSerialStatusCodeBufferGuid;
+
+#endif
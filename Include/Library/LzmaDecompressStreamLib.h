@@ -0,0 +1,182 @@
+/** @file
+  Incremental decompression interface for LZMA compressed data.
+
+  Unlike LzmaUefiDecompress(), the caller does not need a destination buffer
+  for the whole uncompressed image. The decoder keeps its probability model
+  and the LZMA dictionary in the scratch buffer, and hands out the
+  uncompressed data in chunks of any size.
+
+  A decompression context keeps the decoder and its probability model in a
+  scratch region that is reused across any number of compressed buffers.
+
+  Both interfaces decode raw LZMA data, as found in sections defined by
+  gLzmaCustomDecompressGuid. The x86 converter of gLzmaF86CustomDecompressGuid
+  sections is not applied, so those sections must be decoded through their
+  GUIDed section handler instead.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __LZMA_DECOMPRESS_STREAM_LIB_H__
+#define __LZMA_DECOMPRESS_STREAM_LIB_H__
+
+/**
+  Retrieves the size of the uncompressed data and the size of the scratch
+  buffer required to decompress it incrementally.
+
+  The scratch buffer holds the decoder state and the dictionary. The
+  dictionary is the smaller of the dictionary size recorded in the LZMA
+  header and the size of the uncompressed data, and does not depend on the
+  size of the chunks later requested from LzmaUefiDecompressStreamRead().
+
+  If Source is NULL, then ASSERT().
+  If DestinationSize is NULL, then ASSERT().
+  If ScratchSize is NULL, then ASSERT().
+
+  @param  Source          The source buffer containing the compressed data.
+  @param  SourceSize      The size, in bytes, of the source buffer.
+  @param  DestinationSize A pointer to the size, in bytes, of the uncompressed data.
+  @param  ScratchSize     A pointer to the size, in bytes, of the scratch buffer that
+                          is required to decompress the data incrementally.
+
+  @retval  RETURN_SUCCESS           The sizes were returned.
+  @retval  RETURN_INVALID_PARAMETER The sizes cannot be determined from the source
+                                    data.
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressStreamGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  );
+
+/**
+  Prepares a scratch buffer for the incremental decompression of Source.
+
+  Source and Scratch must stay valid and must not move until the last call
+  to LzmaUefiDecompressStreamRead() for this stream.
+
+  If Source is NULL, then ASSERT().
+  If Scratch is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size, in bytes, of the source buffer.
+  @param  Scratch     The scratch buffer of the size reported by
+                      LzmaUefiDecompressStreamGetInfo().
+
+  @retval  RETURN_SUCCESS           The stream is ready to be read.
+  @retval  RETURN_INVALID_PARAMETER The source data is not a valid compressed
+                                    buffer.
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressStreamInit (
+  IN     CONST VOID  *Source,
+  IN     UINT32      SourceSize,
+  IN OUT VOID        *Scratch
+  );
+
+/**
+  Decompresses the next chunk of a stream prepared by LzmaUefiDecompressStreamInit().
+
+  On return, BufferSize holds the number of bytes written to Buffer. It is
+  smaller than the requested size only when the end of the uncompressed data
+  is reached, and it is zero once all the data has been returned.
+
+  If Scratch is NULL, then ASSERT().
+  If BufferSize is NULL, then ASSERT().
+  If Buffer is NULL and *BufferSize is not zero, then ASSERT().
+
+  @param  Scratch     The scratch buffer passed to LzmaUefiDecompressStreamInit().
+  @param  Buffer      The buffer that receives the uncompressed data.
+  @param  BufferSize  On input, the size, in bytes, of Buffer. On output, the
+                      number of bytes written to Buffer.
+
+  @retval  RETURN_SUCCESS           BufferSize bytes were written to Buffer.
+  @retval  RETURN_INVALID_PARAMETER The source data is corrupted. The stream
+                                    cannot be read any further.
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressStreamRead (
+  IN OUT VOID    *Scratch,
+  OUT    VOID    *Buffer,
+  IN OUT UINT32  *BufferSize
+  );
+
+/**
+  Retrieves the size of a decompression context.
+
+  A decompression context holds the LZMA decoder and its probability model
+  and can be used for any number of LzmaUefiDecompressWithContext() calls,
+  so a caller decoding many sections needs a single scratch region instead
+  of one per section.
+
+  @return The size, in bytes, of a decompression context.
+
+**/
+UINT32
+EFIAPI
+LzmaUefiDecompressContextGetSize (
+  VOID
+  );
+
+/**
+  Prepares a decompression context for its first use.
+
+  The context must not move once it has been used for decompression.
+
+  If Context is NULL, then ASSERT().
+
+  @param  Context     The decompression context of the size reported by
+                      LzmaUefiDecompressContextGetSize().
+
+**/
+VOID
+EFIAPI
+LzmaUefiDecompressContextInit (
+  OUT VOID  *Context
+  );
+
+/**
+  Decompresses a LZMA compressed source buffer using a decompression context
+  prepared by LzmaUefiDecompressContextInit().
+
+  The probability model kept in the context is reset for each call, and is
+  only laid out again when the literal context and position bits of Source
+  differ from those of the previous call.
+
+  If Source is NULL, then ASSERT().
+  If Destination is NULL, then ASSERT().
+  If Context is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size, in bytes, of the source buffer.
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Context     The decompression context.
+
+  @retval  RETURN_SUCCESS           Decompression completed successfully, and
+                                    the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER The source buffer specified by Source is corrupted
+                                    (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressWithContext (
+  IN CONST VOID  *Source,
+  IN UINTN       SourceSize,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Context
+  );
+
+#endif
@@ -0,0 +1,178 @@
+/** @file
+  Incremental decompression interface for UEFI and Tiano compressed data.
+
+  Unlike UefiDecompress(), the caller does not need a destination buffer for
+  the whole uncompressed image. The decoder keeps its state and a sliding
+  window of recently produced bytes in the scratch buffer, and hands out the
+  uncompressed data in chunks of any size.
+
+  A decompression context keeps the decoder state in a scratch region that
+  is reused across any number of compressed buffers.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __TIANO_DECOMPRESS_STREAM_LIB_H__
+#define __TIANO_DECOMPRESS_STREAM_LIB_H__
+
+/**
+  Retrieves the size of the uncompressed data and the size of the scratch
+  buffer required to decompress it incrementally.
+
+  The scratch buffer holds the decoder state and the sliding window, so its
+  size depends on the compression algorithm and on the size of the
+  uncompressed data, but never on the size of the chunks later requested
+  from UefiTianoDecompressStreamRead().
+
+  If Source is NULL, then ASSERT().
+  If DestinationSize is NULL, then ASSERT().
+  If ScratchSize is NULL, then ASSERT().
+
+  @param  Source          The source buffer containing the compressed data.
+  @param  SourceSize      The size, in bytes, of the source buffer.
+  @param  Version         1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+  @param  DestinationSize A pointer to the size, in bytes, of the uncompressed data.
+  @param  ScratchSize     A pointer to the size, in bytes, of the scratch buffer that
+                          is required to decompress the data incrementally.
+
+  @retval  RETURN_SUCCESS           The sizes were returned.
+  @retval  RETURN_INVALID_PARAMETER The sizes cannot be determined from the source
+                                    data, or Version is not supported.
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressStreamGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  IN  UINT32      Version,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  );
+
+/**
+  Prepares a scratch buffer for the incremental decompression of Source.
+
+  Source and Scratch must stay valid and must not move until the last call
+  to UefiTianoDecompressStreamRead() for this stream.
+
+  If Source is NULL, then ASSERT().
+  If Scratch is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size, in bytes, of the source buffer.
+  @param  Scratch     The scratch buffer of the size reported by
+                      UefiTianoDecompressStreamGetInfo().
+  @param  Version     1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @retval  RETURN_SUCCESS           The stream is ready to be read.
+  @retval  RETURN_INVALID_PARAMETER The source data is not a valid compressed
+                                    buffer, or Version is not supported.
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressStreamInit (
+  IN     CONST VOID  *Source,
+  IN     UINT32      SourceSize,
+  IN OUT VOID        *Scratch,
+  IN     UINT32      Version
+  );
+
+/**
+  Decompresses the next chunk of a stream prepared by UefiTianoDecompressStreamInit().
+
+  On return, BufferSize holds the number of bytes written to Buffer. It is
+  smaller than the requested size only when the end of the uncompressed data
+  is reached, and it is zero once all the data has been returned.
+
+  If Scratch is NULL, then ASSERT().
+  If BufferSize is NULL, then ASSERT().
+  If Buffer is NULL and *BufferSize is not zero, then ASSERT().
+
+  @param  Scratch     The scratch buffer passed to UefiTianoDecompressStreamInit().
+  @param  Buffer      The buffer that receives the uncompressed data.
+  @param  BufferSize  On input, the size, in bytes, of Buffer. On output, the
+                      number of bytes written to Buffer.
+
+  @retval  RETURN_SUCCESS           BufferSize bytes were written to Buffer.
+  @retval  RETURN_INVALID_PARAMETER The source data is corrupted. The stream
+                                    cannot be read any further.
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressStreamRead (
+  IN OUT VOID    *Scratch,
+  OUT    VOID    *Buffer,
+  IN OUT UINT32  *BufferSize
+  );
+
+/**
+  Retrieves the size of a decompression context.
+
+  A decompression context holds the state of the UEFI and Tiano decoders and
+  can be used for any number of UefiTianoDecompressWithContext() calls, so a
+  caller decoding many sections needs a single scratch region instead of one
+  per section.
+
+  @return The size, in bytes, of a decompression context.
+
+**/
+UINT32
+EFIAPI
+UefiTianoDecompressContextGetSize (
+  VOID
+  );
+
+/**
+  Prepares a decompression context for its first use.
+
+  If Context is NULL, then ASSERT().
+
+  @param  Context     The decompression context of the size reported by
+                      UefiTianoDecompressContextGetSize().
+
+**/
+VOID
+EFIAPI
+UefiTianoDecompressContextInit (
+  OUT VOID  *Context
+  );
+
+/**
+  Decompresses a UEFI or Tiano compressed source buffer using a decompression
+  context prepared by UefiTianoDecompressContextInit().
+
+  Only the decoder state that is not rebuilt from the compressed data is
+  reset, so the context does not need to be cleared between calls.
+
+  If Source is NULL, then ASSERT().
+  If Destination is NULL, then ASSERT().
+  If Context is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Context     The decompression context.
+  @param  Version     1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @retval  RETURN_SUCCESS           Decompression completed successfully, and
+                                    the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER The source buffer specified by Source is corrupted
+                                    (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressWithContext (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Context,
+  IN UINT32      Version
+  );
+
+#endif
@@ -0,0 +1,100 @@
+/** @file
+  Defines the Data Hub Statistics protocol.
+
+  The protocol is installed by the Data Hub driver on the same handle as the
+  Data Hub protocol. It exposes counters that can be used to size the Data Hub
+  record storage for a platform.
+
+Copyright (c) 2014, Intel Corporation. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions
+of the BSD License which accompanies this distribution.  The
+full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _DATA_HUB_STATISTICS_PROTOCOL_H_
+#define _DATA_HUB_STATISTICS_PROTOCOL_H_
+
+#define DATA_HUB_STATISTICS_PROTOCOL_GUID \
+  { 0xa78002ac, 0x2770, 0x4a4c, { 0x87, 0xea, 0x36, 0xb0, 0x91, 0xcb, 0x83, 0x4b }}
+
+#define DATA_HUB_STATISTICS_PROTOCOL_REVISION  0x00010000
+
+///
+/// Counters maintained by the Data Hub driver. All the fields are read only
+/// for consumers.
+///
+typedef struct {
+  ///
+  /// Revision of this structure.
+  ///
+  UINT32    Revision;
+
+  ///
+  /// Size in bytes of one record storage chunk.
+  ///
+  UINT32    ArenaChunkSize;
+
+  ///
+  /// Number of records logged so far.
+  ///
+  UINT64    RecordCount;
+
+  ///
+  /// Total size in bytes of the logged records, headers included.
+  ///
+  UINT64    RecordBytes;
+
+  ///
+  /// Number of storage chunks allocated, oversize chunks included.
+  ///
+  UINT64    ArenaChunkCount;
+
+  ///
+  /// Number of records too large for a chunk that got a chunk of their own.
+  ///
+  UINT64    OversizeRecordCount;
+
+  ///
+  /// Total size in bytes of all the storage chunks.
+  ///
+  UINT64    ArenaBytesAllocated;
+
+  ///
+  /// Bytes of chunk storage handed out to log entries.
+  ///
+  UINT64    ArenaBytesUsed;
+
+  ///
+  /// Bytes left unused at the end of chunks that could not fit the next entry.
+  ///
+  UINT64    ArenaBytesWasted;
+
+  ///
+  /// Number of times a filter driver event was signaled for a new record.
+  ///
+  UINT64    FilterSignalCount;
+
+  ///
+  /// Number of records that were logged at high TPL or during another log
+  /// and went through the staging ring.
+  ///
+  UINT64    StagedRecordCount;
+
+  ///
+  /// Number of records dropped because the staging ring was full, the record
+  /// was too large for a staging slot, or there was no storage left when it
+  /// was drained. Updated when the staging ring is drained.
+  ///
+  UINT64    DroppedRecordCount;
+} DATA_HUB_STATISTICS_PROTOCOL;
+
+extern EFI_GUID gDataHubStatisticsProtocolGuid;
+
+#endif // #ifndef _DATA_HUB_STATISTICS_PROTOCOL_H_
@@ -0,0 +1,74 @@
+/** @file
+  Defines the Data Hub Status Code Statistics protocol.
+
+  The protocol is installed by the status code drivers which log status codes
+  into the Data Hub. It exposes the counters of the pool of records in which
+  status codes wait to be logged, which can be used to size the pool for a
+  platform.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions
+of the BSD License which accompanies this distribution.  The
+full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL_H_
+#define _DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL_H_
+
+#define DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL_GUID \
+  { 0xf1668d16, 0x033a, 0x47e9, { 0x95, 0x29, 0xc0, 0x52, 0x36, 0x74, 0xb3, 0x56 }}
+
+#define DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL_REVISION  0x00010000
+
+///
+/// Counters maintained by the Data Hub status code worker. All the fields are
+/// read only for consumers.
+///
+typedef struct {
+  ///
+  /// Revision of this structure.
+  ///
+  UINT32    Revision;
+
+  ///
+  /// Number of records allocated when the worker is initialized.
+  ///
+  UINT32    PoolSize;
+
+  ///
+  /// Number of records allocated so far, including the ones added when the
+  /// pool ran low.
+  ///
+  UINT64    RecordCount;
+
+  ///
+  /// Number of records currently free.
+  ///
+  UINT64    FreeCount;
+
+  ///
+  /// Largest number of records in use at the same time.
+  ///
+  UINT64    HighWaterCount;
+
+  ///
+  /// Number of times records were added to the pool.
+  ///
+  UINT64    RefillCount;
+
+  ///
+  /// Number of status codes not logged because no record was free.
+  ///
+  UINT64    DropCount;
+} DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL;
+
+extern EFI_GUID gDataHubStatusCodeStatisticsProtocolGuid;
+
+#endif // #ifndef _DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL_H_
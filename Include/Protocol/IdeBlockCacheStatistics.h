@@ -0,0 +1,96 @@
+/** @file
+  Defines the IDE Block Cache Statistics protocol.
+
+  The protocol is installed by the IDE bus driver on the handle of each hard
+  disk whose reads and writes go through a block cache, next to the Block I/O
+  protocol. It exposes the counters of the cache, which can be used to size
+  the cache for a platform.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions
+of the BSD License which accompanies this distribution.  The
+full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _IDE_BLOCK_CACHE_STATISTICS_PROTOCOL_H_
+#define _IDE_BLOCK_CACHE_STATISTICS_PROTOCOL_H_
+
+#define IDE_BLOCK_CACHE_STATISTICS_PROTOCOL_GUID \
+  { 0x24b05838, 0x41d1, 0x43fb, { 0xa4, 0x4f, 0x22, 0x1e, 0xb7, 0x18, 0xa7, 0x00 }}
+
+#define IDE_BLOCK_CACHE_STATISTICS_PROTOCOL_REVISION  0x00010000
+
+///
+/// Counters maintained by the IDE bus driver for the block cache of a hard
+/// disk. All the fields are read only for consumers.
+///
+typedef struct {
+  ///
+  /// Revision of this structure.
+  ///
+  UINT32    Revision;
+
+  ///
+  /// Size in bytes of the cached data.
+  ///
+  UINT32    CacheSize;
+
+  ///
+  /// Size in bytes of the lines the cached data is kept in. The data of a line
+  /// is read from and written to the disk as a whole.
+  ///
+  UINT32    LineSize;
+
+  ///
+  /// TRUE if writes are kept in the cache until they are flushed, FALSE if they
+  /// are written to the disk immediately.
+  ///
+  BOOLEAN   WriteBack;
+
+  ///
+  /// Number of blocks read by the callers which were found in the cache.
+  ///
+  UINT64    ReadHitBlocks;
+
+  ///
+  /// Number of blocks read by the callers which had to be read from the disk.
+  ///
+  UINT64    ReadMissBlocks;
+
+  ///
+  /// Number of blocks read from the disk ahead of a sequential stream of reads.
+  ///
+  UINT64    ReadAheadBlocks;
+
+  ///
+  /// Number of blocks read by the callers in requests too large for the cache,
+  /// which are read from the disk directly.
+  ///
+  UINT64    BypassReadBlocks;
+
+  ///
+  /// Number of blocks written by the callers.
+  ///
+  UINT64    WriteBlocks;
+
+  ///
+  /// Number of blocks of modified lines written to the disk in write-back mode.
+  ///
+  UINT64    WriteBackBlocks;
+
+  ///
+  /// Number of lines dropped from the cache to make room for other ones.
+  ///
+  UINT64    EvictionCount;
+} IDE_BLOCK_CACHE_STATISTICS_PROTOCOL;
+
+extern EFI_GUID gIdeBlockCacheStatisticsProtocolGuid;
+
+#endif // #ifndef _IDE_BLOCK_CACHE_STATISTICS_PROTOCOL_H_
@@ -0,0 +1,88 @@
+/** @file
+  Defines the Runtime Memory Status Code protocol.
+
+  The protocol is installed by the Status Code Runtime DXE driver when it
+  keeps status codes in runtime memory. It returns the status codes kept in
+  the ring in the order they were reported, starting from a cursor, and
+  tells the caller how many were overwritten before they could be read.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions
+of the BSD License which accompanies this distribution.  The
+full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _RUNTIME_MEMORY_STATUS_CODE_PROTOCOL_H_
+#define _RUNTIME_MEMORY_STATUS_CODE_PROTOCOL_H_
+
+#include <Guid/RuntimeMemoryStatusCodeRing.h>
+
+#define RUNTIME_MEMORY_STATUS_CODE_PROTOCOL_GUID \
+  { 0x7db74c6d, 0x4b26, 0x40bd, { 0xa9, 0x96, 0x61, 0x91, 0xb1, 0x68, 0x4c, 0x83 }}
+
+#define RUNTIME_MEMORY_STATUS_CODE_PROTOCOL_REVISION  0x00010000
+
+typedef struct _RUNTIME_MEMORY_STATUS_CODE_PROTOCOL RUNTIME_MEMORY_STATUS_CODE_PROTOCOL;
+
+/**
+  Returns the status codes kept in runtime memory, in the order they were
+  reported, starting with the status code of sequence number *Cursor.
+
+  Records still being written stop the read, so a record is never returned
+  before one reported earlier. Records overwritten before they could be read
+  are skipped and counted in LostCount.
+
+  @param  This          A pointer to the RUNTIME_MEMORY_STATUS_CODE_PROTOCOL instance.
+  @param  Cursor        On input, the sequence number of the first record to return.
+                        Zero is the same as 1, the first status code ever reported.
+                        On output, the sequence number to pass in the next call
+                        to continue after the records returned.
+  @param  Records       The buffer that receives the records.
+  @param  RecordCount   On input, the number of records Records can hold. On output,
+                        the number of records returned.
+  @param  LostCount     Optional. The number of records between the input and the
+                        output cursor that were overwritten before they were read.
+
+  @retval EFI_SUCCESS           RecordCount records were returned. RecordCount
+                                is zero if no new status code was reported.
+  @retval EFI_INVALID_PARAMETER Cursor or RecordCount is NULL, or Records is NULL
+                                and RecordCount is not zero.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *RUNTIME_MEMORY_STATUS_CODE_GET_RECORDS)(
+  IN     RUNTIME_MEMORY_STATUS_CODE_PROTOCOL  *This,
+  IN OUT UINT32                               *Cursor,
+  OUT    RUNTIME_MEMORY_STATUS_CODE_RECORD    *Records,
+  IN OUT UINTN                                *RecordCount,
+  OUT    UINT32                               *LostCount OPTIONAL
+  );
+
+///
+/// Reader of the status codes kept in runtime memory.
+///
+struct _RUNTIME_MEMORY_STATUS_CODE_PROTOCOL {
+  ///
+  /// Revision of this protocol.
+  ///
+  UINT32                                   Revision;
+
+  ///
+  /// The ring the records are read from.
+  ///
+  RUNTIME_MEMORY_STATUS_CODE_RING          *Ring;
+
+  RUNTIME_MEMORY_STATUS_CODE_GET_RECORDS   GetRecords;
+};
+
+extern EFI_GUID gRuntimeMemoryStatusCodeProtocolGuid;
+
+#endif // #ifndef _RUNTIME_MEMORY_STATUS_CODE_PROTOCOL_H_
@@ -0,0 +1,77 @@
+/** @file
+  Defines the Section Extraction Statistics protocol.
+
+  The protocol is installed by the Section Extraction driver on the same handle
+  as the Section Extraction protocol. It exposes the counters of the cache of
+  decoded encapsulation sections, which can be used to size the cache for a
+  platform.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions
+of the BSD License which accompanies this distribution.  The
+full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _SECTION_EXTRACTION_STATISTICS_PROTOCOL_H_
+#define _SECTION_EXTRACTION_STATISTICS_PROTOCOL_H_
+
+#define SECTION_EXTRACTION_STATISTICS_PROTOCOL_GUID \
+  { 0x56392362, 0x6d7d, 0x42e7, { 0xbb, 0x8b, 0x4f, 0x41, 0xf6, 0x91, 0x7d, 0x50 }}
+
+#define SECTION_EXTRACTION_STATISTICS_PROTOCOL_REVISION  0x00010000
+
+///
+/// Counters maintained by the Section Extraction driver. All the fields are
+/// read only for consumers.
+///
+typedef struct {
+  ///
+  /// Revision of this structure.
+  ///
+  UINT32    Revision;
+
+  ///
+  /// Maximum size in bytes of the decoded data kept in the cache. Zero if the
+  /// cache is disabled.
+  ///
+  UINT32    CacheSize;
+
+  ///
+  /// Size in bytes of the decoded data currently kept in the cache, including
+  /// the copies of the encapsulation sections it was decoded from.
+  ///
+  UINT64    CacheBytes;
+
+  ///
+  /// Number of decoded sections currently kept in the cache.
+  ///
+  UINT64    CacheEntryCount;
+
+  ///
+  /// Number of encapsulation sections whose decoded data was found in the
+  /// cache.
+  ///
+  UINT64    HitCount;
+
+  ///
+  /// Number of encapsulation sections that had to be decoded.
+  ///
+  UINT64    MissCount;
+
+  ///
+  /// Number of decoded sections dropped from the cache to make room for newer
+  /// ones.
+  ///
+  UINT64    EvictionCount;
+} SECTION_EXTRACTION_STATISTICS_PROTOCOL;
+
+extern EFI_GUID gSectionExtractionStatisticsProtocolGuid;
+
+#endif // #ifndef _SECTION_EXTRACTION_STATISTICS_PROTOCOL_H_
@@ -17,6 +17,10 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 /**
   Shift mBitBuf NumOfBits left. Read in NumOfBits of bits from source.
+
+  The low mBitCount bits of mSubBitBuf hold the source bits that follow
+  mBitBuf. While at least 4 bytes of source remain, mSubBitBuf is refilled
+  with 32 bits at once; only the tail of the source is consumed byte by byte.
   
   @param Sd         The global scratch data
   @param NumOfBits  The number of bits to shift and read.  
@@ -27,19 +31,42 @@ FillBuf (
   IN  UINT16        NumOfBits
   )
 {
+  UINT8   *Src;
+
+  if (NumOfBits == 0) {
+    return;
+  }
+
   //
   // Left shift NumOfBits of bits in advance
   //
-  Sd->mBitBuf = (UINT32) (Sd->mBitBuf << NumOfBits);
+  if (NumOfBits >= BITBUFSIZ) {
+    Sd->mBitBuf = 0;
+  } else {
+    Sd->mBitBuf = (UINT32) (Sd->mBitBuf << NumOfBits);
+  }
 
   //
   // Copy data needed in bytes into mSbuBitBuf
   //
   while (NumOfBits > Sd->mBitCount) {
 
-    Sd->mBitBuf |= (UINT32) (Sd->mSubBitBuf << (NumOfBits = (UINT16) (NumOfBits - Sd->mBitCount)));
+    NumOfBits = (UINT16) (NumOfBits - Sd->mBitCount);
+    if (NumOfBits < BITBUFSIZ) {
+      Sd->mBitBuf |= (UINT32) (Sd->mSubBitBuf << NumOfBits);
+    }
 
-    if (Sd->mCompSize > 0) {
+    if (Sd->mCompSize >= sizeof (UINT32)) {
+      //
+      // Get 4 bytes into SubBitBuf, most significant byte first
+      //
+      Src             = Sd->mSrcBase + Sd->mInBuf;
+      Sd->mCompSize  -= sizeof (UINT32);
+      Sd->mInBuf     += sizeof (UINT32);
+      Sd->mSubBitBuf  = ((UINT32) Src[0] << 24) | ((UINT32) Src[1] << 16) | ((UINT32) Src[2] << 8) | Src[3];
+      Sd->mBitCount   = 32;
+
+    } else if (Sd->mCompSize > 0) {
       //
       // Get 1 byte into SubBitBuf
       //
@@ -64,7 +91,8 @@ FillBuf (
   Sd->mBitCount = (UINT16) (Sd->mBitCount - NumOfBits);
   
   //
-  // Copy NumOfBits of bits from mSubBitBuf into mBitBuf
+  // Copy NumOfBits of bits from mSubBitBuf into mBitBuf. Bits of mSubBitBuf
+  // above mBitCount were consumed already and land on identical bits of mBitBuf.
   //
   Sd->mBitBuf |= Sd->mSubBitBuf >> Sd->mBitCount;
 }
@@ -108,7 +136,7 @@ GetBits (
 
   Creates Huffman Code mapping table for Extra Set, Char&Len Set 
   and Position Set according to code length array.
-  If TableBits > 16, then ASSERT ().
+  If TableBits > 15, then ASSERT ().
 
   @param  Sd        The global scratch data
   @param  NumOfChar Number of symbols in the symbol set
@@ -146,9 +174,9 @@ MakeTable (
 
   //
   // The maximum mapping table width supported by this internal
-  // working function is 16.
+  // working function is 15.
   //
-  ASSERT (TableBits <= 16);
+  ASSERT (TableBits <= 15);
 
   for (Index = 0; Index <= 16; Index++) {
     Count[Index] = 0;
@@ -266,10 +294,10 @@ DecodeP (
   UINT32  Mask;
   UINT32  Pos;
 
-  Val = Sd->mPTTable[Sd->mBitBuf >> (BITBUFSIZ - 8)];
+  Val = Sd->mPTTable[Sd->mBitBuf >> (BITBUFSIZ - PTTABLE_BITS)];
 
   if (Val >= MAXNP) {
-    Mask = 1U << (BITBUFSIZ - 1 - 8);
+    Mask = 1U << (BITBUFSIZ - 1 - PTTABLE_BITS);
 
     do {
 
@@ -335,7 +363,7 @@ ReadPTLen (
     //
     CharC = (UINT16) GetBits (Sd, nbit);
 
-    for (Index = 0; Index < 256; Index++) {
+    for (Index = 0; Index < (1U << PTTABLE_BITS); Index++) {
       Sd->mPTTable[Index] = CharC;
     }
 
@@ -385,7 +413,7 @@ ReadPTLen (
     Sd->mPTLen[Index++] = 0;
   }
   
-  return MakeTable (Sd, nn, Sd->mPTLen, 8, Sd->mPTTable);
+  return MakeTable (Sd, nn, Sd->mPTLen, PTTABLE_BITS, Sd->mPTTable);
 }
 
 /**
@@ -417,7 +445,7 @@ ReadCLen (
 
     SetMem (Sd->mCLen, NC, 0);
 
-    for (Index = 0; Index < 4096; Index++) {
+    for (Index = 0; Index < (1U << CTABLE_BITS); Index++) {
       Sd->mCTable[Index] = CharC;
     }
 
@@ -426,9 +454,9 @@ ReadCLen (
 
   Index = 0;
   while (Index < Number && Index < NC) {
-    CharC = Sd->mPTTable[Sd->mBitBuf >> (BITBUFSIZ - 8)];
+    CharC = Sd->mPTTable[Sd->mBitBuf >> (BITBUFSIZ - PTTABLE_BITS)];
     if (CharC >= NT) {
-      Mask = 1U << (BITBUFSIZ - 1 - 8);
+      Mask = 1U << (BITBUFSIZ - 1 - PTTABLE_BITS);
 
       do {
 
@@ -470,7 +498,7 @@ ReadCLen (
 
   SetMem (Sd->mCLen + Index, NC - Index, 0);
 
-  MakeTable (Sd, NC, Sd->mCLen, 12, Sd->mCTable);
+  MakeTable (Sd, NC, Sd->mCLen, CTABLE_BITS, Sd->mCTable);
 
   return ;
 }
@@ -531,10 +559,10 @@ DecodeC (
   // Get one code according to Code&Set Huffman Table
   //
   Sd->mBlockSize--;
-  Index2 = Sd->mCTable[Sd->mBitBuf >> (BITBUFSIZ - 12)];
+  Index2 = Sd->mCTable[Sd->mBitBuf >> (BITBUFSIZ - CTABLE_BITS)];
 
   if (Index2 >= NC) {
-    Mask = 1U << (BITBUFSIZ - 1 - 12);
+    Mask = 1U << (BITBUFSIZ - 1 - CTABLE_BITS);
 
     do {
       if ((Sd->mBitBuf & Mask) != 0) {
@@ -567,6 +595,7 @@ Decode (
   UINT16  BytesRemain;
   UINT32  DataIdx;
   UINT16  CharC;
+  UINT8   *Dst;
 
   BytesRemain = (UINT16) (-1);
 
@@ -611,16 +640,22 @@ Decode (
       DataIdx     = Sd->mOutBuf - DecodeP (Sd) - 1;
 
       //
-      // Write BytesRemain of bytes into mDstBase
+      // Write BytesRemain of bytes into mDstBase, stopping at mOrigSize.
+      // The copy runs forward byte by byte because source and destination
+      // overlap when the distance is shorter than the string length.
       //
-      BytesRemain--;
-      while ((INT16) (BytesRemain) >= 0) {
-        Sd->mDstBase[Sd->mOutBuf++] = Sd->mDstBase[DataIdx++];
-        if (Sd->mOutBuf >= Sd->mOrigSize) {
-          goto Done ;
-        }
+      if (BytesRemain > Sd->mOrigSize - Sd->mOutBuf) {
+        BytesRemain = (UINT16) (Sd->mOrigSize - Sd->mOutBuf);
+      }
+
+      Dst          = Sd->mDstBase + Sd->mOutBuf;
+      Sd->mOutBuf += BytesRemain;
+      while (BytesRemain-- > 0) {
+        *Dst++ = Sd->mDstBase[DataIdx++];
+      }
 
-        BytesRemain--;
+      if (Sd->mOutBuf >= Sd->mOrigSize) {
+        goto Done ;
       }
     }
   }
@@ -699,59 +734,40 @@ UefiDecompressGetInfo (
 }
 
 /**
-  Decompresses a compressed source buffer by EFI or Tiano algorithm.
+  Decompresses a UEFI or Tiano compressed source buffer with the given
+  scratch data.
 
-  Extracts decompressed data to its original form.
-  This function is designed so that the decompression algorithm can be implemented
-  without using any memory services.  As a result, this function is not allowed to
-  call any memory allocation services in its implementation.  It is the caller's 
-  responsibility to allocate and free the Destination and Scratch buffers.
-  If the compressed source data specified by Source is successfully decompressed 
-  into Destination, then RETURN_SUCCESS is returned.  If the compressed source data 
-  specified by Source is not in a valid compressed data format,
-  then RETURN_INVALID_PARAMETER is returned.
-
-  If Source is NULL, then ASSERT().
-  If Destination is NULL, then ASSERT().
-  If the required scratch buffer size > 0 and Scratch is NULL, then ASSERT().
+  The fields of the scratch data that are not rebuilt from the compressed
+  data are reset first. The Huffman tables that are rebuilt for every block
+  are left as they are, so the scratch data may be reused across calls
+  without being cleared.
 
   @param  Source      The source buffer containing the compressed data.
-  @param  Destination The destination buffer to store the decompressed data
-  @param  Scratch     A temporary scratch buffer that is used to perform the decompression.
-                      This is an optional parameter that may be NULL if the 
-                      required scratch buffer size is 0.
-  @param  Version     1 for UEFI Decompress algoruthm, 2 for Tiano Decompess algorithm.
-
-  @retval  RETURN_SUCCESS Decompression completed successfully, and 
-                          the uncompressed buffer is returned in Destination.
-  @retval  RETURN_INVALID_PARAMETER 
-                          The source buffer specified by Source is corrupted 
-                          (not in a valid compressed format).
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Sd          The scratch data.
+  @param  Version     1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @retval  RETURN_SUCCESS           Decompression completed successfully, and
+                                    the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER The source buffer specified by Source is corrupted
+                                    (not in a valid compressed format).
 **/
 RETURN_STATUS
-EFIAPI
-UefiTianoDecompress (
-  IN CONST VOID  *Source,
-  IN OUT VOID    *Destination,
-  IN OUT VOID    *Scratch,
-  IN UINT32      Version
+DecompressWithScratchData (
+  IN CONST VOID        *Source,
+  IN OUT VOID          *Destination,
+  IN OUT SCRATCH_DATA  *Sd,
+  IN UINT32            Version
   )
 {
   UINT32           CompSize;
   UINT32           OrigSize;
-  SCRATCH_DATA     *Sd;
   CONST UINT8      *Src;
   UINT8            *Dst;
 
-  ASSERT (Source != NULL);
-  ASSERT (Destination != NULL);
-  ASSERT (Scratch != NULL);
-
   Src     = Source;
   Dst     = Destination;
 
-  Sd = (SCRATCH_DATA *) Scratch;
-
   CompSize  = Src[0] + (Src[1] << 8) + (Src[2] << 16) + (Src[3] << 24);
   OrigSize  = Src[4] + (Src[5] << 8) + (Src[6] << 16) + (Src[7] << 24);
 
@@ -764,7 +780,7 @@ UefiTianoDecompress (
 
   Src = Src + 8;
 
-  SetMem (Sd, sizeof (SCRATCH_DATA), 0);
+  SetMem (Sd, OFFSET_OF (SCRATCH_DATA, mLeft), 0);
 
   //
   // The length of the field 'Position Set Code Length Array Size' in Block Header.
@@ -809,6 +825,54 @@ UefiTianoDecompress (
   return RETURN_SUCCESS;
 }
 
+/**
+  Decompresses a compressed source buffer by EFI or Tiano algorithm.
+
+  Extracts decompressed data to its original form.
+  This function is designed so that the decompression algorithm can be implemented
+  without using any memory services.  As a result, this function is not allowed to
+  call any memory allocation services in its implementation.  It is the caller's 
+  responsibility to allocate and free the Destination and Scratch buffers.
+  If the compressed source data specified by Source is successfully decompressed 
+  into Destination, then RETURN_SUCCESS is returned.  If the compressed source data 
+  specified by Source is not in a valid compressed data format,
+  then RETURN_INVALID_PARAMETER is returned.
+
+  If Source is NULL, then ASSERT().
+  If Destination is NULL, then ASSERT().
+  If the required scratch buffer size > 0 and Scratch is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  Destination The destination buffer to store the decompressed data
+  @param  Scratch     A temporary scratch buffer that is used to perform the decompression.
+                      This is an optional parameter that may be NULL if the 
+                      required scratch buffer size is 0.
+  @param  Version     1 for UEFI Decompress algoruthm, 2 for Tiano Decompess algorithm.
+
+  @retval  RETURN_SUCCESS Decompression completed successfully, and 
+                          the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER 
+                          The source buffer specified by Source is corrupted 
+                          (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompress (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch,
+  IN UINT32      Version
+  )
+{
+  ASSERT (Source != NULL);
+  ASSERT (Destination != NULL);
+  ASSERT (Scratch != NULL);
+
+  SetMem (Scratch, sizeof (SCRATCH_DATA), 0);
+
+  return DecompressWithScratchData (Source, Destination, (SCRATCH_DATA *) Scratch, Version);
+}
+
 /**
   Decompresses a UEFI compressed source buffer.
 
@@ -849,6 +913,335 @@ UefiDecompress (
   return UefiTianoDecompress (Source, Destination, Scratch, 1);
 }
 
+/**
+  Computes the size of the sliding window used by the streaming decoder.
+
+  @param  OrigSize  The size, in bytes, of the uncompressed data.
+  @param  Version   1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @return The window size, a power of two no larger than the window of the
+          compression algorithm and no larger than needed for OrigSize bytes.
+
+**/
+UINT32
+GetStreamWindowSize (
+  IN  UINT32  OrigSize,
+  IN  UINT32  Version
+  )
+{
+  UINT32  WindowSize;
+
+  if (Version == 1) {
+    WindowSize = 1U << UEFI_STREAM_WINDOW_BITS;
+  } else {
+    WindowSize = 1U << TIANO_STREAM_WINDOW_BITS;
+  }
+
+  //
+  // A string never reaches further back than the start of the data
+  //
+  while (WindowSize > 1 && (WindowSize >> 1) >= OrigSize) {
+    WindowSize >>= 1;
+  }
+
+  return WindowSize;
+}
+
+/**
+  Retrieves the size of the uncompressed data and the size of the scratch
+  buffer required to decompress it incrementally.
+
+  The scratch buffer holds the decoder state and the sliding window, so its
+  size depends on the compression algorithm and on the size of the
+  uncompressed data, but never on the size of the chunks later requested
+  from UefiTianoDecompressStreamRead().
+
+  If Source is NULL, then ASSERT().
+  If DestinationSize is NULL, then ASSERT().
+  If ScratchSize is NULL, then ASSERT().
+
+  @param  Source          The source buffer containing the compressed data.
+  @param  SourceSize      The size, in bytes, of the source buffer.
+  @param  Version         1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+  @param  DestinationSize A pointer to the size, in bytes, of the uncompressed data.
+  @param  ScratchSize     A pointer to the size, in bytes, of the scratch buffer that
+                          is required to decompress the data incrementally.
+
+  @retval  RETURN_SUCCESS           The sizes were returned.
+  @retval  RETURN_INVALID_PARAMETER The sizes cannot be determined from the source
+                                    data, or Version is not supported.
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressStreamGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  IN  UINT32      Version,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  RETURN_STATUS  Status;
+
+  if (Version != 1 && Version != 2) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Status = UefiDecompressGetInfo (Source, SourceSize, DestinationSize, ScratchSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  *ScratchSize = sizeof (TIANO_DECOMPRESS_STREAM) + GetStreamWindowSize (*DestinationSize, Version);
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Prepares a scratch buffer for the incremental decompression of Source.
+
+  Source and Scratch must stay valid and must not move until the last call
+  to UefiTianoDecompressStreamRead() for this stream.
+
+  If Source is NULL, then ASSERT().
+  If Scratch is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size, in bytes, of the source buffer.
+  @param  Scratch     The scratch buffer of the size reported by
+                      UefiTianoDecompressStreamGetInfo().
+  @param  Version     1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @retval  RETURN_SUCCESS           The stream is ready to be read.
+  @retval  RETURN_INVALID_PARAMETER The source data is not a valid compressed
+                                    buffer, or Version is not supported.
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressStreamInit (
+  IN     CONST VOID  *Source,
+  IN     UINT32      SourceSize,
+  IN OUT VOID        *Scratch,
+  IN     UINT32      Version
+  )
+{
+  RETURN_STATUS            Status;
+  UINT32                   OrigSize;
+  UINT32                   ScratchSize;
+  TIANO_DECOMPRESS_STREAM  *Stream;
+  SCRATCH_DATA             *Sd;
+
+  ASSERT (Source != NULL);
+  ASSERT (Scratch != NULL);
+
+  Status = UefiTianoDecompressStreamGetInfo (Source, SourceSize, Version, &OrigSize, &ScratchSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Stream = (TIANO_DECOMPRESS_STREAM *) Scratch;
+  Sd     = &Stream->Sd;
+
+  SetMem (Stream, sizeof (TIANO_DECOMPRESS_STREAM), 0);
+
+  //
+  // The length of the field 'Position Set Code Length Array Size' in Block Header.
+  // For UEFI 2.0 de/compression algorithm(Version 1), mPBit = 4
+  // For Tiano de/compression algorithm(Version 2), mPBit = 5
+  //
+  Sd->mPBit     = (UINT8) ((Version == 1) ? 4 : 5);
+  Sd->mSrcBase  = (UINT8 *) Source + 8;
+  Sd->mCompSize = ReadUnaligned32 ((UINT32 *) Source);
+  Sd->mOrigSize = OrigSize;
+
+  Stream->Window     = (UINT8 *) (Stream + 1);
+  Stream->WindowMask = GetStreamWindowSize (OrigSize, Version) - 1;
+  Sd->mDstBase       = Stream->Window;
+
+  if (OrigSize != 0) {
+    //
+    // Fill the first BITBUFSIZ bits
+    //
+    FillBuf (Sd, BITBUFSIZ);
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decompresses the next chunk of a stream prepared by UefiTianoDecompressStreamInit().
+
+  On return, BufferSize holds the number of bytes written to Buffer. It is
+  smaller than the requested size only when the end of the uncompressed data
+  is reached, and it is zero once all the data has been returned.
+
+  If Scratch is NULL, then ASSERT().
+  If BufferSize is NULL, then ASSERT().
+  If Buffer is NULL and *BufferSize is not zero, then ASSERT().
+
+  @param  Scratch     The scratch buffer passed to UefiTianoDecompressStreamInit().
+  @param  Buffer      The buffer that receives the uncompressed data.
+  @param  BufferSize  On input, the size, in bytes, of Buffer. On output, the
+                      number of bytes written to Buffer.
+
+  @retval  RETURN_SUCCESS           BufferSize bytes were written to Buffer.
+  @retval  RETURN_INVALID_PARAMETER The source data is corrupted. The stream
+                                    cannot be read any further.
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressStreamRead (
+  IN OUT VOID    *Scratch,
+  OUT    VOID    *Buffer,
+  IN OUT UINT32  *BufferSize
+  )
+{
+  TIANO_DECOMPRESS_STREAM  *Stream;
+  SCRATCH_DATA             *Sd;
+  UINT8                    *Window;
+  UINT8                    *Dst;
+  UINT32                   Remain;
+  UINT32                   Pos;
+  UINT16                   CharC;
+  UINT8                    Data;
+
+  ASSERT (Scratch != NULL);
+  ASSERT (BufferSize != NULL);
+  ASSERT (Buffer != NULL || *BufferSize == 0);
+
+  Stream = (TIANO_DECOMPRESS_STREAM *) Scratch;
+  Sd     = &Stream->Sd;
+  Window = Stream->Window;
+  Dst    = (UINT8 *) Buffer;
+  Remain = MIN (*BufferSize, Sd->mOrigSize - Sd->mOutBuf);
+
+  while (Remain > 0) {
+    if (Stream->MatchLength == 0) {
+      //
+      // Get one code from mBitBuf
+      //
+      CharC = DecodeC (Sd);
+      if (Sd->mBadTableFlag != 0) {
+        return RETURN_INVALID_PARAMETER;
+      }
+
+      if (CharC < 256) {
+        //
+        // Process an Original character
+        //
+        Window[Sd->mOutBuf++ & Stream->WindowMask] = (UINT8) CharC;
+        *Dst++ = (UINT8) CharC;
+        Remain--;
+        continue;
+      }
+
+      //
+      // Process a Pointer. It must not reach before the start of the data
+      // or beyond the sliding window.
+      //
+      Stream->MatchLength = (UINT32) (CharC - (BIT8 - THRESHOLD));
+      Pos                 = DecodeP (Sd);
+      if (Pos >= Sd->mOutBuf || Pos > Stream->WindowMask) {
+        return RETURN_INVALID_PARAMETER;
+      }
+
+      Stream->MatchDistance = Pos + 1;
+    }
+
+    //
+    // Copy as much of the string as fits into Buffer
+    //
+    while (Stream->MatchLength > 0 && Remain > 0) {
+      Data = Window[(Sd->mOutBuf - Stream->MatchDistance) & Stream->WindowMask];
+      Window[Sd->mOutBuf++ & Stream->WindowMask] = Data;
+      *Dst++ = Data;
+      Stream->MatchLength--;
+      Remain--;
+    }
+  }
+
+  *BufferSize = (UINT32) (Dst - (UINT8 *) Buffer);
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Retrieves the size of a decompression context.
+
+  A decompression context holds the state of the UEFI and Tiano decoders and
+  can be used for any number of UefiTianoDecompressWithContext() calls, so a
+  caller decoding many sections needs a single scratch region instead of one
+  per section.
+
+  @return The size, in bytes, of a decompression context.
+
+**/
+UINT32
+EFIAPI
+UefiTianoDecompressContextGetSize (
+  VOID
+  )
+{
+  return sizeof (SCRATCH_DATA);
+}
+
+/**
+  Prepares a decompression context for its first use.
+
+  If Context is NULL, then ASSERT().
+
+  @param  Context     The decompression context of the size reported by
+                      UefiTianoDecompressContextGetSize().
+
+**/
+VOID
+EFIAPI
+UefiTianoDecompressContextInit (
+  OUT VOID  *Context
+  )
+{
+  ASSERT (Context != NULL);
+
+  SetMem (Context, sizeof (SCRATCH_DATA), 0);
+}
+
+/**
+  Decompresses a UEFI or Tiano compressed source buffer using a decompression
+  context prepared by UefiTianoDecompressContextInit().
+
+  Only the decoder state that is not rebuilt from the compressed data is
+  reset, so the context does not need to be cleared between calls.
+
+  If Source is NULL, then ASSERT().
+  If Destination is NULL, then ASSERT().
+  If Context is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Context     The decompression context.
+  @param  Version     1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @retval  RETURN_SUCCESS           Decompression completed successfully, and
+                                    the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER The source buffer specified by Source is corrupted
+                                    (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+UefiTianoDecompressWithContext (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Context,
+  IN UINT32      Version
+  )
+{
+  ASSERT (Source != NULL);
+  ASSERT (Destination != NULL);
+  ASSERT (Context != NULL);
+
+  return DecompressWithScratchData (Source, Destination, (SCRATCH_DATA *) Context, Version);
+}
+
 /**
   Examines a GUIDed section and returns the size of the decoded buffer and the
   size of an optional scratch buffer required to actually decode the data in a GUIDed section.
@@ -23,6 +23,7 @@
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/ExtractGuidedSectionLib.h>
+#include <Library/TianoDecompressStreamLib.h>
 
 //
 // Decompression algorithm begins here
@@ -48,6 +49,23 @@
 #define NPT MAXNP
 #endif
 
+//
+// Width in bits of the direct lookup tables built by MakeTable() for the
+// Char&Len Set and for the Extra/Position Sets. Codes no longer than the
+// table width resolve with a single probe; longer ones continue through
+// the mLeft/mRight tree. MakeTable() supports widths up to 15.
+//
+#define CTABLE_BITS   13
+#define PTTABLE_BITS  10
+
+//
+// Upper bound of the sliding window kept by the streaming decoder. The
+// Position Set of UEFI compressed data (4-bit array size) cannot encode a
+// distance beyond 2^14, and the Tiano compressor uses a 2^19 byte window.
+//
+#define UEFI_STREAM_WINDOW_BITS   14
+#define TIANO_STREAM_WINDOW_BITS  19
+
 typedef struct {
   UINT8   *mSrcBase;  // Starting address of compressed data
   UINT8   *mDstBase;  // Starting address of decompressed data
@@ -67,8 +85,8 @@ typedef struct {
   UINT16  mRight[2 * NC - 1];
   UINT8   mCLen[NC];
   UINT8   mPTLen[NPT];
-  UINT16  mCTable[4096];
-  UINT16  mPTTable[256];
+  UINT16  mCTable[1U << CTABLE_BITS];
+  UINT16  mPTTable[1U << PTTABLE_BITS];
 
   ///
   /// The length of the field 'Position Set Code Length Array Size' in Block Header.
@@ -78,6 +96,22 @@ typedef struct {
   UINT8   mPBit;
 } SCRATCH_DATA;
 
+///
+/// State of an incremental decompression. It lives at the start of the
+/// caller's scratch buffer and the sliding window follows it.
+///
+typedef struct {
+  SCRATCH_DATA  Sd;
+  UINT8         *Window;
+  UINT32        WindowMask;
+  ///
+  /// Length and distance of the string being copied when the previous
+  /// UefiTianoDecompressStreamRead() ran out of output space.
+  ///
+  UINT32        MatchLength;
+  UINT32        MatchDistance;
+} TIANO_DECOMPRESS_STREAM;
+
 /**
   Read NumOfBit of bits from source into mBitBuf.
 
@@ -217,4 +251,44 @@ Decode (
   SCRATCH_DATA  *Sd
   );
 
+/**
+  Decompresses a UEFI or Tiano compressed source buffer with the given
+  scratch data.
+
+  The fields of the scratch data that are not rebuilt from the compressed
+  data are reset first, so the scratch data may be reused across calls
+  without being cleared.
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Sd          The scratch data.
+  @param  Version     1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @retval  RETURN_SUCCESS           Decompression completed successfully.
+  @retval  RETURN_INVALID_PARAMETER The source buffer specified by Source is corrupted.
+**/
+RETURN_STATUS
+DecompressWithScratchData (
+  IN CONST VOID        *Source,
+  IN OUT VOID          *Destination,
+  IN OUT SCRATCH_DATA  *Sd,
+  IN UINT32            Version
+  );
+
+/**
+  Computes the size of the sliding window used by the streaming decoder.
+
+  @param  OrigSize  The size, in bytes, of the uncompressed data.
+  @param  Version   1 for UEFI Decompress algorithm, 2 for Tiano Decompress algorithm.
+
+  @return The window size, a power of two no larger than the window of the
+          compression algorithm and no larger than needed for OrigSize bytes.
+
+**/
+UINT32
+GetStreamWindowSize (
+  IN  UINT32  OrigSize,
+  IN  UINT32  Version
+  );
+
 #endif
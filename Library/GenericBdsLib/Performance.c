@@ -20,6 +20,52 @@ PERF_HEADER               mPerfHeader;
 PERF_DATA                 mPerfData;
 EFI_PHYSICAL_ADDRESS      mAcpiLowMemoryBase = 0x0FFFFFFFFULL;
 
+///
+/// Entry of the table accumulating the measured time of each DXE handle.
+///
+typedef struct {
+  EFI_HANDLE                Handle;
+  UINT64                    Ticker;
+} PERF_HANDLE_ENTRY;
+
+#define PERF_HANDLE_HASH(Handle, Mask)  ((((UINTN) (Handle) >> 3) ^ ((UINTN) (Handle) >> 11)) & (Mask))
+
+/**
+  Find the entry of a handle in the table of DXE handles.
+
+  The table is open addressed with linear probing and always has free entries.
+
+  @param HandleTable     The table of DXE handles.
+  @param Mask            The number of entries of the table minus one.
+  @param Handle          The handle to look for.
+
+  @return The entry of the handle, or NULL if Handle is not a DXE handle.
+
+**/
+PERF_HANDLE_ENTRY *
+FindPerfHandleEntry (
+  IN PERF_HANDLE_ENTRY      *HandleTable,
+  IN UINTN                  Mask,
+  IN CONST VOID             *Handle
+  )
+{
+  UINTN  Index;
+
+  if (Handle == NULL) {
+    return NULL;
+  }
+
+  Index = PERF_HANDLE_HASH (Handle, Mask);
+  while (HandleTable[Index].Handle != NULL) {
+    if (HandleTable[Index].Handle == Handle) {
+      return &HandleTable[Index];
+    }
+    Index = (Index + 1) & Mask;
+  }
+
+  return NULL;
+}
+
 /**
   Get the short verion of PDB file name to be
   used in performance data logging.
@@ -138,6 +184,11 @@ GetNameFromHandle (
   Writes performance data of booting into the allocated memory.
   OS can process these records.
 
+  The measurements are read in two passes over the performance log: the first
+  one adds up the time measured for each DXE handle, and the second one writes
+  the measurements not made for a DXE handle. The name of a DXE handle is only
+  looked up when its time is written.
+
   @param  Event                 The triggered event.
   @param  Context               Context for this event.
 
@@ -168,13 +219,14 @@ WriteBootToOsPerformanceData (
   UINT64                    StartValue;
   UINT64                    EndValue;
   BOOLEAN                   CountUp;
-  UINTN                     EntryIndex;
-  UINTN                     NumPerfEntries;
+  UINTN                     VarSize;
   //
-  // List of flags indicating PerfEntry contains DXE handle
+  // Table of the DXE handles accumulating their measured time
   //
-  BOOLEAN                   *PerfEntriesAsDxeHandle;
-  UINTN                     VarSize;
+  PERF_HANDLE_ENTRY         *HandleTable;
+  PERF_HANDLE_ENTRY         *Entry;
+  UINTN                     Mask;
+  UINTN                     Slot;
 
   //
   // Record the performance data for End of BDS
@@ -235,11 +287,32 @@ WriteBootToOsPerformanceData (
     return ;
   }
 
+  //
+  // Size the table of DXE handles to a power of two at least twice the
+  // number of handles, so that it is at most half full.
+  //
+  Mask        = GetPowerOfTwo32 ((UINT32) NoHandles) * 4 - 1;
+  HandleTable = AllocateZeroPool ((Mask + 1) * sizeof (PERF_HANDLE_ENTRY));
+  if (HandleTable == NULL) {
+    FreePool (Handles);
+    return ;
+  }
+
+  for (Index = 0; Index < NoHandles; Index++) {
+    Slot = PERF_HANDLE_HASH (Handles[Index], Mask);
+    while (HandleTable[Slot].Handle != NULL) {
+      Slot = (Slot + 1) & Mask;
+    }
+    HandleTable[Slot].Handle = Handles[Index];
+  }
+
   Ptr        = (UINT8 *) ((UINT32) mAcpiLowMemoryBase + sizeof (PERF_HEADER));
   LimitCount = (UINT32) (PERF_DATA_MAX_LENGTH - sizeof (PERF_HEADER)) / sizeof (PERF_DATA);
 
-  NumPerfEntries = 0;
-  LogEntryKey    = 0;
+  //
+  // Add up the time measured for each DXE handle
+  //
+  LogEntryKey = 0;
   while ((LogEntryKey = GetPerformanceMeasurement (
                           LogEntryKey,
                           &Handle,
@@ -247,41 +320,24 @@ WriteBootToOsPerformanceData (
                           &Module,
                           &StartTicker,
                           &EndTicker)) != 0) {
-    NumPerfEntries++;
-  }
-  PerfEntriesAsDxeHandle = AllocateZeroPool (NumPerfEntries * sizeof (BOOLEAN));
-  ASSERT (PerfEntriesAsDxeHandle != NULL);
-  
-  //
-  // Get DXE drivers performance
-  //
-  for (Index = 0; Index < NoHandles; Index++) {
-    Ticker = 0;
-    LogEntryKey = 0;
-    EntryIndex  = 0;
-    while ((LogEntryKey = GetPerformanceMeasurement (
-                            LogEntryKey,
-                            &Handle,
-                            &Token,
-                            &Module,
-                            &StartTicker,
-                            &EndTicker)) != 0) {
-      if (Handle == Handles[Index] && !PerfEntriesAsDxeHandle[EntryIndex]) {
-        PerfEntriesAsDxeHandle[EntryIndex] = TRUE;
+    Entry = FindPerfHandleEntry (HandleTable, Mask, Handle);
+    if ((Entry != NULL) && (EndTicker != 0)) {
+      if (StartTicker == 1) {
+        StartTicker = StartValue;
       }
-      EntryIndex++;
-      if ((Handle == Handles[Index]) && (EndTicker != 0)) {
-        if (StartTicker == 1) {
-          StartTicker = StartValue;
-        }
-        if (EndTicker == 1) {
-          EndTicker = StartValue;
-        }
-        Ticker += CountUp ? (EndTicker - StartTicker) : (StartTicker - EndTicker);
+      if (EndTicker == 1) {
+        EndTicker = StartValue;
       }
+      Entry->Ticker += CountUp ? (EndTicker - StartTicker) : (StartTicker - EndTicker);
     }
+  }
 
-    Duration = (UINT32) DivU64x32 (Ticker, (UINT32) Freq);
+  //
+  // Get DXE drivers performance, in the order of the handle database
+  //
+  for (Index = 0; Index < NoHandles; Index++) {
+    Entry    = FindPerfHandleEntry (HandleTable, Mask, Handles[Index]);
+    Duration = (UINT32) DivU64x32 (Entry->Ticker, (UINT32) Freq);
 
     if (Duration > 0) {
 
@@ -304,7 +360,6 @@ WriteBootToOsPerformanceData (
   // Get inserted performance data
   //
   LogEntryKey = 0;
-  EntryIndex  = 0;
   while ((LogEntryKey = GetPerformanceMeasurement (
                           LogEntryKey,
                           &Handle,
@@ -312,7 +367,7 @@ WriteBootToOsPerformanceData (
                           &Module,
                           &StartTicker,
                           &EndTicker)) != 0) {
-    if (!PerfEntriesAsDxeHandle[EntryIndex] && EndTicker != 0) {
+    if ((EndTicker != 0) && (FindPerfHandleEntry (HandleTable, Mask, Handle) == NULL)) {
 
       ZeroMem (&mPerfData, sizeof (PERF_DATA));
 
@@ -335,13 +390,12 @@ WriteBootToOsPerformanceData (
         goto Done;
       }
     }
-    EntryIndex++;
   }
 
 Done:
 
   FreePool (Handles);
-  FreePool (PerfEntriesAsDxeHandle);
+  FreePool (HandleTable);
 
   mPerfHeader.Signiture = PERFORMANCE_SIGNATURE;
 
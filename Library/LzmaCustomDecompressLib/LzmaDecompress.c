@@ -26,6 +26,37 @@ typedef struct
   UINTN    BufferSize;
 } ISzAllocWithData;
 
+//
+// Smallest dictionary the LZMA decoder accepts
+//
+#define LZMA_STREAM_DICTIONARY_MIN SIZE_4KB
+
+///
+/// State of an incremental decompression. It lives at the start of the
+/// caller's scratch buffer; the probability model and the dictionary are
+/// carved out of the rest of the scratch buffer.
+///
+typedef struct
+{
+  CLzmaDec          Decoder;
+  ISzAllocWithData  AllocFuncs;
+  CONST UINT8       *Source;        // Next compressed byte to feed the decoder
+  SizeT             SourceRemain;   // Compressed bytes left after Source
+  UINT64            DecodedRemain;  // Uncompressed bytes not returned yet
+} LZMA_DECOMPRESS_STREAM;
+
+///
+/// Decompression context reused across LzmaUefiDecompressWithContext()
+/// calls. The probability model is taken from the rest of the context and
+/// stays in place as long as the literal context and position bits of the
+/// compressed data do not change.
+///
+typedef struct
+{
+  CLzmaDec          Decoder;
+  ISzAllocWithData  AllocFuncs;
+} LZMA_DECOMPRESS_CONTEXT;
+
 /**
   Allocation routine used by LZMA decompression.
 
@@ -218,3 +249,377 @@ LzmaUefiDecompress (
   }
 }
 
+/**
+  Retrieves the size of a decompression context.
+
+  A decompression context holds the LZMA decoder and its probability model
+  and can be used for any number of LzmaUefiDecompressWithContext() calls,
+  so a caller decoding many sections needs a single scratch region instead
+  of one per section.
+
+  @return The size, in bytes, of a decompression context.
+
+**/
+UINT32
+EFIAPI
+LzmaUefiDecompressContextGetSize (
+  VOID
+  )
+{
+  return sizeof (LZMA_DECOMPRESS_CONTEXT) + SCRATCH_BUFFER_REQUEST_SIZE;
+}
+
+/**
+  Prepares a decompression context for its first use.
+
+  The context must not move once it has been used for decompression.
+
+  If Context is NULL, then ASSERT().
+
+  @param  Context     The decompression context of the size reported by
+                      LzmaUefiDecompressContextGetSize().
+
+**/
+VOID
+EFIAPI
+LzmaUefiDecompressContextInit (
+  OUT VOID  *Context
+  )
+{
+  LZMA_DECOMPRESS_CONTEXT  *DecompressContext;
+
+  ASSERT (Context != NULL);
+
+  DecompressContext = (LZMA_DECOMPRESS_CONTEXT *) Context;
+
+  DecompressContext->AllocFuncs.Functions.Alloc = SzAlloc;
+  DecompressContext->AllocFuncs.Functions.Free  = SzFree;
+  LzmaDec_Construct (&DecompressContext->Decoder);
+}
+
+/**
+  Decompresses a LZMA compressed source buffer using a decompression context
+  prepared by LzmaUefiDecompressContextInit().
+
+  The probability model kept in the context is reset for each call, and is
+  only laid out again when the literal context and position bits of Source
+  differ from those of the previous call.
+
+  If Source is NULL, then ASSERT().
+  If Destination is NULL, then ASSERT().
+  If Context is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size, in bytes, of the source buffer.
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Context     The decompression context.
+
+  @retval  RETURN_SUCCESS           Decompression completed successfully, and
+                                    the uncompressed buffer is returned in Destination.
+  @retval  RETURN_INVALID_PARAMETER The source buffer specified by Source is corrupted
+                                    (not in a valid compressed format).
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressWithContext (
+  IN CONST VOID  *Source,
+  IN UINTN       SourceSize,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Context
+  )
+{
+  LZMA_DECOMPRESS_CONTEXT  *DecompressContext;
+  CLzmaDec                 *Decoder;
+  SRes                     LzmaResult;
+  ELzmaStatus              Status;
+  SizeT                    DecodedBufSize;
+  SizeT                    EncodedDataSize;
+
+  ASSERT (Source != NULL);
+  ASSERT (Destination != NULL);
+  ASSERT (Context != NULL);
+
+  if (SourceSize < LZMA_HEADER_SIZE) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  DecompressContext = (LZMA_DECOMPRESS_CONTEXT *) Context;
+  Decoder           = &DecompressContext->Decoder;
+
+  //
+  // The probability model always starts at the beginning of the scratch
+  // region. LzmaDec_AllocateProbs() only asks for it again when the number
+  // of probabilities changes; otherwise the model is kept and reset by
+  // LzmaDec_Init() below.
+  //
+  DecompressContext->AllocFuncs.Buffer     = DecompressContext + 1;
+  DecompressContext->AllocFuncs.BufferSize = SCRATCH_BUFFER_REQUEST_SIZE;
+  if (LzmaDec_AllocateProbs (Decoder, Source, LZMA_PROPS_SIZE, &DecompressContext->AllocFuncs.Functions) != SZ_OK) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  DecodedBufSize  = (SizeT) GetDecodedSizeOfBuf ((UINT8 *) Source);
+  EncodedDataSize = (SizeT) (SourceSize - LZMA_HEADER_SIZE);
+
+  Decoder->dic        = Destination;
+  Decoder->dicBufSize = DecodedBufSize;
+  LzmaDec_Init (Decoder);
+
+  LzmaResult = LzmaDec_DecodeToDic (
+                 Decoder,
+                 DecodedBufSize,
+                 (Byte *) ((UINT8 *) Source + LZMA_HEADER_SIZE),
+                 &EncodedDataSize,
+                 LZMA_FINISH_END,
+                 &Status
+                 );
+
+  //
+  // The destination belongs to the caller, do not keep it in the context
+  //
+  Decoder->dic        = NULL;
+  Decoder->dicBufSize = 0;
+
+  if (LzmaResult != SZ_OK || Status == LZMA_STATUS_NEEDS_MORE_INPUT) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Computes the dictionary size used by the streaming decoder.
+
+  A string never reaches further back than the start of the uncompressed
+  data, so the dictionary recorded in the LZMA header is clipped to the
+  size of the uncompressed data.
+
+  @param  EncodedData  The source buffer containing the LZMA header.
+
+  @return The dictionary size in bytes, or 0 if the LZMA properties are not supported.
+
+**/
+UINT32
+GetStreamDictionarySize (
+  IN CONST UINT8  *EncodedData
+  )
+{
+  CLzmaProps  Props;
+  UINT64      DecodedSize;
+  UINT32      DictionarySize;
+
+  if (LzmaProps_Decode (&Props, EncodedData, LZMA_PROPS_SIZE) != SZ_OK) {
+    return 0;
+  }
+
+  DecodedSize    = GetDecodedSizeOfBuf ((UINT8 *) EncodedData);
+  DictionarySize = Props.dicSize;
+  if (DecodedSize < DictionarySize) {
+    DictionarySize = (UINT32) DecodedSize;
+  }
+
+  if (DictionarySize < LZMA_STREAM_DICTIONARY_MIN) {
+    DictionarySize = LZMA_STREAM_DICTIONARY_MIN;
+  }
+
+  return DictionarySize;
+}
+
+/**
+  Retrieves the size of the uncompressed data and the size of the scratch
+  buffer required to decompress it incrementally.
+
+  The scratch buffer holds the decoder state and the dictionary. The
+  dictionary is the smaller of the dictionary size recorded in the LZMA
+  header and the size of the uncompressed data, and does not depend on the
+  size of the chunks later requested from LzmaUefiDecompressStreamRead().
+
+  If Source is NULL, then ASSERT().
+  If DestinationSize is NULL, then ASSERT().
+  If ScratchSize is NULL, then ASSERT().
+
+  @param  Source          The source buffer containing the compressed data.
+  @param  SourceSize      The size, in bytes, of the source buffer.
+  @param  DestinationSize A pointer to the size, in bytes, of the uncompressed data.
+  @param  ScratchSize     A pointer to the size, in bytes, of the scratch buffer that
+                          is required to decompress the data incrementally.
+
+  @retval  RETURN_SUCCESS           The sizes were returned.
+  @retval  RETURN_INVALID_PARAMETER The sizes cannot be determined from the source
+                                    data.
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressStreamGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  UINT32  DictionarySize;
+
+  ASSERT (Source != NULL);
+  ASSERT (DestinationSize != NULL);
+  ASSERT (ScratchSize != NULL);
+
+  if (SourceSize < LZMA_HEADER_SIZE) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  DictionarySize = GetStreamDictionarySize (Source);
+  if (DictionarySize == 0) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  *DestinationSize = (UINT32) GetDecodedSizeOfBuf ((UINT8 *) Source);
+  *ScratchSize     = sizeof (LZMA_DECOMPRESS_STREAM) + SCRATCH_BUFFER_REQUEST_SIZE + DictionarySize;
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Prepares a scratch buffer for the incremental decompression of Source.
+
+  Source and Scratch must stay valid and must not move until the last call
+  to LzmaUefiDecompressStreamRead() for this stream.
+
+  If Source is NULL, then ASSERT().
+  If Scratch is NULL, then ASSERT().
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  SourceSize  The size, in bytes, of the source buffer.
+  @param  Scratch     The scratch buffer of the size reported by
+                      LzmaUefiDecompressStreamGetInfo().
+
+  @retval  RETURN_SUCCESS           The stream is ready to be read.
+  @retval  RETURN_INVALID_PARAMETER The source data is not a valid compressed
+                                    buffer.
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressStreamInit (
+  IN     CONST VOID  *Source,
+  IN     UINT32      SourceSize,
+  IN OUT VOID        *Scratch
+  )
+{
+  LZMA_DECOMPRESS_STREAM  *Stream;
+  UINT32                  DictionarySize;
+  UINT8                   Props[LZMA_PROPS_SIZE];
+
+  ASSERT (Source != NULL);
+  ASSERT (Scratch != NULL);
+
+  if (SourceSize < LZMA_HEADER_SIZE) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  DictionarySize = GetStreamDictionarySize (Source);
+  if (DictionarySize == 0) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  //
+  // Hand the clipped dictionary size to the decoder
+  //
+  CopyMem (Props, Source, LZMA_PROPS_SIZE);
+  WriteUnaligned32 ((UINT32 *) &Props[1], DictionarySize);
+
+  Stream = (LZMA_DECOMPRESS_STREAM *) Scratch;
+
+  Stream->AllocFuncs.Functions.Alloc  = SzAlloc;
+  Stream->AllocFuncs.Functions.Free   = SzFree;
+  Stream->AllocFuncs.Buffer           = Stream + 1;
+  Stream->AllocFuncs.BufferSize       = SCRATCH_BUFFER_REQUEST_SIZE + DictionarySize;
+
+  LzmaDec_Construct (&Stream->Decoder);
+  if (LzmaDec_Allocate (&Stream->Decoder, Props, LZMA_PROPS_SIZE, &Stream->AllocFuncs.Functions) != SZ_OK) {
+    return RETURN_INVALID_PARAMETER;
+  }
+  LzmaDec_Init (&Stream->Decoder);
+
+  Stream->Source        = (CONST UINT8 *) Source + LZMA_HEADER_SIZE;
+  Stream->SourceRemain  = (SizeT) (SourceSize - LZMA_HEADER_SIZE);
+  Stream->DecodedRemain = GetDecodedSizeOfBuf ((UINT8 *) Source);
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decompresses the next chunk of a stream prepared by LzmaUefiDecompressStreamInit().
+
+  On return, BufferSize holds the number of bytes written to Buffer. It is
+  smaller than the requested size only when the end of the uncompressed data
+  is reached, and it is zero once all the data has been returned.
+
+  If Scratch is NULL, then ASSERT().
+  If BufferSize is NULL, then ASSERT().
+  If Buffer is NULL and *BufferSize is not zero, then ASSERT().
+
+  @param  Scratch     The scratch buffer passed to LzmaUefiDecompressStreamInit().
+  @param  Buffer      The buffer that receives the uncompressed data.
+  @param  BufferSize  On input, the size, in bytes, of Buffer. On output, the
+                      number of bytes written to Buffer.
+
+  @retval  RETURN_SUCCESS           BufferSize bytes were written to Buffer.
+  @retval  RETURN_INVALID_PARAMETER The source data is corrupted. The stream
+                                    cannot be read any further.
+**/
+RETURN_STATUS
+EFIAPI
+LzmaUefiDecompressStreamRead (
+  IN OUT VOID    *Scratch,
+  OUT    VOID    *Buffer,
+  IN OUT UINT32  *BufferSize
+  )
+{
+  LZMA_DECOMPRESS_STREAM  *Stream;
+  SRes                    LzmaResult;
+  ELzmaStatus             Status;
+  SizeT                   RequestSize;
+  SizeT                   DecodedBufSize;
+  SizeT                   EncodedDataSize;
+
+  ASSERT (Scratch != NULL);
+  ASSERT (BufferSize != NULL);
+  ASSERT (Buffer != NULL || *BufferSize == 0);
+
+  Stream      = (LZMA_DECOMPRESS_STREAM *) Scratch;
+  RequestSize = *BufferSize;
+  if (Stream->DecodedRemain < RequestSize) {
+    RequestSize = (SizeT) Stream->DecodedRemain;
+  }
+
+  *BufferSize = 0;
+  if (RequestSize == 0) {
+    return RETURN_SUCCESS;
+  }
+
+  DecodedBufSize  = RequestSize;
+  EncodedDataSize = Stream->SourceRemain;
+
+  LzmaResult = LzmaDec_DecodeToBuf (
+                 &Stream->Decoder,
+                 Buffer,
+                 &DecodedBufSize,
+                 Stream->Source,
+                 &EncodedDataSize,
+                 LZMA_FINISH_ANY,
+                 &Status
+                 );
+
+  //
+  // The decoder only stops short of the request when the source is exhausted
+  //
+  if (LzmaResult != SZ_OK || DecodedBufSize != RequestSize) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Stream->Source        += EncodedDataSize;
+  Stream->SourceRemain  -= EncodedDataSize;
+  Stream->DecodedRemain -= DecodedBufSize;
+  *BufferSize            = (UINT32) DecodedBufSize;
+
+  return RETURN_SUCCESS;
+}
@@ -21,6 +21,7 @@
 #include <Library/DebugLib.h>
 #include <Library/ExtractGuidedSectionLib.h>
 #include <Guid/LzmaDecompress.h>
+#include <Library/LzmaDecompressStreamLib.h>
 
 /**
   Given a Lzma compressed source buffer, this function retrieves the size of 
@@ -153,15 +153,40 @@ Out:
     = kMatchSpecLenStart + 2 : State Init Marker
 */
 
-static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+/*
+  EDK II: LzmaDec_DecodeRealBody() is expanded twice. The generic copy takes
+  lc/lp/pb from the stream properties. The fixed copy has them folded in as
+  constants for the properties used by the EDK II LzmaCompress tool, which
+  turns the literal context and position state masks into immediates.
+*/
+#ifndef LZMA_FIXED_LC
+#define LZMA_FIXED_LC 3
+#endif
+#ifndef LZMA_FIXED_LP
+#define LZMA_FIXED_LP 0
+#endif
+#ifndef LZMA_FIXED_PB
+#define LZMA_FIXED_PB 2
+#endif
+
+/* Matches at least this long are copied with memcpy() instead of byte by byte. */
+#define LZMA_WIDE_COPY_MIN 16
+
+#if defined(_MSC_VER)
+#define LZMA_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define LZMA_FORCE_INLINE __inline__ __attribute__((always_inline))
+#else
+#define LZMA_FORCE_INLINE
+#endif
+
+static LZMA_FORCE_INLINE int LzmaDec_DecodeRealBody(CLzmaDec *p, SizeT limit, const Byte *bufLimit,
+    unsigned lc, unsigned lpMask, unsigned pbMask)
 {
   CLzmaProb *probs = p->probs;
 
   unsigned state = p->state;
   UInt32 rep0 = p->reps[0], rep1 = p->reps[1], rep2 = p->reps[2], rep3 = p->reps[3];
-  unsigned pbMask = ((unsigned)1 << (p->prop.pb)) - 1;
-  unsigned lpMask = ((unsigned)1 << (p->prop.lp)) - 1;
-  unsigned lc = p->prop.lc;
 
   Byte *dic = p->dic;
   SizeT dicBufSize = p->dicBufSize;
@@ -418,9 +443,31 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           ptrdiff_t src = (ptrdiff_t)pos - (ptrdiff_t)dicPos;
           const Byte *lim = dest + curLen;
           dicPos += curLen;
-          do
-            *((volatile Byte *)dest) = (Byte)*(dest + src);
-          while (++dest != lim);
+          if (curLen < LZMA_WIDE_COPY_MIN)
+          {
+            do
+              *((volatile Byte *)dest) = (Byte)*(dest + src);
+            while (++dest != lim);
+          }
+          else if (src > 0)
+            memmove(dest, dest + src, curLen);
+          else
+          {
+            /*
+              The source may overlap the destination. Copy in steps that are
+              multiples of the distance, doubling each time, so that every
+              step reads only bytes written before it.
+            */
+            SizeT step = (SizeT)(-src);
+            while (curLen > step)
+            {
+              memcpy(dest, dest - step, step);
+              dest += step;
+              curLen -= (unsigned)step;
+              step += step;
+            }
+            memcpy(dest, dest - step, curLen);
+          }
         }
         else
         {
@@ -452,6 +499,26 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
   return SZ_OK;
 }
 
+static int MY_FAST_CALL LzmaDec_DecodeRealGeneric(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  return LzmaDec_DecodeRealBody(p, limit, bufLimit, p->prop.lc,
+      ((unsigned)1 << (p->prop.lp)) - 1, ((unsigned)1 << (p->prop.pb)) - 1);
+}
+
+static int MY_FAST_CALL LzmaDec_DecodeRealFixed(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  return LzmaDec_DecodeRealBody(p, limit, bufLimit, LZMA_FIXED_LC,
+      ((unsigned)1 << LZMA_FIXED_LP) - 1, ((unsigned)1 << LZMA_FIXED_PB) - 1);
+}
+
+static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte *bufLimit)
+{
+  if (p->prop.lc == LZMA_FIXED_LC && p->prop.lp == LZMA_FIXED_LP &&
+      p->prop.pb == LZMA_FIXED_PB)
+    return LzmaDec_DecodeRealFixed(p, limit, bufLimit);
+  return LzmaDec_DecodeRealGeneric(p, limit, bufLimit);
+}
+
 static void MY_FAST_CALL LzmaDec_WriteRem(CLzmaDec *p, SizeT limit)
 {
   if (p->remainLen != 0 && p->remainLen < kMatchSpecLenStart)
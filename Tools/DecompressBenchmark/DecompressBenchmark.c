@@ -0,0 +1,916 @@
+/** @file
+  Host benchmark for the UEFI, Tiano and LZMA decompression libraries.
+
+  Each input file holds one firmware file section: an EFI_SECTION_COMPRESSION
+  section with standard compression, or an EFI_SECTION_GUID_DEFINED section
+  produced with the Tiano, LZMA or LZMA F86 GUIDed tools. Every section is
+  decoded by the same library code that runs in firmware, and the throughput,
+  cycles per output byte and scratch buffer usage are reported per algorithm.
+
+  Usage: DecompressBenchmark [-n Iterations] [-s ReadSize | -x] [-w | -c] Section [Section ...]
+
+    -n  Number of timed decodes of each section (default 10).
+    -s  Time the incremental decompression API instead, reading the data in
+        chunks of ReadSize bytes. The streamed data must be byte for byte the
+        data of the one-shot decoder. LZMA-F86 sections have no incremental
+        decoder.
+    -x  Time the decompression context API instead, with one context for the
+        UEFI and Tiano sections and one for the LZMA sections, reused across
+        all the sections and iterations. The data must be byte for byte the
+        data of the one-shot decoder. LZMA-F86 sections have no context
+        decoder.
+    -w  Write the decoded data of each section to <Section>.ref.
+    -c  Compare the decoded data of each section with <Section>.ref.
+
+  The scratch buffer is filled with a pattern before the first decode, and
+  the highest byte that no longer holds the pattern gives the peak usage.
+  With -s, this is the scratch buffer of the incremental decoder. With -x,
+  the whole context size is reported for both.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined (__i386__) || defined (__x86_64__)
+#include <x86intrin.h>
+#define READ_CYCLE_COUNTER()  ((UINT64) __rdtsc ())
+#else
+#define READ_CYCLE_COUNTER()  ((UINT64) 0)
+#endif
+
+#include <PiPei.h>
+#include <Guid/TianoDecompress.h>
+#include <Guid/LzmaDecompress.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/UefiDecompressLib.h>
+#include <Library/ExtractGuidedSectionLib.h>
+#include <Library/TianoDecompressStreamLib.h>
+#include <Library/LzmaDecompressStreamLib.h>
+
+#define SCRATCH_FILL_PATTERN  0xA5
+
+typedef enum {
+  BenchmarkOnly,
+  WriteReference,
+  CompareReference
+} BENCHMARK_MODE;
+
+//
+// GUIDed section handlers of BaseUefiTianoCustomDecompressLib and
+// LzmaCustomDecompressLib/LzmaArchCustomDecompressLib.
+//
+RETURN_STATUS EFIAPI TianoDecompressGetInfo (CONST VOID *, UINT32 *, UINT32 *, UINT16 *);
+RETURN_STATUS EFIAPI TianoDecompress (CONST VOID *, VOID **, VOID *, UINT32 *);
+RETURN_STATUS EFIAPI LzmaGuidedSectionGetInfo (CONST VOID *, UINT32 *, UINT32 *, UINT16 *);
+RETURN_STATUS EFIAPI LzmaGuidedSectionExtraction (CONST VOID *, VOID **, VOID *, UINT32 *);
+RETURN_STATUS EFIAPI LzmaArchGuidedSectionGetInfo (CONST VOID *, UINT32 *, UINT32 *, UINT16 *);
+RETURN_STATUS EFIAPI LzmaArchGuidedSectionExtraction (CONST VOID *, VOID **, VOID *, UINT32 *);
+
+/**
+  Returns the compressed data and its size for an EFI_SECTION_COMPRESSION section.
+
+  @param  Section     The compression section.
+  @param  SourceSize  Returns the size of the compressed data.
+
+  @return The compressed data.
+
+**/
+CONST VOID *
+GetCompressionSource (
+  IN  CONST VOID  *Section,
+  OUT UINT32      *SourceSize
+  )
+{
+  if (IS_SECTION2 (Section)) {
+    *SourceSize = SECTION2_SIZE (Section) - sizeof (EFI_COMPRESSION_SECTION2);
+    return (CONST UINT8 *) Section + sizeof (EFI_COMPRESSION_SECTION2);
+  }
+
+  *SourceSize = SECTION_SIZE (Section) - sizeof (EFI_COMPRESSION_SECTION);
+  return (CONST UINT8 *) Section + sizeof (EFI_COMPRESSION_SECTION);
+}
+
+/**
+  GetInfo handler for EFI_SECTION_COMPRESSION sections, shaped like the
+  GUIDed section handlers so that all decoders are driven the same way.
+
+  @param  InputSection      The compression section.
+  @param  OutputBufferSize  Returns the size of the decoded data.
+  @param  ScratchBufferSize Returns the size of the scratch buffer.
+  @param  SectionAttribute  Returns 0.
+
+  @return The status of UefiDecompressGetInfo().
+
+**/
+RETURN_STATUS
+EFIAPI
+EfiSectionGetInfo (
+  IN  CONST VOID  *InputSection,
+  OUT UINT32      *OutputBufferSize,
+  OUT UINT32      *ScratchBufferSize,
+  OUT UINT16      *SectionAttribute
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  *SectionAttribute = 0;
+  Source = GetCompressionSource (InputSection, &SourceSize);
+  return UefiDecompressGetInfo (Source, SourceSize, OutputBufferSize, ScratchBufferSize);
+}
+
+/**
+  Decode handler for EFI_SECTION_COMPRESSION sections.
+
+  @param  InputSection          The compression section.
+  @param  OutputBuffer          Points to the buffer that receives the decoded data.
+  @param  ScratchBuffer         The scratch buffer.
+  @param  AuthenticationStatus  Returns 0.
+
+  @return The status of UefiDecompress().
+
+**/
+RETURN_STATUS
+EFIAPI
+EfiSectionDecode (
+  IN CONST  VOID    *InputSection,
+  OUT       VOID    **OutputBuffer,
+  IN        VOID    *ScratchBuffer,        OPTIONAL
+  OUT       UINT32  *AuthenticationStatus
+  )
+{
+  UINT32  SourceSize;
+
+  *AuthenticationStatus = 0;
+  return UefiDecompress (GetCompressionSource (InputSection, &SourceSize), *OutputBuffer, ScratchBuffer);
+}
+
+/**
+  Returns the data of an EFI_SECTION_GUID_DEFINED section and its size.
+
+  @param  Section     The GUID defined section.
+  @param  SourceSize  Returns the size of the data.
+
+  @return The data.
+
+**/
+CONST VOID *
+GetGuidedSource (
+  IN  CONST VOID  *Section,
+  OUT UINT32      *SourceSize
+  )
+{
+  if (IS_SECTION2 (Section)) {
+    *SourceSize = SECTION2_SIZE (Section) - ((EFI_GUID_DEFINED_SECTION2 *) Section)->DataOffset;
+    return (CONST UINT8 *) Section + ((EFI_GUID_DEFINED_SECTION2 *) Section)->DataOffset;
+  }
+
+  *SourceSize = SECTION_SIZE (Section) - ((EFI_GUID_DEFINED_SECTION *) Section)->DataOffset;
+  return (CONST UINT8 *) Section + ((EFI_GUID_DEFINED_SECTION *) Section)->DataOffset;
+}
+
+/**
+  Retrieves the sizes of the incremental decompression of a section.
+
+  @param  Section          The section.
+  @param  DestinationSize  Returns the size of the decoded data.
+  @param  ScratchSize      Returns the size of the scratch buffer.
+
+  @return The status of the GetInfo function of the incremental decoder.
+
+**/
+typedef
+RETURN_STATUS
+(*STREAM_GET_INFO) (
+  IN  CONST VOID  *Section,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  );
+
+/**
+  Prepares the incremental decompression of a section.
+
+  @param  Section  The section.
+  @param  Scratch  The scratch buffer.
+
+  @return The status of the Init function of the incremental decoder.
+
+**/
+typedef
+RETURN_STATUS
+(*STREAM_INIT) (
+  IN     CONST VOID  *Section,
+  IN OUT VOID        *Scratch
+  );
+
+/**
+  Reads the next chunk of an incremental decompression.
+
+  @param  Scratch     The scratch buffer.
+  @param  Buffer      Receives the decoded data.
+  @param  BufferSize  The size of Buffer on input, the size of the data on output.
+
+  @return The status of the Read function of the incremental decoder.
+
+**/
+typedef
+RETURN_STATUS
+(EFIAPI *STREAM_READ) (
+  IN OUT VOID    *Scratch,
+  OUT    VOID    *Buffer,
+  IN OUT UINT32  *BufferSize
+  );
+
+RETURN_STATUS
+EfiSectionStreamGetInfo (
+  IN  CONST VOID  *Section,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetCompressionSource (Section, &SourceSize);
+  return UefiTianoDecompressStreamGetInfo (Source, SourceSize, 1, DestinationSize, ScratchSize);
+}
+
+RETURN_STATUS
+EfiSectionStreamInit (
+  IN     CONST VOID  *Section,
+  IN OUT VOID        *Scratch
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetCompressionSource (Section, &SourceSize);
+  return UefiTianoDecompressStreamInit (Source, SourceSize, Scratch, 1);
+}
+
+RETURN_STATUS
+TianoSectionStreamGetInfo (
+  IN  CONST VOID  *Section,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetGuidedSource (Section, &SourceSize);
+  return UefiTianoDecompressStreamGetInfo (Source, SourceSize, 2, DestinationSize, ScratchSize);
+}
+
+RETURN_STATUS
+TianoSectionStreamInit (
+  IN     CONST VOID  *Section,
+  IN OUT VOID        *Scratch
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetGuidedSource (Section, &SourceSize);
+  return UefiTianoDecompressStreamInit (Source, SourceSize, Scratch, 2);
+}
+
+RETURN_STATUS
+LzmaSectionStreamGetInfo (
+  IN  CONST VOID  *Section,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetGuidedSource (Section, &SourceSize);
+  return LzmaUefiDecompressStreamGetInfo (Source, SourceSize, DestinationSize, ScratchSize);
+}
+
+RETURN_STATUS
+LzmaSectionStreamInit (
+  IN     CONST VOID  *Section,
+  IN OUT VOID        *Scratch
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetGuidedSource (Section, &SourceSize);
+  return LzmaUefiDecompressStreamInit (Source, SourceSize, Scratch);
+}
+
+//
+// Decompression contexts shared by all the sections with -x
+//
+VOID  *mTianoContext = NULL;
+VOID  *mLzmaContext  = NULL;
+
+/**
+  Decodes a section with the decompression context of its algorithm.
+
+  @param  Section      The section.
+  @param  Destination  Receives the decoded data.
+
+  @return The status of the WithContext function of the decoder.
+
+**/
+typedef
+RETURN_STATUS
+(*CONTEXT_DECODE) (
+  IN  CONST VOID  *Section,
+  OUT VOID        *Destination
+  );
+
+RETURN_STATUS
+EfiSectionContextDecode (
+  IN  CONST VOID  *Section,
+  OUT VOID        *Destination
+  )
+{
+  UINT32  SourceSize;
+
+  return UefiTianoDecompressWithContext (GetCompressionSource (Section, &SourceSize), Destination, mTianoContext, 1);
+}
+
+RETURN_STATUS
+TianoSectionContextDecode (
+  IN  CONST VOID  *Section,
+  OUT VOID        *Destination
+  )
+{
+  UINT32  SourceSize;
+
+  return UefiTianoDecompressWithContext (GetGuidedSource (Section, &SourceSize), Destination, mTianoContext, 2);
+}
+
+RETURN_STATUS
+LzmaSectionContextDecode (
+  IN  CONST VOID  *Section,
+  OUT VOID        *Destination
+  )
+{
+  CONST VOID  *Source;
+  UINT32      SourceSize;
+
+  Source = GetGuidedSource (Section, &SourceSize);
+  return LzmaUefiDecompressWithContext (Source, SourceSize, Destination, mLzmaContext);
+}
+
+typedef struct {
+  CONST CHAR8                              *Name;
+  GUID                                     *Guid;
+  EXTRACT_GUIDED_SECTION_GET_INFO_HANDLER  GetInfo;
+  EXTRACT_GUIDED_SECTION_DECODE_HANDLER    Decode;
+  //
+  // Incremental decoder, NULL if there is none
+  //
+  STREAM_GET_INFO                          StreamGetInfo;
+  STREAM_INIT                              StreamInit;
+  STREAM_READ                              StreamRead;
+  //
+  // Context decoder, NULL if there is none
+  //
+  CONTEXT_DECODE                           ContextDecode;
+  UINT32                                   (EFIAPI *ContextGetSize) (VOID);
+  //
+  // Totals over all sections decoded with this algorithm
+  //
+  UINTN                                    Sections;
+  UINT64                                   InputBytes;
+  UINT64                                   OutputBytes;
+  UINT64                                   Nanoseconds;
+  UINT64                                   Cycles;
+  UINT32                                   ScratchSize;
+  UINT32                                   PeakScratch;
+} DECODER;
+
+DECODER  mDecoders[] = {
+  { "EFI",      NULL,                          EfiSectionGetInfo,            EfiSectionDecode,
+    EfiSectionStreamGetInfo,   EfiSectionStreamInit,   UefiTianoDecompressStreamRead,
+    EfiSectionContextDecode,   UefiTianoDecompressContextGetSize },
+  { "Tiano",    &gTianoCustomDecompressGuid,   TianoDecompressGetInfo,       TianoDecompress,
+    TianoSectionStreamGetInfo, TianoSectionStreamInit, UefiTianoDecompressStreamRead,
+    TianoSectionContextDecode, UefiTianoDecompressContextGetSize },
+  { "LZMA",     &gLzmaCustomDecompressGuid,    LzmaGuidedSectionGetInfo,     LzmaGuidedSectionExtraction,
+    LzmaSectionStreamGetInfo,  LzmaSectionStreamInit,  LzmaUefiDecompressStreamRead,
+    LzmaSectionContextDecode,  LzmaUefiDecompressContextGetSize  },
+  { "LZMA-F86", &gLzmaF86CustomDecompressGuid, LzmaArchGuidedSectionGetInfo, LzmaArchGuidedSectionExtraction,
+    NULL,                      NULL,                   NULL,
+    NULL,                      NULL                              }
+};
+
+#define DECODER_COUNT  (sizeof (mDecoders) / sizeof (mDecoders[0]))
+
+/**
+  Reads a whole file into a newly allocated buffer.
+
+  @param  FileName  The file to read.
+  @param  Size      Returns the size of the file.
+
+  @return The file contents, or NULL on error.
+
+**/
+UINT8 *
+ReadWholeFile (
+  IN  CONST CHAR8  *FileName,
+  OUT UINTN        *Size
+  )
+{
+  FILE   *File;
+  UINT8  *Buffer;
+  long   Length;
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return NULL;
+  }
+
+  Buffer = NULL;
+  if (fseek (File, 0, SEEK_END) == 0 && (Length = ftell (File)) >= 0 && fseek (File, 0, SEEK_SET) == 0) {
+    Buffer = malloc ((size_t) Length + 1);
+    if (Buffer != NULL && fread (Buffer, 1, (size_t) Length, File) != (size_t) Length) {
+      free (Buffer);
+      Buffer = NULL;
+    }
+    *Size = (UINTN) Length;
+  }
+
+  fclose (File);
+  return Buffer;
+}
+
+/**
+  Selects the decoder for a section.
+
+  @param  Section  The section.
+  @param  Size     The size of the file holding the section.
+
+  @return The decoder, or NULL if the section is not a supported compressed section.
+
+**/
+DECODER *
+FindDecoder (
+  IN CONST UINT8  *Section,
+  IN UINTN        Size
+  )
+{
+  UINTN  Index;
+
+  if (Size < sizeof (EFI_COMMON_SECTION_HEADER2)) {
+    return NULL;
+  }
+
+  if (IS_SECTION2 (Section) ? SECTION2_SIZE (Section) > Size : SECTION_SIZE (Section) > Size) {
+    return NULL;
+  }
+
+  switch (((EFI_COMMON_SECTION_HEADER *) Section)->Type) {
+  case EFI_SECTION_COMPRESSION:
+    if (IS_SECTION2 (Section) ?
+        ((EFI_COMPRESSION_SECTION2 *) Section)->CompressionType == EFI_STANDARD_COMPRESSION :
+        ((EFI_COMPRESSION_SECTION *) Section)->CompressionType == EFI_STANDARD_COMPRESSION) {
+      return &mDecoders[0];
+    }
+    break;
+
+  case EFI_SECTION_GUID_DEFINED:
+    for (Index = 1; Index < DECODER_COUNT; Index++) {
+      if (CompareGuid (
+            mDecoders[Index].Guid,
+            IS_SECTION2 (Section) ?
+              &((EFI_GUID_DEFINED_SECTION2 *) Section)->SectionDefinitionGuid :
+              &((EFI_GUID_DEFINED_SECTION *) Section)->SectionDefinitionGuid
+            )) {
+        return &mDecoders[Index];
+      }
+    }
+    break;
+  }
+
+  return NULL;
+}
+
+/**
+  Returns a monotonic time stamp in nanoseconds.
+
+**/
+UINT64
+GetNanoseconds (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  clock_gettime (CLOCK_MONOTONIC, &Now);
+  return (UINT64) Now.tv_sec * 1000000000ULL + (UINT64) Now.tv_nsec;
+}
+
+/**
+  Decodes a section through the incremental decoder, in reads of ReadSize
+  bytes.
+
+  @param  Decoder     The decoder of the section.
+  @param  Section     The section.
+  @param  Scratch     The scratch buffer of the incremental decoder.
+  @param  Output      Receives the decoded data.
+  @param  OutputSize  The size of the decoded data.
+  @param  ReadSize    The number of bytes asked from each read.
+
+  @retval RETURN_SUCCESS            OutputSize bytes were decoded, and the stream ended there.
+  @retval RETURN_INVALID_PARAMETER  The section is corrupted, or the stream did
+                                    not end after OutputSize bytes.
+
+**/
+RETURN_STATUS
+StreamDecode (
+  IN  DECODER     *Decoder,
+  IN  CONST VOID  *Section,
+  IN  VOID        *Scratch,
+  OUT UINT8       *Output,
+  IN  UINT32      OutputSize,
+  IN  UINT32      ReadSize
+  )
+{
+  RETURN_STATUS  Status;
+  UINT32         Offset;
+  UINT32         Size;
+  UINT8          Extra;
+
+  Status = Decoder->StreamInit (Section, Scratch);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Offset = 0; Offset < OutputSize; Offset += Size) {
+    Size   = MIN (ReadSize, OutputSize - Offset);
+    Status = Decoder->StreamRead (Scratch, Output + Offset, &Size);
+    if (RETURN_ERROR (Status)) {
+      return Status;
+    }
+    if (Size == 0) {
+      return RETURN_INVALID_PARAMETER;
+    }
+  }
+
+  //
+  // The stream must be over once all the data has been read
+  //
+  Size   = sizeof (Extra);
+  Status = Decoder->StreamRead (Scratch, &Extra, &Size);
+  if (RETURN_ERROR (Status) || Size != 0) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decodes one section, accounts the results to its decoder, and writes or
+  checks the reference output.
+
+  @param  FileName    The file holding the section.
+  @param  Iterations  The number of timed decodes.
+  @param  ReadSize    The read size of the incremental decoder, or 0 to time
+                      another decoder.
+  @param  UseContext  TRUE to time the context decoder.
+  @param  Mode        Whether to write or compare the reference output.
+
+  @retval TRUE   The section was decoded (and matched its reference, if checked).
+  @retval FALSE  The section could not be read, decoded or verified.
+
+**/
+BOOLEAN
+BenchmarkSection (
+  IN CONST CHAR8     *FileName,
+  IN UINTN           Iterations,
+  IN UINT32          ReadSize,
+  IN BOOLEAN         UseContext,
+  IN BENCHMARK_MODE  Mode
+  )
+{
+  UINT8          *Section;
+  UINTN          SectionSize;
+  DECODER        *Decoder;
+  UINT32         OutputSize;
+  UINT32         ScratchSize;
+  UINT32         PeakScratch;
+  UINT16         Attribute;
+  UINT32         AuthenticationStatus;
+  UINT8          *Output;
+  UINT8          *Scratch;
+  UINT32         StreamOutputSize;
+  UINT32         StreamScratchSize;
+  UINT8          *StreamScratch;
+  UINT8          *StreamOutput;
+  UINT32         Mismatch;
+  VOID           *OutputBuffer;
+  RETURN_STATUS  Status;
+  UINTN          Index;
+  UINT64         StartTime;
+  UINT64         StartCycles;
+  UINT64         Nanoseconds;
+  UINT64         Cycles;
+  CHAR8          *RefName;
+  UINT8          *Reference;
+  UINTN          ReferenceSize;
+  FILE           *RefFile;
+  BOOLEAN        Result;
+
+  Section = ReadWholeFile (FileName, &SectionSize);
+  if (Section == NULL) {
+    fprintf (stderr, "%s: cannot read file\n", FileName);
+    return FALSE;
+  }
+
+  Decoder = FindDecoder (Section, SectionSize);
+  if (Decoder == NULL) {
+    fprintf (stderr, "%s: not a supported compressed section\n", FileName);
+    free (Section);
+    return FALSE;
+  }
+
+  Status = Decoder->GetInfo (Section, &OutputSize, &ScratchSize, &Attribute);
+  if (RETURN_ERROR (Status)) {
+    fprintf (stderr, "%s: %s GetInfo failed\n", FileName, Decoder->Name);
+    free (Section);
+    return FALSE;
+  }
+
+  StreamScratchSize = 0;
+  if (ReadSize != 0) {
+    if (Decoder->StreamGetInfo == NULL) {
+      fprintf (stderr, "%s: %s has no incremental decoder\n", FileName, Decoder->Name);
+      free (Section);
+      return FALSE;
+    }
+    Status = Decoder->StreamGetInfo (Section, &StreamOutputSize, &StreamScratchSize);
+    if (RETURN_ERROR (Status) || StreamOutputSize != OutputSize) {
+      fprintf (stderr, "%s: %s incremental GetInfo failed\n", FileName, Decoder->Name);
+      free (Section);
+      return FALSE;
+    }
+  } else if (UseContext && Decoder->ContextDecode == NULL) {
+    fprintf (stderr, "%s: %s has no context decoder\n", FileName, Decoder->Name);
+    free (Section);
+    return FALSE;
+  }
+
+  Output        = malloc ((size_t) OutputSize + 1);
+  Scratch       = malloc ((size_t) ScratchSize + 1);
+  StreamOutput  = malloc ((size_t) OutputSize + 1);
+  StreamScratch = malloc ((size_t) StreamScratchSize + 1);
+  RefName       = malloc (strlen (FileName) + sizeof (".ref"));
+  if (Output == NULL || Scratch == NULL || StreamOutput == NULL || StreamScratch == NULL || RefName == NULL) {
+    fprintf (stderr, "%s: out of memory\n", FileName);
+    free (Section);
+    free (Output);
+    free (Scratch);
+    free (StreamOutput);
+    free (StreamScratch);
+    free (RefName);
+    return FALSE;
+  }
+  sprintf (RefName, "%s.ref", FileName);
+
+  //
+  // The first decode measures how much of the scratch buffer is touched
+  //
+  SetMem (Scratch, ScratchSize, SCRATCH_FILL_PATTERN);
+  OutputBuffer = Output;
+  Status = Decoder->Decode (Section, &OutputBuffer, Scratch, &AuthenticationStatus);
+  for (PeakScratch = ScratchSize; PeakScratch > 0; PeakScratch--) {
+    if (Scratch[PeakScratch - 1] != SCRATCH_FILL_PATTERN) {
+      break;
+    }
+  }
+
+  Nanoseconds = 0;
+  Cycles      = 0;
+  if (ReadSize == 0 && !UseContext) {
+    for (Index = 0; Index < Iterations && !RETURN_ERROR (Status); Index++) {
+      OutputBuffer = Output;
+      StartTime    = GetNanoseconds ();
+      StartCycles  = READ_CYCLE_COUNTER ();
+      Status       = Decoder->Decode (Section, &OutputBuffer, Scratch, &AuthenticationStatus);
+      Cycles      += READ_CYCLE_COUNTER () - StartCycles;
+      Nanoseconds += GetNanoseconds () - StartTime;
+    }
+  } else if (UseContext && !RETURN_ERROR (Status)) {
+    //
+    // The one-shot data is the reference of the data decoded with the context
+    //
+    for (Index = 0; Index < Iterations && !RETURN_ERROR (Status); Index++) {
+      SetMem (StreamOutput, OutputSize, (UINT8) ~SCRATCH_FILL_PATTERN);
+      StartTime    = GetNanoseconds ();
+      StartCycles  = READ_CYCLE_COUNTER ();
+      Status       = Decoder->ContextDecode (Section, StreamOutput);
+      Cycles      += READ_CYCLE_COUNTER () - StartCycles;
+      Nanoseconds += GetNanoseconds () - StartTime;
+    }
+
+    if (!RETURN_ERROR (Status) && memcmp (StreamOutput, OutputBuffer, OutputSize) != 0) {
+      Status = RETURN_VOLUME_CORRUPTED;
+    }
+    ScratchSize = Decoder->ContextGetSize ();
+    PeakScratch = ScratchSize;
+  } else if (!RETURN_ERROR (Status)) {
+    //
+    // The one-shot data is the reference of the streamed data, and the peak
+    // usage is measured on the scratch buffer of the incremental decoder
+    //
+    SetMem (StreamScratch, StreamScratchSize, SCRATCH_FILL_PATTERN);
+    for (Index = 0; Index < Iterations && !RETURN_ERROR (Status); Index++) {
+      SetMem (StreamOutput, OutputSize, (UINT8) ~SCRATCH_FILL_PATTERN);
+      StartTime    = GetNanoseconds ();
+      StartCycles  = READ_CYCLE_COUNTER ();
+      Status       = StreamDecode (Decoder, Section, StreamScratch, StreamOutput, OutputSize, ReadSize);
+      Cycles      += READ_CYCLE_COUNTER () - StartCycles;
+      Nanoseconds += GetNanoseconds () - StartTime;
+      if (Index == 0) {
+        for (PeakScratch = StreamScratchSize; PeakScratch > 0; PeakScratch--) {
+          if (StreamScratch[PeakScratch - 1] != SCRATCH_FILL_PATTERN) {
+            break;
+          }
+        }
+      }
+    }
+
+    if (!RETURN_ERROR (Status) && memcmp (StreamOutput, OutputBuffer, OutputSize) != 0) {
+      Status = RETURN_VOLUME_CORRUPTED;
+    }
+    ScratchSize = StreamScratchSize;
+  }
+
+  Result = FALSE;
+  if (Status == RETURN_VOLUME_CORRUPTED) {
+    for (Mismatch = 0; StreamOutput[Mismatch] == ((UINT8 *) OutputBuffer)[Mismatch]; Mismatch++) {
+    }
+    fprintf (stderr, "%s: %s data differs from the one-shot data at offset %u\n", FileName, UseContext ? "context" : "streamed", (unsigned) Mismatch);
+  } else if (RETURN_ERROR (Status)) {
+    fprintf (stderr, "%s: %s decode failed\n", FileName, Decoder->Name);
+  } else if (Mode == WriteReference) {
+    RefFile = fopen (RefName, "wb");
+    if (RefFile != NULL && fwrite (OutputBuffer, 1, OutputSize, RefFile) == OutputSize) {
+      Result = TRUE;
+    } else {
+      fprintf (stderr, "%s: cannot write %s\n", FileName, RefName);
+    }
+    if (RefFile != NULL) {
+      fclose (RefFile);
+    }
+  } else if (Mode == CompareReference) {
+    Reference = ReadWholeFile (RefName, &ReferenceSize);
+    if (Reference == NULL) {
+      fprintf (stderr, "%s: cannot read %s\n", FileName, RefName);
+    } else if (ReferenceSize != OutputSize || memcmp (Reference, OutputBuffer, OutputSize) != 0) {
+      fprintf (stderr, "%s: decoded data does not match %s\n", FileName, RefName);
+    } else {
+      Result = TRUE;
+    }
+    free (Reference);
+  } else {
+    Result = TRUE;
+  }
+
+  if (Result) {
+    printf (
+      "%-10s %10u -> %10u bytes  %9.1f MB/s  %s\n",
+      Decoder->Name,
+      (unsigned) SectionSize,
+      (unsigned) OutputSize,
+      Nanoseconds == 0 ? 0.0 : (double) OutputSize * Iterations * 1000.0 / (double) Nanoseconds,
+      FileName
+      );
+
+    Decoder->Sections++;
+    Decoder->InputBytes  += (UINT64) SectionSize * Iterations;
+    Decoder->OutputBytes += (UINT64) OutputSize * Iterations;
+    Decoder->Nanoseconds += Nanoseconds;
+    Decoder->Cycles      += Cycles;
+    Decoder->ScratchSize  = MAX (Decoder->ScratchSize, ScratchSize);
+    Decoder->PeakScratch  = MAX (Decoder->PeakScratch, PeakScratch);
+  }
+
+  free (Section);
+  free (Output);
+  free (Scratch);
+  free (StreamOutput);
+  free (StreamScratch);
+  free (RefName);
+  return Result;
+}
+
+/**
+  Prints the per-algorithm totals.
+
+**/
+VOID
+PrintSummary (
+  VOID
+  )
+{
+  UINTN    Index;
+  DECODER  *Decoder;
+
+  printf ("\n%-10s %8s %12s %12s %9s %9s %12s %12s\n",
+    "Algorithm", "Sections", "Input", "Output", "MB/s", "Cycles/B", "Scratch", "PeakScratch");
+
+  for (Index = 0; Index < DECODER_COUNT; Index++) {
+    Decoder = &mDecoders[Index];
+    if (Decoder->Sections == 0) {
+      continue;
+    }
+
+    printf (
+      "%-10s %8u %12llu %12llu %9.1f %9.2f %12u %12u\n",
+      Decoder->Name,
+      (unsigned) Decoder->Sections,
+      (unsigned long long) Decoder->InputBytes,
+      (unsigned long long) Decoder->OutputBytes,
+      Decoder->Nanoseconds == 0 ? 0.0 : (double) Decoder->OutputBytes * 1000.0 / (double) Decoder->Nanoseconds,
+      Decoder->OutputBytes == 0 ? 0.0 : (double) Decoder->Cycles / (double) Decoder->OutputBytes,
+      (unsigned) Decoder->ScratchSize,
+      (unsigned) Decoder->PeakScratch
+      );
+  }
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  UINTN           Iterations;
+  UINT32          ReadSize;
+  BOOLEAN         UseContext;
+  BENCHMARK_MODE  Mode;
+  int             Index;
+  int             Failures;
+
+  Iterations = 10;
+  ReadSize   = 0;
+  UseContext = FALSE;
+  Mode       = BenchmarkOnly;
+
+  for (Index = 1; Index < argc && argv[Index][0] == '-'; Index++) {
+    if (strcmp (argv[Index], "-n") == 0 && Index + 1 < argc) {
+      Iterations = (UINTN) strtoul (argv[++Index], NULL, 0);
+    } else if (strcmp (argv[Index], "-s") == 0 && Index + 1 < argc) {
+      ReadSize = (UINT32) strtoul (argv[++Index], NULL, 0);
+    } else if (strcmp (argv[Index], "-x") == 0) {
+      UseContext = TRUE;
+    } else if (strcmp (argv[Index], "-w") == 0) {
+      Mode = WriteReference;
+    } else if (strcmp (argv[Index], "-c") == 0) {
+      Mode = CompareReference;
+    } else {
+      break;
+    }
+  }
+
+  if (Index >= argc || Iterations == 0 || (ReadSize != 0 && UseContext)) {
+    fprintf (stderr, "Usage: %s [-n Iterations] [-s ReadSize | -x] [-w | -c] Section [Section ...]\n", argv[0]);
+    return 2;
+  }
+
+  if (UseContext) {
+    mTianoContext = malloc (UefiTianoDecompressContextGetSize ());
+    mLzmaContext  = malloc (LzmaUefiDecompressContextGetSize ());
+    if (mTianoContext == NULL || mLzmaContext == NULL) {
+      fprintf (stderr, "out of memory\n");
+      return 2;
+    }
+    UefiTianoDecompressContextInit (mTianoContext);
+    LzmaUefiDecompressContextInit (mLzmaContext);
+  }
+
+  Failures = 0;
+  for (; Index < argc; Index++) {
+    if (!BenchmarkSection (argv[Index], Iterations, ReadSize, UseContext, Mode)) {
+      Failures++;
+    }
+  }
+
+  PrintSummary ();
+
+  free (mTianoContext);
+  free (mLzmaContext);
+
+  return (Failures == 0) ? 0 : 1;
+}
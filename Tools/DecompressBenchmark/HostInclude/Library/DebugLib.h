@@ -0,0 +1,33 @@
+/** @file
+  Host replacement for DebugLib. ASSERT() is always enabled.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_DEBUG_LIB_H__
+#define __HOST_DEBUG_LIB_H__
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  );
+
+#define ASSERT(Expression)  \
+  do {                      \
+    if (!(Expression)) {    \
+      DebugAssert (__FILE__, __LINE__, #Expression); \
+    }                       \
+  } while (FALSE)
+
+#endif
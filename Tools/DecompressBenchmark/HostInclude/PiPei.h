@@ -0,0 +1,150 @@
+/** @file
+  Host replacement for PiPei.h used by the decompression benchmark.
+
+  Provides the base types, status codes and firmware file section
+  definitions that the decompression libraries use, mapped onto the
+  host C library.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under 
+the terms and conditions of the BSD License that accompanies this distribution.  
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.                                          
+    
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,                     
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_PI_PEI_H__
+#define __HOST_PI_PEI_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// The LZMA SDK glue (UefiLzma.h) must not redefine these.
+//
+#define _SIZE_T_DEFINED
+#define _PTRDIFF_T_DEFINED
+
+typedef uint8_t     UINT8;
+typedef uint16_t    UINT16;
+typedef uint32_t    UINT32;
+typedef uint64_t    UINT64;
+typedef int8_t      INT8;
+typedef int16_t     INT16;
+typedef int32_t     INT32;
+typedef int64_t     INT64;
+typedef uintptr_t   UINTN;
+typedef intptr_t    INTN;
+typedef uint8_t     BOOLEAN;
+typedef char        CHAR8;
+typedef uint16_t    CHAR16;
+typedef void        VOID;
+
+typedef UINTN       RETURN_STATUS;
+typedef UINTN       EFI_STATUS;
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST     const
+#define STATIC    static
+#define EFIAPI
+
+#define TRUE      ((BOOLEAN) (1 == 1))
+#define FALSE     ((BOOLEAN) (0 == 1))
+
+#define BIT8      0x00000100
+#define SIZE_4KB  0x00001000
+#define SIZE_64KB 0x00010000
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+#define OFFSET_OF(TYPE, Field) ((UINTN) &(((TYPE *)0)->Field))
+
+#define MAX_BIT                     ((UINTN) 1 << (sizeof (UINTN) * 8 - 1))
+#define ENCODE_ERROR(StatusCode)    ((RETURN_STATUS) (MAX_BIT | (StatusCode)))
+#define RETURN_ERROR(StatusCode)    (((INTN) (RETURN_STATUS) (StatusCode)) < 0)
+#define EFI_ERROR(StatusCode)       RETURN_ERROR (StatusCode)
+
+#define RETURN_SUCCESS              0
+#define RETURN_INVALID_PARAMETER    ENCODE_ERROR (2)
+#define RETURN_UNSUPPORTED          ENCODE_ERROR (3)
+#define RETURN_BUFFER_TOO_SMALL     ENCODE_ERROR (5)
+#define RETURN_OUT_OF_RESOURCES     ENCODE_ERROR (9)
+#define RETURN_VOLUME_CORRUPTED     ENCODE_ERROR (10)
+
+typedef struct {
+  UINT32  Data1;
+  UINT16  Data2;
+  UINT16  Data3;
+  UINT8   Data4[8];
+} GUID;
+
+typedef GUID EFI_GUID;
+
+//
+// Firmware file sections, as defined by the PI Specification
+//
+#pragma pack(1)
+
+typedef UINT8 EFI_SECTION_TYPE;
+
+#define EFI_SECTION_COMPRESSION   0x01
+#define EFI_SECTION_GUID_DEFINED  0x02
+
+#define EFI_NOT_COMPRESSED        0x00
+#define EFI_STANDARD_COMPRESSION  0x01
+
+typedef struct {
+  UINT8             Size[3];
+  EFI_SECTION_TYPE  Type;
+} EFI_COMMON_SECTION_HEADER;
+
+typedef struct {
+  UINT8             Size[3];
+  EFI_SECTION_TYPE  Type;
+  UINT32            ExtendedSize;
+} EFI_COMMON_SECTION_HEADER2;
+
+typedef struct {
+  EFI_COMMON_SECTION_HEADER   CommonHeader;
+  UINT32                      UncompressedLength;
+  UINT8                       CompressionType;
+} EFI_COMPRESSION_SECTION;
+
+typedef struct {
+  EFI_COMMON_SECTION_HEADER2  CommonHeader;
+  UINT32                      UncompressedLength;
+  UINT8                       CompressionType;
+} EFI_COMPRESSION_SECTION2;
+
+typedef struct {
+  EFI_COMMON_SECTION_HEADER   CommonHeader;
+  EFI_GUID                    SectionDefinitionGuid;
+  UINT16                      DataOffset;
+  UINT16                      Attributes;
+} EFI_GUID_DEFINED_SECTION;
+
+typedef struct {
+  EFI_COMMON_SECTION_HEADER2  CommonHeader;
+  EFI_GUID                    SectionDefinitionGuid;
+  UINT16                      DataOffset;
+  UINT16                      Attributes;
+} EFI_GUID_DEFINED_SECTION2;
+
+#pragma pack()
+
+#define IS_SECTION2(SectionHeaderPtr) \
+    ((UINT32) (*((UINT32 *) ((EFI_COMMON_SECTION_HEADER *) (SectionHeaderPtr))->Size) & 0x00ffffff) == 0x00ffffff)
+
+#define SECTION_SIZE(SectionHeaderPtr) \
+    ((UINT32) (*((UINT32 *) ((EFI_COMMON_SECTION_HEADER *) (SectionHeaderPtr))->Size) & 0x00ffffff))
+
+#define SECTION2_SIZE(SectionHeaderPtr) \
+    (((EFI_COMMON_SECTION_HEADER2 *) (SectionHeaderPtr))->ExtendedSize)
+
+#endif
@@ -0,0 +1,762 @@
+/** @file
+  Host decoder for the status codes logged in binary batches in the Data Hub.
+
+  Each input file holds the data of gDataHubStatusCodeBatchGuid Data Hub
+  records, each a DATA_HUB_STATUS_CODE_BATCH_HEADER followed by its entries,
+  one record after the other in the order of their monotonic counts. Format
+  strings defined in a record stay defined for the following records, also
+  across input files.
+
+  The status codes are printed as the serial status code worker prints them,
+  with the DEBUG() messages formatted from their format strings and arguments,
+  and the ASSERT() and ASCII string data printed from the strings the status
+  code worker put in place of their pointers.
+
+  Usage: StatusCodeDecoder [-c] Batches [Batches ...]
+
+    -c  Also print the caller ID of each status code.
+
+Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+This program and the accompanying materials are licensed and made available under
+the terms and conditions of the BSD License that accompanies this distribution.
+The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php.
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t     UINT8;
+typedef uint16_t    UINT16;
+typedef uint32_t    UINT32;
+typedef uint64_t    UINT64;
+typedef int64_t     INT64;
+typedef size_t      UINTN;
+typedef uint8_t     BOOLEAN;
+typedef char        CHAR8;
+typedef void        VOID;
+
+#define IN
+#define OUT
+#define CONST     const
+#define TRUE      ((BOOLEAN) (1 == 1))
+#define FALSE     ((BOOLEAN) (0 == 1))
+
+typedef struct {
+  UINT32  Data1;
+  UINT16  Data2;
+  UINT16  Data3;
+  UINT8   Data4[8];
+} EFI_GUID;
+
+#include <Guid/DataHubStatusCodeBatch.h>
+
+//
+// Status code types of Pi/PiStatusCode.h.
+//
+#define EFI_STATUS_CODE_TYPE_MASK   0x000000FF
+#define EFI_STATUS_CODE_SEVERITY_MASK     0xFF000000
+#define EFI_STATUS_CODE_OPERATION_MASK    0x0000FFFF
+#define EFI_PROGRESS_CODE           0x00000001
+#define EFI_ERROR_CODE              0x00000002
+#define EFI_ERROR_UNRECOVERED       0x90000000
+#define EFI_SW_EC_ILLEGAL_SOFTWARE_STATE  0x00000007
+
+//
+// EFI_STATUS_CODE_DATA_TYPE_STRING_GUID of Guid/StatusCodeDataTypeId.h.
+//
+#define EFI_STATUS_CODE_DATA_TYPE_STRING_GUID \
+  { 0x92D11080, 0x496F, 0x4D95, { 0xBE, 0x7E, 0x03, 0x74, 0x88, 0x38, 0x2B, 0x0A } }
+#define EFI_STRING_ASCII            0
+
+//
+// Sizes of the EFI_GUID and EFI_TIME arguments in the stream.
+//
+#define GUID_SIZE                   16
+#define TIME_SIZE                   16
+
+#define MAX_FORMAT_ID               0x10000
+#define MAX_MESSAGE_LENGTH          0x1000
+
+///
+/// Reader of the entries of a batch record.
+///
+typedef struct {
+  CONST UINT8  *Buffer;
+  UINTN        Size;
+  UINTN        Offset;
+  BOOLEAN      Error;
+} DECODER;
+
+///
+/// Text of the EFI_STATUS values, as printed by %r in PrintLib.
+///
+CONST CHAR8  *mStatusString[] = {
+  "Success",
+  "Load Error",
+  "Invalid Parameter",
+  "Unsupported",
+  "Bad Buffer Size",
+  "Buffer Too Small",
+  "Not Ready",
+  "Device Error",
+  "Write Protected",
+  "Out of Resources",
+  "Volume Corrupt",
+  "Volume Full",
+  "No Media",
+  "Media changed",
+  "Not Found",
+  "Access Denied",
+  "No Response",
+  "No mapping",
+  "Time out",
+  "Not started",
+  "Already started",
+  "Aborted",
+  "ICMP Error",
+  "TFTP Error",
+  "Protocol Error",
+  "Incompatible Version",
+  "Security Violation",
+  "CRC Error",
+  "End of Media",
+  "Reserved (29)",
+  "Reserved (30)",
+  "End of File",
+  "Invalid Language",
+  "Compromised Data"
+};
+
+CONST CHAR8  *mWarningString[] = {
+  "Success",
+  "Warning Unknown Glyph",
+  "Warning Delete Failure",
+  "Warning Write Failure",
+  "Warning Buffer Too Small",
+  "Warning Stale Data"
+};
+
+EFI_GUID  mStatusCodeDataTypeStringGuid = EFI_STATUS_CODE_DATA_TYPE_STRING_GUID;
+
+//
+// Format strings defined in the stream so far, indexed by their identifier.
+//
+CHAR8    *mFormat[MAX_FORMAT_ID];
+BOOLEAN  mPrintCallerId = FALSE;
+
+/**
+  Read bytes from a batch record.
+
+  @param  Decoder          The reader of the batch record.
+  @param  Length           The number of bytes to read.
+
+  @return The bytes read, or NULL if the record ends before them.
+
+**/
+CONST UINT8 *
+GetBytes (
+  IN OUT DECODER  *Decoder,
+  IN     UINTN    Length
+  )
+{
+  CONST UINT8  *Bytes;
+
+  if (Decoder->Error || Length > Decoder->Size - Decoder->Offset) {
+    Decoder->Error = TRUE;
+    return NULL;
+  }
+
+  Bytes = Decoder->Buffer + Decoder->Offset;
+  Decoder->Offset += Length;
+  return Bytes;
+}
+
+/**
+  Read an unsigned LEB128 varint from a batch record.
+
+  @param  Decoder          The reader of the batch record.
+
+  @return The value read, or 0 on error.
+
+**/
+UINT64
+GetVarint (
+  IN OUT DECODER  *Decoder
+  )
+{
+  CONST UINT8  *Byte;
+  UINT64       Value;
+  UINTN        Shift;
+
+  Value = 0;
+  for (Shift = 0; Shift < 64; Shift += 7) {
+    Byte = GetBytes (Decoder, 1);
+    if (Byte == NULL) {
+      return 0;
+    }
+    Value |= (UINT64) (*Byte & 0x7F) << Shift;
+    if ((*Byte & 0x80) == 0) {
+      return Value;
+    }
+  }
+
+  Decoder->Error = TRUE;
+  return 0;
+}
+
+/**
+  Read a string stored as its length and characters from a batch record.
+
+  @param  Decoder          The reader of the batch record.
+
+  @return The string read, allocated with malloc(), or NULL on error.
+
+**/
+CHAR8 *
+GetString (
+  IN OUT DECODER  *Decoder
+  )
+{
+  UINT64       Length;
+  CONST UINT8  *Bytes;
+  CHAR8        *String;
+
+  Length = GetVarint (Decoder);
+  Bytes  = GetBytes (Decoder, (UINTN) Length);
+  if (Bytes == NULL) {
+    return NULL;
+  }
+
+  String = malloc ((UINTN) Length + 1);
+  if (String == NULL) {
+    Decoder->Error = TRUE;
+    return NULL;
+  }
+  memcpy (String, Bytes, (UINTN) Length);
+  String[Length] = '\0';
+  return String;
+}
+
+/**
+  Format a GUID stored as the bytes of an EFI_GUID.
+
+  @param  Bytes            The bytes of the GUID.
+  @param  Text             Returns the GUID in registry format.
+  @param  Size             The size of Text.
+
+**/
+VOID
+FormatGuid (
+  IN  CONST UINT8  *Bytes,
+  OUT CHAR8        *Text,
+  IN  UINTN        Size
+  )
+{
+  EFI_GUID  Guid;
+
+  memcpy (&Guid, Bytes, sizeof (Guid));
+  snprintf (
+    Text,
+    Size,
+    "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+    Guid.Data1,
+    Guid.Data2,
+    Guid.Data3,
+    Guid.Data4[0],
+    Guid.Data4[1],
+    Guid.Data4[2],
+    Guid.Data4[3],
+    Guid.Data4[4],
+    Guid.Data4[5],
+    Guid.Data4[6],
+    Guid.Data4[7]
+    );
+}
+
+/**
+  Format a DEBUG() message from its format string and the encoded arguments.
+
+  The format string follows the PrintLib syntax. The arguments are read in
+  the order the status code worker encoded them.
+
+  @param  Decoder          The reader of the batch record.
+  @param  Format           The format string.
+  @param  Message          Returns the formatted message.
+  @param  Size             The size of Message.
+
+**/
+VOID
+FormatDebugMessage (
+  IN OUT DECODER      *Decoder,
+  IN     CONST CHAR8  *Format,
+  OUT    CHAR8        *Message,
+  IN     UINTN        Size
+  )
+{
+  CHAR8        Spec[32];
+  CHAR8        Text[64];
+  CHAR8        *String;
+  CONST UINT8  *Bytes;
+  UINTN        Length;
+  UINTN        SpecLength;
+  UINT64       Value;
+  BOOLEAN      Long;
+
+  Length = 0;
+  Message[0] = '\0';
+
+  for (; *Format != '\0' && Length + 1 < Size && !Decoder->Error; Format++) {
+    if (*Format != '%') {
+      Message[Length++] = *Format;
+      Message[Length]   = '\0';
+      continue;
+    }
+
+    //
+    // Collect the flags, width and precision into a C format specification.
+    //
+    Spec[0]    = '%';
+    SpecLength = 1;
+    Long       = FALSE;
+    for (Format++; *Format != '\0'; Format++) {
+      if (*Format == 'L' || *Format == 'l') {
+        Long = TRUE;
+        continue;
+      }
+      if (*Format == '*') {
+        if (SpecLength < sizeof (Spec) - 16) {
+          SpecLength += snprintf (Spec + SpecLength, sizeof (Spec) - SpecLength, "%u", (unsigned) GetVarint (Decoder));
+        } else {
+          GetVarint (Decoder);
+        }
+        continue;
+      }
+      if (*Format == '.' || *Format == '-' || *Format == '+' || *Format == ' ' ||
+          (*Format >= '0' && *Format <= '9')) {
+        if (SpecLength < sizeof (Spec) - 8) {
+          Spec[SpecLength++] = *Format;
+        }
+        continue;
+      }
+      if (*Format == ',') {
+        continue;
+      }
+      break;
+    }
+    Spec[SpecLength] = '\0';
+
+    if (*Format == '\0') {
+      break;
+    }
+
+    Text[0] = '\0';
+    String  = NULL;
+    switch (*Format) {
+    case 'd':
+      Value = GetVarint (Decoder);
+      strcat (Spec, "lld");
+      snprintf (Text, sizeof (Text), Spec, (long long) ((Value >> 1) ^ (0 - (Value & 1))));
+      break;
+
+    case 'p':
+      Value = GetVarint (Decoder);
+      snprintf (Text, sizeof (Text), "%016llX", (unsigned long long) Value);
+      break;
+
+    case 'X':
+    case 'x':
+    case 'u':
+      Value = GetVarint (Decoder);
+      if (!Long) {
+        Value = (UINT32) Value;
+      }
+      strcat (Spec, (*Format == 'u') ? "llu" : (*Format == 'x') ? "llx" : "llX");
+      snprintf (Text, sizeof (Text), Spec, (unsigned long long) Value);
+      break;
+
+    case 'a':
+    case 's':
+    case 'S':
+      String = GetString (Decoder);
+      break;
+
+    case 'g':
+      Bytes = GetBytes (Decoder, GUID_SIZE);
+      if (Bytes != NULL) {
+        FormatGuid (Bytes, Text, sizeof (Text));
+      }
+      break;
+
+    case 't':
+      Bytes = GetBytes (Decoder, TIME_SIZE);
+      if (Bytes != NULL) {
+        //
+        // EFI_TIME: UINT16 Year, UINT8 Month, Day, Hour, Minute, Second.
+        //
+        snprintf (
+          Text,
+          sizeof (Text),
+          "%02d/%02d/%04d  %02d:%02d",
+          Bytes[2],
+          Bytes[3],
+          Bytes[0] | (Bytes[1] << 8),
+          Bytes[4],
+          Bytes[5]
+          );
+      }
+      break;
+
+    case 'c':
+      Value = GetVarint (Decoder);
+      Text[0] = (CHAR8) ((Value < 0x80) ? Value : '?');
+      Text[1] = '\0';
+      break;
+
+    case 'r':
+      Value = GetVarint (Decoder);
+      if ((Value & 0x8000000000000000ULL) != 0 || (Value & 0x80000000ULL) != 0) {
+        Value &= 0x7FFFFFFF;
+        if (Value < sizeof (mStatusString) / sizeof (mStatusString[0])) {
+          snprintf (Text, sizeof (Text), "%s", mStatusString[Value]);
+        } else {
+          snprintf (Text, sizeof (Text), "%08llX", (unsigned long long) Value);
+        }
+      } else if (Value < sizeof (mWarningString) / sizeof (mWarningString[0])) {
+        snprintf (Text, sizeof (Text), "%s", mWarningString[Value]);
+      } else {
+        snprintf (Text, sizeof (Text), "%08llX", (unsigned long long) Value);
+      }
+      break;
+
+    case '%':
+      Text[0] = '%';
+      Text[1] = '\0';
+      break;
+
+    case 'n':
+      Text[0] = '\n';
+      Text[1] = '\r';
+      Text[2] = '\0';
+      break;
+
+    default:
+      break;
+    }
+
+    if (String != NULL) {
+      strcat (Spec, "s");
+      Length += snprintf (Message + Length, Size - Length, Spec, String);
+      free (String);
+    } else {
+      Length += snprintf (Message + Length, Size - Length, "%s", Text);
+    }
+    if (Length >= Size) {
+      Length = Size - 1;
+    }
+  }
+}
+
+/**
+  Check that extended data ends with the given number of NUL terminated strings.
+
+  @param  Data             The extended data.
+  @param  Size             The size of the extended data.
+  @param  Offset           The offset of the first string.
+  @param  Count            The number of strings.
+
+  @return The first string, or NULL if the extended data does not hold them.
+
+**/
+CONST CHAR8 *
+GetDataStrings (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size,
+  IN UINTN        Offset,
+  IN UINTN        Count
+  )
+{
+  UINTN  Index;
+
+  if (Data == NULL || Size <= Offset) {
+    return NULL;
+  }
+
+  for (Index = Offset; Index < Size && Count > 0; Index++) {
+    if (Data[Index] == '\0') {
+      Count--;
+    }
+  }
+
+  if (Count != 0 || Index != Size) {
+    return NULL;
+  }
+  return (CONST CHAR8 *) Data + Offset;
+}
+
+/**
+  Decode and print the entries of a batch record.
+
+  @param  Decoder          The reader of the entries.
+  @param  EntryCount       The number of status code entries in the record.
+
+  @retval 0                The record is decoded.
+  @retval 1                The record is malformed.
+
+**/
+int
+DecodeBatch (
+  IN OUT DECODER  *Decoder,
+  IN     UINT16   EntryCount
+  )
+{
+  CHAR8        Message[MAX_MESSAGE_LENGTH];
+  CHAR8        Guid[40];
+  CHAR8        *Format;
+  CONST UINT8  *Bytes;
+  CONST UINT8  *Data;
+  CONST CHAR8  *String;
+  UINT32       LineNumber;
+  UINT32       StringType;
+  UINT8        Tag;
+  UINT64       CodeType;
+  UINT64       Value;
+  UINT64       Instance;
+  UINT64       FormatId;
+  UINT64       DataSize;
+  UINTN        Count;
+
+  Count = 0;
+  while (Decoder->Offset < Decoder->Size && !Decoder->Error) {
+    Bytes = GetBytes (Decoder, 1);
+    Tag   = *Bytes;
+
+    if ((Tag & DATA_HUB_STATUS_CODE_ENTRY_TYPE_MASK) == DATA_HUB_STATUS_CODE_ENTRY_FORMAT) {
+      FormatId = GetVarint (Decoder);
+      Format   = GetString (Decoder);
+      if (Format == NULL || FormatId == DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID || FormatId >= MAX_FORMAT_ID) {
+        free (Format);
+        Decoder->Error = TRUE;
+        break;
+      }
+      free (mFormat[FormatId]);
+      mFormat[FormatId] = Format;
+      continue;
+    }
+
+    if ((Tag & DATA_HUB_STATUS_CODE_ENTRY_TYPE_MASK) != DATA_HUB_STATUS_CODE_ENTRY_STATUS_CODE) {
+      Decoder->Error = TRUE;
+      break;
+    }
+
+    Count++;
+    CodeType = GetVarint (Decoder);
+    Value    = GetVarint (Decoder);
+    Instance = GetVarint (Decoder);
+    Guid[0]  = '\0';
+    if ((Tag & DATA_HUB_STATUS_CODE_ENTRY_CALLER_ID) != 0) {
+      Bytes = GetBytes (Decoder, GUID_SIZE);
+      if (Bytes != NULL) {
+        FormatGuid (Bytes, Guid, sizeof (Guid));
+      }
+    }
+    if (mPrintCallerId && Guid[0] != '\0') {
+      printf ("[%s] ", Guid);
+    }
+
+    switch (Tag & DATA_HUB_STATUS_CODE_ENTRY_DATA_MASK) {
+    case DATA_HUB_STATUS_CODE_ENTRY_DATA_DEBUG:
+      GetVarint (Decoder);
+      FormatId = GetVarint (Decoder);
+      if (FormatId == DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID) {
+        Format = GetString (Decoder);
+        if (Format != NULL) {
+          FormatDebugMessage (Decoder, Format, Message, sizeof (Message));
+          free (Format);
+        }
+      } else if (FormatId < MAX_FORMAT_ID && mFormat[FormatId] != NULL) {
+        FormatDebugMessage (Decoder, mFormat[FormatId], Message, sizeof (Message));
+      } else {
+        fprintf (stderr, "Format %llu is not defined. Are records missing?\n", (unsigned long long) FormatId);
+        Decoder->Error = TRUE;
+        continue;
+      }
+      if (!Decoder->Error) {
+        printf ("%s", Message);
+      }
+      continue;
+
+    case DATA_HUB_STATUS_CODE_ENTRY_DATA_RAW:
+      Bytes    = GetBytes (Decoder, GUID_SIZE);
+      DataSize = GetVarint (Decoder);
+      Data     = GetBytes (Decoder, (UINTN) DataSize);
+      break;
+
+    case DATA_HUB_STATUS_CODE_ENTRY_DATA_NONE:
+      Bytes    = NULL;
+      Data     = NULL;
+      DataSize = 0;
+      break;
+
+    default:
+      Decoder->Error = TRUE;
+      continue;
+    }
+
+    if (Decoder->Error) {
+      continue;
+    }
+
+    //
+    // The checks are made in the order of the serial status code worker.
+    //
+    String = NULL;
+    if ((CodeType & EFI_STATUS_CODE_TYPE_MASK) == EFI_ERROR_CODE &&
+        (CodeType & EFI_STATUS_CODE_SEVERITY_MASK) == EFI_ERROR_UNRECOVERED &&
+        (Value & EFI_STATUS_CODE_OPERATION_MASK) == EFI_SW_EC_ILLEGAL_SOFTWARE_STATE) {
+      String = GetDataStrings (Data, (UINTN) DataSize, sizeof (UINT32), 2);
+    }
+    if (String != NULL) {
+      memcpy (&LineNumber, Data, sizeof (UINT32));
+      printf ("\nDXE_ASSERT!: %s (%d): %s\n", String, (int) LineNumber, String + strlen (String) + 1);
+      continue;
+    }
+
+    if ((CodeType & EFI_STATUS_CODE_TYPE_MASK) == EFI_ERROR_CODE) {
+      printf ("ERROR: C%08x:V%08x I%x", (UINT32) CodeType, (UINT32) Value, (UINT32) Instance);
+      if (Guid[0] != '\0' && !mPrintCallerId) {
+        printf (" %s", Guid);
+      }
+      printf ("\n");
+    } else if ((CodeType & EFI_STATUS_CODE_TYPE_MASK) == EFI_PROGRESS_CODE) {
+      printf ("PROGRESS CODE: V%08x I%x\n", (UINT32) Value, (UINT32) Instance);
+    } else {
+      if (Bytes != NULL && memcmp (Bytes, &mStatusCodeDataTypeStringGuid, GUID_SIZE) == 0) {
+        String = GetDataStrings (Data, (UINTN) DataSize, sizeof (UINT32), 1);
+      }
+      if (String != NULL) {
+        memcpy (&StringType, Data, sizeof (UINT32));
+      }
+      if (String != NULL && StringType == EFI_STRING_ASCII) {
+        printf ("%s\n", String);
+        continue;
+      }
+      printf ("Undefined: C%08x:V%08x I%x\n", (UINT32) CodeType, (UINT32) Value, (UINT32) Instance);
+    }
+
+    if (Bytes != NULL) {
+      FormatGuid (Bytes, Guid, sizeof (Guid));
+      printf ("  Data: %s (%llu bytes)\n", Guid, (unsigned long long) DataSize);
+    }
+  }
+
+  if (Decoder->Error) {
+    return 1;
+  }
+  if (Count != EntryCount) {
+    fprintf (stderr, "The record holds %u status codes instead of %u.\n", (unsigned) Count, EntryCount);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+  Decode and print the batch records of a file.
+
+  @param  FileName         The name of the file.
+
+  @retval 0                All the records of the file are decoded.
+  @retval 1                The file cannot be read or holds a malformed record.
+
+**/
+int
+DecodeFile (
+  IN CONST CHAR8  *FileName
+  )
+{
+  FILE                               *File;
+  UINT8                              *Buffer;
+  long                               Size;
+  UINTN                              Offset;
+  DATA_HUB_STATUS_CODE_BATCH_HEADER  Header;
+  DECODER                            Decoder;
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    fprintf (stderr, "%s: cannot open\n", FileName);
+    return 1;
+  }
+  fseek (File, 0, SEEK_END);
+  Size = ftell (File);
+  fseek (File, 0, SEEK_SET);
+  Buffer = malloc (Size > 0 ? (UINTN) Size : 1);
+  if (Buffer == NULL || fread (Buffer, 1, (UINTN) Size, File) != (UINTN) Size) {
+    fprintf (stderr, "%s: cannot read\n", FileName);
+    fclose (File);
+    free (Buffer);
+    return 1;
+  }
+  fclose (File);
+
+  for (Offset = 0; Offset < (UINTN) Size; Offset += sizeof (Header) + Header.Size) {
+    if ((UINTN) Size - Offset < sizeof (Header)) {
+      fprintf (stderr, "%s: truncated record header at offset 0x%x\n", FileName, (unsigned) Offset);
+      free (Buffer);
+      return 1;
+    }
+    memcpy (&Header, Buffer + Offset, sizeof (Header));
+    if (Header.Version != DATA_HUB_STATUS_CODE_BATCH_VERSION ||
+        Header.Size > (UINTN) Size - Offset - sizeof (Header)) {
+      fprintf (stderr, "%s: bad record header at offset 0x%x\n", FileName, (unsigned) Offset);
+      free (Buffer);
+      return 1;
+    }
+
+    Decoder.Buffer = Buffer + Offset + sizeof (Header);
+    Decoder.Size   = Header.Size;
+    Decoder.Offset = 0;
+    Decoder.Error  = FALSE;
+    if (DecodeBatch (&Decoder, Header.EntryCount) != 0) {
+      fprintf (stderr, "%s: malformed record at offset 0x%x\n", FileName, (unsigned) Offset);
+      free (Buffer);
+      return 1;
+    }
+  }
+
+  free (Buffer);
+  return 0;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  int  Index;
+  int  Status;
+
+  Index = 1;
+  if (Index < argc && strcmp (argv[Index], "-c") == 0) {
+    mPrintCallerId = TRUE;
+    Index++;
+  }
+
+  if (Index >= argc) {
+    fprintf (stderr, "Usage: %s [-c] Batches [Batches ...]\n", argv[0]);
+    return 1;
+  }
+
+  Status = 0;
+  for (; Index < argc; Index++) {
+    Status |= DecodeFile (argv[Index]);
+  }
+
+  return Status;
+}
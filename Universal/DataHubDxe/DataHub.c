@@ -23,84 +23,580 @@ CONST EFI_GUID gZeroGuid  = { 0, 0, 0, { 0, 0, 0, 0, 0, 0, 0, 0 } };
 //
 DATA_HUB_INSTANCE mPrivateData;
 
+CONST UINT8 mDaysInMonth[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
 /**
-  Log data record into the data logging hub
+  Make sure an index array has room for one more element, doubling its
+  size when it is full.
 
-  @param This                   Protocol instance structure
+  @param Buffer         On input, the current index array. On output, the
+                        index array with room for at least Count + 1 elements.
+  @param MaxCount       On input, the number of elements Buffer can hold. On
+                        output, the number of elements the new Buffer can hold.
+  @param Count          Number of elements currently used in Buffer.
+  @param ElementSize    Size in bytes of one element of Buffer.
+
+  @retval EFI_SUCCESS           There is room for one more element.
+  @retval EFI_OUT_OF_RESOURCES  The index array could not be grown.
+
+**/
+EFI_STATUS
+GrowDataHubIndex (
+  IN OUT VOID             **Buffer,
+  IN OUT UINTN            *MaxCount,
+  IN     UINTN            Count,
+  IN     UINTN            ElementSize
+  )
+{
+  VOID                    *NewBuffer;
+  UINTN                   NewMaxCount;
+
+  if (Count < *MaxCount) {
+    return EFI_SUCCESS;
+  }
+
+  if (*MaxCount == 0) {
+    NewMaxCount = DATA_HUB_INDEX_INITIAL_COUNT;
+  } else {
+    NewMaxCount = *MaxCount * 2;
+  }
+
+  NewBuffer = ReallocatePool (*MaxCount * ElementSize, NewMaxCount * ElementSize, *Buffer);
+  if (NewBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Buffer   = NewBuffer;
+  *MaxCount = NewMaxCount;
+  return EFI_SUCCESS;
+}
+
+/**
+  Make sure the record index and the index of every class the new record
+  belongs to have room for one more entry.
+
+  @param Private          Data Hub private data.
+  @param DataRecordClass  Class of the new data record.
+
+  @retval EFI_SUCCESS           The indexes have room for the new record.
+  @retval EFI_OUT_OF_RESOURCES  The indexes could not be grown.
+
+**/
+EFI_STATUS
+ReserveDataRecordIndex (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN UINT64               DataRecordClass
+  )
+{
+  EFI_STATUS              Status;
+  DATA_HUB_CLASS_INDEX    *ClassIndex;
+  UINTN                   Bit;
+
+  Status = GrowDataHubIndex (
+             (VOID **) &Private->RecordIndex,
+             &Private->MaxRecordCount,
+             Private->RecordCount,
+             sizeof (EFI_DATA_ENTRY *)
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Bit = 0; Bit < DATA_HUB_INDEXED_CLASS_COUNT; Bit++) {
+    if ((DataRecordClass & LShiftU64 (1, Bit)) != 0) {
+      ClassIndex = &Private->ClassIndex[Bit];
+      Status = GrowDataHubIndex (
+                 (VOID **) &ClassIndex->Position,
+                 &ClassIndex->MaxCount,
+                 ClassIndex->Count,
+                 sizeof (UINTN)
+                 );
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Add a newly logged entry to the record index and to the index of every
+  class the record belongs to. The entry gets the next free position, which
+  matches the Monotonic Count the caller assigned to it.
+
+  ReserveDataRecordIndex() must have been called for the record first.
+
+  @param Private          Data Hub private data.
+  @param LogEntry         The new data log entry.
+  @param DataRecordClass  Class of the new data record.
+
+**/
+VOID
+IndexDataRecord (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN EFI_DATA_ENTRY       *LogEntry,
+  IN UINT64               DataRecordClass
+  )
+{
+  DATA_HUB_CLASS_INDEX    *ClassIndex;
+  UINTN                   Bit;
+
+  ASSERT (Private->RecordCount < Private->MaxRecordCount);
+
+  for (Bit = 0; Bit < DATA_HUB_INDEXED_CLASS_COUNT; Bit++) {
+    if ((DataRecordClass & LShiftU64 (1, Bit)) != 0) {
+      ClassIndex = &Private->ClassIndex[Bit];
+      ASSERT (ClassIndex->Count < ClassIndex->MaxCount);
+      ClassIndex->Position[ClassIndex->Count++] = Private->RecordCount;
+    }
+  }
+
+  Private->RecordIndex[Private->RecordCount++] = LogEntry;
+}
+
+/**
+  Allocate a new chunk of record storage and add it to the chunk list.
+
+  @param Private          Data Hub private data.
+  @param Size             Number of bytes of storage in the chunk.
+
+  @return The new chunk, or NULL if it could not be allocated.
+
+**/
+DATA_HUB_ARENA_CHUNK *
+AllocateArenaChunk (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN UINTN                Size
+  )
+{
+  DATA_HUB_ARENA_CHUNK    *Chunk;
+
+  Chunk = AllocatePool (sizeof (DATA_HUB_ARENA_CHUNK) + Size);
+  if (Chunk == NULL) {
+    return NULL;
+  }
+
+  Chunk->Signature = DATA_HUB_ARENA_CHUNK_SIGNATURE;
+  Chunk->Size      = Size;
+  Chunk->Used      = 0;
+  InsertTailList (&Private->ArenaChunkListHead, &Chunk->Link);
+
+  Private->Statistics.ArenaChunkCount++;
+  Private->Statistics.ArenaBytesAllocated += Size;
+
+  return Chunk;
+}
+
+/**
+  Carve the storage for one log entry out of the record storage arena.
+
+  Entries are packed back to back in the current chunk. When the current
+  chunk cannot fit the entry, its tail is left unused and a new chunk is
+  started. An entry larger than a whole chunk gets a chunk of its own and
+  the current chunk stays in use for the following entries. Storage is
+  never given back, because data records stay valid for the whole boot.
+
+  @param Private          Data Hub private data.
+  @param Size             Size in bytes of the log entry.
+
+  @return Storage for the entry, or NULL if no storage could be allocated.
+
+**/
+EFI_DATA_ENTRY *
+AllocateDataEntry (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN UINTN                Size
+  )
+{
+  DATA_HUB_ARENA_CHUNK    *Chunk;
+  VOID                    *Buffer;
+
+  Size = ALIGN_VALUE (Size, sizeof (UINT64));
+
+  if (Size > Private->Statistics.ArenaChunkSize) {
+    Chunk = AllocateArenaChunk (Private, Size);
+    if (Chunk == NULL) {
+      return NULL;
+    }
+    Private->Statistics.OversizeRecordCount++;
+  } else {
+    Chunk = Private->CurrentChunk;
+    if ((Chunk == NULL) || (Chunk->Size - Chunk->Used < Size)) {
+      if (Chunk != NULL) {
+        Private->Statistics.ArenaBytesWasted += Chunk->Size - Chunk->Used;
+      }
+      Chunk = AllocateArenaChunk (Private, Private->Statistics.ArenaChunkSize);
+      if (Chunk == NULL) {
+        return NULL;
+      }
+      Private->CurrentChunk = Chunk;
+    }
+  }
+
+  Buffer       = (UINT8 *) (Chunk + 1) + Chunk->Used;
+  Chunk->Used += Size;
+  Private->Statistics.ArenaBytesUsed += Size;
+
+  return (EFI_DATA_ENTRY *) Buffer;
+}
+
+/**
+  Signal a filter driver about a newly logged record.
+
+  A filter driver is signaled at most once per record, even if it is found
+  through more than one class bucket.
+
+  @param Private            Data Hub private data.
+  @param FilterEntry        The filter driver to signal.
+  @param LogMonotonicCount  Monotonic Count of the new record.
+
+**/
+VOID
+SignalFilterDriver (
+  IN DATA_HUB_INSTANCE      *Private,
+  IN DATA_HUB_FILTER_DRIVER *FilterEntry,
+  IN UINT64                 LogMonotonicCount
+  )
+{
+  if (FilterEntry->SignalMonotonicCount == LogMonotonicCount) {
+    return;
+  }
+  FilterEntry->SignalMonotonicCount = LogMonotonicCount;
+
+  Private->Statistics.FilterSignalCount++;
+  gBS->SignalEvent (FilterEntry->Event);
+}
+
+/**
+  Signal the filter drivers interested in a newly logged record. Only the
+  class buckets of the record's classes are visited.
+
+  @param Private            Data Hub private data.
+  @param DataRecordGuid     GUID of the new record.
+  @param DataRecordClass    Class of the new record.
+  @param LogMonotonicCount  Monotonic Count of the new record.
+
+**/
+VOID
+SignalFilterDrivers (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN EFI_GUID             *DataRecordGuid,
+  IN UINT64               DataRecordClass,
+  IN UINT64               LogMonotonicCount
+  )
+{
+  DATA_HUB_FILTER_BUCKET  *Bucket;
+  DATA_HUB_FILTER_DRIVER  *FilterEntry;
+  LIST_ENTRY              *Link;
+  LIST_ENTRY              *Head;
+  UINTN                   Bit;
+
+  for (Bit = 0; Bit < DATA_HUB_INDEXED_CLASS_COUNT; Bit++) {
+    if ((DataRecordClass & LShiftU64 (1, Bit)) == 0) {
+      continue;
+    }
+    Bucket = &Private->FilterBucket[Bit];
+
+    Head = &Bucket->AnyGuidListHead;
+    for (Link = GetFirstNode (Head); Link != Head; Link = GetNextNode (Head, Link)) {
+      FilterEntry = FILTER_ENTRY_FROM_CLASS_LINK (Link, Bit);
+      SignalFilterDriver (Private, FilterEntry, LogMonotonicCount);
+    }
+
+    Head = &Bucket->GuidListHead[DATA_HUB_FILTER_GUID_HASH (DataRecordGuid)];
+    for (Link = GetFirstNode (Head); Link != Head; Link = GetNextNode (Head, Link)) {
+      FilterEntry = FILTER_ENTRY_FROM_CLASS_LINK (Link, Bit);
+      if (CompareGuid (&FilterEntry->FilterDataRecordGuid, DataRecordGuid)) {
+        SignalFilterDriver (Private, FilterEntry, LogMonotonicCount);
+      }
+    }
+  }
+
+  if ((DataRecordClass & ~((UINT64) DATA_HUB_INDEXED_CLASS_MASK)) != 0) {
+    Head = &Private->OtherClassFilterListHead;
+    for (Link = GetFirstNode (Head); Link != Head; Link = GetNextNode (Head, Link)) {
+      FilterEntry = FILTER_ENTRY_FROM_OTHER_CLASS_LINK (Link);
+      if (((FilterEntry->ClassFilter & DataRecordClass) != 0) &&
+          (CompareGuid (&FilterEntry->FilterDataRecordGuid, &gZeroGuid) || 
+           CompareGuid (&FilterEntry->FilterDataRecordGuid, DataRecordGuid))) {
+        SignalFilterDriver (Private, FilterEntry, LogMonotonicCount);
+      }
+    }
+  }
+}
+
+/**
+  Add a filter driver to, or remove it from, the class buckets that match
+  its ClassFilter and FilterDataRecordGuid. Must be called with the data
+  lock held.
+
+  @param Private          Data Hub private data.
+  @param FilterDriver     The filter driver.
+  @param Insert           TRUE to add the filter driver, FALSE to remove it.
+
+**/
+VOID
+UpdateFilterDriverBuckets (
+  IN DATA_HUB_INSTANCE      *Private,
+  IN DATA_HUB_FILTER_DRIVER *FilterDriver,
+  IN BOOLEAN                Insert
+  )
+{
+  DATA_HUB_FILTER_BUCKET  *Bucket;
+  LIST_ENTRY              *Head;
+  UINTN                   Bit;
+
+  for (Bit = 0; Bit < DATA_HUB_INDEXED_CLASS_COUNT; Bit++) {
+    if ((FilterDriver->ClassFilter & LShiftU64 (1, Bit)) == 0) {
+      continue;
+    }
+    if (!Insert) {
+      RemoveEntryList (&FilterDriver->ClassLink[Bit]);
+      continue;
+    }
+
+    Bucket = &Private->FilterBucket[Bit];
+    if (CompareGuid (&FilterDriver->FilterDataRecordGuid, &gZeroGuid)) {
+      Head = &Bucket->AnyGuidListHead;
+    } else {
+      Head = &Bucket->GuidListHead[DATA_HUB_FILTER_GUID_HASH (&FilterDriver->FilterDataRecordGuid)];
+    }
+    InsertTailList (Head, &FilterDriver->ClassLink[Bit]);
+  }
+
+  if ((FilterDriver->ClassFilter & ~((UINT64) DATA_HUB_INDEXED_CLASS_MASK)) != 0) {
+    if (Insert) {
+      InsertTailList (&Private->OtherClassFilterListHead, &FilterDriver->OtherClassLink);
+    } else {
+      RemoveEntryList (&FilterDriver->OtherClassLink);
+    }
+  }
+}
+
+/**
+  Get the number of nanoseconds between two performance counter values,
+  taking the direction and the wrap around of the counter into account.
+
+  @param Private          Data Hub private data.
+  @param StartCounter     Earlier performance counter value.
+  @param EndCounter       Later performance counter value.
+
+  @return Number of nanoseconds from StartCounter to EndCounter.
+
+**/
+UINT64
+GetElapsedNanoSeconds (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN UINT64               StartCounter,
+  IN UINT64               EndCounter
+  )
+{
+  UINT64                  Ticks;
+
+  if (Private->CounterEndValue >= Private->CounterStartValue) {
+    if (EndCounter >= StartCounter) {
+      Ticks = EndCounter - StartCounter;
+    } else {
+      Ticks = (Private->CounterEndValue - StartCounter) + (EndCounter - Private->CounterStartValue) + 1;
+    }
+  } else {
+    if (StartCounter >= EndCounter) {
+      Ticks = StartCounter - EndCounter;
+    } else {
+      Ticks = (StartCounter - Private->CounterEndValue) + (Private->CounterStartValue - EndCounter) + 1;
+    }
+  }
+
+  return GetTimeInNanoSecond (Ticks);
+}
+
+/**
+  Add a number of nanoseconds to an EFI_TIME.
+
+  @param Time             The time to update.
+  @param NanoSeconds      Number of nanoseconds to add.
+
+**/
+VOID
+AddNanoSecondsToTime (
+  IN OUT EFI_TIME         *Time,
+  IN     UINT64           NanoSeconds
+  )
+{
+  UINT64                  Seconds;
+  UINT32                  Remainder;
+  UINT8                   DaysInMonth;
+
+  Seconds          = DivU64x32Remainder (NanoSeconds + Time->Nanosecond, 1000000000, &Remainder);
+  Time->Nanosecond = Remainder;
+
+  Seconds          = DivU64x32Remainder (Seconds + Time->Second, 60, &Remainder);
+  Time->Second     = (UINT8) Remainder;
+  Seconds          = DivU64x32Remainder (Seconds + Time->Minute, 60, &Remainder);
+  Time->Minute     = (UINT8) Remainder;
+  Seconds          = DivU64x32Remainder (Seconds + Time->Hour, 24, &Remainder);
+  Time->Hour       = (UINT8) Remainder;
+
+  //
+  // Seconds now holds the number of days to add.
+  //
+  while (Seconds-- > 0) {
+    DaysInMonth = mDaysInMonth[(Time->Month - 1) % 12];
+    if ((Time->Month == 2) &&
+        (((Time->Year % 4 == 0) && (Time->Year % 100 != 0)) || (Time->Year % 400 == 0))) {
+      DaysInMonth++;
+    }
+
+    if (Time->Day < DaysInMonth) {
+      Time->Day++;
+    } else {
+      Time->Day = 1;
+      if (Time->Month < 12) {
+        Time->Month++;
+      } else {
+        Time->Month = 1;
+        Time->Year++;
+      }
+    }
+  }
+}
+
+/**
+  Get the log time of a record from the performance counter value taken when
+  it was logged. The time is extrapolated from the last time read through
+  gRT->GetTime(), so no runtime service call is needed at high TPL. Without
+  a performance counter, it is the last time read as is.
+
+  @param Private          Data Hub private data.
+  @param Counter          Performance counter value when the record was logged.
+  @param LogTime          Returns the log time, zero if it is not known.
+
+**/
+VOID
+GetRecordLogTime (
+  IN  DATA_HUB_INSTANCE   *Private,
+  IN  UINT64              Counter,
+  OUT EFI_TIME            *LogTime
+  )
+{
+  if (!Private->TimeBaseValid) {
+    ZeroMem (LogTime, sizeof (EFI_TIME));
+    return;
+  }
+
+  CopyMem (LogTime, &Private->TimeBase, sizeof (EFI_TIME));
+  if (FeaturePcdGet (PcdDataHubUsePerformanceCounter)) {
+    AddNanoSecondsToTime (LogTime, GetElapsedNanoSeconds (Private, Private->TimeBaseCounter, Counter));
+  }
+}
+
+/**
+  Update the time base that log times at high TPL are extrapolated from.
+
+  @param Private          Data Hub private data.
+  @param Time             Time read through gRT->GetTime().
+  @param Counter          Performance counter value when Time was read.
+
+**/
+VOID
+UpdateTimeBase (
+  IN DATA_HUB_INSTANCE    *Private,
+  IN EFI_TIME             *Time,
+  IN UINT64               Counter
+  )
+{
+  if (!Private->TimeBaseValid && FeaturePcdGet (PcdDataHubUsePerformanceCounter)) {
+    GetPerformanceCounterProperties (&Private->CounterStartValue, &Private->CounterEndValue);
+  }
+
+  CopyMem (&Private->TimeBase, Time, sizeof (EFI_TIME));
+  Private->TimeBaseCounter = Counter;
+  Private->TimeBaseValid   = TRUE;
+}
+
+/**
+  Read the performance counter to time a record logged above TPL_CALLBACK,
+  and have the time base refreshed from then on.
+
+  @param Private          Data Hub private data.
+
+  @return The performance counter value, or zero if the platform has no
+          performance counter.
+
+**/
+UINT64
+ReadLogTimeCounter (
+  IN DATA_HUB_INSTANCE    *Private
+  )
+{
+  Private->CounterUsed = TRUE;
+
+  if (!FeaturePcdGet (PcdDataHubUsePerformanceCounter)) {
+    return 0;
+  }
+  return GetPerformanceCounter ();
+}
+
+/**
+  Append a data record to the data log and signal the filter drivers that
+  are interested in it. Must be called with the data lock held.
+
+  @param Private                Data Hub private data.
   @param DataRecordGuid         GUID that defines record contents
   @param ProducerName           GUID that defines the name of the producer of the data
   @param DataRecordClass        Class that defines generic record type
   @param RawData                Data Log record as defined by DataRecordGuid
   @param RawDataSize            Size of Data Log data in bytes
+  @param LogTime                Time the record was logged.
 
   @retval EFI_SUCCESS           If data was logged
   @retval EFI_OUT_OF_RESOURCES  If data was not logged due to lack of system 
                                 resources.
 **/
 EFI_STATUS
-EFIAPI
-DataHubLogData (
-  IN  EFI_DATA_HUB_PROTOCOL   *This,
+AppendDataRecord (
+  IN  DATA_HUB_INSTANCE       *Private,
   IN  EFI_GUID                *DataRecordGuid,
   IN  EFI_GUID                *ProducerName,
   IN  UINT64                  DataRecordClass,
   IN  VOID                    *RawData,
-  IN  UINT32                  RawDataSize
+  IN  UINT32                  RawDataSize,
+  IN  EFI_TIME                *LogTime
   )
 {
   EFI_STATUS              Status;
-  DATA_HUB_INSTANCE       *Private;
   EFI_DATA_ENTRY          *LogEntry;
   UINT32                  TotalSize;
   UINT32                  RecordSize;
   EFI_DATA_RECORD_HEADER  *Record;
   VOID                    *Raw;
-  DATA_HUB_FILTER_DRIVER  *FilterEntry;
-  LIST_ENTRY              *Link;
-  LIST_ENTRY              *Head;
-  EFI_TIME                LogTime;
-
-  Private = DATA_HUB_INSTANCE_FROM_THIS (This);
 
   //
   // Combine the storage for the internal structs and a copy of the log record.
   //  Record follows PrivateLogEntry. The consumer will be returned a pointer
   //  to Record so we don't what it to be the thing that was allocated from
-  //  pool, so the consumer can't free an data record by mistake.
+  //  pool, so the consumer can't free an data record by mistake. Every field
+  //  of the entry is written below, so the storage is not zeroed first.
   //
   RecordSize  = sizeof (EFI_DATA_RECORD_HEADER) + RawDataSize;
   TotalSize   = sizeof (EFI_DATA_ENTRY) + RecordSize;
-  
-  //
-  // First try to get log time at TPL level <= TPL_CALLBACK.
-  //
-  ZeroMem (&LogTime, sizeof (LogTime));
-  if (EfiGetCurrentTpl() <= TPL_CALLBACK) {
-    gRT->GetTime (&LogTime, NULL);
-  }
 
   //
-  // The Logging action is the critical section, so it is locked.
-  //  The MTC asignment & update and logging must be an
-  //  atomic operation, so use the lock.
+  // Make room in the indexes first, so a failure does not leave
+  //  a hole in the Monotonic Count sequence.
   //
-  Status = EfiAcquireLockOrFail (&Private->DataLock);
+  Status = ReserveDataRecordIndex (Private, DataRecordClass);
   if (EFI_ERROR (Status)) {
-    //
-    // Reentrancy detected so exit!
-    //
     return Status;
   }
 
-  LogEntry = AllocatePool (TotalSize);
+  LogEntry = AllocateDataEntry (Private, TotalSize);
 
   if (LogEntry == NULL) {
-    EfiReleaseLock (&Private->DataLock);
     return EFI_OUT_OF_RESOURCES;
   }
 
-  ZeroMem (LogEntry, TotalSize);
-
   Record  = (EFI_DATA_RECORD_HEADER *) (LogEntry + 1);
   Raw     = (VOID *) (Record + 1);
 
@@ -119,7 +615,7 @@ DataHubLogData (
   //
   Record->LogMonotonicCount = ++Private->GlobalMonotonicCount;
 
-  CopyMem (&Record->LogTime, &LogTime, sizeof (LogTime));
+  CopyMem (&Record->LogTime, LogTime, sizeof (EFI_TIME));
 
   //
   // Insert log into the internal linked list.
@@ -128,33 +624,362 @@ DataHubLogData (
   LogEntry->Record      = Record;
   LogEntry->RecordSize  = sizeof (EFI_DATA_ENTRY) + RawDataSize;
   InsertTailList (&Private->DataListHead, &LogEntry->Link);
+  IndexDataRecord (Private, LogEntry, DataRecordClass);
 
   CopyMem (Raw, RawData, RawDataSize);
 
-  EfiReleaseLock (&Private->DataLock);
+  Private->Statistics.RecordCount++;
+  Private->Statistics.RecordBytes += RecordSize;
 
   //
   // Send Signal to all the filter drivers which are interested
-  //  in the record's class and guid.
+  //  in the record's class and guid. Their notification functions
+  //  cannot run before the lock is released.
   //
-  Head = &Private->FilterDriverListHead;
-  for (Link = GetFirstNode(Head); Link != Head; Link = GetNextNode(Head, Link)) {
-    FilterEntry = FILTER_ENTRY_FROM_LINK (Link);
-    if (((FilterEntry->ClassFilter & DataRecordClass) != 0) &&
-        (CompareGuid (&FilterEntry->FilterDataRecordGuid, &gZeroGuid) || 
-         CompareGuid (&FilterEntry->FilterDataRecordGuid, DataRecordGuid))) {
-      gBS->SignalEvent (FilterEntry->Event);
-    }
+  SignalFilterDrivers (Private, DataRecordGuid, DataRecordClass, Record->LogMonotonicCount);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Stage a data record in the staging ring, because it is logged at a TPL
+  above the data lock TPL or while another record is being logged. The ring
+  is lock free: a slot is reserved by advancing StagingHead with a compare
+  exchange, filled, and then marked ready for DrainStagingRing().
+
+  @param Private                Data Hub private data.
+  @param DataRecordGuid         GUID that defines record contents
+  @param ProducerName           GUID that defines the name of the producer of the data
+  @param DataRecordClass        Class that defines generic record type
+  @param RawData                Data Log record as defined by DataRecordGuid
+  @param RawDataSize            Size of Data Log data in bytes
+
+  @retval EFI_SUCCESS           The record was staged.
+  @retval EFI_OUT_OF_RESOURCES  The ring is full or the record is too large for a
+                                slot. The record was dropped.
+**/
+EFI_STATUS
+StageDataRecord (
+  IN  DATA_HUB_INSTANCE       *Private,
+  IN  EFI_GUID                *DataRecordGuid,
+  IN  EFI_GUID                *ProducerName,
+  IN  UINT64                  DataRecordClass,
+  IN  VOID                    *RawData,
+  IN  UINT32                  RawDataSize
+  )
+{
+  UINT64                  Counter;
+  UINT32                  Head;
+  DATA_HUB_STAGING_SLOT   *Slot;
+
+  //
+  // Take the timestamp first, so it is as close as possible to the event
+  //  being logged.
+  //
+  Counter = ReadLogTimeCounter (Private);
+
+  if ((Private->StagingRing == NULL) || (RawDataSize > DATA_HUB_STAGING_DATA_SIZE)) {
+    InterlockedIncrement (&Private->StagingDropCount);
+    return EFI_OUT_OF_RESOURCES;
   }
 
+  do {
+    Head = Private->StagingHead;
+    if (Head - Private->StagingTail >= DATA_HUB_STAGING_SLOT_COUNT) {
+      InterlockedIncrement (&Private->StagingDropCount);
+      return EFI_OUT_OF_RESOURCES;
+    }
+  } while (InterlockedCompareExchange32 (&Private->StagingHead, Head, Head + 1) != Head);
+
+  Slot = &Private->StagingRing[Head % DATA_HUB_STAGING_SLOT_COUNT];
+  ASSERT (Slot->State == DATA_HUB_STAGING_SLOT_FREE);
+
+  CopyMem (&Slot->DataRecordGuid, DataRecordGuid, sizeof (EFI_GUID));
+  CopyMem (&Slot->ProducerName, ProducerName, sizeof (EFI_GUID));
+  Slot->DataRecordClass = DataRecordClass;
+  Slot->RawDataSize     = RawDataSize;
+  Slot->Counter         = Counter;
+  CopyMem (Slot->RawData, RawData, RawDataSize);
+
+  //
+  // Publish the slot only after its content is complete.
+  //
+  MemoryFence ();
+  Slot->State = DATA_HUB_STAGING_SLOT_READY;
+
+  gBS->SignalEvent (Private->StagingDrainEvent);
+
   return EFI_SUCCESS;
 }
 
 /**
-  Search the Head doubly linked list for the passed in MTC. Return the 
-  matching element in Head and the MTC on the next entry.
+  Move the records staged in the staging ring into the data log, in the
+  order they were staged. Must be called with the data lock held.
+
+  A slot that was reserved but is still being filled by an interrupted
+  producer stops the drain. The producer signals the drain event again once
+  the slot is ready.
+
+  @param Private          Data Hub private data.
+
+**/
+VOID
+DrainStagingRing (
+  IN DATA_HUB_INSTANCE    *Private
+  )
+{
+  DATA_HUB_STAGING_SLOT   *Slot;
+  EFI_TIME                LogTime;
+  EFI_STATUS              Status;
+
+  while (Private->StagingTail != Private->StagingHead) {
+    Slot = &Private->StagingRing[Private->StagingTail % DATA_HUB_STAGING_SLOT_COUNT];
+    if (Slot->State != DATA_HUB_STAGING_SLOT_READY) {
+      break;
+    }
+    MemoryFence ();
+
+    GetRecordLogTime (Private, Slot->Counter, &LogTime);
+    Status = AppendDataRecord (
+               Private,
+               &Slot->DataRecordGuid,
+               &Slot->ProducerName,
+               Slot->DataRecordClass,
+               Slot->RawData,
+               Slot->RawDataSize,
+               &LogTime
+               );
+    if (EFI_ERROR (Status)) {
+      InterlockedIncrement (&Private->StagingDropCount);
+    } else {
+      Private->Statistics.StagedRecordCount++;
+    }
+
+    Slot->State = DATA_HUB_STAGING_SLOT_FREE;
+    MemoryFence ();
+    Private->StagingTail++;
+  }
+
+  Private->Statistics.DroppedRecordCount = Private->StagingDropCount;
+}
+
+/**
+  Notification function of the staging drain event. Moves the staged records
+  into the data log at TPL_CALLBACK, and then refreshes the time base, as
+  records are being logged at high TPL.
+
+  @param Event            The staging drain event.
+  @param Context          Data Hub private data.
+
+**/
+VOID
+EFIAPI
+DataHubStagingDrainNotify (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  )
+{
+  DATA_HUB_INSTANCE       *Private;
+  EFI_TIME                Time;
+  UINT64                  Counter;
+
+  Private = (DATA_HUB_INSTANCE *) Context;
+
+  EfiAcquireLock (&Private->DataLock);
+  DrainStagingRing (Private);
+  if (!EFI_ERROR (gRT->GetTime (&Time, NULL))) {
+    Counter = ReadLogTimeCounter (Private);
+    UpdateTimeBase (Private, &Time, Counter);
+  }
+  EfiReleaseLock (&Private->DataLock);
+}
+
+/**
+  Log data record into the data logging hub
 
-  @param Head             Head of Data Log linked list.
+  Records logged above the data lock TPL, or while another record is being
+  logged, are staged in a lock free ring and moved into the data log later
+  at a safe TPL. Their Monotonic Count is assigned at that point, while
+  their log time reflects when they were logged.
+
+  @param This                   Protocol instance structure
+  @param DataRecordGuid         GUID that defines record contents
+  @param ProducerName           GUID that defines the name of the producer of the data
+  @param DataRecordClass        Class that defines generic record type
+  @param RawData                Data Log record as defined by DataRecordGuid
+  @param RawDataSize            Size of Data Log data in bytes
+
+  @retval EFI_SUCCESS           If data was logged
+  @retval EFI_OUT_OF_RESOURCES  If data was not logged due to lack of system 
+                                resources.
+**/
+EFI_STATUS
+EFIAPI
+DataHubLogData (
+  IN  EFI_DATA_HUB_PROTOCOL   *This,
+  IN  EFI_GUID                *DataRecordGuid,
+  IN  EFI_GUID                *ProducerName,
+  IN  UINT64                  DataRecordClass,
+  IN  VOID                    *RawData,
+  IN  UINT32                  RawDataSize
+  )
+{
+  EFI_STATUS              Status;
+  DATA_HUB_INSTANCE       *Private;
+  EFI_TIME                LogTime;
+  EFI_TPL                 CurrentTpl;
+  UINT64                  Counter;
+  BOOLEAN                 TimeValid;
+  BOOLEAN                 CounterRead;
+
+  Private = DATA_HUB_INSTANCE_FROM_THIS (This);
+
+  CurrentTpl = EfiGetCurrentTpl ();
+
+  if (CurrentTpl > TPL_NOTIFY) {
+    //
+    // The data lock cannot be acquired at this TPL.
+    //
+    return StageDataRecord (Private, DataRecordGuid, ProducerName, DataRecordClass, RawData, RawDataSize);
+  }
+
+  //
+  // First try to get log time at TPL level <= TPL_CALLBACK. The performance
+  //  counter is only needed once records are timed above TPL_CALLBACK: to
+  //  extrapolate their log time, or to refresh the time base it is
+  //  extrapolated from.
+  //
+  TimeValid   = FALSE;
+  CounterRead = FALSE;
+  Counter     = 0;
+  if (CurrentTpl <= TPL_CALLBACK) {
+    TimeValid = (BOOLEAN) !EFI_ERROR (gRT->GetTime (&LogTime, NULL));
+    if (TimeValid && Private->CounterUsed) {
+      Counter     = ReadLogTimeCounter (Private);
+      CounterRead = TRUE;
+    }
+  } else {
+    Counter = ReadLogTimeCounter (Private);
+  }
+
+  //
+  // The Logging action is the critical section, so it is locked.
+  //  The MTC asignment & update and logging must be an
+  //  atomic operation, so use the lock.
+  //
+  Status = EfiAcquireLockOrFail (&Private->DataLock);
+  if (EFI_ERROR (Status)) {
+    //
+    // Reentrancy detected, so stage the record instead.
+    //
+    return StageDataRecord (Private, DataRecordGuid, ProducerName, DataRecordClass, RawData, RawDataSize);
+  }
+
+  //
+  // Records staged earlier go into the log first, and are timed with the
+  //  time base they were staged under.
+  //
+  DrainStagingRing (Private);
+
+  if (TimeValid) {
+    if (CounterRead) {
+      UpdateTimeBase (Private, &LogTime, Counter);
+    }
+  } else {
+    GetRecordLogTime (Private, Counter, &LogTime);
+  }
+
+  Status = AppendDataRecord (
+             Private,
+             DataRecordGuid,
+             ProducerName,
+             DataRecordClass,
+             RawData,
+             RawDataSize,
+             &LogTime
+             );
+
+  EfiReleaseLock (&Private->DataLock);
+
+  return Status;
+}
+
+/**
+  Find the first record at or after Start in the record index whose class
+  matches ClassFilter.
+
+  If ClassFilter only contains indexed classes, the per class indexes are
+  binary searched, otherwise the record index is scanned from Start.
+
+  @param Private          Data Hub private data.
+  @param ClassFilter      Only match records in the same Class as the ClassFilter.
+  @param Start            Position in the record index to start searching from.
+  @param Position         Returns the position of the matching record.
+
+  @retval TRUE            A matching record was found.
+  @retval FALSE           No record at or after Start matches ClassFilter.
+
+**/
+BOOLEAN
+FindNextRecordPosition (
+  IN  DATA_HUB_INSTANCE   *Private,
+  IN  UINT64              ClassFilter,
+  IN  UINTN               Start,
+  OUT UINTN               *Position
+  )
+{
+  DATA_HUB_CLASS_INDEX    *ClassIndex;
+  UINTN                   Bit;
+  UINTN                   Low;
+  UINTN                   High;
+  UINTN                   Middle;
+  BOOLEAN                 Found;
+
+  if ((ClassFilter & ~((UINT64) DATA_HUB_INDEXED_CLASS_MASK)) != 0) {
+    for (Low = Start; Low < Private->RecordCount; Low++) {
+      if ((Private->RecordIndex[Low]->Record->DataRecordClass & ClassFilter) != 0) {
+        *Position = Low;
+        return TRUE;
+      }
+    }
+    return FALSE;
+  }
+
+  Found = FALSE;
+  for (Bit = 0; Bit < DATA_HUB_INDEXED_CLASS_COUNT; Bit++) {
+    if ((ClassFilter & LShiftU64 (1, Bit)) == 0) {
+      continue;
+    }
+
+    //
+    // Find the first position in this class that is not below Start
+    //
+    ClassIndex = &Private->ClassIndex[Bit];
+    Low        = 0;
+    High       = ClassIndex->Count;
+    while (Low < High) {
+      Middle = (Low + High) / 2;
+      if (ClassIndex->Position[Middle] < Start) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    if (Low < ClassIndex->Count && (!Found || ClassIndex->Position[Low] < *Position)) {
+      *Position = ClassIndex->Position[Low];
+      Found     = TRUE;
+    }
+  }
+
+  return Found;
+}
+
+/**
+  Look up the passed in MTC in the data log index. Return the matching 
+  record and the MTC of the next record in the same class.
+
+  @param Private          Data Hub private data.
   @param ClassFilter      Only match the MTC if it is in the same Class as the
                           ClassFilter.
   @param PtrCurrentMTC    On IN contians MTC to search for. On OUT contians next
@@ -166,59 +991,44 @@ DataHubLogData (
 **/
 EFI_DATA_RECORD_HEADER *
 GetNextDataRecord (
-  IN  LIST_ENTRY          *Head,
+  IN  DATA_HUB_INSTANCE   *Private,
   IN  UINT64              ClassFilter,
   IN OUT  UINT64          *PtrCurrentMTC
   )
 
 {
-  EFI_DATA_ENTRY          *LogEntry;
-  LIST_ENTRY              *Link;
-  BOOLEAN                 ReturnFirstEntry;
   EFI_DATA_RECORD_HEADER  *Record;
-  EFI_DATA_ENTRY          *NextLogEntry;
-
-  //
-  // If MonotonicCount == 0 just return the first one
-  //
-  ReturnFirstEntry  = (BOOLEAN) (*PtrCurrentMTC == 0);
+  UINTN                   Position;
+  UINTN                   NextPosition;
 
-  Record            = NULL;
-  for (Link = GetFirstNode(Head); Link != Head; Link = GetNextNode(Head, Link)) {
-    LogEntry = DATA_ENTRY_FROM_LINK (Link);
-    if ((LogEntry->Record->DataRecordClass & ClassFilter) == 0) {
-      //
-      // Skip any entry that does not have the correct ClassFilter
-      //
-      continue;
+  if (*PtrCurrentMTC == 0) {
+    //
+    // If MonotonicCount == 0 just return the first one
+    //
+    if (!FindNextRecordPosition (Private, ClassFilter, 0, &Position)) {
+      return NULL;
+    }
+  } else {
+    if ((*PtrCurrentMTC < Private->FirstMonotonicCount) ||
+        (*PtrCurrentMTC - Private->FirstMonotonicCount >= Private->RecordCount)) {
+      return NULL;
     }
+    Position = (UINTN) (*PtrCurrentMTC - Private->FirstMonotonicCount);
+  }
 
-    if ((LogEntry->Record->LogMonotonicCount == *PtrCurrentMTC) || ReturnFirstEntry) {
-      //
-      // Return record to the user
-      //
-      Record = LogEntry->Record;
+  Record = Private->RecordIndex[Position]->Record;
+  ASSERT (Record->LogMonotonicCount == Private->FirstMonotonicCount + Position);
+  if ((Record->DataRecordClass & ClassFilter) == 0) {
+    return NULL;
+  }
 
-      //
-      // Calculate the next MTC value. If there is no next entry set
-      // MTC to zero.
-      //
-      *PtrCurrentMTC = 0;
-      for (Link = GetNextNode(Head, Link); Link != Head; Link = GetNextNode(Head, Link)) {
-        NextLogEntry = DATA_ENTRY_FROM_LINK (Link);
-        if ((NextLogEntry->Record->DataRecordClass & ClassFilter) != 0) {
-          //
-          // Return the MTC of the next thing to search for if found
-          //
-          *PtrCurrentMTC = NextLogEntry->Record->LogMonotonicCount;
-          break;
-        }
-      }
-      //
-      // Record found exit loop and return
-      //
-      break;
-    }
+  //
+  // Calculate the next MTC value. If there is no next entry set
+  // MTC to zero.
+  //
+  *PtrCurrentMTC = 0;
+  if (FindNextRecordPosition (Private, ClassFilter, Position + 1, &NextPosition)) {
+    *PtrCurrentMTC = Private->RecordIndex[NextPosition]->Record->LogMonotonicCount;
   }
 
   return Record;
@@ -256,6 +1066,8 @@ FindFilterDriverByEvent (
 
 /**
 
+  Worker function of DataHubGetNextRecord, called with the data lock held.
+
   Get a previously logged data record and the MonotonicCount for the next
   availible Record. This allows all records or all records later 
   than a give MonotonicCount to be returned. If an optional FilterDriverEvent
@@ -263,7 +1075,7 @@ FindFilterDriverByEvent (
   not yet read by the filter driver. If FilterDriverEvent is NULL and 
   MonotonicCount is zero return the first data record.
 
-  @param This                     Pointer to the EFI_DATA_HUB_PROTOCOL instance.
+  @param Private                  Data Hub private data.
   @param MonotonicCount           Specifies the Record to return. On input, zero means
                                   return the first record. On output, contains the next
                                   record to availible. Zero indicates no more records.
@@ -284,20 +1096,16 @@ FindFilterDriverByEvent (
 
 **/
 EFI_STATUS
-EFIAPI
-DataHubGetNextRecord (
-  IN EFI_DATA_HUB_PROTOCOL            *This,
+GetNextRecordWorker (
+  IN DATA_HUB_INSTANCE                *Private,
   IN OUT UINT64                       *MonotonicCount,
   IN EFI_EVENT                        *FilterDriverEvent, OPTIONAL
   OUT EFI_DATA_RECORD_HEADER          **Record
   )
 {
-  DATA_HUB_INSTANCE       *Private;
   DATA_HUB_FILTER_DRIVER  *FilterDriver;
   UINT64                  ClassFilter;
 
-  Private               = DATA_HUB_INSTANCE_FROM_THIS (This);
-
   FilterDriver          = NULL;
   ClassFilter = EFI_DATA_RECORD_CLASS_DEBUG |
     EFI_DATA_RECORD_CLASS_ERROR |
@@ -308,7 +1116,7 @@ DataHubGetNextRecord (
   // If FilterDriverEvent is NULL, then return the next record
   //
   if (FilterDriverEvent == NULL) {
-    *Record = GetNextDataRecord (&Private->DataListHead, ClassFilter, MonotonicCount);
+    *Record = GetNextDataRecord (Private, ClassFilter, MonotonicCount);
     if (*Record == NULL) {
       return EFI_NOT_FOUND;
     }
@@ -336,7 +1144,7 @@ DataHubGetNextRecord (
   // Retrieve the next record or the first record.
   //   
   if (*MonotonicCount != 0 || FilterDriver->GetNextMonotonicCount == 0) { 
-    *Record = GetNextDataRecord (&Private->DataListHead, ClassFilter, MonotonicCount);
+    *Record = GetNextDataRecord (Private, ClassFilter, MonotonicCount);
     if (*Record == NULL) {
       return EFI_NOT_FOUND;
     }
@@ -365,7 +1173,7 @@ DataHubGetNextRecord (
   // Retrieve the last record successfuly read again, but do not return it since
   // it has already been returned before.
   //
-  *Record = GetNextDataRecord (&Private->DataListHead, ClassFilter, MonotonicCount);
+  *Record = GetNextDataRecord (Private, ClassFilter, MonotonicCount);
   if (*Record == NULL) {
     return EFI_NOT_FOUND;
   }
@@ -379,7 +1187,7 @@ DataHubGetNextRecord (
     //
     // Retrieve the record after the last record successfuly read 
     //  
-    *Record = GetNextDataRecord (&Private->DataListHead, ClassFilter, MonotonicCount);
+    *Record = GetNextDataRecord (Private, ClassFilter, MonotonicCount);
     if (*Record == NULL) {
       return EFI_NOT_FOUND;
     }
@@ -388,6 +1196,60 @@ DataHubGetNextRecord (
   return EFI_SUCCESS;
 }
 
+/**
+
+  Get a previously logged data record and the MonotonicCount for the next
+  availible Record. This allows all records or all records later 
+  than a give MonotonicCount to be returned. If an optional FilterDriverEvent
+  is passed in with a MonotonicCout of zero return the first record 
+  not yet read by the filter driver. If FilterDriverEvent is NULL and 
+  MonotonicCount is zero return the first data record.
+
+  @param This                     Pointer to the EFI_DATA_HUB_PROTOCOL instance.
+  @param MonotonicCount           Specifies the Record to return. On input, zero means
+                                  return the first record. On output, contains the next
+                                  record to availible. Zero indicates no more records.
+  @param FilterDriverEvent        If FilterDriverEvent is not passed in a MonotonicCount 
+                                  of zero, it means to return the first data record. 
+                                  If FilterDriverEvent is passed in, then a MonotonicCount 
+                                  of zero means to return the first data not yet read by 
+                                  FilterDriverEvent.
+  @param Record                   Returns a dynamically allocated memory buffer with a data 
+                                  record that matches MonotonicCount.
+
+  @retval EFI_SUCCESS             Data was returned in Record.
+  @retval EFI_INVALID_PARAMETER   FilterDriverEvent was passed in but does not exist.
+  @retval EFI_NOT_FOUND           MonotonicCount does not match any data record in the
+                                  system. If a MonotonicCount of zero was passed in, then
+                                  no data records exist in the system.
+  @retval EFI_OUT_OF_RESOURCES    Record was not returned due to lack of system resources.
+
+**/
+EFI_STATUS
+EFIAPI
+DataHubGetNextRecord (
+  IN EFI_DATA_HUB_PROTOCOL            *This,
+  IN OUT UINT64                       *MonotonicCount,
+  IN EFI_EVENT                        *FilterDriverEvent, OPTIONAL
+  OUT EFI_DATA_RECORD_HEADER          **Record
+  )
+{
+  EFI_STATUS              Status;
+  DATA_HUB_INSTANCE       *Private;
+
+  Private = DATA_HUB_INSTANCE_FROM_THIS (This);
+
+  //
+  // The record indexes may be reallocated by DataHubLogData, so hold
+  //  the lock while they are searched.
+  //
+  EfiAcquireLock (&Private->DataLock);
+  Status = GetNextRecordWorker (Private, MonotonicCount, FilterDriverEvent, Record);
+  EfiReleaseLock (&Private->DataLock);
+
+  return Status;
+}
+
 /**
   This function registers the data hub filter driver that is represented 
   by FilterEvent. Only one instance of each FilterEvent can be registered.
@@ -468,6 +1330,7 @@ DataHubRegisterFilterDriver (
   //
   EfiAcquireLock (&Private->DataLock);
   InsertTailList (&Private->FilterDriverListHead, &FilterDriver->Link);
+  UpdateFilterDriverBuckets (Private, FilterDriver, TRUE);
   EfiReleaseLock (&Private->DataLock);
 
   //
@@ -520,6 +1383,7 @@ DataHubUnregisterFilterDriver (
   //
   EfiAcquireLock (&Private->DataLock);
   RemoveEntryList (&FilterDriver->Link);
+  UpdateFilterDriverBuckets (Private, FilterDriver, FALSE);
   EfiReleaseLock (&Private->DataLock);
 
   return EFI_SUCCESS;
@@ -546,6 +1410,8 @@ DataHubInstall (
 {
   EFI_STATUS  Status;
   UINT32      HighMontonicCount;
+  UINTN       Bit;
+  UINTN       Index;
 
   mPrivateData.Signature                      = DATA_HUB_INSTANCE_SIGNATURE;
   mPrivateData.DataHub.LogData                = DataHubLogData;
@@ -559,9 +1425,37 @@ DataHubInstall (
   //
   InitializeListHead (&mPrivateData.DataListHead);
   InitializeListHead (&mPrivateData.FilterDriverListHead);
+  InitializeListHead (&mPrivateData.OtherClassFilterListHead);
+  for (Bit = 0; Bit < DATA_HUB_INDEXED_CLASS_COUNT; Bit++) {
+    InitializeListHead (&mPrivateData.FilterBucket[Bit].AnyGuidListHead);
+    for (Index = 0; Index < DATA_HUB_FILTER_GUID_HASH_SIZE; Index++) {
+      InitializeListHead (&mPrivateData.FilterBucket[Bit].GuidListHead[Index]);
+    }
+  }
 
   EfiInitializeLock (&mPrivateData.DataLock, TPL_NOTIFY);
 
+  //
+  // The staging ring is allocated up front, because records are staged
+  //  at TPLs where memory cannot be allocated.
+  //
+  mPrivateData.StagingRing = AllocateZeroPool (DATA_HUB_STAGING_SLOT_COUNT * sizeof (DATA_HUB_STAGING_SLOT));
+  ASSERT (mPrivateData.StagingRing != NULL);
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  DataHubStagingDrainNotify,
+                  &mPrivateData,
+                  &mPrivateData.StagingDrainEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  InitializeListHead (&mPrivateData.ArenaChunkListHead);
+  mPrivateData.CurrentChunk              = NULL;
+  mPrivateData.Statistics.Revision       = DATA_HUB_STATISTICS_PROTOCOL_REVISION;
+  mPrivateData.Statistics.ArenaChunkSize = PcdGet32 (PcdDataHubArenaChunkSize);
+  ASSERT (mPrivateData.Statistics.ArenaChunkSize >= EFI_PAGE_SIZE);
+
   //
   // Make sure we get a bigger MTC number on every boot!
   //
@@ -574,15 +1468,22 @@ DataHubInstall (
   } else {
     mPrivateData.GlobalMonotonicCount = LShiftU64 ((UINT64) HighMontonicCount, 32);
   }
+
+  //
+  // Monotonic Count is pre-incremented, so the first record gets the next one.
+  //
+  mPrivateData.FirstMonotonicCount = mPrivateData.GlobalMonotonicCount + 1;
   //
   // Make a new handle and install the protocol
   //
   mPrivateData.Handle = NULL;
-  Status = gBS->InstallProtocolInterface (
+  Status = gBS->InstallMultipleProtocolInterfaces (
                   &mPrivateData.Handle,
                   &gEfiDataHubProtocolGuid,
-                  EFI_NATIVE_INTERFACE,
-                  &mPrivateData.DataHub
+                  &mPrivateData.DataHub,
+                  &gDataHubStatisticsProtocolGuid,
+                  &mPrivateData.Statistics,
+                  NULL
                   );
   return Status;
 }
@@ -20,6 +20,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <FrameworkDxe.h>
 
 #include <Protocol/DataHub.h>
+#include <Protocol/DataHubStatistics.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
@@ -27,9 +28,116 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 
+//
+// Private data structure to contain the data log. One record per
+//  structure. Head pointer to the list is the Log member of
+//  EFI_DATA_ENTRY. Record is a copy of the data passed in. The
+//  structures are carved out of DATA_HUB_ARENA_CHUNK storage.
+//
+#define EFI_DATA_ENTRY_SIGNATURE  SIGNATURE_32 ('D', 'r', 'e', 'c')
+typedef struct {
+  UINT32                  Signature;
+  LIST_ENTRY              Link;
+
+  EFI_DATA_RECORD_HEADER  *Record;
+
+  UINTN                   RecordSize;
+
+} EFI_DATA_ENTRY;
+
+#define DATA_ENTRY_FROM_LINK(link)  CR (link, EFI_DATA_ENTRY, Link, EFI_DATA_ENTRY_SIGNATURE)
+
+//
+// Number of low DataRecordClass bits that get their own position index.
+//  They cover the four classes defined by the Data Hub specification.
+//
+#define DATA_HUB_INDEXED_CLASS_COUNT  4
+#define DATA_HUB_INDEXED_CLASS_MASK   (EFI_DATA_RECORD_CLASS_DEBUG | \
+                                       EFI_DATA_RECORD_CLASS_ERROR | \
+                                       EFI_DATA_RECORD_CLASS_DATA  | \
+                                       EFI_DATA_RECORD_CLASS_PROGRESS_CODE)
+
+//
+// Initial number of slots in the record and class indexes. The indexes
+//  double in size each time they fill up.
+//
+#define DATA_HUB_INDEX_INITIAL_COUNT  64
+
+//
+// Sorted list of positions in the record index of all the records that
+//  belong to one data record class.
+//
+typedef struct {
+  UINTN                 *Position;
+  UINTN                 Count;
+  UINTN                 MaxCount;
+} DATA_HUB_CLASS_INDEX;
+
+//
+// Number of GUID hash buckets per class for filter drivers that filter on
+//  a data record GUID. Must be a power of two.
+//
+#define DATA_HUB_FILTER_GUID_HASH_SIZE  16
+#define DATA_HUB_FILTER_GUID_HASH(Guid) \
+  ((UINTN) ((Guid)->Data1 & (DATA_HUB_FILTER_GUID_HASH_SIZE - 1)))
+
+//
+// Registered filter drivers that are interested in one data record class.
+//  Filter drivers without a FilterDataRecordGuid are on AnyGuidListHead,
+//  the others are hashed by FilterDataRecordGuid.
+//
+typedef struct {
+  LIST_ENTRY            AnyGuidListHead;
+  LIST_ENTRY            GuidListHead[DATA_HUB_FILTER_GUID_HASH_SIZE];
+} DATA_HUB_FILTER_BUCKET;
+
+//
+// Chunk of the record storage arena. Log entries are packed back to back
+//  in the storage that follows the chunk header.
+//
+#define DATA_HUB_ARENA_CHUNK_SIGNATURE  SIGNATURE_32 ('D', 'h', 'A', 'c')
+typedef struct {
+  UINT32                Signature;
+  LIST_ENTRY            Link;
+
+  //
+  // Number of bytes of storage in the chunk, and number of them in use.
+  //
+  UINTN                 Size;
+  UINTN                 Used;
+} DATA_HUB_ARENA_CHUNK;
+
+//
+// Number of slots in the staging ring, and the largest RawData a slot holds.
+//  Must be a power of two, so the slot index stays right when the 32-bit
+//  head and tail counters wrap.
+//
+#define DATA_HUB_STAGING_SLOT_COUNT   32
+#define DATA_HUB_STAGING_DATA_SIZE    256
+
+#define DATA_HUB_STAGING_SLOT_FREE    0
+#define DATA_HUB_STAGING_SLOT_READY   1
+
+//
+// Slot of the staging ring. Holds a copy of a record logged at a TPL where
+//  it cannot be put into the data log directly.
+//
+typedef struct {
+  volatile UINT32       State;
+  UINT32                RawDataSize;
+  UINT64                DataRecordClass;
+  UINT64                Counter;
+  EFI_GUID              DataRecordGuid;
+  EFI_GUID              ProducerName;
+  UINT8                 RawData[DATA_HUB_STAGING_DATA_SIZE];
+} DATA_HUB_STAGING_SLOT;
+
 #define DATA_HUB_INSTANCE_SIGNATURE SIGNATURE_32 ('D', 'H', 'u', 'b')
 typedef struct {
   UINT32                Signature;
@@ -45,8 +153,8 @@ typedef struct {
   // Private Data
   //
   //
-  // Updates to GlobalMonotonicCount, LogListHead, and FilterDriverListHead
-  //  must be locked.
+  // Updates to GlobalMonotonicCount, LogListHead, FilterDriverListHead and
+  //  the record indexes must be locked.
   //
   EFI_LOCK              DataLock;
 
@@ -63,32 +171,77 @@ typedef struct {
   LIST_ENTRY            DataListHead;
 
   //
-  // List of EFI_DATA_HUB_FILTER_DRIVER structures. Represents all
-  //  the registered filter drivers.
+  // Monotonic Count of the first record logged in this boot. Because the
+  //  Monotonic Count is incremented by one for every record, the record with
+  //  Monotonic Count MTC lives at RecordIndex[MTC - FirstMonotonicCount].
   //
-  LIST_ENTRY            FilterDriverListHead;
+  UINT64                FirstMonotonicCount;
+  EFI_DATA_ENTRY        **RecordIndex;
+  UINTN                 RecordCount;
+  UINTN                 MaxRecordCount;
 
-} DATA_HUB_INSTANCE;
+  //
+  // Per class position indexes, so a class filtered search can jump to the
+  //  next matching record instead of testing every record in between.
+  //
+  DATA_HUB_CLASS_INDEX  ClassIndex[DATA_HUB_INDEXED_CLASS_COUNT];
 
-#define DATA_HUB_INSTANCE_FROM_THIS(this) CR (this, DATA_HUB_INSTANCE, DataHub, DATA_HUB_INSTANCE_SIGNATURE)
+  //
+  // List of DATA_HUB_ARENA_CHUNK structures that hold the log entries,
+  //  and the chunk new entries are carved from.
+  //
+  LIST_ENTRY            ArenaChunkListHead;
+  DATA_HUB_ARENA_CHUNK  *CurrentChunk;
 
-//
-// Private data structure to contain the data log. One record per
-//  structure. Head pointer to the list is the Log member of
-//  EFI_DATA_ENTRY. Record is a copy of the data passed in.
-//
-#define EFI_DATA_ENTRY_SIGNATURE  SIGNATURE_32 ('D', 'r', 'e', 'c')
-typedef struct {
-  UINT32                  Signature;
-  LIST_ENTRY              Link;
+  //
+  // Lock free ring of records logged above TPL_NOTIFY or while the data lock
+  //  is held. Producers reserve slots by advancing StagingHead, the drain
+  //  advances StagingTail with the data lock held.
+  //
+  DATA_HUB_STAGING_SLOT *StagingRing;
+  volatile UINT32       StagingHead;
+  volatile UINT32       StagingTail;
+  volatile UINT32       StagingDropCount;
+  EFI_EVENT             StagingDrainEvent;
 
-  EFI_DATA_RECORD_HEADER  *Record;
+  //
+  // Last time read through gRT->GetTime() and the performance counter value
+  //  when it was read. Log times at high TPL are extrapolated from it. The
+  //  time base is only refreshed once a record has been logged above
+  //  TPL_CALLBACK, which sets CounterUsed. Without a performance counter
+  //  (PcdDataHubUsePerformanceCounter is FALSE) the counter values are zero
+  //  and the time base is used as is.
+  //
+  EFI_TIME              TimeBase;
+  UINT64                TimeBaseCounter;
+  BOOLEAN               TimeBaseValid;
+  BOOLEAN               CounterUsed;
+  UINT64                CounterStartValue;
+  UINT64                CounterEndValue;
 
-  UINTN                   RecordSize;
+  //
+  // Counters published through the Data Hub Statistics protocol.
+  //
+  DATA_HUB_STATISTICS_PROTOCOL  Statistics;
 
-} EFI_DATA_ENTRY;
+  //
+  // List of EFI_DATA_HUB_FILTER_DRIVER structures. Represents all
+  //  the registered filter drivers.
+  //
+  LIST_ENTRY            FilterDriverListHead;
 
-#define DATA_ENTRY_FROM_LINK(link)  CR (link, EFI_DATA_ENTRY, Link, EFI_DATA_ENTRY_SIGNATURE)
+  //
+  // Filter drivers bucketed by the indexed classes in their ClassFilter, so
+  //  a new record only visits the filter drivers it may have to signal.
+  //  Filter drivers that also filter on other classes are kept on
+  //  OtherClassFilterListHead.
+  //
+  DATA_HUB_FILTER_BUCKET  FilterBucket[DATA_HUB_INDEXED_CLASS_COUNT];
+  LIST_ENTRY            OtherClassFilterListHead;
+
+} DATA_HUB_INSTANCE;
+
+#define DATA_HUB_INSTANCE_FROM_THIS(this) CR (this, DATA_HUB_INSTANCE, DataHub, DATA_HUB_INSTANCE_SIGNATURE)
 
 //
 // Private data to contain the filter driver Event and it's
@@ -122,8 +275,23 @@ typedef struct {
   //
   EFI_GUID        FilterDataRecordGuid;
 
+  //
+  // Links into the class buckets of DATA_HUB_INSTANCE.
+  //
+  LIST_ENTRY      ClassLink[DATA_HUB_INDEXED_CLASS_COUNT];
+  LIST_ENTRY      OtherClassLink;
+
+  //
+  // Monotonic count of the last record Event was signaled for.
+  //
+  UINT64          SignalMonotonicCount;
+
 } DATA_HUB_FILTER_DRIVER;
 
 #define FILTER_ENTRY_FROM_LINK(link)  CR (link, DATA_HUB_FILTER_DRIVER, Link, EFI_DATA_HUB_FILTER_DRIVER_SIGNATURE)
+#define FILTER_ENTRY_FROM_CLASS_LINK(link, Bit) \
+  CR ((link) - (Bit), DATA_HUB_FILTER_DRIVER, ClassLink, EFI_DATA_HUB_FILTER_DRIVER_SIGNATURE)
+#define FILTER_ENTRY_FROM_OTHER_CLASS_LINK(link) \
+  CR (link, DATA_HUB_FILTER_DRIVER, OtherClassLink, EFI_DATA_HUB_FILTER_DRIVER_SIGNATURE)
 
 #endif
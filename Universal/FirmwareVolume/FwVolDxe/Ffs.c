@@ -89,31 +89,45 @@ Buffer2LbaEntry (
   )
 {
   LBA_ENTRY   *LbaEntry;
-  LIST_ENTRY  *Link;
+  UINTN       Offset;
+  UINTN       Low;
+  UINTN       High;
+  UINTN       Middle;
 
-  Link      = FvDevice->LbaHeader.ForwardLink;
-  LbaEntry  = (LBA_ENTRY *) Link;
+  if ((BufferAddress < FvDevice->CachedFv) || (FvDevice->LbaCount == 0)) {
+    return EFI_NOT_FOUND;
+  }
 
-  //
-  // Locate LBA which contains the address
-  //
-  while (&LbaEntry->Link != &FvDevice->LbaHeader) {
-    if ((EFI_PHYSICAL_ADDRESS) (UINTN) (LbaEntry->StartingAddress) > BufferAddress) {
-      break;
+  Offset = (UINTN) (BufferAddress - FvDevice->CachedFv);
+
+  if (FvDevice->UniformBlockLength != 0) {
+    //
+    // All blocks have the same length, so the index follows from the offset
+    //
+    if (Offset / FvDevice->UniformBlockLength >= FvDevice->LbaCount) {
+      return EFI_NOT_FOUND;
     }
 
-    Link      = LbaEntry->Link.ForwardLink;
-    LbaEntry  = (LBA_ENTRY *) Link;
+    *LbaListEntry = &FvDevice->LbaTable[Offset / FvDevice->UniformBlockLength];
+    return EFI_SUCCESS;
   }
 
-  if (&LbaEntry->Link == &FvDevice->LbaHeader) {
-    return EFI_NOT_FOUND;
+  //
+  // Locate LBA which contains the address, the table is in address order
+  //
+  Low   = 0;
+  High  = FvDevice->LbaCount;
+  while (High - Low > 1) {
+    Middle = Low + (High - Low) / 2;
+    if ((EFI_PHYSICAL_ADDRESS) (UINTN) (FvDevice->LbaTable[Middle].StartingAddress) > BufferAddress) {
+      High = Middle;
+    } else {
+      Low  = Middle;
+    }
   }
 
-  Link      = LbaEntry->Link.BackLink;
-  LbaEntry  = (LBA_ENTRY *) Link;
-
-  if (&LbaEntry->Link == &FvDevice->LbaHeader) {
+  LbaEntry = &FvDevice->LbaTable[Low];
+  if ((EFI_PHYSICAL_ADDRESS) (UINTN) (LbaEntry->StartingAddress + LbaEntry->BlockLength) <= BufferAddress) {
     return EFI_NOT_FOUND;
   }
 
@@ -457,10 +471,19 @@ DuplicateFileExist (
       break;
     }
 
+    if (EFI_ERROR (FvCacheRange (FvDevice, Ptr, sizeof (EFI_FFS_FILE_HEADER2)))) {
+      break;
+    }
+
     if (!IsValidFFSHeader (FvDevice->ErasePolarity, NextFfsFile)) {
       continue;
     }
 
+    if (((NextFfsFile->Attributes & FFS_ATTRIB_CHECKSUM) != 0) &&
+        EFI_ERROR (FvCacheFfsFile (FvDevice, NextFfsFile))) {
+      break;
+    }
+
     if (!VerifyFileChecksum (NextFfsFile)) {
       continue;
     }
@@ -493,15 +516,27 @@ UpdateHeaderBit (
   IN EFI_FFS_FILE_STATE   State
   )
 {
-  EFI_STATUS  Status;
-  EFI_LBA     Lba;
-  UINTN       Offset;
-  UINTN       NumBytesWritten;
+  EFI_STATUS          Status;
+  EFI_LBA             Lba;
+  UINTN               Offset;
+  UINTN               NumBytesWritten;
+  EFI_FFS_FILE_HEADER *StateHeader;
+  EFI_FFS_FILE_HEADER MappedHeader;
 
   Lba    = 0;
   Offset = 0;
 
-  SetFileState (State, FfsHeader);
+  //
+  // The memory mapped FV must not be written directly, the FVB write
+  // below updates it.
+  //
+  StateHeader = FfsHeader;
+  if (FvDevice->IsCacheMapped) {
+    CopyMem (&MappedHeader, FfsHeader, sizeof (EFI_FFS_FILE_HEADER));
+    StateHeader = &MappedHeader;
+  }
+
+  SetFileState (State, StateHeader);
 
   Buffer2Lba (
     FvDevice,
@@ -518,7 +553,7 @@ UpdateHeaderBit (
                             Lba,
                             Offset,
                             &NumBytesWritten,
-                            &FfsHeader->State
+                            &StateHeader->State
                             );
   return Status;
 }
@@ -545,6 +580,14 @@ IsValidFFSFile (
 
   ErasePolarity = FvDevice->ErasePolarity;
 
+  //
+  // The file data is needed to verify its checksum
+  //
+  if (((FfsHeader->Attributes & FFS_ATTRIB_CHECKSUM) != 0) &&
+      EFI_ERROR (FvCacheFfsFile (FvDevice, FfsHeader))) {
+    return FALSE;
+  }
+
   FileState     = GetFileState (ErasePolarity, FfsHeader);
 
   switch (FileState) {
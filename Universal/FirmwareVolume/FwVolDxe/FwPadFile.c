@@ -205,11 +205,12 @@ FvCreatePadFileInFreeSpace (
   //
   // If successfully, insert an FfsFileEntry at the end of ffs file list
   //
-  FfsFileEntry = AllocateZeroPool (sizeof (FFS_FILE_LIST_ENTRY));
+  FfsFileEntry = FvAllocateFfsFileEntry (FvDevice);
   ASSERT (FfsFileEntry != NULL);
 
   FfsFileEntry->FfsHeader = (UINT8 *) (UINTN) StartPos;
   InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+  FvAddFfsFileEntryToIndex (FvDevice, FfsFileEntry);
 
   *PadFileEntry             = FfsFileEntry;
   FvDevice->CurrentFfsFile  = FfsFileEntry;
@@ -376,11 +377,13 @@ FvAdjustFfsFile (
 /**
   Free File List entry pointed by FileListHead.
 
+  @param FvDevice         Firmware Volume Device.
   @param FileListHeader   FileListEntry Header.
 
 **/
 VOID
 FreeFileList (
+  IN  FV_DEVICE   *FvDevice,
   IN  LIST_ENTRY  *FileListHead
   )
 {
@@ -394,7 +397,7 @@ FreeFileList (
   //
   while (&FfsFileEntry->Link != FileListHead) {
     NextEntry = (&FfsFileEntry->Link)->ForwardLink;
-    FreePool (FfsFileEntry);
+    FvFreeFfsFileEntry (FvDevice, FfsFileEntry);
     FfsFileEntry = (FFS_FILE_LIST_ENTRY *) NextEntry;
   }
 
@@ -442,6 +445,7 @@ FvCreateNewFileInsidePadFile (
   UINTN                               NumBytesWritten;
   UINT8                               *StartPos;
   LIST_ENTRY                          NewFileList;
+  LIST_ENTRY                          *Link;
   FFS_FILE_LIST_ENTRY                 *NewFileListEntry;
   FFS_FILE_LIST_ENTRY                 *FfsEntry;
   FFS_FILE_LIST_ENTRY                 *NextFfsEntry;
@@ -508,7 +512,7 @@ FvCreateNewFileInsidePadFile (
     // Insert a PAD file before to achieve required alignment
     //
     FvFillPadFile (PadFileHeader, PadSize);
-    NewFileListEntry            = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+    NewFileListEntry            = FvAllocateFfsFileEntry (FvDevice);
     ASSERT (NewFileListEntry   != NULL);
     NewFileListEntry->FfsHeader = (UINT8 *) PadFileHeader;
     InsertTailList (&NewFileList, &NewFileListEntry->Link);
@@ -526,11 +530,11 @@ FvCreateNewFileInsidePadFile (
             FileAttributes
             );
   if (EFI_ERROR (Status)) {
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     return Status;
   }
 
-  NewFileListEntry            = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+  NewFileListEntry            = FvAllocateFfsFileEntry (FvDevice);
   ASSERT (NewFileListEntry   != NULL);
 
   NewFileListEntry->FfsHeader = (UINT8 *) FileHeader;
@@ -546,7 +550,7 @@ FvCreateNewFileInsidePadFile (
       TailPadFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) FileHeader + BufferSize);
       FvFillPadFile (TailPadFileHeader, PadAreaLength - BufferSize - PadSize);
 
-      NewFileListEntry            = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+      NewFileListEntry            = FvAllocateFfsFileEntry (FvDevice);
       ASSERT (NewFileListEntry   != NULL);
 
       NewFileListEntry->FfsHeader = (UINT8 *) TailPadFileHeader;
@@ -582,7 +586,7 @@ FvCreateNewFileInsidePadFile (
             StartPos
             );
   if (EFI_ERROR (Status)) {
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     FvDevice->CurrentFfsFile = NULL;
     return Status;
   }
@@ -606,7 +610,7 @@ FvCreateNewFileInsidePadFile (
             );
   if (EFI_ERROR (Status)) {
     SetFileState (EFI_FILE_HEADER_INVALID, OldPadFileHeader);
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     FvDevice->CurrentFfsFile = NULL;
     return Status;
   }
@@ -621,13 +625,21 @@ FvCreateNewFileInsidePadFile (
   FfsEntry      = (FFS_FILE_LIST_ENTRY *) PadFileEntry->Link.BackLink;
   NextFfsEntry  = (FFS_FILE_LIST_ENTRY *) PadFileEntry->Link.ForwardLink;
 
-  FreePool (PadFileEntry);
+  FvRemoveFfsFileEntryFromIndex (PadFileEntry);
+  FvFreeFfsFileEntry (FvDevice, PadFileEntry);
 
   FfsEntry->Link.ForwardLink          = NewFileList.ForwardLink;
   (NewFileList.ForwardLink)->BackLink = &FfsEntry->Link;
   NextFfsEntry->Link.BackLink         = NewFileList.BackLink;
   (NewFileList.BackLink)->ForwardLink = &NextFfsEntry->Link;
 
+  //
+  // Index the new entries now that they are in the file list
+  //
+  for (Link = FfsEntry->Link.ForwardLink; Link != &NextFfsEntry->Link; Link = Link->ForwardLink) {
+    FvAddFfsFileEntryToIndex (FvDevice, (FFS_FILE_LIST_ENTRY *) Link);
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -691,6 +703,7 @@ FvCreateMultipleFilesInsidePadFile (
   UINTN                               TotalSize;
   UINTN                               PadAreaLength;
   LIST_ENTRY                          NewFileList;
+  LIST_ENTRY                          *Link;
   FFS_FILE_LIST_ENTRY                 *NewFileListEntry;
   UINTN                               Offset;
   UINTN                               NumBytesWritten;
@@ -731,9 +744,9 @@ FvCreateMultipleFilesInsidePadFile (
   for (Index = 0; Index < NumOfFiles; Index++) {
     if (PadSize[Index] != 0) {
       FvFillPadFile (PadFileHeader, PadSize[Index]);
-      NewFileListEntry = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+      NewFileListEntry = FvAllocateFfsFileEntry (FvDevice);
       if (NewFileListEntry == NULL) {
-        FreeFileList (&NewFileList);
+        FreeFileList (FvDevice, &NewFileList);
         return EFI_OUT_OF_RESOURCES;
       }
 
@@ -752,13 +765,13 @@ FvCreateMultipleFilesInsidePadFile (
               FileData[Index].FileAttributes
               );
     if (EFI_ERROR (Status)) {
-      FreeFileList (&NewFileList);
+      FreeFileList (FvDevice, &NewFileList);
       return Status;
     }
 
-    NewFileListEntry = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+    NewFileListEntry = FvAllocateFfsFileEntry (FvDevice);
     if (NewFileListEntry == NULL) {
-      FreeFileList (&NewFileList);
+      FreeFileList (FvDevice, &NewFileList);
       return EFI_OUT_OF_RESOURCES;
     }
 
@@ -782,9 +795,9 @@ FvCreateMultipleFilesInsidePadFile (
       TailPadFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) FileHeader + BufferSize[NumOfFiles - 1]);
       FvFillPadFile (TailPadFileHeader, PadAreaLength - TotalSize);
 
-      NewFileListEntry = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+      NewFileListEntry = FvAllocateFfsFileEntry (FvDevice);
       if (NewFileListEntry == NULL) {
-        FreeFileList (&NewFileList);
+        FreeFileList (FvDevice, &NewFileList);
         FvDevice->CurrentFfsFile = NULL;
         return EFI_OUT_OF_RESOURCES;
       }
@@ -822,7 +835,7 @@ FvCreateMultipleFilesInsidePadFile (
             StartPos
             );
   if (EFI_ERROR (Status)) {
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     FvDevice->CurrentFfsFile = NULL;
     return Status;
   }
@@ -833,7 +846,7 @@ FvCreateMultipleFilesInsidePadFile (
             EFI_FILE_HEADER_INVALID
             );
   if (EFI_ERROR (Status)) {
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     FvDevice->CurrentFfsFile = NULL;
     return Status;
   }
@@ -848,13 +861,21 @@ FvCreateMultipleFilesInsidePadFile (
   FfsEntry      = (FFS_FILE_LIST_ENTRY *) PadFileEntry->Link.BackLink;
   NextFfsEntry  = (FFS_FILE_LIST_ENTRY *) PadFileEntry->Link.ForwardLink;
 
-  FreePool (PadFileEntry);
+  FvRemoveFfsFileEntryFromIndex (PadFileEntry);
+  FvFreeFfsFileEntry (FvDevice, PadFileEntry);
 
   FfsEntry->Link.ForwardLink          = NewFileList.ForwardLink;
   (NewFileList.ForwardLink)->BackLink = &FfsEntry->Link;
   NextFfsEntry->Link.BackLink         = NewFileList.BackLink;
   (NewFileList.BackLink)->ForwardLink = &NextFfsEntry->Link;
 
+  //
+  // Index the new entries now that they are in the file list
+  //
+  for (Link = FfsEntry->Link.ForwardLink; Link != &NextFfsEntry->Link; Link = Link->ForwardLink) {
+    FvAddFfsFileEntryToIndex (FvDevice, (FFS_FILE_LIST_ENTRY *) Link);
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -894,6 +915,7 @@ FvCreateMultipleFilesInsideFreeSpace (
   EFI_FFS_FILE_HEADER                 *FileHeader;
   UINTN                               TotalSize;
   LIST_ENTRY                          NewFileList;
+  LIST_ENTRY                          *Link;
   FFS_FILE_LIST_ENTRY                 *NewFileListEntry;
   UINTN                               Offset;
   UINTN                               NumBytesWritten;
@@ -911,9 +933,9 @@ FvCreateMultipleFilesInsideFreeSpace (
   for (Index = 0; Index < NumOfFiles; Index++) {
     if (PadSize[Index] != 0) {
       FvFillPadFile (PadFileHeader, PadSize[Index]);
-      NewFileListEntry = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+      NewFileListEntry = FvAllocateFfsFileEntry (FvDevice);
       if (NewFileListEntry == NULL) {
-        FreeFileList (&NewFileList);
+        FreeFileList (FvDevice, &NewFileList);
         return EFI_OUT_OF_RESOURCES;
       }
 
@@ -932,13 +954,13 @@ FvCreateMultipleFilesInsideFreeSpace (
               FileData[Index].FileAttributes
               );
     if (EFI_ERROR (Status)) {
-      FreeFileList (&NewFileList);
+      FreeFileList (FvDevice, &NewFileList);
       return Status;
     }
 
-    NewFileListEntry = AllocatePool (sizeof (FFS_FILE_LIST_ENTRY));
+    NewFileListEntry = FvAllocateFfsFileEntry (FvDevice);
     if (NewFileListEntry == NULL) {
-      FreeFileList (&NewFileList);
+      FreeFileList (FvDevice, &NewFileList);
       return EFI_OUT_OF_RESOURCES;
     }
 
@@ -951,7 +973,7 @@ FvCreateMultipleFilesInsideFreeSpace (
   }
 
   if (FreeSpaceEntry->Length < TotalSize) {
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     return EFI_OUT_OF_RESOURCES;
   }
 
@@ -970,7 +992,7 @@ FvCreateMultipleFilesInsideFreeSpace (
             StartPos
             );
   if (EFI_ERROR (Status)) {
-    FreeFileList (&NewFileList);
+    FreeFileList (FvDevice, &NewFileList);
     FvDevice->CurrentFfsFile = NULL;
     return Status;
   }
@@ -981,8 +1003,13 @@ FvCreateMultipleFilesInsideFreeSpace (
   NewFileListEntry = (FFS_FILE_LIST_ENTRY *) (NewFileList.ForwardLink);
 
   while (NewFileListEntry != (FFS_FILE_LIST_ENTRY *) &NewFileList) {
+    //
+    // InsertTailList() relinks the entry, so fetch the next one first
+    //
+    Link = NewFileListEntry->Link.ForwardLink;
     InsertTailList (&FvDevice->FfsFileListHeader, &NewFileListEntry->Link);
-    NewFileListEntry = (FFS_FILE_LIST_ENTRY *) (NewFileListEntry->Link.ForwardLink);
+    FvAddFfsFileEntryToIndex (FvDevice, NewFileListEntry);
+    NewFileListEntry = (FFS_FILE_LIST_ENTRY *) Link;
   }
 
   return EFI_SUCCESS;
@@ -1208,7 +1235,8 @@ FvCreateMultipleFiles (
     if (!IsCreateFile && OldFfsFileEntry[Index1] != NULL) {
       (OldFfsFileEntry[Index1]->Link.BackLink)->ForwardLink  = OldFfsFileEntry[Index1]->Link.ForwardLink;
       (OldFfsFileEntry[Index1]->Link.ForwardLink)->BackLink  = OldFfsFileEntry[Index1]->Link.BackLink;
-      FreePool (OldFfsFileEntry[Index1]);
+      FvRemoveFfsFileEntryFromIndex (OldFfsFileEntry[Index1]);
+      FvFreeFfsFileEntry (FvDevice, OldFfsFileEntry[Index1]);
     }
   }
   //
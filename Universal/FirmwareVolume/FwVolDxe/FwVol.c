@@ -152,28 +152,24 @@ FreeFvDeviceResource (
   IN FV_DEVICE  *FvDevice
   )
 {
-  LBA_ENTRY           *LbaEntry;
-  FREE_SPACE_ENTRY    *FreeSpaceEntry;
-  FFS_FILE_LIST_ENTRY *FfsFileEntry;
-  LIST_ENTRY      *NextEntry;
+  FREE_SPACE_ENTRY      *FreeSpaceEntry;
+  FFS_FILE_ENTRY_CHUNK  *Chunk;
+  LIST_ENTRY            *NextEntry;
 
   //
   // Free LAB Entry
   //
-  LbaEntry = (LBA_ENTRY *) FvDevice->LbaHeader.ForwardLink;
-  while (&LbaEntry->Link != &FvDevice->LbaHeader) {
-    NextEntry = (&LbaEntry->Link)->ForwardLink;
-    FreePool (LbaEntry);
-    LbaEntry = (LBA_ENTRY *) NextEntry;
+  if (FvDevice->LbaTable != NULL) {
+    FreePool (FvDevice->LbaTable);
   }
   //
-  // Free File List Entry
+  // Free File List Entry, all of them live in the chunks
   //
-  FfsFileEntry = (FFS_FILE_LIST_ENTRY *) FvDevice->FfsFileListHeader.ForwardLink;
-  while (&FfsFileEntry->Link != &FvDevice->FfsFileListHeader) {
-    NextEntry = (&FfsFileEntry->Link)->ForwardLink;
-    FreePool (FfsFileEntry);
-    FfsFileEntry = (FFS_FILE_LIST_ENTRY *) NextEntry;
+  Chunk = (FFS_FILE_ENTRY_CHUNK *) FvDevice->FfsFileEntryChunkHeader.ForwardLink;
+  while (&Chunk->Link != &FvDevice->FfsFileEntryChunkHeader) {
+    NextEntry = (&Chunk->Link)->ForwardLink;
+    FreePool (Chunk);
+    Chunk = (FFS_FILE_ENTRY_CHUNK *) NextEntry;
   }
   //
   // Free Space Entry
@@ -185,9 +181,11 @@ FreeFvDeviceResource (
     FreeSpaceEntry = (FREE_SPACE_ENTRY *) NextEntry;
   }
   //
-  // Free the cache
+  // Free the cache, unless it is the memory mapped FV
   //
-  FreePool ((UINT8 *) (UINTN) FvDevice->CachedFv);
+  if (!FvDevice->IsCacheMapped) {
+    FreePool ((UINT8 *) (UINTN) FvDevice->CachedFv);
+  }
 
   return ;
 }
@@ -276,8 +274,11 @@ FwVolInheritAuthenticationStatus (
             } else {
               //
               // Both FVs don't contain extension header, then compare their whole FV Image.
+              // The blocks of a lazily cached FV are read first, the cache only holds the
+              // headers FvCheck() walked through.
               //
-              if (CompareMem ((VOID *) FvHeader, (VOID *) CachedFvHeader, (UINTN) FvHeader->FvLength) == 0) {
+              if (!EFI_ERROR (FvCacheRange (FvDevice, (UINT8 *) CachedFvHeader, (UINTN) CachedFvHeader->FvLength)) &&
+                  (CompareMem ((VOID *) FvHeader, (VOID *) CachedFvHeader, (UINTN) FvHeader->FvLength) == 0)) {
                 //
                 // Found the FV image section where the firmware volume came from
                 // and then inherit authentication status from it.
@@ -295,6 +296,329 @@ FwVolInheritAuthenticationStatus (
   }
 }
 
+/**
+  Make sure the blocks of the FV that hold a range of the cache have been
+  read from the device.
+
+  @param FvDevice        Cached FvDevice
+  @param Buffer          Start of the range in the cache.
+  @param Length          Length of the range in bytes.
+
+  @retval EFI_SUCCESS    The range is in the cache.
+  @retval others         A block of the range could not be read.
+
+**/
+EFI_STATUS
+FvCacheRange (
+  IN FV_DEVICE            *FvDevice,
+  IN UINT8                *Buffer,
+  IN UINTN                Length
+  )
+{
+  EFI_STATUS  Status;
+  LBA_ENTRY   *LbaEntry;
+  LIST_ENTRY  *Link;
+  UINTN       Size;
+
+  if ((FvDevice->UncachedLbaCount == 0) || (Length == 0)) {
+    return EFI_SUCCESS;
+  }
+
+  Status = Buffer2LbaEntry (FvDevice, (EFI_PHYSICAL_ADDRESS) (UINTN) Buffer, &LbaEntry);
+  if (EFI_ERROR (Status)) {
+    //
+    // Nothing of the FV to read
+    //
+    return EFI_SUCCESS;
+  }
+
+  for (Link = &LbaEntry->Link; Link != &FvDevice->LbaHeader; Link = Link->ForwardLink) {
+    LbaEntry = (LBA_ENTRY *) Link;
+    if (LbaEntry->StartingAddress >= Buffer + Length) {
+      break;
+    }
+
+    if (!LbaEntry->Cached) {
+      Size = LbaEntry->BlockLength;
+      Status = FvDevice->Fvb->Read (
+                                FvDevice->Fvb,
+                                LbaEntry->LbaIndex,
+                                0,
+                                &Size,
+                                LbaEntry->StartingAddress
+                                );
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      LbaEntry->Cached = TRUE;
+      FvDevice->UncachedLbaCount--;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Make sure the header and the data of an FFS file are in the cache.
+
+  @param FvDevice        Cached FvDevice
+  @param FfsHeader       Points to the FFS file header in the cache.
+
+  @retval EFI_SUCCESS    The file is in the cache.
+  @retval others         A block of the file could not be read.
+
+**/
+EFI_STATUS
+FvCacheFfsFile (
+  IN FV_DEVICE            *FvDevice,
+  IN EFI_FFS_FILE_HEADER  *FfsHeader
+  )
+{
+  EFI_STATUS  Status;
+
+  if (FvDevice->UncachedLbaCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = FvCacheRange (FvDevice, (UINT8 *) FfsHeader, sizeof (EFI_FFS_FILE_HEADER2));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (IS_FFS_FILE2 (FfsHeader)) {
+    return FvCacheRange (FvDevice, (UINT8 *) FfsHeader, (UINTN) FFS_FILE2_SIZE (FfsHeader));
+  }
+
+  return FvCacheRange (FvDevice, (UINT8 *) FfsHeader, FFS_FILE_SIZE (FfsHeader));
+}
+
+/**
+  Give the FV a complete cache that may be modified. Called before any
+  write path updates the cache.
+
+  @param FvDevice               Cached FvDevice
+
+  @retval EFI_SUCCESS           The cache is complete and private.
+  @retval EFI_OUT_OF_RESOURCES  No enough buffer could be allocated.
+  @retval others                A block could not be read.
+
+**/
+EFI_STATUS
+FvMakeCachePrivate (
+  IN FV_DEVICE            *FvDevice
+  )
+{
+  UINT8               *FwCache;
+  UINTN               Delta;
+  LIST_ENTRY          *Link;
+
+  if (!FvDevice->IsCacheMapped) {
+    return FvCacheRange (
+             FvDevice,
+             (UINT8 *) (UINTN) FvDevice->CachedFv,
+             (UINTN) FvDevice->FwVolHeader->FvLength
+             );
+  }
+
+  //
+  // Copy the memory mapped FV and move everything that points into it
+  //
+  FwCache = AllocateCopyPool (
+              (UINTN) FvDevice->FwVolHeader->FvLength,
+              (VOID *) (UINTN) FvDevice->CachedFv
+              );
+  if (FwCache == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Delta = (UINTN) FwCache - (UINTN) FvDevice->CachedFv;
+
+  for (Link = FvDevice->LbaHeader.ForwardLink; Link != &FvDevice->LbaHeader; Link = Link->ForwardLink) {
+    ((LBA_ENTRY *) Link)->StartingAddress += Delta;
+  }
+
+  for (Link = FvDevice->FreeSpaceHeader.ForwardLink; Link != &FvDevice->FreeSpaceHeader; Link = Link->ForwardLink) {
+    ((FREE_SPACE_ENTRY *) Link)->StartingAddress += Delta;
+  }
+
+  for (Link = FvDevice->FfsFileListHeader.ForwardLink; Link != &FvDevice->FfsFileListHeader; Link = Link->ForwardLink) {
+    ((FFS_FILE_LIST_ENTRY *) Link)->FfsHeader += Delta;
+  }
+
+  FvDevice->FwVolHeader   = (EFI_FIRMWARE_VOLUME_HEADER *) FwCache;
+  FvDevice->CachedFv      = (EFI_PHYSICAL_ADDRESS) (UINTN) FwCache;
+  FvDevice->IsCacheMapped = FALSE;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate a zeroed file list entry from the chunks of the FV.
+
+  @param FvDevice        Cached FvDevice
+
+  @return The file entry, or NULL if no chunk could be allocated.
+
+**/
+FFS_FILE_LIST_ENTRY *
+FvAllocateFfsFileEntry (
+  IN FV_DEVICE            *FvDevice
+  )
+{
+  FFS_FILE_ENTRY_CHUNK  *Chunk;
+  FFS_FILE_LIST_ENTRY   *FfsFileEntry;
+  UINTN                 Index;
+
+  if (IsListEmpty (&FvDevice->FreeFfsFileEntryHeader)) {
+    Chunk = AllocatePool (sizeof (FFS_FILE_ENTRY_CHUNK));
+    if (Chunk == NULL) {
+      return NULL;
+    }
+
+    InsertTailList (&FvDevice->FfsFileEntryChunkHeader, &Chunk->Link);
+    for (Index = 0; Index < FFS_FILE_ENTRY_CHUNK_COUNT; Index++) {
+      InsertTailList (&FvDevice->FreeFfsFileEntryHeader, &Chunk->Entry[Index].Link);
+    }
+  }
+
+  FfsFileEntry = (FFS_FILE_LIST_ENTRY *) FvDevice->FreeFfsFileEntryHeader.ForwardLink;
+  RemoveEntryList (&FfsFileEntry->Link);
+  ZeroMem (FfsFileEntry, sizeof (FFS_FILE_LIST_ENTRY));
+
+  return FfsFileEntry;
+}
+
+/**
+  Return a file list entry to the FV. The entry must not be linked into
+  any list.
+
+  @param FvDevice        Cached FvDevice
+  @param FfsFileEntry    The file entry to be freed.
+
+**/
+VOID
+FvFreeFfsFileEntry (
+  IN FV_DEVICE            *FvDevice,
+  IN FFS_FILE_LIST_ENTRY  *FfsFileEntry
+  )
+{
+  InsertHeadList (&FvDevice->FreeFfsFileEntryHeader, &FfsFileEntry->Link);
+}
+
+/**
+  Add a file entry to the name hash and type chain of the FV. The entry
+  must already be linked into FfsFileListHeader at its final position.
+
+  @param FvDevice        Cached FvDevice
+  @param FfsFileEntry    The file entry to be indexed.
+
+**/
+VOID
+FvAddFfsFileEntryToIndex (
+  IN FV_DEVICE            *FvDevice,
+  IN FFS_FILE_LIST_ENTRY  *FfsFileEntry
+  )
+{
+  EFI_FFS_FILE_HEADER *FfsHeader;
+  FFS_FILE_LIST_ENTRY *PrevEntry;
+  LIST_ENTRY          *Link;
+
+  InitializeListHead (&FfsFileEntry->HashLink);
+  InitializeListHead (&FfsFileEntry->TypeLink);
+
+  FfsHeader = (EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader;
+  if (FfsHeader->Type == EFI_FV_FILETYPE_FFS_PAD) {
+    //
+    // Pad files are never returned by GetNextFile() or ReadFile()
+    //
+    return ;
+  }
+
+  InsertTailList (
+    &FvDevice->FfsFileHashHeader[FFS_FILE_HASH (&FfsHeader->Name)],
+    &FfsFileEntry->HashLink
+    );
+
+  if (FfsHeader->Type >= FFS_FILE_TYPE_INDEX_COUNT) {
+    return ;
+  }
+
+  //
+  // Keep the type chain in file list order. Entries appended while the FV
+  // is scanned go to the tail; files created in a pad file area land in the
+  // middle of the list, so find the previous file of the same type.
+  //
+  Link = FfsFileEntry->Link.BackLink;
+  if (FfsFileEntry->Link.ForwardLink != &FvDevice->FfsFileListHeader) {
+    while (Link != &FvDevice->FfsFileListHeader) {
+      PrevEntry = (FFS_FILE_LIST_ENTRY *) Link;
+      if (((EFI_FFS_FILE_HEADER *) PrevEntry->FfsHeader)->Type == FfsHeader->Type) {
+        InsertHeadList (&PrevEntry->TypeLink, &FfsFileEntry->TypeLink);
+        return ;
+      }
+      Link = Link->BackLink;
+    }
+
+    InsertHeadList (&FvDevice->FfsFileTypeHeader[FfsHeader->Type], &FfsFileEntry->TypeLink);
+    return ;
+  }
+
+  InsertTailList (&FvDevice->FfsFileTypeHeader[FfsHeader->Type], &FfsFileEntry->TypeLink);
+}
+
+/**
+  Remove a file entry from the name hash and type chain of the FV.
+
+  @param FfsFileEntry    The file entry to be removed from the index.
+
+**/
+VOID
+FvRemoveFfsFileEntryFromIndex (
+  IN FFS_FILE_LIST_ENTRY  *FfsFileEntry
+  )
+{
+  if (!IsListEmpty (&FfsFileEntry->HashLink)) {
+    RemoveEntryList (&FfsFileEntry->HashLink);
+    InitializeListHead (&FfsFileEntry->HashLink);
+  }
+
+  if (!IsListEmpty (&FfsFileEntry->TypeLink)) {
+    RemoveEntryList (&FfsFileEntry->TypeLink);
+    InitializeListHead (&FfsFileEntry->TypeLink);
+  }
+}
+
+/**
+  Find the first non-pad file with the given name in the FV.
+
+  @param FvDevice        Cached FvDevice
+  @param NameGuid        The name of the file to find.
+
+  @return The file entry, or NULL if there is no such file.
+
+**/
+FFS_FILE_LIST_ENTRY *
+FvFindFfsFileEntry (
+  IN FV_DEVICE            *FvDevice,
+  IN CONST EFI_GUID       *NameGuid
+  )
+{
+  LIST_ENTRY          *HashHeader;
+  LIST_ENTRY          *Link;
+  FFS_FILE_LIST_ENTRY *FfsFileEntry;
+
+  HashHeader = &FvDevice->FfsFileHashHeader[FFS_FILE_HASH (NameGuid)];
+  for (Link = HashHeader->ForwardLink; Link != HashHeader; Link = Link->ForwardLink) {
+    FfsFileEntry = FFS_FILE_ENTRY_FROM_HASH_LINK (Link);
+    if (CompareGuid (&((EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader)->Name, NameGuid)) {
+      return FfsFileEntry;
+    }
+  }
+
+  return NULL;
+}
+
 /**
   Check if an FV is consistent and allocate cache for it.
 
@@ -332,6 +656,7 @@ FvCheck (
   UINT8                               *TopFvAddress;
   UINTN                               TestLength;
   EFI_PHYSICAL_ADDRESS                BaseAddress;
+  BOOLEAN                             LazyCache;
 
   Fvb     = FvDevice->Fvb;
 
@@ -343,6 +668,14 @@ FvCheck (
   InitializeListHead (&FvDevice->LbaHeader);
   InitializeListHead (&FvDevice->FreeSpaceHeader);
   InitializeListHead (&FvDevice->FfsFileListHeader);
+  for (Index = 0; Index < FFS_FILE_HASH_SIZE; Index++) {
+    InitializeListHead (&FvDevice->FfsFileHashHeader[Index]);
+  }
+  for (Index = 0; Index < FFS_FILE_TYPE_INDEX_COUNT; Index++) {
+    InitializeListHead (&FvDevice->FfsFileTypeHeader[Index]);
+  }
+  InitializeListHead (&FvDevice->FfsFileEntryChunkHeader);
+  InitializeListHead (&FvDevice->FreeFfsFileEntryHeader);
 
   FwVolHeader = NULL;
   Status = GetFwVolHeader (Fvb, &FwVolHeader);
@@ -364,21 +697,23 @@ FvCheck (
   BlockMap = FwVolHeader->BlockMap;
 
   //
-  // FwVolHeader->FvLength is the whole FV length including FV header
+  // Count the blocks and check if they all have the same length
   //
-  FwCache = AllocateZeroPool ((UINTN) FwVolHeader->FvLength);
-  if (FwCache == NULL) {
-    FreePool (FwVolHeader);
-    return EFI_OUT_OF_RESOURCES;
+  FvDevice->LbaCount            = 0;
+  FvDevice->UniformBlockLength  = BlockMap->Length;
+  for (Index = 0; (BlockMap[Index].NumBlocks != 0) || (BlockMap[Index].Length != 0); Index++) {
+    FvDevice->LbaCount += BlockMap[Index].NumBlocks;
+    if (BlockMap[Index].Length != FvDevice->UniformBlockLength) {
+      FvDevice->UniformBlockLength = 0;
+    }
   }
 
-  FvDevice->CachedFv = (EFI_PHYSICAL_ADDRESS) (UINTN) FwCache;
-
   //
-  // Copy to memory
+  // With PcdFwVolDxeLazyCache set, a memory mapped FV is used in place
+  // until a write needs a private copy, and the blocks of any other FV are
+  // read into the cache the first time they are used.
   //
-  LbaStart  = FwCache;
-  LbaIndex  = 0;
+  LazyCache = FeaturePcdGet (PcdFwVolDxeLazyCache);
   Ptr       = NULL;
 
   if ((FvbAttributes & EFI_FVB2_MEMORY_MAPPED) != 0) {
@@ -395,31 +730,65 @@ FvCheck (
 
     DEBUG((EFI_D_INFO, "Fv Base Address is 0x%LX\n", BaseAddress));
   }
+
+  if (LazyCache && (Ptr != NULL)) {
+    FwCache                 = Ptr;
+    FvDevice->IsCacheMapped = TRUE;
+  } else {
+    //
+    // FwVolHeader->FvLength is the whole FV length including FV header
+    //
+    FwCache = AllocateZeroPool ((UINTN) FwVolHeader->FvLength);
+    if (FwCache == NULL) {
+      FreePool (FwVolHeader);
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  FvDevice->CachedFv = (EFI_PHYSICAL_ADDRESS) (UINTN) FwCache;
+
+  //
+  // Copy to memory
+  //
+  LbaStart  = FwCache;
+  LbaIndex  = 0;
+
+  FvDevice->LbaTable = AllocatePool (FvDevice->LbaCount * sizeof (LBA_ENTRY));
+  if (FvDevice->LbaTable == NULL) {
+    FreePool (FwVolHeader);
+    FreeFvDeviceResource (FvDevice);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   //
   // Copy whole FV into the memory
   //
   while ((BlockMap->NumBlocks != 0) || (BlockMap->Length != 0)) {
 
     for (Index = 0; Index < BlockMap->NumBlocks; Index++) {
-      LbaEntry = AllocatePool (sizeof (LBA_ENTRY));
-      if (LbaEntry == NULL) {
-        FreePool (FwVolHeader);
-        FreeFvDeviceResource (FvDevice);
-        return EFI_OUT_OF_RESOURCES;
-      }
-
+      LbaEntry                  = &FvDevice->LbaTable[(UINTN) LbaIndex];
       LbaEntry->LbaIndex        = LbaIndex;
       LbaEntry->StartingAddress = LbaStart;
       LbaEntry->BlockLength     = BlockMap->Length;
+      LbaEntry->Cached          = TRUE;
 
       //
       // Copy each LBA into memory
       //
-      if ((FvbAttributes & EFI_FVB2_MEMORY_MAPPED) != 0) {
+      if (FvDevice->IsCacheMapped) {
+        //
+        // The cache is the memory mapped FV itself
+        //
+      } else if ((FvbAttributes & EFI_FVB2_MEMORY_MAPPED) != 0) {
 
         CopyMem (LbaStart, Ptr, BlockMap->Length);
         Ptr += BlockMap->Length;
 
+      } else if (LazyCache) {
+
+        LbaEntry->Cached = FALSE;
+        FvDevice->UncachedLbaCount++;
+
       } else {
 
         Size = BlockMap->Length;
@@ -450,6 +819,24 @@ FvCheck (
     BlockMap++;
   }
 
+  //
+  // The volume header and its extension must be in the cache before the
+  // scan below
+  //
+  Status = FvCacheRange (FvDevice, FwCache, FwVolHeader->HeaderLength);
+  if (!EFI_ERROR (Status) && (FwVolHeader->ExtHeaderOffset != 0)) {
+    FwVolExtHeader = (EFI_FIRMWARE_VOLUME_EXT_HEADER *) (FwCache + FwVolHeader->ExtHeaderOffset);
+    Status = FvCacheRange (FvDevice, (UINT8 *) FwVolExtHeader, sizeof (EFI_FIRMWARE_VOLUME_EXT_HEADER));
+    if (!EFI_ERROR (Status)) {
+      Status = FvCacheRange (FvDevice, (UINT8 *) FwVolExtHeader, FwVolExtHeader->ExtHeaderSize);
+    }
+  }
+  if (EFI_ERROR (Status)) {
+    FreePool (FwVolHeader);
+    FreeFvDeviceResource (FvDevice);
+    return Status;
+  }
+
   FvDevice->FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *) FwCache;
 
   //
@@ -493,6 +880,12 @@ FvCheck (
       TestLength = sizeof (EFI_FFS_FILE_HEADER);
     }
 
+    Status = FvCacheRange (FvDevice, Ptr, sizeof (EFI_FFS_FILE_HEADER2));
+    if (EFI_ERROR (Status)) {
+      FreeFvDeviceResource (FvDevice);
+      return Status;
+    }
+
     if (IsBufferErased (ErasePolarity, Ptr, TestLength)) {
       //
       // We found free space
@@ -507,6 +900,12 @@ FvCheck (
           TestLength = sizeof (EFI_FFS_FILE_HEADER);
         }
 
+        Status = FvCacheRange (FvDevice, Ptr, TestLength);
+        if (EFI_ERROR (Status)) {
+          FreeFvDeviceResource (FvDevice);
+          return Status;
+        }
+
         if (!IsBufferErased (ErasePolarity, Ptr, TestLength)) {
           break;
         }
@@ -592,7 +991,7 @@ FvCheck (
         //
         // Create a FFS list entry for each non-deleted file
         //
-        FfsFileEntry = AllocateZeroPool (sizeof (FFS_FILE_LIST_ENTRY));
+        FfsFileEntry = FvAllocateFfsFileEntry (FvDevice);
         if (FfsFileEntry == NULL) {
           FreeFvDeviceResource (FvDevice);
           return EFI_OUT_OF_RESOURCES;
@@ -600,6 +999,7 @@ FvCheck (
 
         FfsFileEntry->FfsHeader = Ptr;
         InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+        FvAddFfsFileEntryToIndex (FvDevice, FfsFileEntry);
       }
 
       if (IS_FFS_FILE2 (Ptr)) {
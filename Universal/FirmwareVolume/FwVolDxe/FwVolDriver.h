@@ -33,6 +33,7 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/PcdLib.h>
 
 #define FV_DEVICE_SIGNATURE           SIGNATURE_32 ('_', 'F', 'V', '_')
 
@@ -59,6 +60,10 @@ typedef struct {
   EFI_LBA         LbaIndex;
   UINT8           *StartingAddress;
   UINTN           BlockLength;
+  //
+  // FALSE until the block has been read into the cache, see FvCacheRange()
+  //
+  BOOLEAN         Cached;
 } LBA_ENTRY;
 
 //
@@ -70,14 +75,45 @@ typedef struct {
   UINTN           Length;
 } FREE_SPACE_ENTRY;
 
+//
+// Number of buckets in the file name hash, must be a power of 2
+//
+#define FFS_FILE_HASH_SIZE    64
+#define FFS_FILE_HASH(Guid)   ((UINTN) ((Guid)->Data1 & (FFS_FILE_HASH_SIZE - 1)))
+
+//
+// File types 0x01 - EFI_FV_FILETYPE_SMM_CORE are chained by type
+//
+#define FFS_FILE_TYPE_INDEX_COUNT   (EFI_FV_FILETYPE_SMM_CORE + 1)
+
 //
 // Used to track all non-deleted files
 //
 typedef struct {
   LIST_ENTRY      Link;
   UINT8           *FfsHeader;
+  //
+  // Links into the name hash and the per-type chain. Pad files and files
+  // whose type has no chain are self-linked on the respective list.
+  //
+  LIST_ENTRY      HashLink;
+  LIST_ENTRY      TypeLink;
 } FFS_FILE_LIST_ENTRY;
 
+#define FFS_FILE_ENTRY_FROM_HASH_LINK(a)  BASE_CR (a, FFS_FILE_LIST_ENTRY, HashLink)
+#define FFS_FILE_ENTRY_FROM_TYPE_LINK(a)  BASE_CR (a, FFS_FILE_LIST_ENTRY, TypeLink)
+
+//
+// File list entries are carved out of chunks of this many entries, see
+// FvAllocateFfsFileEntry()
+//
+#define FFS_FILE_ENTRY_CHUNK_COUNT  64
+
+typedef struct {
+  LIST_ENTRY            Link;
+  FFS_FILE_LIST_ENTRY   Entry[FFS_FILE_ENTRY_CHUNK_COUNT];
+} FFS_FILE_ENTRY_CHUNK;
+
 typedef struct {
   UINTN                               Signature;
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
@@ -89,11 +125,37 @@ typedef struct {
   UINT8                               ErasePolarity;
   EFI_PHYSICAL_ADDRESS                CachedFv;
   LIST_ENTRY                          LbaHeader;
+  //
+  // All LBA entries are in one array in LBA order. UniformBlockLength is
+  // the block length if all blocks have the same length, 0 otherwise.
+  //
+  LBA_ENTRY                           *LbaTable;
+  UINTN                               LbaCount;
+  UINTN                               UniformBlockLength;
   LIST_ENTRY                          FreeSpaceHeader;
   LIST_ENTRY                          FfsFileListHeader;
+  //
+  // Index over FfsFileListHeader, see FvAddFfsFileEntryToIndex()
+  //
+  LIST_ENTRY                          FfsFileHashHeader[FFS_FILE_HASH_SIZE];
+  LIST_ENTRY                          FfsFileTypeHeader[FFS_FILE_TYPE_INDEX_COUNT];
+  //
+  // Chunks that file list entries are allocated from, and the unused ones
+  //
+  LIST_ENTRY                          FfsFileEntryChunkHeader;
+  LIST_ENTRY                          FreeFfsFileEntryHeader;
 
   FFS_FILE_LIST_ENTRY                 *CurrentFfsFile;
   BOOLEAN                             IsFfs3Fv;
+  //
+  // TRUE while CachedFv is the memory mapped FV itself rather than a
+  // private copy, see FvMakeCachePrivate()
+  //
+  BOOLEAN                             IsCacheMapped;
+  //
+  // Number of blocks not yet read into the cache
+  //
+  UINTN                               UncachedLbaCount;
   UINT32                              AuthenticationStatus;
 } FV_DEVICE;
 
@@ -758,4 +820,122 @@ FvFileAttrib2FfsFileAttrib (
   OUT UINT8                      *FfsFileAttrib
   );
 
+/**
+  Allocate a zeroed file list entry from the chunks of the FV.
+
+  @param FvDevice        Cached FvDevice
+
+  @return The file entry, or NULL if no chunk could be allocated.
+
+**/
+FFS_FILE_LIST_ENTRY *
+FvAllocateFfsFileEntry (
+  IN FV_DEVICE            *FvDevice
+  );
+
+/**
+  Return a file list entry to the FV. The entry must not be linked into
+  any list.
+
+  @param FvDevice        Cached FvDevice
+  @param FfsFileEntry    The file entry to be freed.
+
+**/
+VOID
+FvFreeFfsFileEntry (
+  IN FV_DEVICE            *FvDevice,
+  IN FFS_FILE_LIST_ENTRY  *FfsFileEntry
+  );
+
+/**
+  Add a file entry to the name hash and type chain of the FV. The entry
+  must already be linked into FfsFileListHeader at its final position.
+
+  @param FvDevice        Cached FvDevice
+  @param FfsFileEntry    The file entry to be indexed.
+
+**/
+VOID
+FvAddFfsFileEntryToIndex (
+  IN FV_DEVICE            *FvDevice,
+  IN FFS_FILE_LIST_ENTRY  *FfsFileEntry
+  );
+
+/**
+  Remove a file entry from the name hash and type chain of the FV.
+
+  @param FfsFileEntry    The file entry to be removed from the index.
+
+**/
+VOID
+FvRemoveFfsFileEntryFromIndex (
+  IN FFS_FILE_LIST_ENTRY  *FfsFileEntry
+  );
+
+/**
+  Find the first non-pad file with the given name in the FV.
+
+  @param FvDevice        Cached FvDevice
+  @param NameGuid        The name of the file to find.
+
+  @return The file entry, or NULL if there is no such file.
+
+**/
+FFS_FILE_LIST_ENTRY *
+FvFindFfsFileEntry (
+  IN FV_DEVICE            *FvDevice,
+  IN CONST EFI_GUID       *NameGuid
+  );
+
+/**
+  Make sure the blocks of the FV that hold a range of the cache have been
+  read from the device.
+
+  @param FvDevice        Cached FvDevice
+  @param Buffer          Start of the range in the cache.
+  @param Length          Length of the range in bytes.
+
+  @retval EFI_SUCCESS    The range is in the cache.
+  @retval others         A block of the range could not be read.
+
+**/
+EFI_STATUS
+FvCacheRange (
+  IN FV_DEVICE            *FvDevice,
+  IN UINT8                *Buffer,
+  IN UINTN                Length
+  );
+
+/**
+  Make sure the header and the data of an FFS file are in the cache.
+
+  @param FvDevice        Cached FvDevice
+  @param FfsHeader       Points to the FFS file header in the cache.
+
+  @retval EFI_SUCCESS    The file is in the cache.
+  @retval others         A block of the file could not be read.
+
+**/
+EFI_STATUS
+FvCacheFfsFile (
+  IN FV_DEVICE            *FvDevice,
+  IN EFI_FFS_FILE_HEADER  *FfsHeader
+  );
+
+/**
+  Give the FV a complete cache that may be modified. Called before any
+  write path updates the cache.
+
+  @param FvDevice               Cached FvDevice
+
+  @retval EFI_SUCCESS           The cache is complete and private.
+  @retval EFI_OUT_OF_RESOURCES  No enough buffer could be allocated.
+  @retval others                A block could not be read.
+
+**/
+EFI_STATUS
+FvMakeCachePrivate (
+  IN FV_DEVICE            *FvDevice
+  );
+
 #endif
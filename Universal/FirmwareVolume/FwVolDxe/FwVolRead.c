@@ -58,6 +58,50 @@ FfsAttributes2FvFileAttributes (
   return FileAttribute;
 }
 
+/**
+  Get the size of the data of an FFS file, excluding the file header. The
+  zero padding at the start of the volume top file is not counted.
+
+  @param  FfsFileHeader              The header of the FFS file.
+
+  @return The size of the file data in bytes.
+
+**/
+UINTN
+GetFfsFileDataSize (
+  IN EFI_FFS_FILE_HEADER  *FfsFileHeader
+  )
+{
+  UINTN   Size;
+  UINT8   *SrcPtr;
+  UINT32  Tmp;
+
+  if (IS_FFS_FILE2 (FfsFileHeader)) {
+    Size    = FFS_FILE2_SIZE (FfsFileHeader) - sizeof (EFI_FFS_FILE_HEADER2);
+    SrcPtr  = ((UINT8 *) FfsFileHeader) + sizeof (EFI_FFS_FILE_HEADER2);
+  } else {
+    Size    = FFS_FILE_SIZE (FfsFileHeader) - sizeof (EFI_FFS_FILE_HEADER);
+    SrcPtr  = ((UINT8 *) FfsFileHeader) + sizeof (EFI_FFS_FILE_HEADER);
+  }
+
+  if (CompareGuid (&gEfiFirmwareVolumeTopFileGuid, &FfsFileHeader->Name)) {
+    //
+    // specially deal with VTF file
+    //
+    while (Size >= 4) {
+      Tmp = *(UINT32 *) SrcPtr;
+      if (Tmp == 0) {
+        SrcPtr += 4;
+        Size   -= 4;
+      } else {
+        break;
+      }
+    }
+  }
+
+  return Size;
+}
+
 /**
   Given the input key, search for the next matching file in the volume.
 
@@ -147,72 +191,100 @@ FvGetNextFile (
     return EFI_NOT_FOUND;
   }
 
-  do {
+  if (*FileType != EFI_FV_FILETYPE_ALL) {
+    //
+    // Walk the chain of files of the requested type, unless the key was
+    // returned for a file of another type
+    //
+    Link = NULL;
     if (*KeyValue == 0) {
-      //
-      // Search for 1st matching file
-      //
-      Link = &FvDevice->FfsFileListHeader;
-      if (Link->ForwardLink == &FvDevice->FfsFileListHeader) {
-        return EFI_NOT_FOUND;
-      }
-
-      FfsFileEntry  = (FFS_FILE_LIST_ENTRY *) Link->ForwardLink;
-      FfsFileHeader = (EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader;
-
-      //
-      // remember the key
-      //
-      *KeyValue = (UINTN) FfsFileEntry;
-
-      //
-      // we ignore pad files
-      //
-      if (FfsFileHeader->Type == EFI_FV_FILETYPE_FFS_PAD) {
-        continue;
-      }
-
-      if (*FileType == 0) {
-        break;
-      }
-
-      if (*FileType == FfsFileHeader->Type) {
-        break;
+      Link = FvDevice->FfsFileTypeHeader[*FileType].ForwardLink;
+    } else {
+      FfsFileEntry = (FFS_FILE_LIST_ENTRY *) (*KeyValue);
+      if (((EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader)->Type == *FileType) {
+        Link = FfsFileEntry->TypeLink.ForwardLink;
       }
+    }
 
-    } else {
-      //
-      // Getting link from last Ffs
-      //
-      Link = (LIST_ENTRY *) (*KeyValue);
-      if (Link->ForwardLink == &FvDevice->FfsFileListHeader) {
+    if (Link != NULL) {
+      if (Link == &FvDevice->FfsFileTypeHeader[*FileType]) {
         return EFI_NOT_FOUND;
       }
 
-      FfsFileEntry  = (FFS_FILE_LIST_ENTRY *) Link->ForwardLink;
+      FfsFileEntry  = FFS_FILE_ENTRY_FROM_TYPE_LINK (Link);
       FfsFileHeader = (EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader;
+      *KeyValue     = (UINTN) FfsFileEntry;
+    }
+  }
 
-      //
-      // remember the key
-      //
-      *KeyValue = (UINTN) FfsFileEntry;
-
-      //
-      // we ignore pad files
-      //
-      if (FfsFileHeader->Type == EFI_FV_FILETYPE_FFS_PAD) {
-        continue;
-      }
-
-      if (*FileType == EFI_FV_FILETYPE_ALL) {
-        break;
-      }
+  if (FfsFileHeader == NULL) {
+    do {
+      if (*KeyValue == 0) {
+        //
+        // Search for 1st matching file
+        //
+        Link = &FvDevice->FfsFileListHeader;
+        if (Link->ForwardLink == &FvDevice->FfsFileListHeader) {
+          return EFI_NOT_FOUND;
+        }
+
+        FfsFileEntry  = (FFS_FILE_LIST_ENTRY *) Link->ForwardLink;
+        FfsFileHeader = (EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader;
+
+        //
+        // remember the key
+        //
+        *KeyValue = (UINTN) FfsFileEntry;
+
+        //
+        // we ignore pad files
+        //
+        if (FfsFileHeader->Type == EFI_FV_FILETYPE_FFS_PAD) {
+          continue;
+        }
+
+        if (*FileType == 0) {
+          break;
+        }
+
+        if (*FileType == FfsFileHeader->Type) {
+          break;
+        }
 
-      if (*FileType == FfsFileHeader->Type) {
-        break;
+      } else {
+        //
+        // Getting link from last Ffs
+        //
+        Link = (LIST_ENTRY *) (*KeyValue);
+        if (Link->ForwardLink == &FvDevice->FfsFileListHeader) {
+          return EFI_NOT_FOUND;
+        }
+
+        FfsFileEntry  = (FFS_FILE_LIST_ENTRY *) Link->ForwardLink;
+        FfsFileHeader = (EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader;
+
+        //
+        // remember the key
+        //
+        *KeyValue = (UINTN) FfsFileEntry;
+
+        //
+        // we ignore pad files
+        //
+        if (FfsFileHeader->Type == EFI_FV_FILETYPE_FFS_PAD) {
+          continue;
+        }
+
+        if (*FileType == EFI_FV_FILETYPE_ALL) {
+          break;
+        }
+
+        if (*FileType == FfsFileHeader->Type) {
+          break;
+        }
       }
-    }
-  } while (Link->ForwardLink != &FvDevice->FfsFileListHeader);
+    } while (Link->ForwardLink != &FvDevice->FfsFileListHeader);
+  }
 
   //
   // Cache this file entry
@@ -227,38 +299,21 @@ FvGetNextFile (
    }
 
   //
-  // we need to substract the header size
+  // The size of the VTF does not count its leading zero padding, so its
+  // data must be in the cache
   //
-  if (IS_FFS_FILE2 (FfsFileHeader)) {
-    *Size = FFS_FILE2_SIZE (FfsFileHeader) - sizeof (EFI_FFS_FILE_HEADER2);
-  } else {
-    *Size = FFS_FILE_SIZE (FfsFileHeader) - sizeof (EFI_FFS_FILE_HEADER);
-  }
-
   if (CompareGuid (&gEfiFirmwareVolumeTopFileGuid, NameGuid)) {
-    //
-    // specially deal with VTF file
-    //
-    UINT8   *SrcPtr;
-    UINT32  Tmp;
-
-    if (IS_FFS_FILE2 (FfsFileHeader)) {
-      SrcPtr = ((UINT8 *) FfsFileHeader) + sizeof (EFI_FFS_FILE_HEADER2);
-    } else {
-      SrcPtr = ((UINT8 *) FfsFileHeader) + sizeof (EFI_FFS_FILE_HEADER);
-    }
-
-    while (*Size >= 4) {
-      Tmp = *(UINT32 *) SrcPtr;
-      if (Tmp == 0) {
-        SrcPtr += 4;
-        (*Size) -= 4;
-      } else {
-        break;
-      }
+    Status = FvCacheFfsFile (FvDevice, FfsFileHeader);
+    if (EFI_ERROR (Status)) {
+      return Status;
     }
   }
 
+  //
+  // we need to substract the header size
+  //
+  *Size = GetFfsFileDataSize (FfsFileHeader);
+
   return EFI_SUCCESS;
 }
 
@@ -316,11 +371,7 @@ FvReadFile (
 {
   EFI_STATUS              Status;
   FV_DEVICE               *FvDevice;
-  UINTN                   Key;
-  EFI_GUID                SearchNameGuid;
   EFI_FV_ATTRIBUTES       FvAttributes;
-  EFI_FV_FILETYPE         LocalFoundType;
-  EFI_FV_FILE_ATTRIBUTES  LocalAttributes;
   UINTN                   FileSize;
   UINT8                   *SrcPtr;
   FFS_FILE_LIST_ENTRY     *FfsFileEntry;
@@ -357,28 +408,12 @@ FvReadFile (
 
   if ((FfsFileEntry == NULL) || (!CompareGuid (&FfsHeader->Name, NameGuid))) {
     //
-    // If not match or no file cached, search this file
-    //
-    Key = 0;
-    do {
-      LocalFoundType = 0;
-      Status = This->GetNextFile (
-                      This,
-                      &Key,
-                      &LocalFoundType,
-                      &SearchNameGuid,
-                      &LocalAttributes,
-                      &FileSize
-                      );
-      if (EFI_ERROR (Status)) {
-        return EFI_NOT_FOUND;
-      }
-    } while (!CompareGuid (&SearchNameGuid, NameGuid));
-
-    //
-    // Get file entry
+    // If not match or no file cached, look the file up by name
     //
-    FfsFileEntry = (FFS_FILE_LIST_ENTRY *) Key;
+    FfsFileEntry = FvFindFfsFileEntry (FvDevice, NameGuid);
+    if (FfsFileEntry == NULL) {
+      return EFI_NOT_FOUND;
+    }
 
     //
     // Update the cache
@@ -387,7 +422,19 @@ FvReadFile (
 
     FfsHeader                 = (EFI_FFS_FILE_HEADER *) FfsFileEntry->FfsHeader;
 
+    Status = FvCacheFfsFile (FvDevice, FfsHeader);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    FileSize                  = GetFfsFileDataSize (FfsHeader);
+
   } else {
+    Status = FvCacheFfsFile (FvDevice, FfsHeader);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
     //
     // Get File Size of the cached file
     //
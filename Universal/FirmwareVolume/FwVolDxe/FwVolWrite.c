@@ -599,48 +599,21 @@ CalculateRemainingLength (
   OUT  UINTN                                  *LOffset
   )
 {
-  LIST_ENTRY      *Link;
   LBA_ENTRY       *LbaEntry;
-  UINTN           Count;
+  LBA_ENTRY       *LastLbaEntry;
 
-  Count     = 0;
   *Lba      = 0;
-  Link      = FvDevice->LbaHeader.ForwardLink;
-  LbaEntry  = (LBA_ENTRY *) Link;
 
-  while (&LbaEntry->Link != &FvDevice->LbaHeader) {
-    if (Count > Offset) {
-      break;
-    }
-
-    Count += LbaEntry->BlockLength;
-    (*Lba)++;
-    Link      = LbaEntry->Link.ForwardLink;
-    LbaEntry  = (LBA_ENTRY *) Link;
-  }
-
-  if (Count <= Offset) {
+  if (EFI_ERROR (Buffer2LbaEntry (FvDevice, FvDevice->CachedFv + Offset, &LbaEntry))) {
     return 0;
   }
 
-  Link      = LbaEntry->Link.BackLink;
-  LbaEntry  = (LBA_ENTRY *) Link;
+  *Lba      = LbaEntry->LbaIndex;
+  *LOffset  = (UINTN) (FvDevice->CachedFv + Offset - (UINTN) LbaEntry->StartingAddress);
 
-  (*Lba)--;
-  *LOffset  = (UINTN) (LbaEntry->BlockLength - (Count - Offset));
-
-  Count     = 0;
-  while (&LbaEntry->Link != &FvDevice->LbaHeader) {
-
-    Count += LbaEntry->BlockLength;
-
-    Link      = LbaEntry->Link.ForwardLink;
-    LbaEntry  = (LBA_ENTRY *) Link;
-  }
+  LastLbaEntry = &FvDevice->LbaTable[FvDevice->LbaCount - 1];
 
-  Count -= *LOffset;
-
-  return Count;
+  return (UINTN) (LastLbaEntry->StartingAddress + LastLbaEntry->BlockLength - (UINT8 *) (UINTN) FvDevice->CachedFv) - Offset;
 }
 
 /**
@@ -1012,10 +985,11 @@ FvCreateNewFile (
   // If successfully, insert an FfsFileEntry at the end of ffs file list
   //
 
-  FfsFileEntry            = AllocateZeroPool (sizeof (FFS_FILE_LIST_ENTRY));
+  FfsFileEntry            = FvAllocateFfsFileEntry (FvDevice);
   ASSERT (FfsFileEntry   != NULL);
   FfsFileEntry->FfsHeader = (UINT8 *) (UINTN) BufferPtr;
   InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+  FvAddFfsFileEntryToIndex (FvDevice, FfsFileEntry);
 
   //
   // Set cache file to this file
@@ -1164,7 +1138,8 @@ FvUpdateFile (
   //
   (OldFfsFileEntry->Link.BackLink)->ForwardLink = OldFfsFileEntry->Link.ForwardLink;
   (OldFfsFileEntry->Link.ForwardLink)->BackLink = OldFfsFileEntry->Link.BackLink;
-  FreePool (OldFfsFileEntry);
+  FvRemoveFfsFileEntryFromIndex (OldFfsFileEntry);
+  FvFreeFfsFileEntry (FvDevice, OldFfsFileEntry);
 
   //
   // Step 3: Delete old files,
@@ -1311,7 +1286,8 @@ FvDeleteFile (
 
   (FfsFileEntry->Link.BackLink)->ForwardLink  = FfsFileEntry->Link.ForwardLink;
   (FfsFileEntry->Link.ForwardLink)->BackLink  = FfsFileEntry->Link.BackLink;
-  FreePool (FfsFileEntry);
+  FvRemoveFfsFileEntryFromIndex (FfsFileEntry);
+  FvFreeFfsFileEntry (FvDevice, FfsFileEntry);
 
   return EFI_SUCCESS;
 }
@@ -1390,6 +1366,14 @@ FvWriteFile (
     return EFI_WRITE_PROTECTED;
   }
 
+  //
+  // The write paths below update the cache in place
+  //
+  Status = FvMakeCachePrivate (FvDevice);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   ErasePolarity = FvDevice->ErasePolarity;
 
   //
@@ -40,19 +40,30 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <FrameworkDxe.h>
 
+#include <Guid/LzmaDecompress.h>
+#include <Guid/TianoDecompress.h>
+
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TianoDecompressStreamLib.h>
+#include <Library/LzmaDecompressStreamLib.h>
 #include <Protocol/Decompress.h>
 #include <Protocol/GuidedSectionExtraction.h>
 #include <Protocol/SectionExtraction.h>
+#include <Protocol/MpService.h>
+#include <Protocol/SectionExtractionStatistics.h>
 
 //
 // Local defines and typedefs
 //
+typedef struct _DECODED_SECTION DECODED_SECTION;
+
 #define FRAMEWORK_SECTION_CHILD_SIGNATURE  SIGNATURE_32('S','X','F','S')
 #define CHILD_SECTION_NODE_FROM_LINK(Node) \
   CR (Node, FRAMEWORK_SECTION_CHILD_NODE, Link, FRAMEWORK_SECTION_CHILD_SIGNATURE)
@@ -83,10 +94,57 @@ typedef struct {
   EFI_EVENT                   Event;
 } FRAMEWORK_SECTION_CHILD_NODE;
 
+//
+// Children of a stream in stream order, kept in an array so that the Nth
+// one can be reached directly.
+//
+typedef struct {
+  FRAMEWORK_SECTION_CHILD_NODE  **Nodes;
+  UINTN                         Count;
+  UINTN                         Capacity;
+} CHILD_NODE_ARRAY;
+
+#define CHILD_NODE_ARRAY_MIN_CAPACITY  4
+
+//
+// A child node is listed in the EFI_SECTION_ALL entry, the entry of its type,
+// the entry of its section definition GUID and the encapsulation array.
+//
+#define CHILD_INDEX_ARRAYS_MAX  4
+
+#define SECTION_INDEX_SIGNATURE  SIGNATURE_32('S','X','S','I')
+#define SECTION_INDEX_FROM_LINK(Node) \
+  CR (Node, SECTION_INDEX, Link, SECTION_INDEX_SIGNATURE)
+
+//
+// The children of a stream that match a section type, and for a GUID defined
+// section also a section definition GUID.  A stream has one index entry for
+// each type and GUID found so far, plus one of type EFI_SECTION_ALL holding
+// every child.
+//
+typedef struct {
+  UINT32                      Signature;
+  LIST_ENTRY                  Link;
+  EFI_SECTION_TYPE            Type;
+  //
+  // Points into the stream buffer.  NULL if the entry is not limited to one
+  // section definition GUID.
+  //
+  EFI_GUID                    *SectionDefinitionGuid;
+  CHILD_NODE_ARRAY            Children;
+} SECTION_INDEX;
+
 #define FRAMEWORK_SECTION_STREAM_SIGNATURE SIGNATURE_32('S','X','S','S')
 #define STREAM_NODE_FROM_LINK(Node) \
   CR (Node, FRAMEWORK_SECTION_STREAM_NODE, Link, FRAMEWORK_SECTION_STREAM_SIGNATURE)
 
+//
+// Open streams are kept in a hash table keyed by stream handle.
+//
+#define STREAM_HASH_SIZE  64
+#define STREAM_HASH(Handle) \
+  ((UINTN) (((Handle) >> 4) ^ ((Handle) >> 10)) & (STREAM_HASH_SIZE - 1))
+
 typedef struct {
   UINT32                      Signature;
   LIST_ENTRY                  Link;
@@ -95,9 +153,28 @@ typedef struct {
   UINTN                       StreamLength;
   LIST_ENTRY                  Children;
   //
+  // Index of the children parsed so far, by section type and GUID.
+  //
+  LIST_ENTRY                  SectionIndex;
+  //
+  // Encapsulation sections among the children parsed so far.  A search
+  // descends into these and uses SectionIndex for the rest of the stream.
+  //
+  CHILD_NODE_ARRAY            Encapsulations;
+  //
   // Authentication status is from GUIDed encapsulations.
   //
   UINT32                      AuthenticationStatus;
+  //
+  // Encapsulated sections of this stream that were decoded ahead of time on
+  // the APs and have not been turned into child nodes yet.
+  //
+  LIST_ENTRY                  PrefetchedSections;
+  //
+  // If not NULL, StreamBuffer is owned by this entry of the decoded section
+  // cache and is released with it instead of being freed.
+  //
+  DECODED_SECTION             *DecodedSection;
 } FRAMEWORK_SECTION_STREAM_NODE;
 
 #define NULL_STREAM_HANDLE    0
@@ -108,6 +185,115 @@ typedef struct {
   VOID                             *Registration;
 } RPN_EVENT_CONTEXT;
 
+#define PREFETCHED_SECTION_SIGNATURE  SIGNATURE_32('S','X','P','S')
+#define PREFETCHED_SECTION_FROM_LINK(Node) \
+  CR (Node, PREFETCHED_SECTION, Link, PREFETCHED_SECTION_SIGNATURE)
+
+typedef enum {
+  PrefetchUefiDecompress,
+  PrefetchTianoDecompress,
+  PrefetchLzmaDecompress
+} PREFETCH_DECODER;
+
+typedef struct {
+  UINT32                      Signature;
+  LIST_ENTRY                  Link;
+  //
+  // Offset of the encapsulation section header in the parent stream.
+  //
+  UINT32                      OffsetInStream;
+  EFI_COMMON_SECTION_HEADER   *Section;
+  //
+  // Compressed data of the section and the decoder it is given to.
+  //
+  PREFETCH_DECODER            Decoder;
+  VOID                        *Source;
+  UINT32                      SourceSize;
+  VOID                        *Buffer;
+  UINT32                      BufferSize;
+  //
+  // Always zero, as returned by the Tiano and LZMA GUIDed section handlers.
+  //
+  UINT32                      AuthenticationStatus;
+  EFI_STATUS                  Status;
+} PREFETCHED_SECTION;
+
+typedef struct {
+  PREFETCHED_SECTION          **Sections;
+  UINT32                      Count;
+  //
+  // Index of the next section to be claimed by the BSP or an AP.
+  //
+  UINT32                      Next;
+  //
+  // Decompression contexts, one for each processor taking part.  Each one
+  // holds a Tiano decompression context followed, at LzmaContextOffset, by an
+  // LZMA decompression context.
+  //
+  UINT8                       *Workers;
+  UINTN                       WorkerSize;
+  UINTN                       LzmaContextOffset;
+  UINT32                      WorkerCount;
+  //
+  // Index of the next decompression context to be claimed.
+  //
+  UINT32                      NextWorker;
+} PREFETCH_CONTEXT;
+
+//
+// The decoded section cache keeps the streams produced by decoding
+// encapsulation sections after the streams are closed, so that opening a
+// section stream holding the same section again does not decode it again.
+//
+#define DECODED_SECTION_SIGNATURE  SIGNATURE_32('S','X','D','S')
+#define DECODED_SECTION_FROM_LINK(Node) \
+  CR (Node, DECODED_SECTION, Link, DECODED_SECTION_SIGNATURE)
+#define DECODED_SECTION_FROM_HASH_LINK(Node) \
+  CR (Node, DECODED_SECTION, HashLink, DECODED_SECTION_SIGNATURE)
+
+#define DECODED_SECTION_HASH_SIZE  64
+
+typedef struct {
+  //
+  // CRC32 and size of the whole encapsulation section, header included.
+  //
+  UINT32                      Crc32;
+  UINT32                      SectionSize;
+  UINT32                      OffsetInStream;
+  //
+  // Zero for a compression section.
+  //
+  EFI_GUID                    SectionDefinitionGuid;
+  //
+  // The whole encapsulation section.  The CRC32 only selects the candidates;
+  // a hit requires the same section bytes, since a CRC32 is easily forged.
+  // A cache entry points to its own copy of the section.
+  //
+  VOID                        *Section;
+} DECODED_SECTION_KEY;
+
+struct _DECODED_SECTION {
+  UINT32                      Signature;
+  //
+  // Link in mDecodedSectionList, most recently used first.
+  //
+  LIST_ENTRY                  Link;
+  LIST_ENTRY                  HashLink;
+  DECODED_SECTION_KEY         Key;
+  VOID                        *Buffer;
+  UINTN                       BufferSize;
+  //
+  // Authentication status returned by the GUIDed section extraction protocol.
+  //
+  UINT32                      AuthenticationStatus;
+  //
+  // Number of open streams using Buffer.  An entry that is evicted while in
+  // use is freed when the last of them is closed.
+  //
+  UINTN                       RefCount;
+  BOOLEAN                     InCache;
+};
+
 /**
   SEP member function.  This function creates and returns a new section stream
   handle to represent the new section stream.
@@ -211,13 +397,42 @@ CloseSectionStream (
   )
 ;
 
+/**
+  Worker function.  Decodes the encapsulation sections found at the top level
+  of a section stream on the BSP and the APs together, so that CreateChildNode()
+  can take the results instead of decoding them one at a time on the BSP.
+
+  @param Stream               The section stream to scan.
+
+**/
+VOID
+PrefetchEncapsulatedSections (
+  IN FRAMEWORK_SECTION_STREAM_NODE              *Stream
+  )
+;
+
 //
 // Module globals
 //
-LIST_ENTRY mStreamRoot = INITIALIZE_LIST_HEAD_VARIABLE (mStreamRoot);
+LIST_ENTRY mStreamHash[STREAM_HASH_SIZE];
 
 EFI_HANDLE mSectionExtractionHandle = NULL;
 
+LIST_ENTRY mDecodedSectionList = INITIALIZE_LIST_HEAD_VARIABLE (mDecodedSectionList);
+
+LIST_ENTRY mDecodedSectionHash[DECODED_SECTION_HASH_SIZE];
+
+//
+// Scratch buffer of the Decompress Protocol.  It is kept from one compression
+// section to the next and only grows when a section needs a larger one.
+//
+VOID   *mScratchBuffer     = NULL;
+UINT32 mScratchBufferSize  = 0;
+
+SECTION_EXTRACTION_STATISTICS_PROTOCOL mSectionExtractionStatistics = {
+  SECTION_EXTRACTION_STATISTICS_PROTOCOL_REVISION
+};
+
 EFI_SECTION_EXTRACTION_PROTOCOL mSectionExtraction = { 
   OpenSectionStream, 
   GetSection, 
@@ -243,15 +458,26 @@ SectionExtractionEntryPoint (
   )
 {
   EFI_STATUS                         Status;
+  UINTN                              Index;
+
+  for (Index = 0; Index < STREAM_HASH_SIZE; Index++) {
+    InitializeListHead (&mStreamHash[Index]);
+  }
+  for (Index = 0; Index < DECODED_SECTION_HASH_SIZE; Index++) {
+    InitializeListHead (&mDecodedSectionHash[Index]);
+  }
+  mSectionExtractionStatistics.CacheSize = PcdGet32 (PcdSectionExtractionCacheSize);
 
   //
   // Install SEP to a new handle
   //
-  Status = gBS->InstallProtocolInterface (
+  Status = gBS->InstallMultipleProtocolInterfaces (
                   &mSectionExtractionHandle,
                   &gEfiSectionExtractionProtocolGuid,
-                  EFI_NATIVE_INTERFACE,
-                  &mSectionExtraction
+                  &mSectionExtraction,
+                  &gSectionExtractionStatisticsProtocolGuid,
+                  &mSectionExtractionStatistics,
+                  NULL
                   );
   ASSERT_EFI_ERROR (Status);
 
@@ -383,13 +609,17 @@ OpenSectionStreamEx (
   NewStream->StreamHandle = (UINTN) NewStream;
   NewStream->StreamLength = SectionStreamLength;
   InitializeListHead (&NewStream->Children);
+  InitializeListHead (&NewStream->SectionIndex);
+  ZeroMem (&NewStream->Encapsulations, sizeof (NewStream->Encapsulations));
   NewStream->AuthenticationStatus = AuthenticationStatus;
+  InitializeListHead (&NewStream->PrefetchedSections);
+  NewStream->DecodedSection = NULL;
   
   //
   // Add new stream to stream list
   //
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
-  InsertTailList (&mStreamRoot, &NewStream->Link);
+  InsertTailList (&mStreamHash[STREAM_HASH (NewStream->StreamHandle)], &NewStream->Link);
   gBS->RestoreTPL (OldTpl);
 
   *SectionStreamHandle = NewStream->StreamHandle;
@@ -422,6 +652,8 @@ OpenSectionStream (
      OUT UINTN                                     *SectionStreamHandle
   )
 {
+  EFI_STATUS                                      Status;
+
   //
   // Check to see section stream looks good...
   //
@@ -429,53 +661,18 @@ OpenSectionStream (
     return EFI_INVALID_PARAMETER;
   }
   
-  return OpenSectionStreamEx ( 
-          SectionStreamLength, 
-          SectionStream,
-          TRUE,
-          0,
-          SectionStreamHandle
-          );
-}
-
-/**
-  Worker function.  Determine if the input stream:child matches the input type.
-
-  @param Stream                 Indicates the section stream associated with the child
-  @param Child                  Indicates the child to check
-  @param SearchType             Indicates the type of section to check against for
-  @param SectionDefinitionGuid  Indicates the GUID to check against if the type is
-                                EFI_SECTION_GUID_DEFINED
-
-  @retval TRUE                  The child matches
-  @retval FALSE                 The child doesn't match
-
-**/
-BOOLEAN
-ChildIsType (
-  IN FRAMEWORK_SECTION_STREAM_NODE *Stream,
-  IN FRAMEWORK_SECTION_CHILD_NODE  *Child,
-  IN EFI_SECTION_TYPE              SearchType,
-  IN EFI_GUID                      *SectionDefinitionGuid
-  )
-{
-  EFI_GUID_DEFINED_SECTION    *GuidedSection;
-  
-  if (SearchType == EFI_SECTION_ALL) {
-    return TRUE;
-  }
-  if (Child->Type != SearchType) {
-    return FALSE;
-  }
-  if ((SearchType != EFI_SECTION_GUID_DEFINED) || (SectionDefinitionGuid == NULL)) {
-    return TRUE;
-  }
-  GuidedSection = (EFI_GUID_DEFINED_SECTION * )(Stream->StreamBuffer + Child->OffsetInStream);
-  if (IS_SECTION2 (GuidedSection)) {
-    return CompareGuid (&(((EFI_GUID_DEFINED_SECTION2 *) GuidedSection)->SectionDefinitionGuid), SectionDefinitionGuid);
-  } else {
-    return CompareGuid (&GuidedSection->SectionDefinitionGuid, SectionDefinitionGuid);
+  Status = OpenSectionStreamEx ( 
+             SectionStreamLength, 
+             SectionStream,
+             TRUE,
+             0,
+             SectionStreamHandle
+             );
+  if (!EFI_ERROR (Status) && FeaturePcdGet (PcdSectionExtractionParallelDecompress)) {
+    PrefetchEncapsulatedSections ((FRAMEWORK_SECTION_STREAM_NODE *) *SectionStreamHandle);
   }
+
+  return Status;
 }
 
 /**
@@ -700,189 +897,1194 @@ CreateGuidedExtractionRpnEvent (
 }
 
 /**
-  Worker function.  Constructor for new child nodes.
+  Worker function.  Computes the key of an encapsulation section in the
+  decoded section cache.
 
-  @param Stream                Indicates the section stream in which to add the child.
-  @param ChildOffset           Indicates the offset in Stream that is the beginning
-                               of the child section.
-  @param ChildNode             Indicates the Callee allocated and initialized child.
+  @param SectionHeader          Points to the encapsulation section.
+  @param OffsetInStream         Indicates the offset of the section in its stream.
+  @param SectionDefinitionGuid  The GUID of a GUID defined section, or NULL for
+                                a compression section.
+  @param Key                    Output key.
 
-  @retval EFI_SUCCESS          Child node was found and returned.
-  @retval EFI_OUT_OF_RESOURCES Memory allocation failed.
-  @retval EFI_PROTOCOL_ERROR   Encapsulation sections produce new stream handles when
-                               the child node is created.  If the section type is GUID
-                               defined, and the extraction GUID does not exist, and
-                               producing the stream requires the GUID, then a protocol
-                               error is generated and no child is produced.
-                               Values returned by OpenSectionStreamEx.
+  The key points to the section, which must stay in place while it is used.
+
+  @retval EFI_SUCCESS           The key was computed.
+  @retval EFI_UNSUPPORTED       The decoded section cache is disabled.
+  @retval Others                The CRC32 of the section could not be computed.
 
 **/
 EFI_STATUS
-CreateChildNode (
-  IN     FRAMEWORK_SECTION_STREAM_NODE              *Stream,
-  IN     UINT32                                     ChildOffset,
-  OUT    FRAMEWORK_SECTION_CHILD_NODE               **ChildNode
+GetDecodedSectionKey (
+  IN  EFI_COMMON_SECTION_HEADER          *SectionHeader,
+  IN  UINT32                             OffsetInStream,
+  IN  EFI_GUID                           *SectionDefinitionGuid,
+  OUT DECODED_SECTION_KEY                *Key
   )
 {
-  EFI_STATUS                                   Status;
-  EFI_COMMON_SECTION_HEADER                    *SectionHeader;
-  EFI_COMPRESSION_SECTION                      *CompressionHeader;
-  EFI_GUID_DEFINED_SECTION                     *GuidedHeader;
-  EFI_DECOMPRESS_PROTOCOL                      *Decompress;
-  EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL       *GuidedExtraction;
-  VOID                                         *NewStreamBuffer;
-  VOID                                         *ScratchBuffer;
-  UINT32                                       ScratchSize;
-  UINTN                                        NewStreamBufferSize;
-  UINT32                                       AuthenticationStatus;
-  VOID                                         *CompressionSource;
-  UINT32                                       CompressionSourceSize;
-  UINT32                                       UncompressedLength;
-  UINT8                                        CompressionType;
-  UINT16                                       GuidedSectionAttributes;
-    
-  FRAMEWORK_SECTION_CHILD_NODE                      *Node;
+  EFI_STATUS                             Status;
+  UINT32                                 SectionSize;
 
-  SectionHeader = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + ChildOffset);
-
-  //
-  // Allocate a new node
-  //
-  *ChildNode = AllocateZeroPool (sizeof (FRAMEWORK_SECTION_CHILD_NODE));
-  Node = *ChildNode;
-  if (Node == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  if (mSectionExtractionStatistics.CacheSize == 0) {
+    return EFI_UNSUPPORTED;
   }
-  
-  //
-  // Now initialize it
-  //
-  Node->Signature = FRAMEWORK_SECTION_CHILD_SIGNATURE;
-  Node->Type = SectionHeader->Type;
+
   if (IS_SECTION2 (SectionHeader)) {
-    Node->Size = SECTION2_SIZE (SectionHeader);
+    SectionSize = SECTION2_SIZE (SectionHeader);
   } else {
-    Node->Size = SECTION_SIZE (SectionHeader);
+    SectionSize = SECTION_SIZE (SectionHeader);
   }
-  Node->OffsetInStream = ChildOffset;
-  Node->EncapsulatedStreamHandle = NULL_STREAM_HANDLE;
-  Node->EncapsulationGuid = NULL;
-  
-  //
-  // If it's an encapsulating section, then create the new section stream also
-  //
-  switch (Node->Type) {
-    case EFI_SECTION_COMPRESSION:
-      //
-      // Get the CompressionSectionHeader
-      //
-      if (Node->Size < sizeof (EFI_COMPRESSION_SECTION)) {
-        FreePool (Node);
-        return EFI_NOT_FOUND;
-      }
 
-      CompressionHeader = (EFI_COMPRESSION_SECTION *) SectionHeader;
+  ZeroMem (Key, sizeof (DECODED_SECTION_KEY));
+  Status = gBS->CalculateCrc32 (SectionHeader, SectionSize, &Key->Crc32);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Key->SectionSize    = SectionSize;
+  Key->OffsetInStream = OffsetInStream;
+  Key->Section        = SectionHeader;
+  if (SectionDefinitionGuid != NULL) {
+    CopyGuid (&Key->SectionDefinitionGuid, SectionDefinitionGuid);
+  }
 
-      if (IS_SECTION2 (CompressionHeader)) {
-        CompressionSource = (VOID *) ((UINT8 *) CompressionHeader + sizeof (EFI_COMPRESSION_SECTION2));
-        CompressionSourceSize = (UINT32) (SECTION2_SIZE (CompressionHeader) - sizeof (EFI_COMPRESSION_SECTION2));
-        UncompressedLength = ((EFI_COMPRESSION_SECTION2 *) CompressionHeader)->UncompressedLength;
-        CompressionType = ((EFI_COMPRESSION_SECTION2 *) CompressionHeader)->CompressionType;
-      } else {
-        CompressionSource = (VOID *) ((UINT8 *) CompressionHeader + sizeof (EFI_COMPRESSION_SECTION));
-        CompressionSourceSize = (UINT32) (SECTION_SIZE (CompressionHeader) - sizeof (EFI_COMPRESSION_SECTION));
-        UncompressedLength = CompressionHeader->UncompressedLength;
-        CompressionType = CompressionHeader->CompressionType;
-      }
+  return EFI_SUCCESS;
+}
 
-      //
-      // Allocate space for the new stream
-      //
-      if (UncompressedLength > 0) {
-        NewStreamBufferSize = UncompressedLength;
-        NewStreamBuffer = AllocatePool (NewStreamBufferSize);
-        if (NewStreamBuffer == NULL) {
-          FreePool (Node);
-          return EFI_OUT_OF_RESOURCES;
-        }
-        
-        if (CompressionType == EFI_NOT_COMPRESSED) {
-          //
-          // stream is not actually compressed, just encapsulated.  So just copy it.
-          //
-          CopyMem (NewStreamBuffer, CompressionSource, NewStreamBufferSize);
-        } else if (CompressionType == EFI_STANDARD_COMPRESSION) {
-          //
-          // Only support the EFI_SATNDARD_COMPRESSION algorithm.
-          // 
+/**
+  Worker function.  Searches the decoded section cache.
 
-          //
-          // Decompress the stream
-          //
-          Status = gBS->LocateProtocol (&gEfiDecompressProtocolGuid, NULL, (VOID **)&Decompress);
-          
-          ASSERT_EFI_ERROR (Status);
-          
-          Status = Decompress->GetInfo (
-                                 Decompress,
-                                 CompressionSource,
-                                 CompressionSourceSize,
-                                 (UINT32 *)&NewStreamBufferSize,
-                                 &ScratchSize
-                                 );
-          if (EFI_ERROR (Status) || (NewStreamBufferSize != UncompressedLength)) {
-            FreePool (Node);
-            FreePool (NewStreamBuffer);
-            if (!EFI_ERROR (Status)) {
-              Status = EFI_BAD_BUFFER_SIZE;
-            }
-            return Status;
-          }
+  @param Key                 Indicates the key to look for.
 
-          ScratchBuffer = AllocatePool (ScratchSize);
-          if (ScratchBuffer == NULL) {
-            FreePool (Node);
-            FreePool (NewStreamBuffer);
-            return EFI_OUT_OF_RESOURCES;
-          }
+  @return The cache entry, or NULL if the key is not in the cache.
 
-          Status = Decompress->Decompress (
-                                 Decompress,
-                                 CompressionSource,
-                                 CompressionSourceSize,
-                                 NewStreamBuffer,
-                                 (UINT32)NewStreamBufferSize,
-                                 ScratchBuffer,
-                                 ScratchSize
-                                 );
-          FreePool (ScratchBuffer); 
-          if (EFI_ERROR (Status)) {
-            FreePool (Node);
-            FreePool (NewStreamBuffer);
-            return Status;
-          }
-        }
-      } else {
-        NewStreamBuffer = NULL;
-        NewStreamBufferSize = 0;
-      }
-      
-      Status = OpenSectionStreamEx (
-                 NewStreamBufferSize,
-                 NewStreamBuffer,
-                 FALSE,
-                 Stream->AuthenticationStatus,
-                 &Node->EncapsulatedStreamHandle
-                 );
-      if (EFI_ERROR (Status)) {
-        FreePool (Node);
-        FreePool (NewStreamBuffer);
-        return Status;
-      }
-      break;
+**/
+DECODED_SECTION *
+FindDecodedSection (
+  IN DECODED_SECTION_KEY                 *Key
+  )
+{
+  LIST_ENTRY                             *Bucket;
+  LIST_ENTRY                             *Link;
+  DECODED_SECTION                        *DecodedSection;
+
+  Bucket = &mDecodedSectionHash[Key->Crc32 % DECODED_SECTION_HASH_SIZE];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    DecodedSection = DECODED_SECTION_FROM_HASH_LINK (Link);
+    if ((DecodedSection->Key.Crc32 == Key->Crc32) &&
+        (DecodedSection->Key.SectionSize == Key->SectionSize) &&
+        (DecodedSection->Key.OffsetInStream == Key->OffsetInStream) &&
+        CompareGuid (&DecodedSection->Key.SectionDefinitionGuid, &Key->SectionDefinitionGuid) &&
+        (CompareMem (DecodedSection->Key.Section, Key->Section, Key->SectionSize) == 0)) {
+      return DecodedSection;
+    }
+  }
 
-    case EFI_SECTION_GUID_DEFINED:
-      GuidedHeader = (EFI_GUID_DEFINED_SECTION *) SectionHeader;
+  return NULL;
+}
+
+/**
+  Worker function.  Looks up an encapsulation section in the decoded section
+  cache and takes a reference on the entry if it is found.
+
+  @param Key                 Indicates the key to look for.
+
+  @return The cache entry, or NULL if the section has to be decoded.
+
+**/
+DECODED_SECTION *
+AcquireDecodedSection (
+  IN DECODED_SECTION_KEY                 *Key
+  )
+{
+  DECODED_SECTION                        *DecodedSection;
+
+  DecodedSection = FindDecodedSection (Key);
+  if (DecodedSection == NULL) {
+    mSectionExtractionStatistics.MissCount++;
+    return NULL;
+  }
+
+  mSectionExtractionStatistics.HitCount++;
+  RemoveEntryList (&DecodedSection->Link);
+  InsertHeadList (&mDecodedSectionList, &DecodedSection->Link);
+  DecodedSection->RefCount++;
+  return DecodedSection;
+}
+
+/**
+  Worker function.  Drops a reference on a decoded section cache entry.  The
+  entry is freed if it is no longer in the cache and no longer used.
+
+  @param DecodedSection      Indicates the cache entry to release.
+
+**/
+VOID
+ReleaseDecodedSection (
+  IN DECODED_SECTION                     *DecodedSection
+  )
+{
+  ASSERT (DecodedSection->Signature == DECODED_SECTION_SIGNATURE);
+  ASSERT (DecodedSection->RefCount > 0);
+
+  DecodedSection->RefCount--;
+  if ((DecodedSection->RefCount == 0) && !DecodedSection->InCache) {
+    FreePool (DecodedSection->Key.Section);
+    FreePool (DecodedSection->Buffer);
+    FreePool (DecodedSection);
+  }
+}
+
+/**
+  Worker function.  Removes an entry from the decoded section cache.
+
+  @param DecodedSection      Indicates the cache entry to evict.
+
+**/
+VOID
+EvictDecodedSection (
+  IN DECODED_SECTION                     *DecodedSection
+  )
+{
+  ASSERT (DecodedSection->InCache);
+
+  RemoveEntryList (&DecodedSection->Link);
+  RemoveEntryList (&DecodedSection->HashLink);
+  DecodedSection->InCache = FALSE;
+  mSectionExtractionStatistics.CacheBytes -= DecodedSection->BufferSize + DecodedSection->Key.SectionSize;
+  mSectionExtractionStatistics.CacheEntryCount--;
+  mSectionExtractionStatistics.EvictionCount++;
+
+  if (DecodedSection->RefCount == 0) {
+    FreePool (DecodedSection->Key.Section);
+    FreePool (DecodedSection->Buffer);
+    FreePool (DecodedSection);
+  }
+}
+
+/**
+  Worker function.  Adds a newly decoded encapsulation section to the decoded
+  section cache, evicting the least recently used entries as needed.  On
+  success the cache entry takes ownership of Buffer and the caller holds a
+  reference on it.  The entry keeps a copy of the section, which counts
+  toward the cache size along with the decoded stream.
+
+  @param Key                   Indicates the key of the section.
+  @param Buffer                The decoded stream.
+  @param BufferSize            The size in bytes of the decoded stream.
+  @param AuthenticationStatus  The authentication status returned by the
+                               GUIDed section extraction protocol.
+
+  @return The cache entry, or NULL if the stream was not cached and Buffer
+          still belongs to the caller.
+
+**/
+DECODED_SECTION *
+InsertDecodedSection (
+  IN DECODED_SECTION_KEY                 *Key,
+  IN VOID                                *Buffer,
+  IN UINTN                               BufferSize,
+  IN UINT32                              AuthenticationStatus
+  )
+{
+  DECODED_SECTION                        *DecodedSection;
+  VOID                                   *Section;
+  UINTN                                  EntrySize;
+
+  EntrySize = BufferSize + Key->SectionSize;
+  if (EntrySize > mSectionExtractionStatistics.CacheSize) {
+    return NULL;
+  }
+
+  DecodedSection = AllocateZeroPool (sizeof (DECODED_SECTION));
+  if (DecodedSection == NULL) {
+    return NULL;
+  }
+  Section = AllocateCopyPool (Key->SectionSize, Key->Section);
+  if (Section == NULL) {
+    FreePool (DecodedSection);
+    return NULL;
+  }
+
+  while (mSectionExtractionStatistics.CacheBytes + EntrySize > mSectionExtractionStatistics.CacheSize) {
+    ASSERT (!IsListEmpty (&mDecodedSectionList));
+    EvictDecodedSection (DECODED_SECTION_FROM_LINK (GetPreviousNode (&mDecodedSectionList, &mDecodedSectionList)));
+  }
+
+  DecodedSection->Signature            = DECODED_SECTION_SIGNATURE;
+  DecodedSection->Buffer               = Buffer;
+  DecodedSection->BufferSize           = BufferSize;
+  DecodedSection->AuthenticationStatus = AuthenticationStatus;
+  DecodedSection->RefCount             = 1;
+  DecodedSection->InCache              = TRUE;
+  CopyMem (&DecodedSection->Key, Key, sizeof (DECODED_SECTION_KEY));
+  DecodedSection->Key.Section          = Section;
+  InsertHeadList (&mDecodedSectionList, &DecodedSection->Link);
+  InsertTailList (&mDecodedSectionHash[Key->Crc32 % DECODED_SECTION_HASH_SIZE], &DecodedSection->HashLink);
+
+  mSectionExtractionStatistics.CacheBytes += EntrySize;
+  mSectionExtractionStatistics.CacheEntryCount++;
+  return DecodedSection;
+}
+
+/**
+  Worker function.  Destructor for prefetched sections.  The caller removes the
+  section from its list first if it is on one.
+
+  @param Prefetched          Indicates the prefetched section to destroy.
+
+**/
+VOID
+FreePrefetchedSection (
+  IN PREFETCHED_SECTION                  *Prefetched
+  )
+{
+  ASSERT (Prefetched->Signature == PREFETCHED_SECTION_SIGNATURE);
+  if (Prefetched->Buffer != NULL) {
+    FreePool (Prefetched->Buffer);
+  }
+  FreePool (Prefetched);
+}
+
+/**
+  Worker function.  Constructor for prefetched sections.
+
+  Only sections whose decoder touches nothing but memory are accepted, since
+  the decoding may run on an AP: compression sections using
+  EFI_STANDARD_COMPRESSION, and the GUID defined sections of
+  gTianoCustomDecompressGuid and gLzmaCustomDecompressGuid whose extraction
+  protocol is available.  Any other GUID defined section is left to its
+  extraction protocol on the BSP, because its ExtractGuidedSectionLib handler
+  may call boot services.  Sections found in the decoded section cache are
+  skipped.  The output buffer is allocated here, on the BSP.
+
+  @param Stream              Indicates the section stream holding the section.
+  @param Offset              Indicates the offset of the section in Stream.
+  @param Prefetched          Indicates the callee allocated prefetched section.
+
+  @retval EFI_SUCCESS          The section can be decoded on an AP.
+  @retval EFI_UNSUPPORTED      The section is not an encapsulation that can be
+                               decoded ahead of time.
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failed.
+
+**/
+EFI_STATUS
+CreatePrefetchedSection (
+  IN  FRAMEWORK_SECTION_STREAM_NODE      *Stream,
+  IN  UINT32                             Offset,
+  OUT PREFETCHED_SECTION                 **Prefetched
+  )
+{
+  EFI_STATUS                              Status;
+  EFI_COMMON_SECTION_HEADER               *SectionHeader;
+  EFI_COMPRESSION_SECTION                 *CompressionHeader;
+  EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL  *GuidedExtraction;
+  EFI_GUID                                *SectionDefinitionGuid;
+  PREFETCH_DECODER                        Decoder;
+  VOID                                    *Source;
+  UINT32                                  SourceSize;
+  UINT32                                  SectionSize;
+  UINT32                                  DataOffset;
+  UINT32                                  UncompressedLength;
+  UINT8                                   CompressionType;
+  UINT32                                  OutputSize;
+  UINT32                                  ScratchSize;
+  DECODED_SECTION_KEY                     Key;
+  DECODED_SECTION                         *DecodedSection;
+  EFI_TPL                                 OldTpl;
+  PREFETCHED_SECTION                      *Node;
+
+  SectionHeader         = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + Offset);
+  SectionDefinitionGuid = NULL;
+  Source                = NULL;
+  SourceSize            = 0;
+
+  switch (SectionHeader->Type) {
+    case EFI_SECTION_COMPRESSION:
+      CompressionHeader = (EFI_COMPRESSION_SECTION *) SectionHeader;
+      if (IS_SECTION2 (CompressionHeader)) {
+        if (SECTION2_SIZE (CompressionHeader) < sizeof (EFI_COMPRESSION_SECTION2)) {
+          return EFI_UNSUPPORTED;
+        }
+        Source = (VOID *) ((UINT8 *) CompressionHeader + sizeof (EFI_COMPRESSION_SECTION2));
+        SourceSize = (UINT32) (SECTION2_SIZE (CompressionHeader) - sizeof (EFI_COMPRESSION_SECTION2));
+        UncompressedLength = ((EFI_COMPRESSION_SECTION2 *) CompressionHeader)->UncompressedLength;
+        CompressionType = ((EFI_COMPRESSION_SECTION2 *) CompressionHeader)->CompressionType;
+      } else {
+        if (SECTION_SIZE (CompressionHeader) < sizeof (EFI_COMPRESSION_SECTION)) {
+          return EFI_UNSUPPORTED;
+        }
+        Source = (VOID *) ((UINT8 *) CompressionHeader + sizeof (EFI_COMPRESSION_SECTION));
+        SourceSize = (UINT32) (SECTION_SIZE (CompressionHeader) - sizeof (EFI_COMPRESSION_SECTION));
+        UncompressedLength = CompressionHeader->UncompressedLength;
+        CompressionType = CompressionHeader->CompressionType;
+      }
+      if ((CompressionType != EFI_STANDARD_COMPRESSION) || (UncompressedLength == 0)) {
+        return EFI_UNSUPPORTED;
+      }
+      Decoder = PrefetchUefiDecompress;
+      Status = UefiTianoDecompressStreamGetInfo (Source, SourceSize, 1, &OutputSize, &ScratchSize);
+      if (EFI_ERROR (Status) || (OutputSize != UncompressedLength)) {
+        return EFI_UNSUPPORTED;
+      }
+      break;
+
+    case EFI_SECTION_GUID_DEFINED:
+      if (IS_SECTION2 (SectionHeader)) {
+        SectionDefinitionGuid = &(((EFI_GUID_DEFINED_SECTION2 *) SectionHeader)->SectionDefinitionGuid);
+        SectionSize = SECTION2_SIZE (SectionHeader);
+        DataOffset = ((EFI_GUID_DEFINED_SECTION2 *) SectionHeader)->DataOffset;
+      } else {
+        SectionDefinitionGuid = &(((EFI_GUID_DEFINED_SECTION *) SectionHeader)->SectionDefinitionGuid);
+        SectionSize = SECTION_SIZE (SectionHeader);
+        DataOffset = ((EFI_GUID_DEFINED_SECTION *) SectionHeader)->DataOffset;
+      }
+      if (!CompareGuid (SectionDefinitionGuid, &gTianoCustomDecompressGuid) &&
+          !CompareGuid (SectionDefinitionGuid, &gLzmaCustomDecompressGuid)) {
+        return EFI_UNSUPPORTED;
+      }
+      if (!VerifyGuidedSectionGuid (SectionDefinitionGuid, &GuidedExtraction)) {
+        return EFI_UNSUPPORTED;
+      }
+      if (DataOffset >= SectionSize) {
+        return EFI_UNSUPPORTED;
+      }
+      Source = (VOID *) ((UINT8 *) SectionHeader + DataOffset);
+      SourceSize = SectionSize - DataOffset;
+      if (CompareGuid (SectionDefinitionGuid, &gTianoCustomDecompressGuid)) {
+        Decoder = PrefetchTianoDecompress;
+        Status = UefiTianoDecompressStreamGetInfo (Source, SourceSize, 2, &OutputSize, &ScratchSize);
+      } else {
+        Decoder = PrefetchLzmaDecompress;
+        Status = LzmaUefiDecompressStreamGetInfo (Source, SourceSize, &OutputSize, &ScratchSize);
+      }
+      if (EFI_ERROR (Status) || (OutputSize == 0)) {
+        return EFI_UNSUPPORTED;
+      }
+      break;
+
+    default:
+      return EFI_UNSUPPORTED;
+  }
+
+  //
+  // There is nothing to do for a section already in the decoded section cache.
+  //
+  if (!EFI_ERROR (GetDecodedSectionKey (SectionHeader, Offset, SectionDefinitionGuid, &Key))) {
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    DecodedSection = FindDecodedSection (&Key);
+    gBS->RestoreTPL (OldTpl);
+    if (DecodedSection != NULL) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  Node = AllocateZeroPool (sizeof (PREFETCHED_SECTION));
+  if (Node == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Node->Signature      = PREFETCHED_SECTION_SIGNATURE;
+  Node->OffsetInStream = Offset;
+  Node->Section        = SectionHeader;
+  Node->Decoder        = Decoder;
+  Node->Source         = Source;
+  Node->SourceSize     = SourceSize;
+  Node->BufferSize     = OutputSize;
+  Node->Status         = EFI_NOT_READY;
+
+  Node->Buffer = AllocatePool (OutputSize);
+  if (Node->Buffer == NULL) {
+    FreePrefetchedSection (Node);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Prefetched = Node;
+  return EFI_SUCCESS;
+}
+
+/**
+  AP procedure, also run by the BSP.  Claims a decompression context, then
+  claims prefetched sections one at a time and decodes them with it until
+  none are left.  CreatePrefetchedSection() only accepts sections whose
+  decoders touch nothing but memory, as no boot service may be called on an
+  AP.
+
+  @param Buffer              Pointer to the PREFETCH_CONTEXT.
+
+**/
+VOID
+EFIAPI
+DecodePrefetchedSections (
+  IN VOID                                *Buffer
+  )
+{
+  PREFETCH_CONTEXT                       *Context;
+  PREFETCHED_SECTION                     *Prefetched;
+  UINT8                                  *TianoContext;
+  UINT32                                 Index;
+
+  Context = (PREFETCH_CONTEXT *) Buffer;
+  Index = InterlockedIncrement (&Context->NextWorker) - 1;
+  if (Index >= Context->WorkerCount) {
+    return;
+  }
+  TianoContext = Context->Workers + Index * Context->WorkerSize;
+
+  for (;;) {
+    Index = InterlockedIncrement (&Context->Next) - 1;
+    if (Index >= Context->Count) {
+      break;
+    }
+
+    Prefetched = Context->Sections[Index];
+    switch (Prefetched->Decoder) {
+      case PrefetchUefiDecompress:
+        Prefetched->Status = UefiTianoDecompressWithContext (Prefetched->Source, Prefetched->Buffer, TianoContext, 1);
+        break;
+
+      case PrefetchTianoDecompress:
+        Prefetched->Status = UefiTianoDecompressWithContext (Prefetched->Source, Prefetched->Buffer, TianoContext, 2);
+        break;
+
+      default:
+        Prefetched->Status = LzmaUefiDecompressWithContext (
+                               Prefetched->Source,
+                               Prefetched->SourceSize,
+                               Prefetched->Buffer,
+                               TianoContext + Context->LzmaContextOffset
+                               );
+        break;
+    }
+  }
+}
+
+/**
+  Worker function.  Decodes the encapsulation sections found at the top level
+  of a section stream on the BSP and the APs together, so that CreateChildNode()
+  can take the results instead of decoding them one at a time on the BSP.
+
+  The BSP claims sections alongside the APs when it runs at TPL_APPLICATION,
+  where it can wait for the APs with WaitForEvent().  At a higher TPL it waits
+  in a blocking StartupAllAPs() instead.
+
+  @param Stream               The section stream to scan.
+
+**/
+VOID
+PrefetchEncapsulatedSections (
+  IN FRAMEWORK_SECTION_STREAM_NODE              *Stream
+  )
+{
+  EFI_STATUS                                    Status;
+  EFI_MP_SERVICES_PROTOCOL                      *MpServices;
+  UINTN                                         NumberOfProcessors;
+  UINTN                                         NumberOfEnabledProcessors;
+  EFI_COMMON_SECTION_HEADER                     *SectionHeader;
+  UINTN                                         SectionSize;
+  UINTN                                         Offset;
+  PREFETCHED_SECTION                            *Prefetched;
+  PREFETCH_CONTEXT                              Context;
+  LIST_ENTRY                                    *Link;
+  LIST_ENTRY                                    *NextLink;
+  EFI_TPL                                       OldTpl;
+  EFI_EVENT                                     WaitEvent;
+  UINTN                                         Index;
+  UINT8                                         *Worker;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &MpServices);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  Status = MpServices->GetNumberOfProcessors (MpServices, &NumberOfProcessors, &NumberOfEnabledProcessors);
+  if (EFI_ERROR (Status) || (NumberOfEnabledProcessors < 2)) {
+    return;
+  }
+
+  //
+  // Collect the encapsulations of the top level sections.  Each one decodes
+  // from the stream buffer alone, so they are independent of each other.
+  //
+  Context.Count = 0;
+  Offset = 0;
+  while (Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= Stream->StreamLength) {
+    SectionHeader = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + Offset);
+    if (IS_SECTION2 (SectionHeader)) {
+      SectionSize = SECTION2_SIZE (SectionHeader);
+    } else {
+      SectionSize = SECTION_SIZE (SectionHeader);
+    }
+    if ((SectionSize < sizeof (EFI_COMMON_SECTION_HEADER)) || (SectionSize > Stream->StreamLength - Offset)) {
+      break;
+    }
+
+    Status = CreatePrefetchedSection (Stream, (UINT32) Offset, &Prefetched);
+    if (!EFI_ERROR (Status)) {
+      InsertTailList (&Stream->PrefetchedSections, &Prefetched->Link);
+      Context.Count++;
+    }
+
+    Offset = ALIGN_VALUE (Offset + SectionSize, 4);
+  }
+
+  //
+  // A single encapsulation gains nothing from being decoded in parallel.
+  //
+  Context.Sections = NULL;
+  Context.Workers = NULL;
+  if (Context.Count >= 2) {
+    Context.Sections = AllocatePool (Context.Count * sizeof (PREFETCHED_SECTION *));
+
+    //
+    // Each processor taking part decodes its sections with its own
+    // decompression contexts, which are set up here on the BSP.
+    //
+    Context.WorkerCount       = (UINT32) MIN (NumberOfEnabledProcessors, Context.Count);
+    Context.LzmaContextOffset = ALIGN_VALUE (UefiTianoDecompressContextGetSize (), sizeof (UINT64));
+    Context.WorkerSize        = ALIGN_VALUE (Context.LzmaContextOffset + LzmaUefiDecompressContextGetSize (), sizeof (UINT64));
+    Context.Workers           = AllocatePool (Context.WorkerCount * Context.WorkerSize);
+  }
+  if ((Context.Sections != NULL) && (Context.Workers != NULL)) {
+    for (Index = 0; Index < Context.WorkerCount; Index++) {
+      Worker = Context.Workers + Index * Context.WorkerSize;
+      UefiTianoDecompressContextInit (Worker);
+      LzmaUefiDecompressContextInit (Worker + Context.LzmaContextOffset);
+    }
+    Context.NextWorker = 0;
+
+    Context.Count = 0;
+    for (Link = GetFirstNode (&Stream->PrefetchedSections);
+         !IsNull (&Stream->PrefetchedSections, Link);
+         Link = GetNextNode (&Stream->PrefetchedSections, Link)) {
+      Context.Sections[Context.Count++] = PREFETCHED_SECTION_FROM_LINK (Link);
+    }
+    Context.Next = 0;
+
+    //
+    // WaitForEvent() may only be called at TPL_APPLICATION.
+    //
+    OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    gBS->RestoreTPL (OldTpl);
+    WaitEvent = NULL;
+    if (OldTpl == TPL_APPLICATION) {
+      Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &WaitEvent);
+      if (EFI_ERROR (Status)) {
+        WaitEvent = NULL;
+      }
+    }
+
+    //
+    // Sections not claimed, because the APs could not be started, are left
+    // with EFI_NOT_READY and are decoded by CreateChildNode() later.
+    //
+    Status = MpServices->StartupAllAPs (
+                           MpServices,
+                           DecodePrefetchedSections,
+                           FALSE,
+                           WaitEvent,
+                           0,
+                           &Context,
+                           NULL
+                           );
+    if (WaitEvent != NULL) {
+      if (!EFI_ERROR (Status)) {
+        DecodePrefetchedSections (&Context);
+        gBS->WaitForEvent (1, &WaitEvent, &Index);
+      }
+      gBS->CloseEvent (WaitEvent);
+    }
+  }
+  if (Context.Sections != NULL) {
+    FreePool (Context.Sections);
+  }
+  if (Context.Workers != NULL) {
+    FreePool (Context.Workers);
+  }
+
+  //
+  // Keep the decoded sections only.
+  //
+  for (Link = GetFirstNode (&Stream->PrefetchedSections);
+       !IsNull (&Stream->PrefetchedSections, Link);
+       Link = NextLink) {
+    NextLink = GetNextNode (&Stream->PrefetchedSections, Link);
+    Prefetched = PREFETCHED_SECTION_FROM_LINK (Link);
+    if (EFI_ERROR (Prefetched->Status)) {
+      RemoveEntryList (Link);
+      FreePrefetchedSection (Prefetched);
+    }
+  }
+}
+
+/**
+  Worker function.  Removes the prefetched section at the given offset from a
+  stream, if there is one.
+
+  @param Stream              Indicates the section stream holding the section.
+  @param Offset              Indicates the offset of the section in Stream.
+
+  @return The prefetched section, or NULL if the section was not decoded ahead
+          of time.  The caller owns its Buffer and frees the node itself.
+
+**/
+PREFETCHED_SECTION *
+TakePrefetchedSection (
+  IN FRAMEWORK_SECTION_STREAM_NODE       *Stream,
+  IN UINT32                              Offset
+  )
+{
+  LIST_ENTRY                             *Link;
+  PREFETCHED_SECTION                     *Prefetched;
+
+  for (Link = GetFirstNode (&Stream->PrefetchedSections);
+       !IsNull (&Stream->PrefetchedSections, Link);
+       Link = GetNextNode (&Stream->PrefetchedSections, Link)) {
+    Prefetched = PREFETCHED_SECTION_FROM_LINK (Link);
+    if (Prefetched->OffsetInStream == Offset) {
+      RemoveEntryList (Link);
+      return Prefetched;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Worker function.  Returns the scratch buffer of the Decompress Protocol,
+  growing it if it is smaller than requested.
+
+  The buffer is shared by all the compression sections, which are decoded
+  one at a time at TPL_NOTIFY.
+
+  @param ScratchSize           The size, in bytes, of the scratch buffer needed.
+
+  @return The scratch buffer, or NULL if it could not be allocated.
+
+**/
+VOID *
+GetScratchBuffer (
+  IN UINT32                                   ScratchSize
+  )
+{
+  if ((mScratchBuffer == NULL) || (ScratchSize > mScratchBufferSize)) {
+    if (mScratchBuffer != NULL) {
+      FreePool (mScratchBuffer);
+    }
+    mScratchBufferSize = 0;
+    mScratchBuffer = AllocatePool (ScratchSize);
+    if (mScratchBuffer == NULL) {
+      return NULL;
+    }
+    mScratchBufferSize = ScratchSize;
+  }
+  return mScratchBuffer;
+}
+
+/**
+  Worker function.  Makes room for one more child node in an array.
+
+  @param Array                 The array to grow.
+
+  @retval EFI_SUCCESS          The array can take one more child node.
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failed.
+
+**/
+EFI_STATUS
+GrowChildNodeArray (
+  IN OUT CHILD_NODE_ARRAY                     *Array
+  )
+{
+  FRAMEWORK_SECTION_CHILD_NODE                **Nodes;
+  UINTN                                       Capacity;
+
+  if (Array->Count < Array->Capacity) {
+    return EFI_SUCCESS;
+  }
+
+  Capacity = MAX (Array->Capacity * 2, CHILD_NODE_ARRAY_MIN_CAPACITY);
+  Nodes = ReallocatePool (
+            Array->Capacity * sizeof (FRAMEWORK_SECTION_CHILD_NODE *),
+            Capacity * sizeof (FRAMEWORK_SECTION_CHILD_NODE *),
+            Array->Nodes
+            );
+  if (Nodes == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Array->Nodes = Nodes;
+  Array->Capacity = Capacity;
+  return EFI_SUCCESS;
+}
+
+/**
+  Worker function.  Finds the index entry of a stream for a section type and
+  section definition GUID.
+
+  @param Stream                The section stream.
+  @param SearchType            The section type.
+  @param SectionDefinitionGuid The section definition GUID, or NULL for every
+                               section of SearchType.  Ignored unless SearchType
+                               is EFI_SECTION_GUID_DEFINED.
+  @param Create                TRUE to create the entry if it does not exist yet.
+
+  @return The index entry, or NULL if it does not exist and could not be created.
+
+**/
+SECTION_INDEX *
+GetSectionIndex (
+  IN FRAMEWORK_SECTION_STREAM_NODE            *Stream,
+  IN EFI_SECTION_TYPE                         SearchType,
+  IN EFI_GUID                                 *SectionDefinitionGuid,
+  IN BOOLEAN                                  Create
+  )
+{
+  LIST_ENTRY                                  *Link;
+  SECTION_INDEX                               *Index;
+
+  if (SearchType != EFI_SECTION_GUID_DEFINED) {
+    SectionDefinitionGuid = NULL;
+  }
+
+  for (Link = GetFirstNode (&Stream->SectionIndex); !IsNull (&Stream->SectionIndex, Link); Link = GetNextNode (&Stream->SectionIndex, Link)) {
+    Index = SECTION_INDEX_FROM_LINK (Link);
+    if (Index->Type != SearchType) {
+      continue;
+    }
+    if (SectionDefinitionGuid == NULL) {
+      if (Index->SectionDefinitionGuid == NULL) {
+        return Index;
+      }
+    } else if ((Index->SectionDefinitionGuid != NULL) &&
+               CompareGuid (Index->SectionDefinitionGuid, SectionDefinitionGuid)) {
+      return Index;
+    }
+  }
+
+  if (!Create) {
+    return NULL;
+  }
+
+  Index = AllocateZeroPool (sizeof (SECTION_INDEX));
+  if (Index == NULL) {
+    return NULL;
+  }
+  Index->Signature = SECTION_INDEX_SIGNATURE;
+  Index->Type = SearchType;
+  Index->SectionDefinitionGuid = SectionDefinitionGuid;
+  InsertTailList (&Stream->SectionIndex, &Index->Link);
+  return Index;
+}
+
+/**
+  Worker function.  Collects the child node arrays of a stream a section is
+  listed in.
+
+  @param Stream                The section stream.
+  @param SectionHeader         The section, in the stream buffer.
+  @param Arrays                Array of CHILD_INDEX_ARRAYS_MAX entries that
+                               receives the child node arrays.
+  @param ArrayCount            The number of child node arrays returned.
+
+  @retval EFI_SUCCESS          The child node arrays were returned.
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failed.
+
+**/
+EFI_STATUS
+GetChildIndexArrays (
+  IN  FRAMEWORK_SECTION_STREAM_NODE           *Stream,
+  IN  EFI_COMMON_SECTION_HEADER               *SectionHeader,
+  OUT CHILD_NODE_ARRAY                        **Arrays,
+  OUT UINTN                                   *ArrayCount
+  )
+{
+  SECTION_INDEX                               *Index;
+  EFI_GUID                                    *SectionDefinitionGuid;
+
+  *ArrayCount = 0;
+
+  Index = GetSectionIndex (Stream, EFI_SECTION_ALL, NULL, TRUE);
+  if (Index == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Arrays[(*ArrayCount)++] = &Index->Children;
+
+  if (SectionHeader->Type != EFI_SECTION_ALL) {
+    Index = GetSectionIndex (Stream, SectionHeader->Type, NULL, TRUE);
+    if (Index == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Arrays[(*ArrayCount)++] = &Index->Children;
+  }
+
+  if (SectionHeader->Type == EFI_SECTION_GUID_DEFINED) {
+    if (IS_SECTION2 (SectionHeader)) {
+      SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION2 *) SectionHeader)->SectionDefinitionGuid;
+    } else {
+      SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION *) SectionHeader)->SectionDefinitionGuid;
+    }
+    Index = GetSectionIndex (Stream, EFI_SECTION_GUID_DEFINED, SectionDefinitionGuid, TRUE);
+    if (Index == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Arrays[(*ArrayCount)++] = &Index->Children;
+  }
+
+  if ((SectionHeader->Type == EFI_SECTION_COMPRESSION) ||
+      (SectionHeader->Type == EFI_SECTION_GUID_DEFINED)) {
+    Arrays[(*ArrayCount)++] = &Stream->Encapsulations;
+  }
+
+  ASSERT (*ArrayCount <= CHILD_INDEX_ARRAYS_MAX);
+  return EFI_SUCCESS;
+}
+
+/**
+  Worker function.  Makes room in the index of a stream for a section that is
+  about to become a child node, so that adding the child node cannot fail.
+
+  @param Stream                The section stream.
+  @param SectionHeader         The section, in the stream buffer.
+
+  @retval EFI_SUCCESS          The index can take the child node.
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failed.
+
+**/
+EFI_STATUS
+ReserveChildIndex (
+  IN FRAMEWORK_SECTION_STREAM_NODE            *Stream,
+  IN EFI_COMMON_SECTION_HEADER                *SectionHeader
+  )
+{
+  EFI_STATUS                                  Status;
+  CHILD_NODE_ARRAY                            *Arrays[CHILD_INDEX_ARRAYS_MAX];
+  UINTN                                       ArrayCount;
+  UINTN                                       Index;
+
+  Status = GetChildIndexArrays (Stream, SectionHeader, Arrays, &ArrayCount);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  for (Index = 0; Index < ArrayCount; Index++) {
+    Status = GrowChildNodeArray (Arrays[Index]);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Worker function.  Adds a child node to the index of its stream.  Room must
+  have been made by ReserveChildIndex().
+
+  @param Stream                The section stream.
+  @param SectionHeader         The section of the child node, in the stream buffer.
+  @param Node                  The child node.
+
+**/
+VOID
+AddChildToIndex (
+  IN FRAMEWORK_SECTION_STREAM_NODE            *Stream,
+  IN EFI_COMMON_SECTION_HEADER                *SectionHeader,
+  IN FRAMEWORK_SECTION_CHILD_NODE             *Node
+  )
+{
+  EFI_STATUS                                  Status;
+  CHILD_NODE_ARRAY                            *Arrays[CHILD_INDEX_ARRAYS_MAX];
+  UINTN                                       ArrayCount;
+  UINTN                                       Index;
+
+  Status = GetChildIndexArrays (Stream, SectionHeader, Arrays, &ArrayCount);
+  ASSERT_EFI_ERROR (Status);
+  for (Index = 0; Index < ArrayCount; Index++) {
+    ASSERT (Arrays[Index]->Count < Arrays[Index]->Capacity);
+    Arrays[Index]->Nodes[Arrays[Index]->Count++] = Node;
+  }
+}
+
+/**
+  Worker function.  Frees the index of a stream.
+
+  @param Stream                The section stream.
+
+**/
+VOID
+FreeSectionIndex (
+  IN FRAMEWORK_SECTION_STREAM_NODE            *Stream
+  )
+{
+  SECTION_INDEX                               *Index;
+
+  while (!IsListEmpty (&Stream->SectionIndex)) {
+    Index = SECTION_INDEX_FROM_LINK (GetFirstNode (&Stream->SectionIndex));
+    RemoveEntryList (&Index->Link);
+    if (Index->Children.Nodes != NULL) {
+      FreePool (Index->Children.Nodes);
+    }
+    FreePool (Index);
+  }
+  if (Stream->Encapsulations.Nodes != NULL) {
+    FreePool (Stream->Encapsulations.Nodes);
+  }
+}
+
+/**
+  Worker function.  Counts the child nodes of an array, starting at a given
+  position, that are located at or before a given offset in the stream.
+
+  @param Array                 The child node array, in stream order.
+  @param Start                 The position in the array to start counting at.
+  @param LastOffset            The offset in the stream.
+
+  @return The number of child nodes.
+
+**/
+UINTN
+CountChildNodesUpTo (
+  IN CHILD_NODE_ARRAY                         *Array,
+  IN UINTN                                    Start,
+  IN UINT32                                   LastOffset
+  )
+{
+  UINTN                                       Low;
+  UINTN                                       High;
+  UINTN                                       Middle;
+
+  //
+  // Binary search for the first child located after LastOffset.
+  //
+  Low = Start;
+  High = Array->Count;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Array->Nodes[Middle]->OffsetInStream <= LastOffset) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+  return Low - Start;
+}
+
+/**
+  Worker function.  Constructor for new child nodes.
+
+  @param Stream                Indicates the section stream in which to add the child.
+  @param ChildOffset           Indicates the offset in Stream that is the beginning
+                               of the child section.
+  @param ChildNode             Indicates the Callee allocated and initialized child.
+
+  @retval EFI_SUCCESS          Child node was found and returned.
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failed.
+  @retval EFI_PROTOCOL_ERROR   Encapsulation sections produce new stream handles when
+                               the child node is created.  If the section type is GUID
+                               defined, and the extraction GUID does not exist, and
+                               producing the stream requires the GUID, then a protocol
+                               error is generated and no child is produced.
+                               Values returned by OpenSectionStreamEx.
+
+**/
+EFI_STATUS
+CreateChildNode (
+  IN     FRAMEWORK_SECTION_STREAM_NODE              *Stream,
+  IN     UINT32                                     ChildOffset,
+  OUT    FRAMEWORK_SECTION_CHILD_NODE               **ChildNode
+  )
+{
+  EFI_STATUS                                   Status;
+  EFI_COMMON_SECTION_HEADER                    *SectionHeader;
+  EFI_COMPRESSION_SECTION                      *CompressionHeader;
+  EFI_GUID_DEFINED_SECTION                     *GuidedHeader;
+  EFI_DECOMPRESS_PROTOCOL                      *Decompress;
+  EFI_GUIDED_SECTION_EXTRACTION_PROTOCOL       *GuidedExtraction;
+  VOID                                         *NewStreamBuffer;
+  VOID                                         *ScratchBuffer;
+  UINT32                                       ScratchSize;
+  UINTN                                        NewStreamBufferSize;
+  UINT32                                       AuthenticationStatus;
+  VOID                                         *CompressionSource;
+  UINT32                                       CompressionSourceSize;
+  UINT32                                       UncompressedLength;
+  UINT8                                        CompressionType;
+  UINT16                                       GuidedSectionAttributes;
+  PREFETCHED_SECTION                           *Prefetched;
+  DECODED_SECTION_KEY                          CacheKey;
+  BOOLEAN                                      CacheKeyValid;
+  DECODED_SECTION                              *DecodedSection;
+    
+  FRAMEWORK_SECTION_CHILD_NODE                      *Node;
+
+  SectionHeader = (EFI_COMMON_SECTION_HEADER *) (Stream->StreamBuffer + ChildOffset);
+
+  Status = ReserveChildIndex (Stream, SectionHeader);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Allocate a new node
+  //
+  *ChildNode = AllocateZeroPool (sizeof (FRAMEWORK_SECTION_CHILD_NODE));
+  Node = *ChildNode;
+  if (Node == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  
+  //
+  // Now initialize it
+  //
+  Node->Signature = FRAMEWORK_SECTION_CHILD_SIGNATURE;
+  Node->Type = SectionHeader->Type;
+  if (IS_SECTION2 (SectionHeader)) {
+    Node->Size = SECTION2_SIZE (SectionHeader);
+  } else {
+    Node->Size = SECTION_SIZE (SectionHeader);
+  }
+  Node->OffsetInStream = ChildOffset;
+  Node->EncapsulatedStreamHandle = NULL_STREAM_HANDLE;
+  Node->EncapsulationGuid = NULL;
+  DecodedSection = NULL;
+  
+  //
+  // If it's an encapsulating section, then create the new section stream also
+  //
+  switch (Node->Type) {
+    case EFI_SECTION_COMPRESSION:
+      //
+      // Get the CompressionSectionHeader
+      //
+      if (Node->Size < sizeof (EFI_COMPRESSION_SECTION)) {
+        FreePool (Node);
+        return EFI_NOT_FOUND;
+      }
+
+      CompressionHeader = (EFI_COMPRESSION_SECTION *) SectionHeader;
+
+      if (IS_SECTION2 (CompressionHeader)) {
+        CompressionSource = (VOID *) ((UINT8 *) CompressionHeader + sizeof (EFI_COMPRESSION_SECTION2));
+        CompressionSourceSize = (UINT32) (SECTION2_SIZE (CompressionHeader) - sizeof (EFI_COMPRESSION_SECTION2));
+        UncompressedLength = ((EFI_COMPRESSION_SECTION2 *) CompressionHeader)->UncompressedLength;
+        CompressionType = ((EFI_COMPRESSION_SECTION2 *) CompressionHeader)->CompressionType;
+      } else {
+        CompressionSource = (VOID *) ((UINT8 *) CompressionHeader + sizeof (EFI_COMPRESSION_SECTION));
+        CompressionSourceSize = (UINT32) (SECTION_SIZE (CompressionHeader) - sizeof (EFI_COMPRESSION_SECTION));
+        UncompressedLength = CompressionHeader->UncompressedLength;
+        CompressionType = CompressionHeader->CompressionType;
+      }
+
+      //
+      // Allocate space for the new stream
+      //
+      if (UncompressedLength > 0) {
+        NewStreamBufferSize = UncompressedLength;
+        CacheKeyValid = (BOOLEAN) ((CompressionType == EFI_STANDARD_COMPRESSION) &&
+                                   !EFI_ERROR (GetDecodedSectionKey (SectionHeader, ChildOffset, NULL, &CacheKey)));
+        if (CacheKeyValid) {
+          DecodedSection = AcquireDecodedSection (&CacheKey);
+        }
+        Prefetched = NULL;
+        if (DecodedSection == NULL) {
+          Prefetched = TakePrefetchedSection (Stream, ChildOffset);
+        }
+        if (DecodedSection != NULL) {
+          //
+          // The same section was decompressed for a stream opened earlier.
+          //
+          NewStreamBuffer = DecodedSection->Buffer;
+        } else if (Prefetched != NULL) {
+          //
+          // The stream was already decompressed on an AP.
+          //
+          NewStreamBuffer = Prefetched->Buffer;
+          FreePool (Prefetched);
+        } else {
+          NewStreamBuffer = AllocatePool (NewStreamBufferSize);
+          if (NewStreamBuffer == NULL) {
+            FreePool (Node);
+            return EFI_OUT_OF_RESOURCES;
+          }
+        
+          if (CompressionType == EFI_NOT_COMPRESSED) {
+            //
+            // stream is not actually compressed, just encapsulated.  So just copy it.
+            //
+            CopyMem (NewStreamBuffer, CompressionSource, NewStreamBufferSize);
+          } else if (CompressionType == EFI_STANDARD_COMPRESSION) {
+            //
+            // Only support the EFI_SATNDARD_COMPRESSION algorithm.
+            // 
+
+            //
+            // Decompress the stream
+            //
+            Status = gBS->LocateProtocol (&gEfiDecompressProtocolGuid, NULL, (VOID **)&Decompress);
+          
+            ASSERT_EFI_ERROR (Status);
+          
+            Status = Decompress->GetInfo (
+                                   Decompress,
+                                   CompressionSource,
+                                   CompressionSourceSize,
+                                   (UINT32 *)&NewStreamBufferSize,
+                                   &ScratchSize
+                                   );
+            if (EFI_ERROR (Status) || (NewStreamBufferSize != UncompressedLength)) {
+              FreePool (Node);
+              FreePool (NewStreamBuffer);
+              if (!EFI_ERROR (Status)) {
+                Status = EFI_BAD_BUFFER_SIZE;
+              }
+              return Status;
+            }
+
+            ScratchBuffer = GetScratchBuffer (ScratchSize);
+            if (ScratchBuffer == NULL) {
+              FreePool (Node);
+              FreePool (NewStreamBuffer);
+              return EFI_OUT_OF_RESOURCES;
+            }
+
+            Status = Decompress->Decompress (
+                                   Decompress,
+                                   CompressionSource,
+                                   CompressionSourceSize,
+                                   NewStreamBuffer,
+                                   (UINT32)NewStreamBufferSize,
+                                   ScratchBuffer,
+                                   ScratchSize
+                                   );
+            if (EFI_ERROR (Status)) {
+              FreePool (Node);
+              FreePool (NewStreamBuffer);
+              return Status;
+            }
+          }
+        }
+        if (CacheKeyValid && (DecodedSection == NULL)) {
+          DecodedSection = InsertDecodedSection (&CacheKey, NewStreamBuffer, NewStreamBufferSize, 0);
+        }
+      } else {
+        NewStreamBuffer = NULL;
+        NewStreamBufferSize = 0;
+      }
+      
+      Status = OpenSectionStreamEx (
+                 NewStreamBufferSize,
+                 NewStreamBuffer,
+                 FALSE,
+                 Stream->AuthenticationStatus,
+                 &Node->EncapsulatedStreamHandle
+                 );
+      if (EFI_ERROR (Status)) {
+        FreePool (Node);
+        if (DecodedSection != NULL) {
+          ReleaseDecodedSection (DecodedSection);
+        } else {
+          FreePool (NewStreamBuffer);
+        }
+        return Status;
+      }
+      ((FRAMEWORK_SECTION_STREAM_NODE *) Node->EncapsulatedStreamHandle)->DecodedSection = DecodedSection;
+      break;
+
+    case EFI_SECTION_GUID_DEFINED:
+      GuidedHeader = (EFI_GUID_DEFINED_SECTION *) SectionHeader;
       if (IS_SECTION2 (GuidedHeader)) {
         Node->EncapsulationGuid = &(((EFI_GUID_DEFINED_SECTION2 *) GuidedHeader)->SectionDefinitionGuid);
         GuidedSectionAttributes = ((EFI_GUID_DEFINED_SECTION2 *) GuidedHeader)->Attributes;
@@ -891,21 +2093,57 @@ CreateChildNode (
         GuidedSectionAttributes = GuidedHeader->Attributes;
       }
       if (VerifyGuidedSectionGuid (Node->EncapsulationGuid, &GuidedExtraction)) {
-        //
-        // NewStreamBuffer is always allocated by ExtractSection... No caller
-        // allocation here.
-        //
-        Status = GuidedExtraction->ExtractSection (
-                                     GuidedExtraction,
-                                     GuidedHeader,
-                                     &NewStreamBuffer,
-                                     &NewStreamBufferSize,
-                                     &AuthenticationStatus
-                                     );
+        CacheKeyValid = (BOOLEAN) !EFI_ERROR (GetDecodedSectionKey (SectionHeader, ChildOffset, Node->EncapsulationGuid, &CacheKey));
+        if (CacheKeyValid) {
+          DecodedSection = AcquireDecodedSection (&CacheKey);
+        }
+        Prefetched = NULL;
+        if (DecodedSection == NULL) {
+          Prefetched = TakePrefetchedSection (Stream, ChildOffset);
+        }
+        if (DecodedSection != NULL) {
+          //
+          // The same section was extracted for a stream opened earlier.
+          //
+          NewStreamBuffer = DecodedSection->Buffer;
+          NewStreamBufferSize = DecodedSection->BufferSize;
+          AuthenticationStatus = DecodedSection->AuthenticationStatus;
+          Status = EFI_SUCCESS;
+        } else if (Prefetched != NULL) {
+          //
+          // The section was already extracted on an AP.
+          //
+          NewStreamBuffer = Prefetched->Buffer;
+          NewStreamBufferSize = Prefetched->BufferSize;
+          AuthenticationStatus = Prefetched->AuthenticationStatus;
+          FreePool (Prefetched);
+          Status = EFI_SUCCESS;
+        } else {
+          //
+          // NewStreamBuffer is always allocated by ExtractSection... No caller
+          // allocation here.
+          //
+          Status = GuidedExtraction->ExtractSection (
+                                       GuidedExtraction,
+                                       GuidedHeader,
+                                       &NewStreamBuffer,
+                                       &NewStreamBufferSize,
+                                       &AuthenticationStatus
+                                       );
+        }
         if (EFI_ERROR (Status)) {
           FreePool (*ChildNode);
           return EFI_PROTOCOL_ERROR;
         }
+
+        //
+        // A section that could not be verified yet is not cached, so that its
+        // authentication status is refreshed the next time it is extracted.
+        //
+        if (CacheKeyValid && (DecodedSection == NULL) &&
+            ((AuthenticationStatus & EFI_LOCAL_AUTH_STATUS_NOT_TESTED) == 0)) {
+          DecodedSection = InsertDecodedSection (&CacheKey, NewStreamBuffer, NewStreamBufferSize, AuthenticationStatus);
+        }
         
         //
         // Make sure we initialize the new stream with the correct 
@@ -933,9 +2171,14 @@ CreateChildNode (
                    );
         if (EFI_ERROR (Status)) {
           FreePool (*ChildNode);
-          FreePool (NewStreamBuffer);
+          if (DecodedSection != NULL) {
+            ReleaseDecodedSection (DecodedSection);
+          } else {
+            FreePool (NewStreamBuffer);
+          }
           return Status;
         }
+        ((FRAMEWORK_SECTION_STREAM_NODE *) Node->EncapsulatedStreamHandle)->DecodedSection = DecodedSection;
       } else {
         //
         // There's no GUIDed section extraction protocol available.
@@ -1019,6 +2262,7 @@ CreateChildNode (
   // Last, add the new child node to the stream
   //
   InsertTailList (&Stream->Children, &Node->Link);
+  AddChildToIndex (Stream, SectionHeader, Node);
 
   return EFI_SUCCESS;
 }
@@ -1059,8 +2303,14 @@ FindChildNode (
   )
 {
   FRAMEWORK_SECTION_CHILD_NODE                       *CurrentChildNode;
+  FRAMEWORK_SECTION_CHILD_NODE                       *EncapsulationNode;
   FRAMEWORK_SECTION_CHILD_NODE                       *RecursedChildNode;
   FRAMEWORK_SECTION_STREAM_NODE                      *RecursedFoundStream;
+  SECTION_INDEX                                      *Index;
+  UINTN                                              MatchPosition;
+  UINTN                                              MatchCount;
+  UINTN                                              EncapsulationPosition;
+  UINT32                                             LastOffset;
   UINT32                                        NextChildOffset;
   EFI_STATUS                                    ErrorStatus;
   EFI_STATUS                                    Status;
@@ -1072,8 +2322,10 @@ FindChildNode (
     return EFI_NOT_FOUND;
   }
   
-  if (IsListEmpty (&SourceStream->Children) && 
-                   SourceStream->StreamLength >= sizeof (EFI_COMMON_SECTION_HEADER)) {
+  if (IsListEmpty (&SourceStream->Children)) {
+    if (SourceStream->StreamLength < sizeof (EFI_COMMON_SECTION_HEADER)) {
+      return EFI_NOT_FOUND;
+    }
     //
     // This occurs when a section stream exists, but no child sections
     // have been parsed out yet.  Therefore, extract the first child and add it
@@ -1088,97 +2340,108 @@ FindChildNode (
   }
   
   //
-  // At least one child has been parsed out of the section stream.  So, walk
-  // through the sections that have already been parsed out looking for the
-  // requested section, if necessary, continue parsing section stream and
-  // adding children until either the requested section is found, or we run
-  // out of data
+  // At least one child has been parsed out of the section stream.  Children
+  // are visited in stream order, recursing into encapsulated streams, but the
+  // children of this stream that match are taken from the index: between two
+  // encapsulation sections the requested instance is either reached directly
+  // or skipped over as a whole.  If necessary, continue parsing the section
+  // stream and adding children until either the requested section is found,
+  // or we run out of data.
   //
-  CurrentChildNode = CHILD_SECTION_NODE_FROM_LINK (GetFirstNode(&SourceStream->Children));
+  MatchPosition = 0;
+  EncapsulationPosition = 0;
 
   for (;;) {
-    ASSERT (CurrentChildNode != NULL);
-    if (ChildIsType (SourceStream, CurrentChildNode, SearchType, SectionDefinitionGuid)) {
-      //
-      // The type matches, so check the instance count to see if it's the one we want
-      //
-      (*SectionInstance)--;
-      if (*SectionInstance == 0) {
+    //
+    // Children of this stream up to and including the next encapsulation
+    // section are searched through the index.
+    //
+    if (EncapsulationPosition < SourceStream->Encapsulations.Count) {
+      EncapsulationNode = SourceStream->Encapsulations.Nodes[EncapsulationPosition];
+      LastOffset = EncapsulationNode->OffsetInStream;
+    } else {
+      EncapsulationNode = NULL;
+      LastOffset = MAX_UINT32;
+    }
+
+    Index = GetSectionIndex (SourceStream, SearchType, SectionDefinitionGuid, FALSE);
+    if (Index != NULL) {
+      MatchCount = CountChildNodesUpTo (&Index->Children, MatchPosition, LastOffset);
+      if (*SectionInstance <= MatchCount) {
         //
         // Got it!
         //
-        *FoundChild = CurrentChildNode;
+        *FoundChild = Index->Children.Nodes[MatchPosition + *SectionInstance - 1];
         *FoundStream = SourceStream;
         *AuthenticationStatus = SourceStream->AuthenticationStatus;
+        *SectionInstance = 0;
         return EFI_SUCCESS;
       }
+      *SectionInstance -= MatchCount;
+      MatchPosition += MatchCount;
     }
-    
-    if (CurrentChildNode->EncapsulatedStreamHandle != NULL_STREAM_HANDLE) {
-      //
-      // If the current node is an encapsulating node, recurse into it...
-      //
-      Status = FindChildNode (
-                (FRAMEWORK_SECTION_STREAM_NODE *)CurrentChildNode->EncapsulatedStreamHandle,
-                SearchType,
-                SectionInstance,
-                SectionDefinitionGuid,
-                &RecursedChildNode,
-                &RecursedFoundStream,
-                AuthenticationStatus
-                );
-      //
-      // If the status is not EFI_SUCCESS, just save the error code and continue
-      // to find the request child node in the rest stream.
-      //
-      if (*SectionInstance == 0) {
-        ASSERT_EFI_ERROR (Status);
-        *FoundChild = RecursedChildNode;
-        *FoundStream = RecursedFoundStream;
-        return EFI_SUCCESS;
-      } else {
-        ErrorStatus = Status;
+
+    if (EncapsulationNode != NULL) {
+      EncapsulationPosition++;
+      if (EncapsulationNode->EncapsulatedStreamHandle != NULL_STREAM_HANDLE) {
+        //
+        // If the current node is an encapsulating node, recurse into it...
+        //
+        Status = FindChildNode (
+                  (FRAMEWORK_SECTION_STREAM_NODE *)EncapsulationNode->EncapsulatedStreamHandle,
+                  SearchType,
+                  SectionInstance,
+                  SectionDefinitionGuid,
+                  &RecursedChildNode,
+                  &RecursedFoundStream,
+                  AuthenticationStatus
+                  );
+        //
+        // If the status is not EFI_SUCCESS, just save the error code and continue
+        // to find the request child node in the rest stream.
+        //
+        if (*SectionInstance == 0) {
+          ASSERT_EFI_ERROR (Status);
+          *FoundChild = RecursedChildNode;
+          *FoundStream = RecursedFoundStream;
+          return EFI_SUCCESS;
+        } else {
+          ErrorStatus = Status;
+        }
+      } else if ((EncapsulationNode->Type == EFI_SECTION_GUID_DEFINED) && (SearchType != EFI_SECTION_GUID_DEFINED)) {
+        //
+        // When Node Type is GUIDED section, but Node has no encapsulated data, Node data should not be parsed
+        // because a required GUIDED section extraction protocol does not exist.
+        // If SearchType is not GUIDED section, EFI_PROTOCOL_ERROR should return.
+        //
+        ErrorStatus = EFI_PROTOCOL_ERROR;
       }
-    } else if ((CurrentChildNode->Type == EFI_SECTION_GUID_DEFINED) && (SearchType != EFI_SECTION_GUID_DEFINED)) {
-      //
-      // When Node Type is GUIDED section, but Node has no encapsulated data, Node data should not be parsed
-      // because a required GUIDED section extraction protocol does not exist.
-      // If SearchType is not GUIDED section, EFI_PROTOCOL_ERROR should return.
-      //
-      ErrorStatus = EFI_PROTOCOL_ERROR;
+      continue;
     }
-    
-    if (!IsNodeAtEnd (&SourceStream->Children, &CurrentChildNode->Link)) {
-      //
-      // We haven't found the child node we're interested in yet, but there's
-      // still more nodes that have already been parsed so get the next one
-      // and continue searching..
-      //
-      CurrentChildNode = CHILD_SECTION_NODE_FROM_LINK (GetNextNode (&SourceStream->Children, &CurrentChildNode->Link));
-    } else {
-      //
-      // We've exhausted children that have already been parsed, so see if
-      // there's any more data and continue parsing out more children if there
-      // is.
-      //
-      NextChildOffset = CurrentChildNode->OffsetInStream + CurrentChildNode->Size;
+
+    //
+    // We've exhausted children that have already been parsed, so see if
+    // there's any more data and continue parsing out more children if there
+    // is.
+    //
+    CurrentChildNode = CHILD_SECTION_NODE_FROM_LINK (GetPreviousNode (&SourceStream->Children, &SourceStream->Children));
+    NextChildOffset = CurrentChildNode->OffsetInStream + CurrentChildNode->Size;
+    //
+    // Round up to 4 byte boundary
+    //
+    NextChildOffset += 3;
+    NextChildOffset &= ~(UINTN)3;
+    if (NextChildOffset <= SourceStream->StreamLength - sizeof (EFI_COMMON_SECTION_HEADER)) {
       //
-      // Round up to 4 byte boundary
+      // There's an unparsed child remaining in the stream, so create a new child node
       //
-      NextChildOffset += 3;
-      NextChildOffset &= ~(UINTN)3;
-      if (NextChildOffset <= SourceStream->StreamLength - sizeof (EFI_COMMON_SECTION_HEADER)) {
-        //
-        // There's an unparsed child remaining in the stream, so create a new child node
-        //
-        Status = CreateChildNode (SourceStream, NextChildOffset, &CurrentChildNode);
-        if (EFI_ERROR (Status)) {
-          return Status;
-        }
-      } else {
-        ASSERT (EFI_ERROR (ErrorStatus));
-        return ErrorStatus;
+      Status = CreateChildNode (SourceStream, NextChildOffset, &CurrentChildNode);
+      if (EFI_ERROR (Status)) {
+        return Status;
       }
+    } else {
+      ASSERT (EFI_ERROR (ErrorStatus));
+      return ErrorStatus;
     }
   }
 }
@@ -1201,18 +2464,15 @@ FindStreamNode (
   )
 {  
   FRAMEWORK_SECTION_STREAM_NODE                      *StreamNode;
+  LIST_ENTRY                                         *Bucket;
+  LIST_ENTRY                                         *Link;
   
-  if (!IsListEmpty (&mStreamRoot)) {
-    StreamNode = STREAM_NODE_FROM_LINK (GetFirstNode (&mStreamRoot));
-    for (;;) {
-      if (StreamNode->StreamHandle == SearchHandle) {
-        *FoundStream = StreamNode;
-        return EFI_SUCCESS;
-      } else if (IsNodeAtEnd (&mStreamRoot, &StreamNode->Link)) {
-        break;
-      } else {
-        StreamNode = STREAM_NODE_FROM_LINK (GetNextNode (&mStreamRoot, &StreamNode->Link));
-      }
+  Bucket = &mStreamHash[STREAM_HASH (SearchHandle)];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    StreamNode = STREAM_NODE_FROM_LINK (Link);
+    if (StreamNode->StreamHandle == SearchHandle) {
+      *FoundStream = StreamNode;
+      return EFI_SUCCESS;
     }
   }
   
@@ -1427,6 +2687,7 @@ CloseSectionStream (
   EFI_STATUS                                    Status;
   LIST_ENTRY                                    *Link;
   FRAMEWORK_SECTION_CHILD_NODE                       *ChildNode;
+  PREFETCHED_SECTION                            *Prefetched;
   
   OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
   
@@ -1444,7 +2705,18 @@ CloseSectionStream (
       ChildNode = CHILD_SECTION_NODE_FROM_LINK (Link);
       FreeChildNode (ChildNode);
     }
-    FreePool (StreamNode->StreamBuffer);
+    while (!IsListEmpty (&StreamNode->PrefetchedSections)) {
+      Link = GetFirstNode (&StreamNode->PrefetchedSections);
+      Prefetched = PREFETCHED_SECTION_FROM_LINK (Link);
+      RemoveEntryList (Link);
+      FreePrefetchedSection (Prefetched);
+    }
+    FreeSectionIndex (StreamNode);
+    if (StreamNode->DecodedSection != NULL) {
+      ReleaseDecodedSection (StreamNode->DecodedSection);
+    } else {
+      FreePool (StreamNode->StreamBuffer);
+    }
     FreePool (StreamNode);
     Status = EFI_SUCCESS;
   } else {
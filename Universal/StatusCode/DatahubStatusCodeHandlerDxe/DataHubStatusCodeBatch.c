@@ -0,0 +1,621 @@
+/** @file
+  Data Hub status code worker logging status codes in binary batches.
+
+  Status codes are encoded as described in Guid/DataHubStatusCodeBatch.h into
+  one of two batch buffers. The batch being filled is logged into the Data Hub
+  as one record when it is three quarters full, when an error code is reported
+  and periodically, while the other batch takes the new status codes.
+
+  Copyright (c) 2015, Intel Corporation. All rights reserved.<BR>
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "DatahubStatusCodeHandlerDxe.h"
+
+//
+// The two batch buffers, each holding a header followed by mBatchSize bytes of entries.
+//
+DATA_HUB_STATUS_CODE_BATCH_HEADER  *mBatch[2]     = { NULL, NULL };
+UINT64                             mBatchClass[2] = { 0, 0 };
+UINTN                              mActiveBatch   = 0;
+UINT32                             mBatchSize     = 0;
+
+//
+// Format strings already defined in the batch stream, looked up by the hash of their content.
+//
+DATA_HUB_STATUS_CODE_FORMAT        mBatchFormat[DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE];
+UINT32                             mBatchFormatCount = 0;
+
+/**
+  Append bytes to a batch entry.
+
+  @param  Encoder          The encoder of the batch entry.
+  @param  Data             The bytes to append. NULL appends zeros.
+  @param  Length           The number of bytes to append.
+
+**/
+VOID
+BatchPutBytes (
+  IN OUT DATA_HUB_STATUS_CODE_ENCODER  *Encoder,
+  IN     CONST VOID                    *Data  OPTIONAL,
+  IN     UINTN                         Length
+  )
+{
+  if (Encoder->Overflow || Length > Encoder->Size - Encoder->Length) {
+    Encoder->Overflow = TRUE;
+    return;
+  }
+
+  if (Data == NULL) {
+    ZeroMem (Encoder->Buffer + Encoder->Length, Length);
+  } else {
+    CopyMem (Encoder->Buffer + Encoder->Length, Data, Length);
+  }
+  Encoder->Length += Length;
+}
+
+/**
+  Append an unsigned LEB128 varint to a batch entry.
+
+  @param  Encoder          The encoder of the batch entry.
+  @param  Value            The value to append.
+
+**/
+VOID
+BatchPutVarint (
+  IN OUT DATA_HUB_STATUS_CODE_ENCODER  *Encoder,
+  IN     UINT64                        Value
+  )
+{
+  UINT8   Bytes[10];
+  UINTN   Length;
+
+  Length = 0;
+  while (Value >= 0x80) {
+    Bytes[Length++] = (UINT8) (Value | 0x80);
+    Value           = RShiftU64 (Value, 7);
+  }
+  Bytes[Length++] = (UINT8) Value;
+
+  BatchPutBytes (Encoder, Bytes, Length);
+}
+
+/**
+  Append an ASCII string as its length and characters to a batch entry.
+
+  The string is truncated to DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH characters.
+
+  @param  Encoder          The encoder of the batch entry.
+  @param  String           The string to append.
+
+**/
+VOID
+BatchPutAsciiString (
+  IN OUT DATA_HUB_STATUS_CODE_ENCODER  *Encoder,
+  IN     CONST CHAR8                   *String  OPTIONAL
+  )
+{
+  UINTN  Length;
+
+  if (String == NULL) {
+    String = "<null string>";
+  }
+
+  for (Length = 0; Length < DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH && String[Length] != '\0'; Length++);
+
+  BatchPutVarint (Encoder, Length);
+  BatchPutBytes (Encoder, String, Length);
+}
+
+/**
+  Append a Unicode string as its length and ASCII characters to a batch entry.
+
+  Characters outside of ASCII are replaced by '?'. The string is truncated to
+  DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH characters.
+
+  @param  Encoder          The encoder of the batch entry.
+  @param  String           The string to append.
+
+**/
+VOID
+BatchPutUnicodeString (
+  IN OUT DATA_HUB_STATUS_CODE_ENCODER  *Encoder,
+  IN     CONST CHAR16                  *String  OPTIONAL
+  )
+{
+  CHAR8  Ascii[DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH];
+  UINTN  Length;
+
+  if (String == NULL) {
+    BatchPutAsciiString (Encoder, NULL);
+    return;
+  }
+
+  for (Length = 0; Length < DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH && String[Length] != L'\0'; Length++) {
+    Ascii[Length] = (CHAR8) ((String[Length] < 0x80) ? String[Length] : '?');
+  }
+
+  BatchPutVarint (Encoder, Length);
+  BatchPutBytes (Encoder, Ascii, Length);
+}
+
+/**
+  Append the extended data of a status code to a batch entry.
+
+  ASSERT() data and ASCII string data refer to strings outside of the
+  extended data, so their strings are appended in place of the pointers.
+  Other extended data is appended as it is, up to EFI_STATUS_CODE_DATA_MAX_SIZE
+  bytes. Strings are truncated to DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH
+  characters.
+
+  @param  Encoder          The encoder of the batch entry.
+  @param  CodeType         Indicates the type of status code being reported.
+  @param  Value            Describes the current status of a hardware or software entity.
+  @param  Data             The extended data.
+
+**/
+VOID
+BatchPutExtendedData (
+  IN OUT DATA_HUB_STATUS_CODE_ENCODER  *Encoder,
+  IN     EFI_STATUS_CODE_TYPE          CodeType,
+  IN     EFI_STATUS_CODE_VALUE         Value,
+  IN     EFI_STATUS_CODE_DATA          *Data
+  )
+{
+  CHAR8                        *Filename;
+  CHAR8                        *Description;
+  UINT32                       LineNumber;
+  UINT32                       StringType;
+  UINTN                        FilenameLength;
+  UINTN                        DescriptionLength;
+  UINTN                        StringLength;
+  EFI_STATUS_CODE_STRING_DATA  *StringData;
+
+  BatchPutBytes (Encoder, &Data->Type, sizeof (EFI_GUID));
+
+  if (ReportStatusCodeExtractAssertInfo (CodeType, Value, Data, &Filename, &Description, &LineNumber)) {
+    for (FilenameLength = 0; FilenameLength < DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH && Filename[FilenameLength] != '\0'; FilenameLength++);
+    for (DescriptionLength = 0; DescriptionLength < DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH && Description[DescriptionLength] != '\0'; DescriptionLength++);
+    BatchPutVarint (Encoder, sizeof (UINT32) + FilenameLength + 1 + DescriptionLength + 1);
+    BatchPutBytes (Encoder, &LineNumber, sizeof (UINT32));
+    BatchPutBytes (Encoder, Filename, FilenameLength);
+    BatchPutBytes (Encoder, NULL, 1);
+    BatchPutBytes (Encoder, Description, DescriptionLength);
+    BatchPutBytes (Encoder, NULL, 1);
+    return;
+  }
+
+  StringData = (EFI_STATUS_CODE_STRING_DATA *) Data;
+  if (CompareGuid (&Data->Type, &gEfiStatusCodeDataTypeStringGuid) &&
+      StringData->StringType == EfiStringAscii &&
+      StringData->String.Ascii != NULL) {
+    StringType = EfiStringAscii;
+    for (StringLength = 0; StringLength < DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH && StringData->String.Ascii[StringLength] != '\0'; StringLength++);
+    BatchPutVarint (Encoder, sizeof (UINT32) + StringLength + 1);
+    BatchPutBytes (Encoder, &StringType, sizeof (UINT32));
+    BatchPutBytes (Encoder, StringData->String.Ascii, StringLength);
+    BatchPutBytes (Encoder, NULL, 1);
+    return;
+  }
+
+  BatchPutVarint (Encoder, MIN (Data->Size, EFI_STATUS_CODE_DATA_MAX_SIZE));
+  BatchPutBytes (Encoder, Data + 1, MIN (Data->Size, EFI_STATUS_CODE_DATA_MAX_SIZE));
+}
+
+/**
+  Append the arguments of a DEBUG() format string to a batch entry.
+
+  The arguments are read from the BASE_LIST the same way the DebugLib instance
+  reporting DEBUG() messages as status codes packed them.
+
+  @param  Encoder          The encoder of the batch entry.
+  @param  Format           The format string.
+  @param  Marker           The BASE_LIST of the arguments.
+
+**/
+VOID
+BatchPutDebugArguments (
+  IN OUT DATA_HUB_STATUS_CODE_ENCODER  *Encoder,
+  IN     CONST CHAR8                   *Format,
+  IN     BASE_LIST                     Marker
+  )
+{
+  BOOLEAN  Long;
+  INT64    Signed;
+
+  for (; *Format != '\0'; Format++) {
+    if (*Format != '%') {
+      continue;
+    }
+
+    //
+    // Skip the flags, width and precision, which only take an argument for '*'.
+    //
+    Long = FALSE;
+    for (Format++; TRUE; Format++) {
+      if (*Format == '.' || *Format == '-' || *Format == '+' || *Format == ' ' || *Format == ',' ||
+          (*Format >= '0' && *Format <= '9')) {
+        continue;
+      }
+      if (*Format == 'L' || *Format == 'l') {
+        Long = TRUE;
+        continue;
+      }
+      if (*Format == '*') {
+        BatchPutVarint (Encoder, BASE_ARG (Marker, UINTN));
+        continue;
+      }
+      break;
+    }
+
+    if (*Format == '\0') {
+      break;
+    }
+    if ((*Format == 'p') && (sizeof (VOID *) > 4)) {
+      Long = TRUE;
+    }
+
+    switch (*Format) {
+    case 'd':
+      if (Long) {
+        Signed = BASE_ARG (Marker, INT64);
+      } else {
+        Signed = BASE_ARG (Marker, int);
+      }
+      //
+      // Zigzag encoding keeps small negative numbers short.
+      //
+      BatchPutVarint (Encoder, LShiftU64 ((UINT64) Signed, 1) ^ (UINT64) ARShiftU64 ((UINT64) Signed, 63));
+      break;
+
+    case 'p':
+    case 'X':
+    case 'x':
+    case 'u':
+      if (Long) {
+        BatchPutVarint (Encoder, (UINT64) BASE_ARG (Marker, INT64));
+      } else {
+        BatchPutVarint (Encoder, (UINT32) BASE_ARG (Marker, int));
+      }
+      break;
+
+    case 'a':
+      BatchPutAsciiString (Encoder, BASE_ARG (Marker, CHAR8 *));
+      break;
+
+    case 's':
+    case 'S':
+      BatchPutUnicodeString (Encoder, BASE_ARG (Marker, CHAR16 *));
+      break;
+
+    case 'g':
+      BatchPutBytes (Encoder, BASE_ARG (Marker, EFI_GUID *), sizeof (EFI_GUID));
+      break;
+
+    case 't':
+      BatchPutBytes (Encoder, BASE_ARG (Marker, EFI_TIME *), sizeof (EFI_TIME));
+      break;
+
+    case 'c':
+      BatchPutVarint (Encoder, BASE_ARG (Marker, UINTN));
+      break;
+
+    case 'r':
+      BatchPutVarint (Encoder, BASE_ARG (Marker, RETURN_STATUS));
+      break;
+
+    default:
+      break;
+    }
+  }
+}
+
+/**
+  Find the identifier of a format string already defined in the batch stream.
+
+  @param  Format           The format string.
+  @param  Length           The length of the format string.
+  @param  Hash             The hash of the format string.
+  @param  Slot             Returns the free entry of the table for the format string,
+                           or NULL if the table is full. Only set when the format is not found.
+
+  @return The identifier of the format string, or DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID
+          if it is not defined yet.
+
+**/
+UINT32
+LookupBatchFormat (
+  IN  CONST CHAR8                  *Format,
+  IN  UINT32                       Length,
+  IN  UINT64                       Hash,
+  OUT DATA_HUB_STATUS_CODE_FORMAT  **Slot
+  )
+{
+  UINTN                        Index;
+  DATA_HUB_STATUS_CODE_FORMAT  *Entry;
+
+  Index = (UINTN) Hash & (DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE - 1);
+  while (TRUE) {
+    Entry = &mBatchFormat[Index];
+    if (Entry->Id == DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID) {
+      //
+      // The table is never filled completely, so the probing always ends here.
+      //
+      *Slot = (mBatchFormatCount < DATA_HUB_STATUS_CODE_MAX_FORMATS) ? Entry : NULL;
+      return DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID;
+    }
+    if (Entry->Hash == Hash && Entry->Length == Length) {
+      return Entry->Id;
+    }
+    Index = (Index + 1) & (DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE - 1);
+  }
+}
+
+/**
+  Compute the 64-bit FNV-1a hash of a string.
+
+  @param  String           The string.
+  @param  Length           Returns the length of the string.
+
+  @return The hash of the string.
+
+**/
+UINT64
+HashBatchFormat (
+  IN  CONST CHAR8  *String,
+  OUT UINT32       *Length
+  )
+{
+  UINT64  Hash;
+  UINT32  Index;
+
+  Hash = 0xcbf29ce484222325ULL;
+  for (Index = 0; String[Index] != '\0'; Index++) {
+    Hash = MultU64x32 (Hash ^ (UINT8) String[Index], 0x1b3) + LShiftU64 (Hash ^ (UINT8) String[Index], 40);
+  }
+
+  *Length = Index;
+  return Hash;
+}
+
+/**
+  Get the Data Hub record class of a status code.
+
+  @param  CodeType         The type of the status code.
+
+  @return The Data Hub record class.
+
+**/
+UINT64
+GetDataRecordClass (
+  IN EFI_STATUS_CODE_TYPE     CodeType
+  )
+{
+  switch (CodeType & EFI_STATUS_CODE_TYPE_MASK) {
+  case EFI_PROGRESS_CODE:
+    return EFI_DATA_RECORD_CLASS_PROGRESS_CODE;
+  case EFI_ERROR_CODE:
+    return EFI_DATA_RECORD_CLASS_ERROR;
+  case EFI_DEBUG_CODE:
+    return EFI_DATA_RECORD_CLASS_DEBUG;
+  default:
+    return EFI_DATA_RECORD_CLASS_DEBUG |
+           EFI_DATA_RECORD_CLASS_ERROR |
+           EFI_DATA_RECORD_CLASS_DATA |
+           EFI_DATA_RECORD_CLASS_PROGRESS_CODE;
+  }
+}
+
+/**
+  Allocate the two batch buffers sized by PcdStatusCodeDataHubBatchSize.
+
+  @retval EFI_SUCCESS           The batch buffers are allocated.
+  @retval EFI_OUT_OF_RESOURCES  No memory is available for the batch buffers.
+
+**/
+EFI_STATUS
+InitializeBatchBuffers (
+  VOID
+  )
+{
+  UINTN   Index;
+
+  mBatchSize = PcdGet32 (PcdStatusCodeDataHubBatchSize);
+  for (Index = 0; Index < 2; Index++) {
+    mBatch[Index] = AllocateZeroPool (sizeof (DATA_HUB_STATUS_CODE_BATCH_HEADER) + mBatchSize);
+    if (mBatch[Index] == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    mBatch[Index]->Version = DATA_HUB_STATUS_CODE_BATCH_VERSION;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Encode a status code into the batch being filled.
+
+  @param  CodeType             Indicates the type of status code being reported.
+  @param  Value                Describes the current status of a hardware or software entity.
+                               This included information about the class and subclass that is used to
+                               classify the entity as well as an operation.
+  @param  Instance             The enumeration of a hardware or software entity within
+                               the system. Valid instance numbers start with 1.
+  @param  CallerId             This optional parameter may be used to identify the caller.
+                               This parameter allows the status code driver to apply different rules to
+                               different callers.
+  @param  Data                 This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS          The status code is added to the batch.
+  @retval EFI_OUT_OF_RESOURCES The batch is full.
+
+**/
+EFI_STATUS
+DataHubStatusCodeBatchReportWorker (
+  IN EFI_STATUS_CODE_TYPE     CodeType,
+  IN EFI_STATUS_CODE_VALUE    Value,
+  IN UINT32                   Instance,
+  IN EFI_GUID                 *CallerId,
+  IN EFI_STATUS_CODE_DATA     *Data OPTIONAL
+  )
+{
+  DATA_HUB_STATUS_CODE_BATCH_HEADER  *Batch;
+  DATA_HUB_STATUS_CODE_ENCODER       Encoder;
+  DATA_HUB_STATUS_CODE_FORMAT        *Slot;
+  EFI_TPL                            CurrentTpl;
+  UINT32                             ErrorLevel;
+  BASE_LIST                          Marker;
+  CHAR8                              *Format;
+  UINT32                             FormatLength;
+  UINT64                             FormatHash;
+  UINT32                             FormatId;
+  UINT8                              Tag;
+  UINT8                              FormatTag;
+  BOOLEAN                            Debug;
+  BOOLEAN                            LogNow;
+
+  if (mBatch[0] == NULL || mBatch[1] == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Slot  = NULL;
+  Debug = FALSE;
+  Tag   = DATA_HUB_STATUS_CODE_ENTRY_STATUS_CODE;
+  if (CallerId != NULL) {
+    Tag |= DATA_HUB_STATUS_CODE_ENTRY_CALLER_ID;
+  }
+  if (Data != NULL) {
+    Debug = ReportStatusCodeExtractDebugInfo (Data, &ErrorLevel, &Marker, &Format);
+    Tag |= Debug ? DATA_HUB_STATUS_CODE_ENTRY_DATA_DEBUG : DATA_HUB_STATUS_CODE_ENTRY_DATA_RAW;
+  }
+
+  CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+
+  Batch = mBatch[mActiveBatch];
+  Encoder.Buffer   = (UINT8 *) (Batch + 1);
+  Encoder.Size     = mBatchSize;
+  Encoder.Length   = Batch->Size;
+  Encoder.Overflow = FALSE;
+
+  FormatId = DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID;
+  if (Debug) {
+    FormatHash = HashBatchFormat (Format, &FormatLength);
+    FormatId   = LookupBatchFormat (Format, FormatLength, FormatHash, &Slot);
+    if (Slot != NULL) {
+      //
+      // Define the format string in the stream before its first use.
+      //
+      FormatId  = mBatchFormatCount + 1;
+      FormatTag = DATA_HUB_STATUS_CODE_ENTRY_FORMAT;
+      BatchPutBytes (&Encoder, &FormatTag, sizeof (FormatTag));
+      BatchPutVarint (&Encoder, FormatId);
+      BatchPutVarint (&Encoder, FormatLength);
+      BatchPutBytes (&Encoder, Format, FormatLength);
+    }
+  }
+
+  BatchPutBytes (&Encoder, &Tag, sizeof (Tag));
+  BatchPutVarint (&Encoder, CodeType);
+  BatchPutVarint (&Encoder, Value);
+  BatchPutVarint (&Encoder, Instance);
+  if (CallerId != NULL) {
+    BatchPutBytes (&Encoder, CallerId, sizeof (EFI_GUID));
+  }
+
+  if (Debug) {
+    BatchPutVarint (&Encoder, ErrorLevel);
+    BatchPutVarint (&Encoder, FormatId);
+    if (FormatId == DATA_HUB_STATUS_CODE_INLINE_FORMAT_ID) {
+      BatchPutVarint (&Encoder, FormatLength);
+      BatchPutBytes (&Encoder, Format, FormatLength);
+    }
+    BatchPutDebugArguments (&Encoder, Format, Marker);
+  } else if (Data != NULL) {
+    BatchPutExtendedData (&Encoder, CodeType, Value, Data);
+  }
+
+  if (Encoder.Overflow || Batch->EntryCount == MAX_UINT16) {
+    //
+    // Drop the status code and have the full batch logged.
+    //
+    mDataHubStatusCodeStatistics.DropCount++;
+    gBS->RestoreTPL (CurrentTpl);
+    gBS->SignalEvent (mLogDataHubEvent);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Slot != NULL) {
+    Slot->Hash   = FormatHash;
+    Slot->Length = FormatLength;
+    Slot->Id     = FormatId;
+    mBatchFormatCount++;
+  }
+
+  Batch->Size = (UINT32) Encoder.Length;
+  Batch->EntryCount++;
+  mBatchClass[mActiveBatch] |= GetDataRecordClass (CodeType);
+
+  LogNow = (BOOLEAN) (Batch->Size >= mBatchSize - mBatchSize / 4 ||
+                      (CodeType & EFI_STATUS_CODE_TYPE_MASK) == EFI_ERROR_CODE);
+
+  gBS->RestoreTPL (CurrentTpl);
+
+  if (LogNow) {
+    gBS->SignalEvent (mLogDataHubEvent);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Log the filled batches into the Data Hub.
+
+  The batch being filled is swapped with the empty one before it is logged,
+  so that status codes can be reported while the Data Hub logs it.
+
+**/
+VOID
+LogDataHubBatches (
+  VOID
+  )
+{
+  DATA_HUB_STATUS_CODE_BATCH_HEADER  *Batch;
+  UINT64                             DataRecordClass;
+  EFI_TPL                            CurrentTpl;
+
+  if (mBatch[0] == NULL || mBatch[1] == NULL) {
+    return;
+  }
+
+  while (TRUE) {
+    CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    Batch = mBatch[mActiveBatch];
+    if (Batch->EntryCount == 0) {
+      gBS->RestoreTPL (CurrentTpl);
+      break;
+    }
+    DataRecordClass           = mBatchClass[mActiveBatch];
+    mBatchClass[mActiveBatch] = 0;
+    mActiveBatch             ^= 1;
+    gBS->RestoreTPL (CurrentTpl);
+
+    mDataHubProtocol->LogData (
+                        mDataHubProtocol,
+                        &gDataHubStatusCodeBatchGuid,
+                        &gEfiStatusCodeRuntimeProtocolGuid,
+                        DataRecordClass,
+                        Batch,
+                        sizeof (DATA_HUB_STATUS_CODE_BATCH_HEADER) + Batch->Size
+                        );
+
+    Batch->EntryCount = 0;
+    Batch->Size       = 0;
+  }
+}
@@ -22,17 +22,108 @@ LIST_ENTRY                mRecordsBuffer        = INITIALIZE_LIST_HEAD_VARIABLE
 UINT32                    mLogDataHubStatus     = 0;
 EFI_EVENT                 mLogDataHubEvent;
 //
+// Pool of records. mRecordsBuffer holds the free records, and more are
+// allocated by mRefillRecordPoolEvent when the free ones fall below the
+// low-water mark.
+//
+EFI_EVENT                 mRefillRecordPoolEvent   = NULL;
+BOOLEAN                   mRefillRecordPoolPending = FALSE;
+UINT32                    mRecordPoolLowWater      = 0;
+UINT32                    mRecordPoolMaxSize       = 0;
+
+DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL  mDataHubStatusCodeStatistics = {
+  DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL_REVISION
+};
+//
 // Cache data hub protocol.
 //
 EFI_DATA_HUB_PROTOCOL     *mDataHubProtocol = NULL;
 
 
+/**
+  Add records to the free record buffer.
+
+  The number of records allocated never exceeds PcdStatusCodeDataHubRecordPoolMaxSize.
+  This function must be called at TPL_NOTIFY or below.
+
+  @param  Count  The number of records to add.
+
+  @retval TRUE   Records are added to the free record buffer.
+  @retval FALSE  The pool has reached its maximum size or no memory is available.
+
+**/
+BOOLEAN
+GrowRecordPool (
+  IN UINT32                 Count
+  )
+{
+  DATAHUB_STATUSCODE_RECORD *Record;
+  EFI_TPL                   CurrentTpl;
+  UINT32                    Index;
+
+  //
+  // Reserve the records first so that concurrent callers do not exceed the maximum.
+  //
+  CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mDataHubStatusCodeStatistics.RecordCount + Count > mRecordPoolMaxSize) {
+    Count = (UINT32) (mRecordPoolMaxSize - mDataHubStatusCodeStatistics.RecordCount);
+  }
+  mDataHubStatusCodeStatistics.RecordCount += Count;
+  gBS->RestoreTPL (CurrentTpl);
+
+  if (Count == 0) {
+    return FALSE;
+  }
+
+  Record = (DATAHUB_STATUSCODE_RECORD *) AllocateZeroPool (sizeof (DATAHUB_STATUSCODE_RECORD) * Count);
+
+  CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (Record == NULL) {
+    mDataHubStatusCodeStatistics.RecordCount -= Count;
+  } else {
+    for (Index = 0; Index < Count; Index++) {
+      InsertTailList (&mRecordsBuffer, &Record[Index].Node);
+    }
+    mDataHubStatusCodeStatistics.FreeCount += Count;
+    mDataHubStatusCodeStatistics.RefillCount++;
+  }
+  gBS->RestoreTPL (CurrentTpl);
+
+  return (BOOLEAN) (Record != NULL);
+}
+
+/**
+  Event notification function which adds records to the free record buffer
+  until it is above the low-water mark.
+
+  @param  Event       Event whose notification function is being invoked.
+  @param  Context     Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+RefillRecordPoolEventCallBack (
+  IN  EFI_EVENT     Event,
+  IN  VOID          *Context
+  )
+{
+  mRefillRecordPoolPending = FALSE;
+
+  while (mDataHubStatusCodeStatistics.FreeCount <= mRecordPoolLowWater) {
+    if (!GrowRecordPool (mRecordPoolLowWater + 1)) {
+      break;
+    }
+  }
+}
+
 /**
   Retrieve one record of from free record buffer. This record is removed from
   free record buffer.
 
-  This function retrieves one record from free record buffer.
-  If the pool has been exhausted, then new memory would be allocated for it.
+  This function retrieves one record from free record buffer. When the free records
+  fall to the low-water mark, more records are allocated in the background at
+  TPL_CALLBACK. If the free record buffer is exhausted, new records are allocated
+  at once at TPL_NOTIFY or below, and the status code is dropped above TPL_NOTIFY.
 
   @return  Pointer to the free record.
            NULL means failure to allocate new memeory for free record buffer.
@@ -46,44 +137,47 @@ AcquireRecordBuffer (
   DATAHUB_STATUSCODE_RECORD *Record;
   EFI_TPL                   CurrentTpl;
   LIST_ENTRY                *Node;
-  UINT32                    Index;
+  UINT64                    InUseCount;
 
   CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
 
-  if (!IsListEmpty (&mRecordsBuffer)) {
+  if (IsListEmpty (&mRecordsBuffer)) {
+    gBS->RestoreTPL (CurrentTpl);
     //
-    // Strip one entry from free record buffer.
+    // Memory management should work at <=TPL_NOTIFY
     //
-    Node = GetFirstNode (&mRecordsBuffer);
-    RemoveEntryList (Node);
-
-    Record = BASE_CR (Node, DATAHUB_STATUSCODE_RECORD, Node);
-  } else {
-    if (CurrentTpl > TPL_NOTIFY) {
-      //
-      // Memory management should work at <=TPL_NOTIFY
-      // 
+    if (CurrentTpl > TPL_NOTIFY || !GrowRecordPool (mRecordPoolLowWater + 1)) {
+      CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+      mDataHubStatusCodeStatistics.DropCount++;
       gBS->RestoreTPL (CurrentTpl);
       return NULL;
     }
-
-    //
-    // If free record buffer is exhausted, then allocate 16 new records for it.
-    //
-    gBS->RestoreTPL (CurrentTpl);
-    Record   = (DATAHUB_STATUSCODE_RECORD *) AllocateZeroPool (sizeof (DATAHUB_STATUSCODE_RECORD) * 16);
-    if (Record == NULL) {
+    CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    if (IsListEmpty (&mRecordsBuffer)) {
+      mDataHubStatusCodeStatistics.DropCount++;
+      gBS->RestoreTPL (CurrentTpl);
       return NULL;
     }
+  }
 
-    CurrentTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
-    //
-    // Here we only insert 15 new records to the free record buffer, for the first record
-    // will be returned immediately.
-    //
-    for (Index = 1; Index < 16; Index++) {
-      InsertTailList (&mRecordsBuffer, &Record[Index].Node);
-    }
+  //
+  // Strip one entry from free record buffer.
+  //
+  Node = GetFirstNode (&mRecordsBuffer);
+  RemoveEntryList (Node);
+  Record = BASE_CR (Node, DATAHUB_STATUSCODE_RECORD, Node);
+
+  mDataHubStatusCodeStatistics.FreeCount--;
+  InUseCount = mDataHubStatusCodeStatistics.RecordCount - mDataHubStatusCodeStatistics.FreeCount;
+  if (InUseCount > mDataHubStatusCodeStatistics.HighWaterCount) {
+    mDataHubStatusCodeStatistics.HighWaterCount = InUseCount;
+  }
+
+  if (mDataHubStatusCodeStatistics.FreeCount <= mRecordPoolLowWater &&
+      mDataHubStatusCodeStatistics.RecordCount < mRecordPoolMaxSize &&
+      !mRefillRecordPoolPending) {
+    mRefillRecordPoolPending = TRUE;
+    gBS->SignalEvent (mRefillRecordPoolEvent);
   }
 
   Record->Signature = DATAHUB_STATUS_CODE_SIGNATURE;
@@ -151,6 +245,7 @@ ReleaseRecord (
 
   InsertTailList (&mRecordsBuffer, &Record->Node);
   Record->Signature = 0;
+  mDataHubStatusCodeStatistics.FreeCount++;
 
   gBS->RestoreTPL (CurrentTpl);
 }
@@ -199,6 +294,10 @@ DataHubStatusCodeReportWorker (
     return EFI_DEVICE_ERROR;
   }
 
+  if (FeaturePcdGet (PcdStatusCodeDataHubBinaryFormat)) {
+    return DataHubStatusCodeBatchReportWorker (CodeType, Value, Instance, CallerId, Data);
+  }
+
   Record = AcquireRecordBuffer ();
   if (Record == NULL) {
     //
@@ -278,6 +377,10 @@ LogDataHubEventCallBack (
     return;
   }
 
+  if (FeaturePcdGet (PcdStatusCodeDataHubBinaryFormat)) {
+    LogDataHubBatches ();
+  }
+
   //
   // Log DataRecord in Data Hub.
   // Journal records fifo to find all record entry.
@@ -333,6 +436,53 @@ LogDataHubEventCallBack (
 }
 
 
+/**
+  Allocate the pool of records sized by PcdStatusCodeDataHubRecordPoolSize, and
+  install the Data Hub Status Code Statistics protocol exposing its counters.
+
+  @retval EFI_SUCCESS  The pool of records is initialized.
+
+**/
+EFI_STATUS
+InitializeRecordPool (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  Handle;
+
+  mDataHubStatusCodeStatistics.PoolSize = PcdGet32 (PcdStatusCodeDataHubRecordPoolSize);
+  mRecordPoolMaxSize  = MAX (PcdGet32 (PcdStatusCodeDataHubRecordPoolMaxSize), mDataHubStatusCodeStatistics.PoolSize);
+  mRecordPoolLowWater = mDataHubStatusCodeStatistics.PoolSize / 4;
+
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  RefillRecordPoolEventCallBack,
+                  NULL,
+                  &mRefillRecordPoolEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  if (FeaturePcdGet (PcdStatusCodeDataHubBinaryFormat)) {
+    InitializeBatchBuffers ();
+  } else {
+    GrowRecordPool (mDataHubStatusCodeStatistics.PoolSize);
+    mDataHubStatusCodeStatistics.RefillCount = 0;
+  }
+
+  Handle = NULL;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &Handle,
+                  &gDataHubStatusCodeStatisticsProtocolGuid,
+                  &mDataHubStatusCodeStatistics,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  return EFI_SUCCESS;
+}
+
 /**
   Locate Data Hub Protocol and create event for logging data
   as initialization for data hub status code worker.
@@ -347,6 +497,10 @@ DataHubStatusCodeInitializeWorker (
 {
   EFI_STATUS  Status;
 
+  if (mRefillRecordPoolEvent == NULL) {
+    InitializeRecordPool ();
+  }
+
   Status = gBS->LocateProtocol (
                   &gEfiDataHubProtocolGuid, 
                   NULL, 
@@ -358,10 +512,11 @@ DataHubStatusCodeInitializeWorker (
   }
 
   //
-  // Create a Notify Event to log data in Data Hub
+  // Create a Notify Event to log data in Data Hub.
+  // Binary batches are also logged periodically by making it a timer event.
   //
   Status = gBS->CreateEvent (
-                  EVT_NOTIFY_SIGNAL,
+                  FeaturePcdGet (PcdStatusCodeDataHubBinaryFormat) ? (EVT_TIMER | EVT_NOTIFY_SIGNAL) : EVT_NOTIFY_SIGNAL,
                   TPL_CALLBACK,
                   LogDataHubEventCallBack,
                   NULL,
@@ -370,6 +525,11 @@ DataHubStatusCodeInitializeWorker (
 
   ASSERT_EFI_ERROR (Status);
 
+  if (FeaturePcdGet (PcdStatusCodeDataHubBinaryFormat)) {
+    Status = gBS->SetTimer (mLogDataHubEvent, TimerPeriodic, DATA_HUB_STATUS_CODE_BATCH_PERIOD);
+    ASSERT_EFI_ERROR (Status);
+  }
+
   return EFI_SUCCESS;
 }
 
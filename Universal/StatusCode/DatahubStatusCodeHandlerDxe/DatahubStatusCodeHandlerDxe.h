@@ -18,10 +18,12 @@
 #include <Protocol/ReportStatusCodeHandler.h>
 #include <Protocol/DataHub.h>
 #include <Protocol/StatusCode.h>
+#include <Protocol/DataHubStatusCodeStatistics.h>
 
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Guid/StatusCodeDataTypeDebug.h>
 #include <Guid/DataHubStatusCodeRecord.h>
+#include <Guid/DataHubStatusCodeBatch.h>
 #include <Guid/EventGroup.h>
 
 #include <Library/BaseLib.h>
@@ -46,6 +48,35 @@ typedef struct {
   UINT8       Data[sizeof(DATA_HUB_STATUS_CODE_DATA_RECORD) + EFI_STATUS_CODE_DATA_MAX_SIZE];
 } DATAHUB_STATUSCODE_RECORD;
 
+//
+// Binary batch definitions, used when PcdStatusCodeDataHubBinaryFormat is TRUE
+//
+#define DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE    256
+#define DATA_HUB_STATUS_CODE_MAX_FORMATS          (DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE * 3 / 4)
+#define DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH    255
+
+//
+// Period in 100ns units of the timer which logs the batch being filled.
+//
+#define DATA_HUB_STATUS_CODE_BATCH_PERIOD         1000000
+
+typedef struct {
+  UINT64      Hash;
+  UINT32      Length;
+  UINT32      Id;
+} DATA_HUB_STATUS_CODE_FORMAT;
+
+typedef struct {
+  UINT8       *Buffer;
+  UINTN       Size;
+  UINTN       Length;
+  BOOLEAN     Overflow;
+} DATA_HUB_STATUS_CODE_ENCODER;
+
+extern EFI_EVENT                                 mLogDataHubEvent;
+extern EFI_DATA_HUB_PROTOCOL                     *mDataHubProtocol;
+extern DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL  mDataHubStatusCodeStatistics;
+
 /**
   Report status code into DataHub.
 
@@ -88,4 +119,55 @@ DataHubStatusCodeInitializeWorker (
   VOID
   );
 
+/**
+  Allocate the two batch buffers sized by PcdStatusCodeDataHubBatchSize.
+
+  @retval EFI_SUCCESS           The batch buffers are allocated.
+  @retval EFI_OUT_OF_RESOURCES  No memory is available for the batch buffers.
+
+**/
+EFI_STATUS
+InitializeBatchBuffers (
+  VOID
+  );
+
+/**
+  Encode a status code into the batch being filled.
+
+  @param  CodeType             Indicates the type of status code being reported.
+  @param  Value                Describes the current status of a hardware or software entity.
+                               This included information about the class and subclass that is used to
+                               classify the entity as well as an operation.
+  @param  Instance             The enumeration of a hardware or software entity within
+                               the system. Valid instance numbers start with 1.
+  @param  CallerId             This optional parameter may be used to identify the caller.
+                               This parameter allows the status code driver to apply different rules to
+                               different callers.
+  @param  Data                 This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS          The status code is added to the batch.
+  @retval EFI_OUT_OF_RESOURCES The batch is full.
+
+**/
+EFI_STATUS
+DataHubStatusCodeBatchReportWorker (
+  IN EFI_STATUS_CODE_TYPE     CodeType,
+  IN EFI_STATUS_CODE_VALUE    Value,
+  IN UINT32                   Instance,
+  IN EFI_GUID                 *CallerId,
+  IN EFI_STATUS_CODE_DATA     *Data OPTIONAL
+  );
+
+/**
+  Log the filled batches into the Data Hub.
+
+  The batch being filled is swapped with the empty one before it is logged,
+  so that status codes can be reported while the Data Hub logs it.
+
+**/
+VOID
+LogDataHubBatches (
+  VOID
+  );
+
 #endif
@@ -13,6 +13,175 @@
 
 #include "StatusCodePei.h"
 
+EFI_PEI_NOTIFY_DESCRIPTOR mSerialStatusCodeEndOfPeiNotifyList = {
+  (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST),
+  &gEfiEndOfPeiSignalPpiGuid,
+  SerialStatusCodeEndOfPeiNotify
+};
+
+/**
+  Get the buffer of the serial status code output.
+
+  @return The header of the buffer in the GUID'ed HOB, or NULL if the output is not buffered.
+
+**/
+SERIAL_STATUS_CODE_BUFFER_HEADER *
+GetSerialStatusCodeBuffer (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE  *GuidHob;
+
+  if (PcdGet32 (PcdStatusCodeSerialBufferSize) == 0) {
+    return NULL;
+  }
+
+  GuidHob = GetFirstGuidHob (&gSerialStatusCodeBufferGuid);
+  if (GuidHob == NULL) {
+    return NULL;
+  }
+
+  return (SERIAL_STATUS_CODE_BUFFER_HEADER *) GET_GUID_HOB_DATA (GuidHob);
+}
+
+/**
+  Write the buffered serial status code output to the serial port.
+
+  @param  Header           The header of the buffer.
+
+**/
+VOID
+FlushSerialStatusCodeBuffer (
+  IN SERIAL_STATUS_CODE_BUFFER_HEADER  *Header
+  )
+{
+  if (Header->Length != 0) {
+    SerialPortWrite ((UINT8 *) (Header + 1), Header->Length);
+    Header->Length = 0;
+  }
+}
+
+/**
+  Create the GUID'ed HOB which buffers the serial status code output.
+
+  Nothing is created if PcdStatusCodeSerialBufferSize is zero, and the output
+  is then written to the serial port when each status code is reported.
+
+  @retval EFI_SUCCESS  The serial status code worker is initialized.
+
+**/
+EFI_STATUS
+SerialStatusCodeInitializeWorker (
+  VOID
+  )
+{
+  EFI_STATUS                        Status;
+  SERIAL_STATUS_CODE_BUFFER_HEADER  *Header;
+  UINT32                            Size;
+
+  Size = PcdGet32 (PcdStatusCodeSerialBufferSize);
+  if (Size == 0) {
+    return EFI_SUCCESS;
+  }
+  if (Size > PEI_SERIAL_STATUS_CODE_BUFFER_MAX_SIZE) {
+    Size = PEI_SERIAL_STATUS_CODE_BUFFER_MAX_SIZE;
+  }
+
+  Header = BuildGuidHob (
+             &gSerialStatusCodeBufferGuid,
+             sizeof (SERIAL_STATUS_CODE_BUFFER_HEADER) + Size
+             );
+  if (Header == NULL) {
+    //
+    // Fall back to writing each status code to the serial port.
+    //
+    return EFI_SUCCESS;
+  }
+
+  Header->Size   = Size;
+  Header->Length = 0;
+
+  Status = PeiServicesNotifyPpi (&mSerialStatusCodeEndOfPeiNotifyList);
+  ASSERT_EFI_ERROR (Status);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write the buffered serial status code output at the end of PEI.
+
+  The status codes reported after the end of PEI are written to the serial port
+  directly, so that none of them waits in the buffer across the hand off to DXE.
+
+  @param  PeiServices      An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  NotifyDescriptor Address of the notification descriptor data structure.
+  @param  Ppi              Address of the PPI that was installed.
+
+  @retval EFI_SUCCESS      The buffered output is written.
+
+**/
+EFI_STATUS
+EFIAPI
+SerialStatusCodeEndOfPeiNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  SERIAL_STATUS_CODE_BUFFER_HEADER  *Header;
+
+  Header = GetSerialStatusCodeBuffer ();
+  if (Header != NULL) {
+    FlushSerialStatusCodeBuffer (Header);
+    Header->Size = 0;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write status code output to the serial port through the buffer.
+
+  The output is appended to the buffer, which is written to the serial port first
+  if the output does not fit in it. Output larger than the buffer and output which
+  must not be delayed are written to the serial port before returning.
+
+  @param  Buffer           The characters to write.
+  @param  Length           The number of characters to write.
+  @param  Flush            TRUE to write the output to the serial port before returning.
+
+**/
+VOID
+SerialStatusCodeWrite (
+  IN CHAR8                          *Buffer,
+  IN UINTN                          Length,
+  IN BOOLEAN                        Flush
+  )
+{
+  SERIAL_STATUS_CODE_BUFFER_HEADER  *Header;
+
+  Header = GetSerialStatusCodeBuffer ();
+  if (Header == NULL) {
+    SerialPortWrite ((UINT8 *) Buffer, Length);
+    return;
+  }
+
+  if (Header->Length + Length > Header->Size) {
+    FlushSerialStatusCodeBuffer (Header);
+  }
+  if (Length > Header->Size) {
+    SerialPortWrite ((UINT8 *) Buffer, Length);
+    return;
+  }
+
+  CopyMem ((UINT8 *) (Header + 1) + Header->Length, Buffer, Length);
+  Header->Length += (UINT32) Length;
+
+  if (Flush) {
+    FlushSerialStatusCodeBuffer (Header);
+  }
+}
+
 /**
   Convert status code value and extended data to readable ASCII string, send string to serial I/O device.
 
@@ -52,8 +221,10 @@ SerialStatusCodeReportWorker (
   UINT32          LineNumber;
   UINTN           CharCount;
   BASE_LIST       Marker;
+  BOOLEAN         Flush;
 
   Buffer[0] = '\0';
+  Flush     = (BOOLEAN) ((CodeType & EFI_STATUS_CODE_TYPE_MASK) == EFI_ERROR_CODE);
 
   if (Data != NULL &&
       ReportStatusCodeExtractAssertInfo (CodeType, Value, Data, &Filename, &Description, &LineNumber)) {
@@ -73,6 +244,7 @@ SerialStatusCodeReportWorker (
     //
     // Print DEBUG() information into output buffer.
     //
+    Flush = (BOOLEAN) ((ErrorLevel & DEBUG_ERROR) != 0);
     CharCount = AsciiBSPrint (
                   Buffer,
                   sizeof (Buffer),
@@ -153,9 +325,10 @@ SerialStatusCodeReportWorker (
   }
 
   //
-  // Call SerialPort Lib function to do print.
+  // Error codes and error messages are written to the serial port at once.
+  // Other output may wait in the buffer.
   //
-  SerialPortWrite ((UINT8 *) Buffer, CharCount);
+  SerialStatusCodeWrite (Buffer, CharCount, Flush);
 
   return EFI_SUCCESS;
 }
@@ -124,6 +124,8 @@ PeiStatusCodeDriverEntry (
   if (FeaturePcdGet (PcdStatusCodeUseSerial)) {
     Status = SerialPortInitialize();
     ASSERT_EFI_ERROR (Status);
+    Status = SerialStatusCodeInitializeWorker ();
+    ASSERT_EFI_ERROR (Status);
   }
   if (FeaturePcdGet (PcdStatusCodeUseMemory)) {
     Status = MemoryStatusCodeInitializeWorker ();
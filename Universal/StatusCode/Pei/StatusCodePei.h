@@ -20,7 +20,9 @@
 #include <Guid/MemoryStatusCodeRecord.h>
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Guid/StatusCodeDataTypeDebug.h>
+#include <Guid/SerialStatusCodeBuffer.h>
 #include <Ppi/StatusCode.h>
+#include <Ppi/EndOfPeiPhase.h>
 
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -34,6 +36,46 @@
 #include <Library/OemHookStatusCodeLib.h>
 #include <Library/PeimEntryPoint.h>
 
+//
+// The largest serial status code buffer which fits in a GUID'ed HOB.
+//
+#define PEI_SERIAL_STATUS_CODE_BUFFER_MAX_SIZE  0xF000
+
+/**
+  Create the GUID'ed HOB which buffers the serial status code output.
+
+  Nothing is created if PcdStatusCodeSerialBufferSize is zero, and the output
+  is then written to the serial port when each status code is reported.
+
+  @retval EFI_SUCCESS  The serial status code worker is initialized.
+
+**/
+EFI_STATUS
+SerialStatusCodeInitializeWorker (
+  VOID
+  );
+
+/**
+  Write the buffered serial status code output at the end of PEI.
+
+  The status codes reported after the end of PEI are written to the serial port
+  directly, so that none of them waits in the buffer across the hand off to DXE.
+
+  @param  PeiServices      An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  NotifyDescriptor Address of the notification descriptor data structure.
+  @param  Ppi              Address of the PPI that was installed.
+
+  @retval EFI_SUCCESS      The buffered output is written.
+
+**/
+EFI_STATUS
+EFIAPI
+SerialStatusCodeEndOfPeiNotify (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  );
+
 /**
   Convert status code value and extended data to readable ASCII string, send string to serial I/O device.
 
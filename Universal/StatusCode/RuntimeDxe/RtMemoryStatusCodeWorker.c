@@ -14,11 +14,21 @@
 
 #include "StatusCodeRuntimeDxe.h"
 
-RUNTIME_MEMORY_STATUSCODE_HEADER  *mRtMemoryStatusCodeTable;
+RUNTIME_MEMORY_STATUS_CODE_RING  *mRtMemoryStatusCodeTable;
+
+RUNTIME_MEMORY_STATUS_CODE_PROTOCOL  mRtMemoryStatusCodeProtocol = {
+  RUNTIME_MEMORY_STATUS_CODE_PROTOCOL_REVISION,
+  NULL,
+  RtMemoryStatusCodeGetRecords
+};
 
 /**
   Initialize runtime memory status code table as initialization for runtime memory status code worker
  
+  The table is published as a configuration table so that it can be found by
+  code outside of this driver, and the Runtime Memory Status Code Protocol is
+  installed to read it back.
+
   @retval EFI_SUCCESS  Runtime memory status code table successfully initialized.
 
 **/
@@ -27,19 +37,40 @@ RtMemoryStatusCodeInitializeWorker (
   VOID
   )
 {
+  EFI_STATUS  Status;
+  UINT64      StartValue;
+  UINT64      EndValue;
+
   //
   // Allocate runtime memory status code pool.
   //
-  mRtMemoryStatusCodeTable = AllocateRuntimePool (
-                               sizeof (RUNTIME_MEMORY_STATUSCODE_HEADER) +
+  mRtMemoryStatusCodeTable = AllocateRuntimeZeroPool (
+                               sizeof (RUNTIME_MEMORY_STATUS_CODE_RING) +
                                PcdGet16 (PcdStatusCodeMemorySize) * 1024
                                );
   ASSERT (mRtMemoryStatusCodeTable != NULL);
 
-  mRtMemoryStatusCodeTable->RecordIndex      = 0;
-  mRtMemoryStatusCodeTable->NumberOfRecords  = 0;
-  mRtMemoryStatusCodeTable->MaxRecordsNumber = 
-    (PcdGet16 (PcdStatusCodeMemorySize) * 1024) / sizeof (MEMORY_STATUSCODE_RECORD);
+  mRtMemoryStatusCodeTable->Signature          = RUNTIME_MEMORY_STATUS_CODE_RING_SIGNATURE;
+  mRtMemoryStatusCodeTable->MaxRecordsNumber   = 
+    (PcdGet16 (PcdStatusCodeMemorySize) * 1024) / sizeof (RUNTIME_MEMORY_STATUS_CODE_RECORD);
+  mRtMemoryStatusCodeTable->LastSequence       = 0;
+  mRtMemoryStatusCodeTable->TimeStampFrequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (mRtMemoryStatusCodeTable->TimeStampFrequency == 0) {
+    DEBUG ((EFI_D_WARN, "StatusCodeRuntimeDxe: no performance counter, status codes are not time stamped\n"));
+  }
+  ASSERT (mRtMemoryStatusCodeTable->MaxRecordsNumber > 0);
+
+  Status = gBS->InstallConfigurationTable (&gRuntimeMemoryStatusCodeRingGuid, mRtMemoryStatusCodeTable);
+  ASSERT_EFI_ERROR (Status);
+
+  mRtMemoryStatusCodeProtocol.Ring = mRtMemoryStatusCodeTable;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gRuntimeMemoryStatusCodeProtocolGuid,
+                  &mRtMemoryStatusCodeProtocol,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
 
   return EFI_SUCCESS;
 }
@@ -48,6 +79,15 @@ RtMemoryStatusCodeInitializeWorker (
 /**
   Report status code into runtime memory. If the runtime pool is full, roll back to the 
   first record and overwrite it.
+
+  The function takes no lock, so it may be called from several processors at
+  once and may interrupt itself. The record is reserved by incrementing the
+  sequence number of the ring, and its sequence number is stored last, once
+  the rest of the record is complete.
+
+  The performance counter is not read at runtime, where the TimerLib may use
+  physical addresses, nor when there is no counter. The time stamp is zero
+  then.
  
   @param  CodeType                Indicates the type of status code being reported.
   @param  Value                   Describes the current status of a hardware or software entity.
@@ -66,39 +106,145 @@ RtMemoryStatusCodeReportWorker (
   IN UINT32                             Instance
   )
 {
-  MEMORY_STATUSCODE_RECORD              *Record;
+  RUNTIME_MEMORY_STATUS_CODE_RECORD     *Record;
+  UINT32                                Sequence;
 
   //
-  // Locate current record buffer.
+  // Reserve a record. Once the ring is full, the record reserved is the
+  // oldest one, which is overwritten.
   //
-  Record = (MEMORY_STATUSCODE_RECORD *) (mRtMemoryStatusCodeTable + 1);
-  Record = &Record[mRtMemoryStatusCodeTable->RecordIndex++];
+  Sequence = InterlockedIncrement (&mRtMemoryStatusCodeTable->LastSequence);
+  Record   = (RUNTIME_MEMORY_STATUS_CODE_RECORD *) (mRtMemoryStatusCodeTable + 1);
+  Record   = &Record[(Sequence - 1) % mRtMemoryStatusCodeTable->MaxRecordsNumber];
 
   //
-  // Save status code.
+  // Tell readers the record is being written before changing it.
   //
-  Record->CodeType = CodeType;
-  Record->Value    = Value;
-  Record->Instance = Instance;
+  Record->Sequence = 0;
+  MemoryFence ();
 
   //
-  // If record index equals to max record number, then wrap around record index to zero.
-  //
-  // The reader of status code should compare the number of records with max records number,
-  // If it is equal to or larger than the max number, then the wrap-around had happened,
-  // so the first record is pointed by record index.
-  // If it is less then max number, index of the first record is zero.
+  // Save status code.
   //
-  mRtMemoryStatusCodeTable->NumberOfRecords++;
-  if (mRtMemoryStatusCodeTable->RecordIndex == mRtMemoryStatusCodeTable->MaxRecordsNumber) {
-    //
-    // Wrap around record index.
-    //
-    mRtMemoryStatusCodeTable->RecordIndex = 0;
+  if (EfiAtRuntime () || (mRtMemoryStatusCodeTable->TimeStampFrequency == 0)) {
+    Record->TimeStamp = 0;
+  } else {
+    Record->TimeStamp = GetPerformanceCounter ();
   }
+  Record->CodeType  = CodeType;
+  Record->Value     = Value;
+  Record->Instance  = Instance;
+
+  MemoryFence ();
+  Record->Sequence  = Sequence;
 
   return EFI_SUCCESS;
 }
 
+/**
+  Returns the status codes kept in runtime memory, in the order they were
+  reported, starting with the status code of sequence number *Cursor.
+
+  Records still being written stop the read, so a record is never returned
+  before one reported earlier. Records overwritten before they could be read
+  are skipped and counted in LostCount.
+
+  @param  This          A pointer to the RUNTIME_MEMORY_STATUS_CODE_PROTOCOL instance.
+  @param  Cursor        On input, the sequence number of the first record to return.
+                        Zero is the same as 1, the first status code ever reported.
+                        On output, the sequence number to pass in the next call
+                        to continue after the records returned.
+  @param  Records       The buffer that receives the records.
+  @param  RecordCount   On input, the number of records Records can hold. On output,
+                        the number of records returned.
+  @param  LostCount     Optional. The number of records between the input and the
+                        output cursor that were overwritten before they were read.
+
+  @retval EFI_SUCCESS           RecordCount records were returned.
+  @retval EFI_INVALID_PARAMETER Cursor or RecordCount is NULL, or Records is NULL
+                                and RecordCount is not zero.
+
+**/
+EFI_STATUS
+EFIAPI
+RtMemoryStatusCodeGetRecords (
+  IN     RUNTIME_MEMORY_STATUS_CODE_PROTOCOL  *This,
+  IN OUT UINT32                               *Cursor,
+  OUT    RUNTIME_MEMORY_STATUS_CODE_RECORD    *Records,
+  IN OUT UINTN                                *RecordCount,
+  OUT    UINT32                               *LostCount OPTIONAL
+  )
+{
+  RUNTIME_MEMORY_STATUS_CODE_RECORD     *Ring;
+  RUNTIME_MEMORY_STATUS_CODE_RECORD     *Record;
+  UINT32                                MaxRecordsNumber;
+  UINT32                                LastSequence;
+  UINT32                                Sequence;
+  UINT32                                RecordSequence;
+  UINT32                                Lost;
+  UINTN                                 Count;
+
+  if ((Cursor == NULL) || (RecordCount == NULL) || ((Records == NULL) && (*RecordCount != 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Ring             = (RUNTIME_MEMORY_STATUS_CODE_RECORD *) (mRtMemoryStatusCodeTable + 1);
+  MaxRecordsNumber = mRtMemoryStatusCodeTable->MaxRecordsNumber;
+  LastSequence     = mRtMemoryStatusCodeTable->LastSequence;
+  MemoryFence ();
 
+  Sequence = (*Cursor == 0) ? 1 : *Cursor;
+  Lost     = 0;
 
+  //
+  // Records older than the ring size have been overwritten for sure.
+  //
+  if ((LastSequence >= MaxRecordsNumber) && (Sequence <= LastSequence - MaxRecordsNumber)) {
+    Lost     = LastSequence - MaxRecordsNumber + 1 - Sequence;
+    Sequence = LastSequence - MaxRecordsNumber + 1;
+  }
+
+  Count = 0;
+  while ((Sequence <= LastSequence) && (Count < *RecordCount)) {
+    Record         = &Ring[(Sequence - 1) % MaxRecordsNumber];
+    RecordSequence = Record->Sequence;
+    if (RecordSequence != Sequence) {
+      if ((RecordSequence == 0) || (RecordSequence < Sequence)) {
+        //
+        // The record is still being written. Stop here to keep the records
+        // in order; it is returned by a later call.
+        //
+        break;
+      }
+      //
+      // A newer record has taken its place.
+      //
+      Lost++;
+      Sequence++;
+      continue;
+    }
+
+    MemoryFence ();
+    CopyMem (&Records[Count], Record, sizeof (RUNTIME_MEMORY_STATUS_CODE_RECORD));
+    MemoryFence ();
+    if (Record->Sequence != Sequence) {
+      //
+      // The record was overwritten while being copied.
+      //
+      Lost++;
+      Sequence++;
+      continue;
+    }
+
+    Count++;
+    Sequence++;
+  }
+
+  *Cursor      = Sequence;
+  *RecordCount = Count;
+  if (LostCount != NULL) {
+    *LostCount = Lost;
+  }
+
+  return EFI_SUCCESS;
+}
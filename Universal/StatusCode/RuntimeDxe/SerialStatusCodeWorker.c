@@ -14,6 +14,339 @@
 
 #include "StatusCodeRuntimeDxe.h"
 
+//
+// Ring which buffers the serial status code output in boot services.
+// mSerialBufferHead and mSerialBufferTail are free running offsets, and the size
+// is a power of two. Characters are only added by the report worker, which is
+// not reentered, and only removed by the owner of mSerialFlushLock.
+//
+UINT8            *mSerialBuffer                = NULL;
+UINT32           mSerialBufferSize             = 0;
+volatile UINT32  mSerialBufferHead             = 0;
+volatile UINT32  mSerialBufferTail             = 0;
+UINT32           mSerialFlushLock              = 0;
+UINT32           mSerialDroppedSinceNotice     = 0;
+EFI_EVENT        mSerialFlushEvent             = NULL;
+EFI_EVENT        mSerialExitBootServicesEvent  = NULL;
+
+//
+// Total number of characters of status code output dropped because the
+// ring was full while it was being written to the serial port. It is
+// reported in a DEBUG message when ExitBootServices() is called.
+//
+UINT64           mSerialStatusCodeDroppedBytes = 0;
+
+/**
+  Write the buffered serial status code output to the serial port, followed
+  by characters which are not buffered.
+
+  Nothing is done if the output is already being written by an interrupted caller,
+  which writes the characters added meanwhile before it returns. The characters
+  which are not buffered are not written then, as they would be written in the
+  middle of the output of the interrupted caller.
+
+  @param  Message          Optional characters to write after the buffered output.
+  @param  MessageLength    The number of characters of Message.
+
+  @retval TRUE             The output is written.
+  @retval FALSE            The output is being written by an interrupted caller.
+
+**/
+BOOLEAN
+FlushSerialStatusCodeBufferAndWrite (
+  IN CHAR8                    *Message  OPTIONAL,
+  IN UINTN                    MessageLength
+  )
+{
+  UINT8   *Buffer;
+  UINT32  Head;
+  UINT32  Tail;
+  UINT32  Offset;
+  UINT32  Length;
+
+  Buffer = mSerialBuffer;
+  if (Buffer == NULL) {
+    if (Message != NULL) {
+      SerialPortWrite ((UINT8 *) Message, MessageLength);
+    }
+    return TRUE;
+  }
+
+  do {
+    if (InterlockedCompareExchange32 (&mSerialFlushLock, 0, 1) != 0) {
+      return (BOOLEAN) (Message == NULL);
+    }
+
+    Tail = mSerialBufferTail;
+    while (TRUE) {
+      Head = mSerialBufferHead;
+      MemoryFence ();
+      if (Head == Tail) {
+        break;
+      }
+
+      Offset = Tail & (mSerialBufferSize - 1);
+      Length = MIN (Head - Tail, mSerialBufferSize - Offset);
+      SerialPortWrite (Buffer + Offset, Length);
+
+      Tail += Length;
+      MemoryFence ();
+      mSerialBufferTail = Tail;
+    }
+
+    if (Message != NULL) {
+      SerialPortWrite ((UINT8 *) Message, MessageLength);
+      Message = NULL;
+    }
+
+    InterlockedCompareExchange32 (&mSerialFlushLock, 1, 0);
+
+    //
+    // Characters added by a caller which interrupted us after the last check
+    // could not be written by that caller.
+    //
+  } while (mSerialBufferHead != Tail);
+
+  return TRUE;
+}
+
+/**
+  Write the buffered serial status code output to the serial port.
+
+  Nothing is done if the output is already being written by an interrupted caller,
+  which writes the characters added meanwhile before it returns.
+
+**/
+VOID
+FlushSerialStatusCodeBuffer (
+  VOID
+  )
+{
+  FlushSerialStatusCodeBufferAndWrite (NULL, 0);
+}
+
+/**
+  Add characters to the ring which buffers the serial status code output.
+
+  If the characters do not fit, the ring is written to the serial port first.
+
+  @param  Buffer           The characters to add.
+  @param  Length           The number of characters to add.
+
+  @retval TRUE             The characters are added.
+  @retval FALSE            The ring is full and being written by an interrupted caller.
+
+**/
+BOOLEAN
+AddToSerialStatusCodeBuffer (
+  IN CHAR8                    *Buffer,
+  IN UINTN                    Length
+  )
+{
+  UINT32  Head;
+  UINT32  Offset;
+  UINTN   FirstLength;
+
+  Head = mSerialBufferHead;
+  if (Length > mSerialBufferSize - (Head - mSerialBufferTail)) {
+    FlushSerialStatusCodeBuffer ();
+    if (Length > mSerialBufferSize - (Head - mSerialBufferTail)) {
+      return FALSE;
+    }
+  }
+  MemoryFence ();
+
+  Offset      = Head & (mSerialBufferSize - 1);
+  FirstLength = MIN (Length, mSerialBufferSize - Offset);
+  CopyMem (mSerialBuffer + Offset, Buffer, FirstLength);
+  CopyMem (mSerialBuffer, Buffer + FirstLength, Length - FirstLength);
+
+  MemoryFence ();
+  mSerialBufferHead = Head + (UINT32) Length;
+
+  return TRUE;
+}
+
+/**
+  Write status code output to the serial port through the ring buffer.
+
+  The output is written to the serial port directly when it is not buffered,
+  which is the case after ExitBootServices(), or when it is larger than the ring.
+  Output larger than the ring is written after the buffered output, and dropped
+  like output which does not fit in the ring if an interrupted caller is writing
+  the buffered output.
+
+  @param  Buffer           The characters to write.
+  @param  Length           The number of characters to write.
+  @param  Flush            TRUE to write the output to the serial port before returning.
+
+**/
+VOID
+SerialStatusCodeWrite (
+  IN CHAR8                    *Buffer,
+  IN UINTN                    Length,
+  IN BOOLEAN                  Flush
+  )
+{
+  CHAR8   Notice[64];
+  UINTN   NoticeLength;
+
+  if (mSerialBuffer == NULL) {
+    SerialPortWrite ((UINT8 *) Buffer, Length);
+    return;
+  }
+
+  if (mSerialDroppedSinceNotice != 0) {
+    NoticeLength = AsciiSPrint (
+                     Notice,
+                     sizeof (Notice),
+                     "\n\r[%d status code characters dropped]\n\r",
+                     mSerialDroppedSinceNotice
+                     );
+    if (AddToSerialStatusCodeBuffer (Notice, NoticeLength)) {
+      mSerialDroppedSinceNotice = 0;
+    }
+  }
+
+  if (Length > mSerialBufferSize) {
+    if (!FlushSerialStatusCodeBufferAndWrite (Buffer, Length)) {
+      mSerialDroppedSinceNotice     += (UINT32) Length;
+      mSerialStatusCodeDroppedBytes += Length;
+    }
+    return;
+  }
+
+  if (!AddToSerialStatusCodeBuffer (Buffer, Length)) {
+    mSerialDroppedSinceNotice     += (UINT32) Length;
+    mSerialStatusCodeDroppedBytes += Length;
+  }
+
+  if (Flush) {
+    FlushSerialStatusCodeBuffer ();
+  }
+}
+
+/**
+  Timer callback which writes the buffered serial status code output.
+
+  @param  Event         Event whose notification function is being invoked.
+  @param  Context       Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+SerialStatusCodeFlushCallback (
+  IN EFI_EVENT        Event,
+  IN VOID             *Context
+  )
+{
+  FlushSerialStatusCodeBuffer ();
+}
+
+/**
+  Write the buffered serial status code output and stop buffering it
+  when ExitBootServices() is called. The number of characters dropped in
+  boot services, if any, is reported first.
+
+  @param  Event         Event whose notification function is being invoked.
+  @param  Context       Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+SerialStatusCodeExitBootServicesCallback (
+  IN EFI_EVENT        Event,
+  IN VOID             *Context
+  )
+{
+  if (mSerialStatusCodeDroppedBytes != 0) {
+    DEBUG ((
+      EFI_D_WARN,
+      "StatusCodeRuntimeDxe: %ld serial status code characters dropped in boot services\n",
+      mSerialStatusCodeDroppedBytes
+      ));
+  }
+
+  FlushSerialStatusCodeBuffer ();
+  mSerialBuffer = NULL;
+}
+
+/**
+  Initialize the serial status code worker.
+
+  The output the Status Code PEIM left in its buffer is written to the serial port.
+  If PcdStatusCodeSerialBufferSize is not zero, a ring is allocated to buffer the
+  output in boot services, and a timer is started to write it periodically.
+
+  @retval EFI_SUCCESS  The serial status code worker is initialized.
+
+**/
+EFI_STATUS
+EfiSerialStatusCodeInitializeWorker (
+  VOID
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_HOB_GUID_TYPE                 *GuidHob;
+  SERIAL_STATUS_CODE_BUFFER_HEADER  *Header;
+  UINT8                             *Buffer;
+  UINT32                            Size;
+
+  GuidHob = GetFirstGuidHob (&gSerialStatusCodeBufferGuid);
+  if (GuidHob != NULL) {
+    Header = (SERIAL_STATUS_CODE_BUFFER_HEADER *) GET_GUID_HOB_DATA (GuidHob);
+    if (Header->Length != 0) {
+      SerialPortWrite ((UINT8 *) (Header + 1), Header->Length);
+      Header->Length = 0;
+    }
+  }
+
+  Size = PcdGet32 (PcdStatusCodeSerialBufferSize);
+  if (Size == 0) {
+    return EFI_SUCCESS;
+  }
+  Size = GetPowerOfTwo32 (Size);
+
+  Buffer = AllocatePool (Size);
+  if (Buffer == NULL) {
+    //
+    // Fall back to writing each status code to the serial port.
+    //
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  SerialStatusCodeFlushCallback,
+                  NULL,
+                  &mSerialFlushEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->SetTimer (
+                  mSerialFlushEvent,
+                  TimerPeriodic,
+                  PcdGet32 (PcdStatusCodeSerialFlushPeriod)
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  SerialStatusCodeExitBootServicesCallback,
+                  NULL,
+                  &gEfiEventExitBootServicesGuid,
+                  &mSerialExitBootServicesEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  mSerialBufferSize = Size;
+  mSerialBuffer     = Buffer;
+
+  return EFI_SUCCESS;
+}
+
 /**
   Convert status code value and extended data to readable ASCII string, send string to serial I/O device.
  
@@ -50,8 +383,10 @@ SerialStatusCodeReportWorker (
   UINT32          LineNumber;
   UINTN           CharCount;
   BASE_LIST       Marker;
+  BOOLEAN         Flush;
 
   Buffer[0] = '\0';
+  Flush     = (BOOLEAN) ((CodeType & EFI_STATUS_CODE_TYPE_MASK) == EFI_ERROR_CODE);
 
   if (Data != NULL &&
       ReportStatusCodeExtractAssertInfo (CodeType, Value, Data, &Filename, &Description, &LineNumber)) {
@@ -71,6 +406,7 @@ SerialStatusCodeReportWorker (
     //
     // Print DEBUG() information into output buffer.
     //
+    Flush = (BOOLEAN) ((ErrorLevel & DEBUG_ERROR) != 0);
     CharCount = AsciiBSPrint (
                   Buffer, 
                   sizeof (Buffer), 
@@ -151,9 +487,10 @@ SerialStatusCodeReportWorker (
   }
 
   //
-  // Call SerialPort Lib function to do print.
+  // Error codes and error messages are written to the serial port at once.
+  // Other output may wait in the buffer.
   //
-  SerialPortWrite ((UINT8 *) Buffer, CharCount);
+  SerialStatusCodeWrite (Buffer, CharCount, Flush);
 
   return EFI_SUCCESS;
 }
@@ -111,6 +111,18 @@ ReportDispatcher (
   IN EFI_STATUS_CODE_DATA     *Data      OPTIONAL
   )
 {
+  //
+  // The runtime memory worker takes no lock, so it is called first and also
+  // records the status codes reported from other processors or nested reports.
+  //
+  if (FeaturePcdGet (PcdStatusCodeUseMemory)) {
+    RtMemoryStatusCodeReportWorker (
+      CodeType,
+      Value,
+      Instance
+      );
+  }
+
   //
   // Use atom operation to avoid the reentant of report.
   // If current status is not zero, then the function is reentrancy.
@@ -128,13 +140,6 @@ ReportDispatcher (
       Data
       );
   }
-  if (FeaturePcdGet (PcdStatusCodeUseMemory)) {
-    RtMemoryStatusCodeReportWorker (
-      CodeType,
-      Value,
-      Instance
-      );
-  }
   if (FeaturePcdGet (PcdStatusCodeUseDataHub)) {
     DataHubStatusCodeReportWorker (
       CodeType,
@@ -219,6 +224,8 @@ InitializationDispatcherWorker (
     //
     Status = SerialPortInitialize ();
     ASSERT_EFI_ERROR (Status);
+    Status = EfiSerialStatusCodeInitializeWorker ();
+    ASSERT_EFI_ERROR (Status);
   }
   if (FeaturePcdGet (PcdStatusCodeUseMemory)) {
     Status = RtMemoryStatusCodeInitializeWorker ();
@@ -18,12 +18,17 @@
 
 #include <FrameworkDxe.h>
 #include <Guid/DataHubStatusCodeRecord.h>
+#include <Guid/DataHubStatusCodeBatch.h>
 #include <Protocol/DataHub.h>
 #include <Guid/MemoryStatusCodeRecord.h>
+#include <Guid/RuntimeMemoryStatusCodeRing.h>
 #include <Protocol/StatusCode.h>
+#include <Protocol/RuntimeMemoryStatusCode.h>
+#include <Protocol/DataHubStatusCodeStatistics.h>
 #include <Guid/StatusCodeDataTypeId.h>
 #include <Guid/StatusCodeDataTypeDebug.h>
 #include <Guid/EventGroup.h>
+#include <Guid/SerialStatusCodeBuffer.h>
 
 #include <Library/BaseLib.h>
 #include <Library/SynchronizationLib.h>
@@ -40,6 +45,7 @@
 #include <Library/UefiRuntimeLib.h>
 #include <Library/SerialPortLib.h>
 #include <Library/OemHookStatusCodeLib.h>
+#include <Library/TimerLib.h>
 
 //
 // Data hub worker definition
@@ -52,17 +58,47 @@ typedef struct {
   UINT8       Data[sizeof(DATA_HUB_STATUS_CODE_DATA_RECORD) + EFI_STATUS_CODE_DATA_MAX_SIZE];
 } DATAHUB_STATUSCODE_RECORD;
 
+//
+// Binary batch definitions, used when PcdStatusCodeDataHubBinaryFormat is TRUE
+//
+#define DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE    256
+#define DATA_HUB_STATUS_CODE_MAX_FORMATS          (DATA_HUB_STATUS_CODE_FORMAT_TABLE_SIZE * 3 / 4)
+#define DATA_HUB_STATUS_CODE_MAX_STRING_LENGTH    255
 
 //
-// Runtime memory status code worker definition
+// Period in 100ns units of the timer which logs the batch being filled.
 //
+#define DATA_HUB_STATUS_CODE_BATCH_PERIOD         1000000
+
 typedef struct {
-  UINT32   RecordIndex;
-  UINT32   NumberOfRecords;
-  UINT32   MaxRecordsNumber;
-} RUNTIME_MEMORY_STATUSCODE_HEADER;
+  UINT64      Hash;
+  UINT32      Length;
+  UINT32      Id;
+} DATA_HUB_STATUS_CODE_FORMAT;
 
-extern RUNTIME_MEMORY_STATUSCODE_HEADER  *mRtMemoryStatusCodeTable;
+typedef struct {
+  UINT8       *Buffer;
+  UINTN       Size;
+  UINTN       Length;
+  BOOLEAN     Overflow;
+} DATA_HUB_STATUS_CODE_ENCODER;
+
+extern EFI_EVENT                                 mLogDataHubEvent;
+extern EFI_DATA_HUB_PROTOCOL                     *mDataHubProtocol;
+extern DATA_HUB_STATUS_CODE_STATISTICS_PROTOCOL  mDataHubStatusCodeStatistics;
+
+
+//
+// Runtime memory status code worker definition
+//
+extern RUNTIME_MEMORY_STATUS_CODE_RING  *mRtMemoryStatusCodeTable;
+
+extern EFI_HANDLE  mHandle;
+
+//
+// Serial status code worker definition
+//
+extern UINT64  mSerialStatusCodeDroppedBytes;
 
 /**
   Report status code to all supported device.
@@ -107,9 +143,13 @@ InitializationDispatcherWorker (
 
 
 /**
-  Locates Serial I/O Protocol as initialization for serial status code worker.
- 
-  @retval EFI_SUCCESS  Serial I/O Protocol is successfully located.
+  Initialize the serial status code worker.
+
+  The output the Status Code PEIM left in its buffer is written to the serial port.
+  If PcdStatusCodeSerialBufferSize is not zero, a ring is allocated to buffer the
+  output in boot services, and a timer is started to write it periodically.
+
+  @retval EFI_SUCCESS  The serial status code worker is initialized.
 
 **/
 EFI_STATUS
@@ -160,6 +200,9 @@ RtMemoryStatusCodeInitializeWorker (
 /**
   Report status code into runtime memory. If the runtime pool is full, roll back to the 
   first record and overwrite it.
+
+  The function takes no lock, so it may be called from several processors at
+  once and may interrupt itself.
  
   @param  CodeType                Indicates the type of status code being reported.
   @param  Value                   Describes the current status of a hardware or software entity.
@@ -178,6 +221,40 @@ RtMemoryStatusCodeReportWorker (
   IN UINT32                             Instance
   );
 
+/**
+  Returns the status codes kept in runtime memory, in the order they were
+  reported, starting with the status code of sequence number *Cursor.
+
+  Records still being written stop the read, so a record is never returned
+  before one reported earlier. Records overwritten before they could be read
+  are skipped and counted in LostCount.
+
+  @param  This          A pointer to the RUNTIME_MEMORY_STATUS_CODE_PROTOCOL instance.
+  @param  Cursor        On input, the sequence number of the first record to return.
+                        Zero is the same as 1, the first status code ever reported.
+                        On output, the sequence number to pass in the next call
+                        to continue after the records returned.
+  @param  Records       The buffer that receives the records.
+  @param  RecordCount   On input, the number of records Records can hold. On output,
+                        the number of records returned.
+  @param  LostCount     Optional. The number of records between the input and the
+                        output cursor that were overwritten before they were read.
+
+  @retval EFI_SUCCESS           RecordCount records were returned.
+  @retval EFI_INVALID_PARAMETER Cursor or RecordCount is NULL, or Records is NULL
+                                and RecordCount is not zero.
+
+**/
+EFI_STATUS
+EFIAPI
+RtMemoryStatusCodeGetRecords (
+  IN     RUNTIME_MEMORY_STATUS_CODE_PROTOCOL  *This,
+  IN OUT UINT32                               *Cursor,
+  OUT    RUNTIME_MEMORY_STATUS_CODE_RECORD    *Records,
+  IN OUT UINTN                                *RecordCount,
+  OUT    UINT32                               *LostCount OPTIONAL
+  );
+
 /**
   Locate Data Hub Protocol and create event for logging data
   as initialization for data hub status code worker.
@@ -190,6 +267,57 @@ DataHubStatusCodeInitializeWorker (
   VOID
   );
 
+/**
+  Allocate the two batch buffers sized by PcdStatusCodeDataHubBatchSize.
+
+  @retval EFI_SUCCESS           The batch buffers are allocated.
+  @retval EFI_OUT_OF_RESOURCES  No memory is available for the batch buffers.
+
+**/
+EFI_STATUS
+InitializeBatchBuffers (
+  VOID
+  );
+
+/**
+  Encode a status code into the batch being filled.
+
+  @param  CodeType             Indicates the type of status code being reported.
+  @param  Value                Describes the current status of a hardware or software entity.
+                               This included information about the class and subclass that is used to
+                               classify the entity as well as an operation.
+  @param  Instance             The enumeration of a hardware or software entity within
+                               the system. Valid instance numbers start with 1.
+  @param  CallerId             This optional parameter may be used to identify the caller.
+                               This parameter allows the status code driver to apply different rules to
+                               different callers.
+  @param  Data                 This optional parameter may be used to pass additional data.
+
+  @retval EFI_SUCCESS          The status code is added to the batch.
+  @retval EFI_OUT_OF_RESOURCES The batch is full.
+
+**/
+EFI_STATUS
+DataHubStatusCodeBatchReportWorker (
+  IN EFI_STATUS_CODE_TYPE     CodeType,
+  IN EFI_STATUS_CODE_VALUE    Value,
+  IN UINT32                   Instance,
+  IN EFI_GUID                 *CallerId,
+  IN EFI_STATUS_CODE_DATA     *Data OPTIONAL
+  );
+
+/**
+  Log the filled batches into the Data Hub.
+
+  The batch being filled is swapped with the empty one before it is logged,
+  so that status codes can be reported while the Data Hub logs it.
+
+**/
+VOID
+LogDataHubBatches (
+  VOID
+  );
+
 
 /**
   Report status code into DataHub.